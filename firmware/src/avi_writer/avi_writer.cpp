@@ -0,0 +1,339 @@
+#include "avi_writer.h"
+#include "../configuration/config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define AVIF_HASINDEX 0x10
+#define AVIIF_KEYFRAME 0x10
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void putChunk(uint8_t *p, const char *fourcc, uint32_t size)
+{
+    memcpy(p, fourcc, 4);
+    put32(p + 4, size);
+}
+
+AviWriter::AviWriter()
+    : file(nullptr), width(0), height(0), buffer(nullptr), buffered(0), fileSize(0), failed(false),
+      index(nullptr), maxFrames(0), frameCount(0), maxFrameSize(0), firstTimestamp(0), lastTimestamp(0)
+{
+}
+
+AviWriter::~AviWriter()
+{
+    release();
+}
+
+bool AviWriter::begin(StorageFile *f, uint16_t w, uint16_t h, uint32_t frames)
+{
+    release();
+
+    buffer = (uint8_t *)malloc(RECORDER_WRITE_BUFFER);
+    index = (AviIndexEntry *)malloc(sizeof(AviIndexEntry) * frames);
+    if (!buffer || !index)
+    {
+        release();
+        return false;
+    }
+
+    file = f;
+    width = w;
+    height = h;
+    maxFrames = frames;
+    frameCount = 0;
+    maxFrameSize = 0;
+    buffered = 0;
+    fileSize = 0;
+    failed = false;
+
+    // Cabecera provisional: se reescribe con los totales en finish()
+    uint8_t header[AVI_HEADER_SIZE];
+    buildHeader(header, AVI_HEADER_SIZE);
+    append(header, sizeof(header));
+    return !failed;
+}
+
+bool AviWriter::addFrame(const uint8_t *jpeg, size_t len, uint32_t timestampMs)
+{
+    if (!file || failed || frameCount >= maxFrames)
+        return false;
+
+    if (frameCount == 0)
+        firstTimestamp = timestampMs;
+    lastTimestamp = timestampMs;
+
+    index[frameCount].offset = fileSize - AVI_MOVI_FOURCC_POS;
+    index[frameCount].size = len;
+    frameCount++;
+    if (len > maxFrameSize)
+        maxFrameSize = len;
+
+    uint8_t chunk[8];
+    putChunk(chunk, "00dc", len);
+    append(chunk, sizeof(chunk));
+    append(jpeg, len);
+    if (len & 1)
+    {
+        static const uint8_t pad = 0;
+        append(&pad, 1);
+    }
+    return !failed;
+}
+
+void AviWriter::append(const uint8_t *data, size_t len)
+{
+    while (len > 0 && !failed)
+    {
+        // Con el buffer vacío la posición del fichero está alineada: los
+        // sectores completos van directos desde el origen sin copiarse
+        if (buffered == 0 && len >= RECORDER_WRITE_BUFFER)
+        {
+            size_t direct = len - len % RECORDER_SECTOR_SIZE;
+            if (file->write(data, direct) != direct)
+            {
+                failed = true;
+                return;
+            }
+            data += direct;
+            len -= direct;
+            fileSize += direct;
+            continue;
+        }
+
+        size_t n = RECORDER_WRITE_BUFFER - buffered;
+        if (n > len)
+            n = len;
+        memcpy(buffer + buffered, data, n);
+        buffered += n;
+        fileSize += n;
+        data += n;
+        len -= n;
+
+        if (buffered == RECORDER_WRITE_BUFFER)
+            flush();
+    }
+}
+
+bool AviWriter::flush()
+{
+    if (buffered > 0 && !failed)
+    {
+        if (file->write(buffer, buffered) != buffered)
+            failed = true;
+        buffered = 0;
+    }
+    return !failed;
+}
+
+bool AviWriter::finish()
+{
+    if (!file)
+        return false;
+
+    // idx1: una entrada de 16 bytes por frame, offsets desde 'movi'
+    uint32_t moviEnd = fileSize;
+    uint8_t entry[16];
+    putChunk(entry, "idx1", frameCount * 16);
+    append(entry, 8);
+    for (uint32_t i = 0; i < frameCount && !failed; i++)
+    {
+        memcpy(entry, "00dc", 4);
+        put32(entry + 4, AVIIF_KEYFRAME);
+        put32(entry + 8, index[i].offset);
+        put32(entry + 12, index[i].size);
+        append(entry, sizeof(entry));
+    }
+    flush();
+
+    // Cabecera definitiva: un sector completo en la posición 0
+    uint8_t header[AVI_HEADER_SIZE];
+    buildHeader(header, moviEnd);
+    bool ok = !failed && file->seek(0) && file->write(header, sizeof(header)) == sizeof(header);
+
+    file->close();
+    file = nullptr;
+    release();
+    return ok;
+}
+
+void AviWriter::buildHeader(uint8_t *out, uint32_t moviEnd)
+{
+    memset(out, 0, AVI_HEADER_SIZE);
+
+    // Intervalo real medido entre el primer y el último frame
+    uint32_t usPerFrame = 100000;
+    if (frameCount > 1 && lastTimestamp > firstTimestamp)
+        usPerFrame = (uint32_t)((uint64_t)(lastTimestamp - firstTimestamp) * 1000 / (frameCount - 1));
+    if (usPerFrame == 0)
+        usPerFrame = 1;
+
+    putChunk(out, "RIFF", (fileSize > 8 ? fileSize : AVI_HEADER_SIZE) - 8);
+    memcpy(out + 8, "AVI ", 4);
+
+    putChunk(out + 12, "LIST", 192);
+    memcpy(out + 20, "hdrl", 4);
+
+    // avih (MainAVIHeader)
+    putChunk(out + 24, "avih", 56);
+    uint8_t *avih = out + 32;
+    put32(avih + 0, usPerFrame);
+    put32(avih + 4, (uint32_t)((uint64_t)maxFrameSize * 1000000 / usPerFrame));
+    put32(avih + 12, AVIF_HASINDEX);
+    put32(avih + 16, frameCount);
+    put32(avih + 24, 1); // Streams
+    put32(avih + 28, maxFrameSize);
+    put32(avih + 32, width);
+    put32(avih + 36, height);
+
+    putChunk(out + 88, "LIST", 116);
+    memcpy(out + 96, "strl", 4);
+
+    // strh (AVIStreamHeader): dwScale/dwRate = segundos por frame exactos
+    putChunk(out + 100, "strh", 56);
+    uint8_t *strh = out + 108;
+    memcpy(strh + 0, "vids", 4);
+    memcpy(strh + 4, "MJPG", 4);
+    put32(strh + 20, usPerFrame);
+    put32(strh + 24, 1000000);
+    put32(strh + 32, frameCount);
+    put32(strh + 36, maxFrameSize);
+    put32(strh + 40, 0xFFFFFFFF); // Calidad por defecto
+    put16(strh + 52, width);
+    put16(strh + 54, height);
+
+    // strf (BITMAPINFOHEADER)
+    putChunk(out + 164, "strf", 40);
+    uint8_t *strf = out + 172;
+    put32(strf + 0, 40);
+    put32(strf + 4, width);
+    put32(strf + 8, height);
+    put16(strf + 12, 1);
+    put16(strf + 14, 24);
+    memcpy(strf + 16, "MJPG", 4);
+    put32(strf + 20, (uint32_t)width * height * 3);
+
+    // Relleno hasta que los datos de 'movi' empiezan en AVI_HEADER_SIZE
+    putChunk(out + 212, "JUNK", AVI_MOVI_FOURCC_POS - 8 - 220);
+
+    putChunk(out + AVI_MOVI_FOURCC_POS - 8, "LIST", moviEnd - AVI_MOVI_FOURCC_POS);
+    memcpy(out + AVI_MOVI_FOURCC_POS, "movi", 4);
+}
+
+void AviWriter::release()
+{
+    free(buffer);
+    free(index);
+    buffer = nullptr;
+    index = nullptr;
+    buffered = 0;
+}
+
+bool AviWriter::isOpen() const { return file != nullptr; }
+bool AviWriter::isFull() const { return frameCount >= maxFrames; }
+uint16_t AviWriter::getWidth() const { return width; }
+uint16_t AviWriter::getHeight() const { return height; }
+uint32_t AviWriter::getFrameCount() const { return frameCount; }
+uint32_t AviWriter::getFileSize() const { return fileSize; }
+
+AviReader::AviReader()
+    : file(nullptr), moviPos(0), indexPos(0), frameCount(0), usPerFrame(0), width(0), height(0)
+{
+}
+
+bool AviReader::open(StorageFile *f)
+{
+    file = f;
+    moviPos = 0;
+    indexPos = 0;
+    frameCount = 0;
+
+    uint8_t head[12];
+    if (!file->seek(0) || file->read(head, 12) != 12 ||
+        memcmp(head, "RIFF", 4) != 0 || memcmp(head + 8, "AVI ", 4) != 0)
+    {
+        return false;
+    }
+
+    // Recorrer los chunks de primer nivel: hdrl, movi, idx1
+    uint32_t fileLen = file->size();
+    uint32_t pos = 12;
+    while (pos + 12 <= fileLen)
+    {
+        if (!file->seek(pos) || file->read(head, 12) != 12)
+            return false;
+        uint32_t size = get32(head + 4);
+
+        if (memcmp(head, "LIST", 4) == 0 && memcmp(head + 8, "hdrl", 4) == 0)
+        {
+            uint8_t avih[8 + 56];
+            if (file->read(avih, sizeof(avih)) == sizeof(avih) && memcmp(avih, "avih", 4) == 0)
+            {
+                usPerFrame = get32(avih + 8);
+                width = get32(avih + 8 + 32);
+                height = get32(avih + 8 + 36);
+            }
+        }
+        else if (memcmp(head, "LIST", 4) == 0 && memcmp(head + 8, "movi", 4) == 0)
+        {
+            moviPos = pos + 8;
+        }
+        else if (memcmp(head, "idx1", 4) == 0)
+        {
+            indexPos = pos + 8;
+            frameCount = size / 16;
+        }
+
+        pos += 8 + size + (size & 1);
+    }
+
+    return moviPos > 0 && indexPos > 0;
+}
+
+bool AviReader::readEntry(uint32_t i, AviIndexEntry &entry)
+{
+    uint8_t raw[16];
+    if (!file || i >= frameCount || !file->seek(indexPos + i * 16) || file->read(raw, 16) != 16)
+        return false;
+    entry.offset = get32(raw + 8);
+    entry.size = get32(raw + 12);
+    return true;
+}
+
+uint32_t AviReader::getFrameSize(uint32_t i)
+{
+    AviIndexEntry entry;
+    return readEntry(i, entry) ? entry.size : 0;
+}
+
+size_t AviReader::readFrame(uint32_t i, uint8_t *buf, size_t bufSize)
+{
+    AviIndexEntry entry;
+    if (!readEntry(i, entry) || entry.size > bufSize)
+        return 0;
+    if (!file->seek(moviPos + entry.offset + 8))
+        return 0;
+    return file->read(buf, entry.size) == entry.size ? entry.size : 0;
+}
+
+uint32_t AviReader::getFrameCount() const { return frameCount; }
+uint32_t AviReader::getMicrosPerFrame() const { return usPerFrame; }
+uint16_t AviReader::getWidth() const { return width; }
+uint16_t AviReader::getHeight() const { return height; }
@@ -0,0 +1,90 @@
+#ifndef AVI_WRITER_H
+#define AVI_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../storage/storage.h"
+
+#define AVI_HEADER_SIZE 512 // Cabecera + JUNK: los frames empiezan alineados al sector
+#define AVI_MOVI_FOURCC_POS 508
+
+// Entrada del índice en memoria (se vuelca como idx1 al cerrar)
+struct AviIndexEntry
+{
+    uint32_t offset; // Desde el fourcc 'movi'
+    uint32_t size;
+};
+
+// Escritor AVI/MJPEG de un solo stream. Sin dependencias de Arduino para
+// poder probarlo en el host con PosixStorage
+class AviWriter
+{
+public:
+    AviWriter();
+    ~AviWriter();
+
+    // El escritor no es dueño del fichero: finish() lo deja cerrado
+    bool begin(StorageFile *file, uint16_t width, uint16_t height, uint32_t maxFrames);
+    bool addFrame(const uint8_t *jpeg, size_t len, uint32_t timestampMs);
+    bool finish(); // idx1 + cabecera definitiva
+
+    bool isOpen() const;
+    bool isFull() const;
+    uint16_t getWidth() const;
+    uint16_t getHeight() const;
+    uint32_t getFrameCount() const;
+    uint32_t getFileSize() const;
+
+private:
+    StorageFile *file;
+    uint16_t width;
+    uint16_t height;
+
+    // Escritura en bloques de sectores completos
+    uint8_t *buffer;
+    size_t buffered;
+    uint32_t fileSize; // Bytes emitidos (escritos + en buffer)
+    bool failed;
+
+    AviIndexEntry *index;
+    uint32_t maxFrames;
+    uint32_t frameCount;
+    uint32_t maxFrameSize;
+    uint32_t firstTimestamp;
+    uint32_t lastTimestamp;
+
+    void append(const uint8_t *data, size_t len);
+    bool flush();
+    void buildHeader(uint8_t *out, uint32_t moviEnd);
+    void release();
+};
+
+// Lectura de un AVI escrito por AviWriter (o cualquier AVI con idx1)
+class AviReader
+{
+public:
+    AviReader();
+
+    bool open(StorageFile *file); // Tampoco es dueño del fichero
+    uint32_t getFrameCount() const;
+    uint32_t getMicrosPerFrame() const;
+    uint16_t getWidth() const;
+    uint16_t getHeight() const;
+
+    uint32_t getFrameSize(uint32_t index);
+    // Lee el frame completo en buf; devuelve los bytes leídos (0 si falla)
+    size_t readFrame(uint32_t index, uint8_t *buf, size_t bufSize);
+
+private:
+    StorageFile *file;
+    uint32_t moviPos;
+    uint32_t indexPos;
+    uint32_t frameCount;
+    uint32_t usPerFrame;
+    uint16_t width;
+    uint16_t height;
+
+    bool readEntry(uint32_t index, AviIndexEntry &entry);
+};
+
+#endif
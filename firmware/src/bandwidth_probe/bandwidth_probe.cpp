@@ -0,0 +1,360 @@
+#include "bandwidth_probe.h"
+#include "../websocket_manager/websocket_manager.h"
+#include "../camera_manager/camera_manager.h"
+#include "../frame_sender/frame_sender.h"
+#include "../fps_controller/fps_controller.h"
+#include <Arduino.h>
+
+// Tamaño aproximado de frame (KB) por resolución RES_* con la calidad por
+// defecto; se recalibra con el último frame real antes de decidir
+static const uint16_t estimatedFrameKB[RES_QXGA + 1] = {
+    4, 5, 8, 12, 18, 40, 60, 100, 150, 200, 300, 400, 500};
+
+BandwidthProbe::BandwidthProbe(WebSocketManager *ws, CameraManager *cam, FrameSender *fs, FPSController *fps)
+    : wsManager(ws), camManager(cam), frameSender(fs), fpsController(fps),
+      pending(false), applyResult(true), durationMs(PROBE_DURATION_MS), probeId(0),
+      stepsRun(0), currentStep(0), saturated(false), reportReceived(false), pingSeq(0), rttMin(0), rttSum(0), rttCount(0)
+{
+    lastResult.valid = false;
+    lastResult.capped = false;
+}
+
+void BandwidthProbe::request(unsigned long duration, bool apply)
+{
+    durationMs = constrain(duration, (unsigned long)(PROBE_STEPS * 100), (unsigned long)PROBE_DURATION_MAX);
+    applyResult = apply;
+    pending = true;
+}
+
+bool BandwidthProbe::isPending() const
+{
+    return pending;
+}
+
+const ProbeResult &BandwidthProbe::getLastResult() const
+{
+    return lastResult;
+}
+
+void BandwidthProbe::run()
+{
+    pending = false;
+
+    if (!wsManager->isConnected())
+    {
+        Serial.println("[PROBE] ✗ Sin conexión WebSocket");
+        return;
+    }
+
+    uint8_t *packet = (uint8_t *)malloc(PROBE_PACKET_SIZE);
+    if (!packet)
+    {
+        Serial.println("[PROBE] ✗ Sin memoria para paquete de sonda");
+        return;
+    }
+    // Payload pseudoaleatorio: no comprimible por ningún intermediario
+    for (size_t i = sizeof(ProbeHeader); i < PROBE_PACKET_SIZE; i++)
+    {
+        packet[i] = (uint8_t)random(256);
+    }
+
+    probeId++;
+    stepsRun = 0;
+    currentStep = 0;
+    saturated = false;
+    reportReceived = false;
+    pingSeq = 0;
+    rttMin = 0;
+    rttSum = 0;
+    rttCount = 0;
+    memset(stepSent, 0, sizeof(stepSent));
+    memset(stepReceived, 0, sizeof(stepReceived));
+    memset(stepElapsed, 0, sizeof(stepElapsed));
+    memset(stepRttSum, 0, sizeof(stepRttSum));
+    memset(stepRttCount, 0, sizeof(stepRttCount));
+
+    unsigned long stepMs = durationMs / PROBE_STEPS;
+
+    Serial.printf("\n[PROBE] 📡 Sonda #%lu: hasta %d escalones x %lums\n", probeId, PROBE_STEPS_MAX, stepMs);
+
+    String start = "{\"type\":\"probe_start\",\"id\":" + String(probeId) +
+                   ",\"steps\":" + String(PROBE_STEPS_MAX) +
+                   ",\"stepMs\":" + String(stepMs) +
+                   ",\"packet\":" + String(PROBE_PACKET_SIZE) + "}";
+    wsManager->sendText(start);
+
+    // La tasa se dobla hasta que el enlace deja de seguirla o el RTT se
+    // dispara; el número de escalones solo lo limitan PROBE_STEPS_MAX y la
+    // duración máxima
+    uint32_t rate = PROBE_START_KBPS * 1024;
+    unsigned long probeStart = millis();
+    for (uint8_t step = 0; step < PROBE_STEPS_MAX; step++)
+    {
+        if (step > 0 && millis() - probeStart + stepMs > PROBE_DURATION_MAX)
+            break;
+
+        stepRate[step] = rate;
+        currentStep = step;
+        runStep(step, stepMs, packet);
+        stepsRun++;
+
+        float achieved = stepSent[step] * 1000.0f / max(stepElapsed[step], 1UL);
+        float rttAvg = stepRttCount[step] ? stepRttSum[step] / stepRttCount[step] : 0;
+        Serial.printf("[PROBE]    Escalón %d: objetivo %lu KB/s → %.1f KB/s | RTT %.1f ms\n",
+                      step, rate / 1024, achieved / 1024.0f, rttAvg);
+
+        // El enlace ya no sigue la tasa pedida o la cola crece: escalones
+        // mayores no aportan
+        if (achieved < rate * PROBE_SATURATION_PCT / 100.0f || isRttInflated(step))
+        {
+            saturated = true;
+            break;
+        }
+        rate *= 2;
+    }
+
+    free(packet);
+
+    String end = "{\"type\":\"probe_end\",\"id\":" + String(probeId) + ",\"sent\":[";
+    for (uint8_t i = 0; i < stepsRun; i++)
+    {
+        end += String(i ? "," : "") + String(stepSent[i]);
+    }
+    end += "]}";
+    wsManager->sendText(end);
+
+    if (!waitForReport())
+    {
+        Serial.println("[PROBE] ⏱️ Sin probe_report del servidor");
+        wsManager->sendText("{\"type\":\"probe_result\",\"valid\":false}");
+        return;
+    }
+
+    computeResult();
+    if (applyResult && lastResult.valid)
+    {
+        applyToStream();
+    }
+    sendResult();
+}
+
+void BandwidthProbe::runStep(uint8_t step, unsigned long stepMs, uint8_t *packet)
+{
+    ProbeHeader header;
+    header.magic = PROBE_MAGIC;
+    header.step = step;
+    header.reserved = 0;
+    header.probeId = probeId;
+
+    unsigned long start = millis();
+    unsigned long startUs = micros();
+    unsigned long lastPing = 0;
+    uint32_t seq = 0;
+
+    while (millis() - start < stepMs)
+    {
+        unsigned long now = millis();
+        if (now - lastPing >= PROBE_PING_INTERVAL)
+        {
+            sendPing();
+            lastPing = now;
+        }
+
+        // Bytes que deberían haber salido a esta tasa
+        uint64_t due = (uint64_t)stepRate[step] * (micros() - startUs) / 1000000ULL;
+        if (stepSent[step] < due)
+        {
+            header.seq = seq++;
+            memcpy(packet, &header, sizeof(ProbeHeader));
+            if (wsManager->sendBinary(packet, PROBE_PACKET_SIZE))
+            {
+                stepSent[step] += PROBE_PACKET_SIZE;
+            }
+        }
+        else
+        {
+            wsManager->loop(); // Recibir probe_pong
+            delay(1);
+        }
+    }
+
+    stepElapsed[step] = millis() - start;
+}
+
+bool BandwidthProbe::isRttInflated(uint8_t step) const
+{
+    if (stepRttCount[step] == 0 || rttCount == 0)
+        return false;
+
+    float avg = stepRttSum[step] / stepRttCount[step];
+    return avg > rttMin * PROBE_RTT_INFLATION && avg - rttMin > PROBE_RTT_INFLATION_MIN_MS;
+}
+
+void BandwidthProbe::sendPing()
+{
+    uint32_t seq = pingSeq++;
+    pingSentAt[seq % PING_SLOTS] = micros();
+    pingStep[seq % PING_SLOTS] = currentStep;
+    wsManager->sendText("{\"type\":\"probe_ping\",\"id\":" + String(probeId) +
+                        ",\"seq\":" + String(seq) + "}");
+}
+
+void BandwidthProbe::onPong(uint32_t id, uint32_t seq)
+{
+    // Descartar pongs ajenos o tan viejos que su slot ya se reutilizó
+    if (id != probeId || seq >= pingSeq || pingSeq - seq > PING_SLOTS)
+        return;
+
+    float rtt = (micros() - pingSentAt[seq % PING_SLOTS]) / 1000.0f;
+    if (rttCount == 0 || rtt < rttMin)
+        rttMin = rtt;
+    rttSum += rtt;
+    rttCount++;
+
+    uint8_t step = pingStep[seq % PING_SLOTS];
+    stepRttSum[step] += rtt;
+    stepRttCount[step]++;
+}
+
+void BandwidthProbe::onReport(uint32_t id, const uint32_t *received, size_t count)
+{
+    if (id != probeId)
+        return;
+
+    for (size_t i = 0; i < count && i < PROBE_STEPS_MAX; i++)
+    {
+        stepReceived[i] = received[i];
+    }
+    reportReceived = true;
+}
+
+bool BandwidthProbe::waitForReport()
+{
+    unsigned long start = millis();
+    while (!reportReceived && millis() - start < PROBE_REPORT_TIMEOUT)
+    {
+        wsManager->loop();
+        delay(DELAY_WS_PROCESSING);
+    }
+    return reportReceived;
+}
+
+void BandwidthProbe::computeResult()
+{
+    uint32_t totalSent = 0;
+    uint32_t totalReceived = 0;
+    float best = 0;
+
+    for (uint8_t i = 0; i < stepsRun; i++)
+    {
+        totalSent += stepSent[i];
+        totalReceived += min(stepReceived[i], stepSent[i]);
+
+        float goodput = min(stepReceived[i], stepSent[i]) * 1000.0f / max(stepElapsed[i], 1UL);
+        if (goodput > best)
+            best = goodput;
+    }
+
+    lastResult.valid = totalSent > 0 && totalReceived > 0;
+    lastResult.throughputKBps = best / 1024.0f;
+    lastResult.rttMinMs = rttMin;
+    lastResult.rttAvgMs = rttCount ? rttSum / rttCount : 0;
+    lastResult.lossPct = totalSent ? 100.0f * (totalSent - totalReceived) / totalSent : 0;
+
+    // Tope alcanzado sin saturar y sin pérdida en el último escalón: el
+    // enlace da al menos esto, pero no se sabe cuánto más
+    uint8_t top = stepsRun - 1;
+    lastResult.capped = !saturated && stepsRun > 0 &&
+                        stepReceived[top] >= stepSent[top] * (uint64_t)PROBE_SATURATION_PCT / 100;
+    lastResult.timestamp = millis();
+
+    Serial.printf("[PROBE] ✅ Throughput: %s%.1f KB/s | RTT: %.1f/%.1f ms | Pérdida: %.1f%%\n",
+                  lastResult.capped ? "≥" : "", lastResult.throughputKBps, lastResult.rttMinMs,
+                  lastResult.rttAvgMs, lastResult.lossPct);
+}
+
+void BandwidthProbe::applyToStream()
+{
+    // 1. Pacing del FrameSender a un margen por debajo del enlace medido. Una
+    // medición que no llegó a saturar es solo un mínimo: limitar a ella el
+    // pacing, la resolución o la calidad frenaría un enlace más rápido
+    uint32_t budget = lastResult.throughputKBps * 1024;
+    if (lastResult.capped)
+    {
+        Serial.println("[PROBE] ⚠️ Sonda sin saturar: pacing desactivado, resolución y calidad sin cambios");
+        frameSender->setPacingRate(0);
+        return;
+    }
+    frameSender->setPacingRate(budget * PROBE_PACING_PCT / 100);
+
+    float usable = budget * PROBE_UTILIZATION_PCT / 100.0f;
+    int fps = fpsController->getFPS();
+    float needed;
+
+    if (camManager->isRoiActive())
+    {
+        // 2. La ventana ROI se respeta: solo cuenta su tamaño real de frame
+        needed = (float)frameSender->getLastFrameSize() * fps;
+    }
+    else
+    {
+        // 2. Resolución/calidad inicial que cabe en el enlace al FPS objetivo
+        int currentRes = camManager->getResolutionIndex();
+        float scale = 1.0f;
+        if (frameSender->getLastFrameSize() > 0 && currentRes >= 0)
+        {
+            scale = (float)frameSender->getLastFrameSize() / (estimatedFrameKB[currentRes] * 1024.0f);
+        }
+
+        // Se sube como mucho hasta UXGA, pero una resolución mayor elegida a
+        // mano se mantiene si cabe
+        int chosen = RES_QQVGA;
+        for (int res = max(currentRes, (int)RES_UXGA); res >= RES_QQVGA; res--)
+        {
+            if (estimatedFrameKB[res] * 1024.0f * scale * fps <= usable)
+            {
+                chosen = res;
+                break;
+            }
+        }
+
+        if (chosen != currentRes)
+        {
+            Serial.printf("[PROBE] 📐 Resolución sugerida: %d\n", chosen);
+            camManager->changeResolution(chosen);
+        }
+        needed = estimatedFrameKB[chosen] * 1024.0f * scale * fps;
+    }
+
+    // 3. Ni la menor resolución (o la ROI) cabe: bajar calidad proporcionalmente
+    if (needed > usable)
+    {
+        int quality = camManager->getCurrentQuality() * needed / usable;
+        camManager->setQuality(min(quality, MAX_QUALITY));
+    }
+}
+
+void BandwidthProbe::sendResult()
+{
+    String json = "{\"type\":\"probe_result\",\"id\":" + String(probeId) +
+                  ",\"valid\":" + String(lastResult.valid ? "true" : "false") +
+                  ",\"throughput\":" + String(lastResult.throughputKBps, 1) +
+                  ",\"rttMin\":" + String(lastResult.rttMinMs, 1) +
+                  ",\"rttAvg\":" + String(lastResult.rttAvgMs, 1) +
+                  ",\"loss\":" + String(lastResult.lossPct, 1) +
+                  ",\"capped\":" + String(lastResult.capped ? "true" : "false") +
+                  ",\"applied\":" + String(applyResult ? "true" : "false") +
+                  ",\"resolution\":" + String(camManager->getResolutionIndex()) +
+                  ",\"quality\":" + String(camManager->getCurrentQuality()) + ",\"steps\":[";
+
+    for (uint8_t i = 0; i < stepsRun; i++)
+    {
+        json += String(i ? "," : "") + "{\"rate\":" + String(stepRate[i] / 1024) +
+                ",\"sent\":" + String(stepSent[i]) +
+                ",\"received\":" + String(stepReceived[i]) +
+                ",\"ms\":" + String(stepElapsed[i]) + "}";
+    }
+    json += "]}";
+
+    wsManager->sendText(json);
+}
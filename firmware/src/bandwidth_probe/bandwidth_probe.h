@@ -0,0 +1,93 @@
+#ifndef BANDWIDTH_PROBE_H
+#define BANDWIDTH_PROBE_H
+
+#include <Arduino.h>
+#include "../configuration/config.h"
+
+// Forward declarations
+class WebSocketManager;
+class CameraManager;
+class FrameSender;
+class FPSController;
+
+// Cabecera de cada paquete sintético (little-endian)
+struct __attribute__((packed)) ProbeHeader
+{
+    uint8_t magic; // PROBE_MAGIC
+    uint8_t step;  // Escalón de tasa
+    uint16_t reserved;
+    uint32_t probeId;
+    uint32_t seq;
+};
+
+struct ProbeResult
+{
+    bool valid;
+    float throughputKBps; // Máximo sostenido sin saturar
+    float rttMinMs;       // RTT en reposo
+    float rttAvgMs;       // RTT bajo carga
+    float lossPct;        // Bytes no entregados al final de la sonda
+    bool capped;          // Sin saturar al llegar al tope: throughput es solo un mínimo
+    unsigned long timestamp;
+};
+
+class BandwidthProbe
+{
+public:
+    BandwidthProbe(WebSocketManager *ws, CameraManager *cam, FrameSender *fs, FPSController *fps);
+
+    // Solicitud desde CommandProcessor; se ejecuta en el loop principal
+    void request(unsigned long durationMs, bool apply);
+    bool isPending() const;
+    void run();
+
+    // Respuestas del probe sink del servidor
+    void onPong(uint32_t probeId, uint32_t seq);
+    void onReport(uint32_t probeId, const uint32_t *received, size_t count);
+
+    const ProbeResult &getLastResult() const;
+
+private:
+    WebSocketManager *wsManager;
+    CameraManager *camManager;
+    FrameSender *frameSender;
+    FPSController *fpsController;
+
+    bool pending;
+    bool applyResult;
+    unsigned long durationMs;
+    uint32_t probeId;
+
+    // Medición en curso
+    uint32_t stepRate[PROBE_STEPS_MAX]; // bytes/s objetivo
+    uint32_t stepSent[PROBE_STEPS_MAX];
+    uint32_t stepReceived[PROBE_STEPS_MAX];
+    unsigned long stepElapsed[PROBE_STEPS_MAX]; // ms reales
+    float stepRttSum[PROBE_STEPS_MAX];
+    uint16_t stepRttCount[PROBE_STEPS_MAX];
+    uint8_t stepsRun;
+    uint8_t currentStep;
+    bool saturated; // La última tasa ya no se sostuvo (envío o RTT)
+    bool reportReceived;
+
+    // RTT (probe_ping / probe_pong)
+    static const int PING_SLOTS = 32;
+    unsigned long pingSentAt[PING_SLOTS];
+    uint8_t pingStep[PING_SLOTS];
+    uint32_t pingSeq;
+    float rttMin;
+    float rttSum;
+    uint16_t rttCount;
+
+    ProbeResult lastResult;
+
+    void runStep(uint8_t step, unsigned long stepMs, uint8_t *packet);
+    bool isRttInflated(uint8_t step) const;
+    void sendPing();
+    bool waitForReport();
+    void computeResult();
+    void applyToStream();
+    void sendResult();
+};
+
+#endif
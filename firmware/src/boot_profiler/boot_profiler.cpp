@@ -0,0 +1,92 @@
+#include "boot_profiler.h"
+#include "../websocket_manager/websocket_manager.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// Las etapas de la cámara se marcan desde su propia tarea
+static portMUX_TYPE bootLock = portMUX_INITIALIZER_UNLOCKED;
+
+BootProfiler::BootProfiler(WebSocketManager *ws)
+    : wsManager(ws), stageCount(0), complete(false)
+{
+}
+
+void BootProfiler::mark(const char *stage)
+{
+    if (complete)
+        return;
+
+    // esp_timer arranca con la aplicación: el tiempo del bootloader no cuenta
+    uint32_t ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    portENTER_CRITICAL(&bootLock);
+    if (stageCount < BOOT_MAX_STAGES)
+    {
+        stages[stageCount].name = stage;
+        stages[stageCount].ms = ms;
+        stageCount++;
+    }
+    portEXIT_CRITICAL(&bootLock);
+
+    Serial.printf("[BOOT] ⏱️ %-14s %5lums\n", stage, (unsigned long)ms);
+}
+
+void BootProfiler::markOnce(const char *stage)
+{
+    if (!complete && !hasStage(stage))
+        mark(stage);
+}
+
+bool BootProfiler::hasStage(const char *stage)
+{
+    for (int i = 0; i < stageCount; i++)
+    {
+        if (strcmp(stages[i].name, stage) == 0)
+            return true;
+    }
+    return false;
+}
+
+void BootProfiler::onFirstFrameAck()
+{
+    if (complete)
+        return;
+
+    mark("first_ack");
+    complete = true;
+
+    printTimeline();
+    wsManager->sendText("{\"type\":\"boot_timeline\"," + getTimelineJson() + "}");
+}
+
+bool BootProfiler::isComplete() const
+{
+    return complete;
+}
+
+String BootProfiler::getTimelineJson()
+{
+    uint32_t total = stageCount > 0 ? stages[stageCount - 1].ms : 0;
+
+    String json = "\"boot\":{\"totalMs\":" + String(total) + ",\"stages\":[";
+    for (int i = 0; i < stageCount; i++)
+    {
+        if (i > 0)
+            json += ",";
+        json += "[\"" + String(stages[i].name) + "\"," + String(stages[i].ms) + "]";
+    }
+    json += "]}";
+    return json;
+}
+
+void BootProfiler::printTimeline()
+{
+    Serial.println("\n[BOOT] 📊 Arranque hasta el primer frame confirmado:");
+    uint32_t previous = 0;
+    for (int i = 0; i < stageCount; i++)
+    {
+        Serial.printf("[BOOT]   %-14s %5lums  (+%lums)\n", stages[i].name,
+                      (unsigned long)stages[i].ms, (unsigned long)(stages[i].ms - previous));
+        previous = stages[i].ms;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef BOOT_PROFILER_H
+#define BOOT_PROFILER_H
+
+#include <Arduino.h>
+#include "../configuration/config.h"
+
+// Forward declarations
+class WebSocketManager;
+
+// Etapa del arranque con su instante desde el reset (esp_timer, ms)
+struct BootStage
+{
+    const char *name;
+    uint32_t ms;
+};
+
+// Línea de tiempo del arranque: desde el reset hasta que el servidor confirma
+// el primer frame. Las etapas pueden marcarse desde varias tareas (la cámara
+// se inicializa en paralelo con el WiFi).
+class BootProfiler
+{
+public:
+    BootProfiler(WebSocketManager *ws);
+
+    void mark(const char *stage);
+    void markOnce(const char *stage);
+
+    // Primer frame confirmado por el servidor: cierra y envía la línea de tiempo
+    void onFirstFrameAck();
+    bool isComplete() const;
+
+    String getTimelineJson();
+
+private:
+    WebSocketManager *wsManager;
+
+    BootStage stages[BOOT_MAX_STAGES];
+    volatile int stageCount;
+    bool complete;
+
+    bool hasStage(const char *stage);
+    void printTimeline();
+};
+
+#endif
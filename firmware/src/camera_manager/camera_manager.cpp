@@ -1,14 +1,95 @@
 #include "camera_manager.h"
+#include "../jpeg_utils/jpeg_utils.h"
 #include <Arduino.h>
 
 CameraManager::CameraManager()
-    : currentResolution(FRAMESIZE_XGA), currentQuality(DEFAULT_QUALITY)
+    : currentResolution(FRAMESIZE_XGA), currentQuality(DEFAULT_QUALITY), restartMarkers(false),
+      restartSavedH(-1), restartSavedL(-1), xclkHz(CAMERA_XCLK_HZ), fbCount(CAMERA_FB_COUNT), grabMode(CAMERA_GRAB_MODE),
+      softRecoveries(0), hardRecoveries(0), failedRecoveries(0), lastRecoveryTier("none"), lastRecoveryMs(0),
+      switchPending(false), switchRes(-1), switchWidth(0), switchHeight(0), switchFromRes(-1), switchStart(0),
+      lastSwitchMs(0), switchesFailed(0), roiActive(false), roiPrevRes(-1), hasStartupSettings(false)
 {
+    memset(resStates, 0, sizeof(resStates));
+    memset(&roi, 0, sizeof(roi));
+    memset(&startupSettings, 0, sizeof(startupSettings));
 }
 
 bool CameraManager::init()
 {
-    return initCamera();
+    // Configuración medida por sensorbench (si se aplicó alguna)
+    preferences.begin("camera", true);
+    xclkHz = preferences.getInt("xclk", CAMERA_XCLK_HZ);
+    fbCount = preferences.getInt("fbc", CAMERA_FB_COUNT);
+    grabMode = (camera_grab_mode_t)preferences.getInt("grab", CAMERA_GRAB_MODE);
+    preferences.end();
+
+    if (initCamera())
+    {
+        return true;
+    }
+
+    // Una configuración guardada que no arranca no debe dejar la cámara muerta
+    if (xclkHz != CAMERA_XCLK_HZ || fbCount != CAMERA_FB_COUNT || grabMode != CAMERA_GRAB_MODE)
+    {
+        Serial.println("[CAM] ⚠️ Configuración guardada falló - usando valores por defecto");
+        xclkHz = CAMERA_XCLK_HZ;
+        fbCount = CAMERA_FB_COUNT;
+        grabMode = CAMERA_GRAB_MODE;
+        return initCamera();
+    }
+    return false;
+}
+
+bool CameraManager::reconfigure(int newXclkHz, int newFbCount, camera_grab_mode_t newGrabMode)
+{
+    int oldXclkHz = xclkHz;
+    int oldFbCount = fbCount;
+    camera_grab_mode_t oldGrabMode = grabMode;
+
+    esp_camera_deinit();
+    xclkHz = newXclkHz;
+    fbCount = newFbCount;
+    grabMode = newGrabMode;
+    if (initCamera())
+    {
+        return true;
+    }
+
+    Serial.printf("[CAM] ✗ XCLK %dMHz / %d buffers no arranca - restaurando\n",
+                  newXclkHz / 1000000, newFbCount);
+    esp_camera_deinit();
+    xclkHz = oldXclkHz;
+    fbCount = oldFbCount;
+    grabMode = oldGrabMode;
+    initCamera();
+    return false;
+}
+
+bool CameraManager::saveSensorConfig()
+{
+    preferences.begin("camera", false);
+    preferences.putInt("xclk", xclkHz);
+    preferences.putInt("fbc", fbCount);
+    preferences.putInt("grab", (int)grabMode);
+    preferences.end();
+    Serial.printf("[CAM] 💾 Guardado: XCLK %dMHz, %d buffers, %s\n", xclkHz / 1000000, fbCount,
+                  grabMode == CAMERA_GRAB_LATEST ? "latest" : "when_empty");
+    return true;
+}
+
+int CameraManager::getXclkHz()
+{
+    return xclkHz;
+}
+
+int CameraManager::getFbCount()
+{
+    return fbCount;
+}
+
+camera_grab_mode_t CameraManager::getGrabMode()
+{
+    return grabMode;
 }
 
 bool CameraManager::initCamera()
@@ -32,12 +113,14 @@ bool CameraManager::initCamera()
     config.pin_sccb_scl = SIOC_GPIO_NUM;
     config.pin_pwdn = PWDN_GPIO_NUM;
     config.pin_reset = RESET_GPIO_NUM;
-    config.xclk_freq_hz = 10000000;
+    config.xclk_freq_hz = xclkHz;
     config.pixel_format = PIXFORMAT_JPEG;
-    config.frame_size = currentResolution;
+    // Buffers JPEG dimensionados para el perfil más grande (snapshots)
+    framesize_t bufferResolution = mapResolution(CAMERA_FB_MAX_RES);
+    config.frame_size = currentResolution > bufferResolution ? currentResolution : bufferResolution;
     config.jpeg_quality = currentQuality;
-    config.fb_count = 2;
-    config.grab_mode = CAMERA_GRAB_WHEN_EMPTY;
+    config.fb_count = fbCount;
+    config.grab_mode = grabMode;
     config.fb_location = CAMERA_FB_IN_PSRAM;
 
     esp_err_t err = esp_camera_init(&config);
@@ -52,24 +135,48 @@ bool CameraManager::initCamera()
     {
         delay(DELAY_CAMERA_STABILIZATION); // Espera inicial
         s->set_framesize(s, currentResolution);
+        if (roiActive)
+        {
+            applyRoi();
+        }
+        switchPending = false; // El calentamiento ya arranca en la resolución actual
         
-        // Habilitar controles automáticos para mejor adaptación inicial
-        s->set_exposure_ctrl(s, 1);
-        s->set_gain_ctrl(s, 1);
-        s->set_whitebal(s, 1);
+        // Habilitar controles automáticos para mejor adaptación inicial,
+        // salvo que el preset de arranque diga otra cosa
+        bool startup = hasStartupSettings;
+        s->set_exposure_ctrl(s, startup ? startupSettings.exposure : 1);
+        s->set_gain_ctrl(s, startup ? startupSettings.gain : 1);
+        s->set_whitebal(s, startup ? startupSettings.whiteBalance : 1);
+
+        // Resto del preset antes del calentamiento: el AEC/AGC converge
+        // ya con los ajustes definitivos
+        if (startup)
+        {
+            s->set_brightness(s, startupSettings.brightness);
+            s->set_contrast(s, startupSettings.contrast);
+            s->set_hmirror(s, startupSettings.hmirror);
+            s->set_vflip(s, startupSettings.vflip);
+            hasStartupSettings = false;
+        }
 
         // === WARMUP (CALENTAMIENTO) ===
         // Capturar y descartar frames para que el AEC/AGC se estabilicen
         Serial.println("[CAM] 🔥 Iniciando secuencia de calentamiento...");
-        for (int i = 0; i < 5; i++) {
+        // (esp_camera_fb_get ya espera al siguiente frame: sin pausas extra)
+        for (int i = 0; i < CAMERA_WARMUP_FRAMES; i++) {
             camera_fb_t *fb = esp_camera_fb_get();
             if (fb) {
                 esp_camera_fb_return(fb);
                 // Serial.printf("[CAM] Warmup frame %d\n", i+1);
             }
-            delay(100); // Pequeña pausa entre frames
         }
         Serial.println("[CAM] ✅ Calentamiento completado");
+
+        // Tras un reset del sensor el intervalo de reinicio se pierde
+        if (restartMarkers)
+        {
+            applyRestartInterval();
+        }
     }
     return true;
 }
@@ -112,10 +219,24 @@ framesize_t CameraManager::mapResolution(int resValue)
 bool CameraManager::resetSensor()
 {
     /**
-     * Reset completo del sensor de cámara
-     * Útil cuando el sensor queda en estado corrupto
+     * Reset del sensor por niveles:
+     *  1. Suave: reset por SCCB y reprogramación, con el driver, el DMA y
+     *     los buffers de PSRAM intactos
+     *  2. Completo: esp_camera_deinit + initCamera (realoca los buffers)
      */
     Serial.println("\n[CAM] 🔄 RESETEANDO SENSOR...");
+    unsigned long start = millis();
+
+    if (softRecover())
+    {
+        softRecoveries++;
+        lastRecoveryTier = "soft";
+        lastRecoveryMs = millis() - start;
+        Serial.printf("[CAM] ✅ Sensor recuperado (SCCB) en %lums\n", lastRecoveryMs);
+        return true;
+    }
+
+    Serial.println("[CAM] ⚠️ Reset SCCB insuficiente - reinicio completo del driver");
 
     // 1. Deinicializar cámara
     esp_err_t err = esp_camera_deinit();
@@ -125,25 +246,119 @@ bool CameraManager::resetSensor()
     }
 
     // 2. Esperar a que se liberen recursos
-    delay(500);
+    delay(RECOVERY_HARD_DELAY_MS);
 
     // 3. Reinicializar
     bool success = initCamera();
+    lastRecoveryMs = millis() - start;
 
     if (success)
     {
-        Serial.println("[CAM] ✅ Sensor reseteado correctamente");
+        hardRecoveries++;
+        lastRecoveryTier = "hard";
+        Serial.printf("[CAM] ✅ Sensor reseteado correctamente en %lums\n", lastRecoveryMs);
     }
     else
     {
+        failedRecoveries++;
+        lastRecoveryTier = "failed";
         Serial.println("[CAM] ❌ Error reseteando sensor");
     }
 
     return success;
 }
 
+bool CameraManager::softRecover()
+{
+    sensor_t *s = esp_camera_sensor_get();
+    if (!s || !s->reset)
+    {
+        return false;
+    }
+
+    // El reset devuelve los registros a sus valores por defecto: guardar
+    // los ajustes actuales para reprogramarlos después
+    camera_status_t saved = s->status;
+
+    if (s->reset(s) != 0)
+    {
+        return false;
+    }
+
+    s->set_pixformat(s, PIXFORMAT_JPEG);
+    s->set_framesize(s, currentResolution);
+    if (roiActive)
+    {
+        applyRoi();
+    }
+    s->set_quality(s, currentQuality);
+    s->set_brightness(s, saved.brightness);
+    s->set_contrast(s, saved.contrast);
+    s->set_saturation(s, saved.saturation);
+    s->set_exposure_ctrl(s, saved.aec);
+    s->set_gain_ctrl(s, saved.agc);
+    s->set_whitebal(s, saved.awb);
+    s->set_hmirror(s, saved.hmirror);
+    s->set_vflip(s, saved.vflip);
+
+    if (!waitForValidFrame(RECOVERY_SOFT_TIMEOUT_MS))
+    {
+        return false;
+    }
+
+    // Tras un reset del sensor el intervalo de reinicio se pierde
+    if (restartMarkers)
+    {
+        applyRestartInterval();
+    }
+    return true;
+}
+
+bool CameraManager::waitForValidFrame(unsigned long timeoutMs)
+{
+    // esp_camera_fb_get() no se puede interrumpir y bloquea hasta su propio
+    // timeout (~4 s) si el sensor no entrega: el plazo se comprueba entre
+    // llamadas, así que el peor caso es timeoutMs + un timeout del driver
+    unsigned long start = millis();
+
+    // Los buffers llenos pueden contener frames anteriores al reset
+    for (int i = 0; i < fbCount && millis() - start < timeoutMs; i++)
+    {
+        camera_fb_t *fb = esp_camera_fb_get();
+        if (!fb)
+            return false; // El driver ya agotó su timeout: el sensor no entrega
+        esp_camera_fb_return(fb);
+    }
+
+    while (millis() - start < timeoutMs)
+    {
+        camera_fb_t *fb = esp_camera_fb_get();
+        if (!fb)
+            continue;
+
+        bool valid = fb->len >= 1000 && fb->buf[0] == 0xFF && fb->buf[1] == 0xD8 && !isFrameBlack(fb);
+        esp_camera_fb_return(fb);
+        if (valid)
+            return true;
+    }
+    return false;
+}
+
+String CameraManager::getRecoveryJson()
+{
+    return "\"recoveries\":{\"soft\":" + String(softRecoveries) +
+           ",\"hard\":" + String(hardRecoveries) +
+           ",\"failed\":" + String(failedRecoveries) +
+           ",\"last\":\"" + String(lastRecoveryTier) + "\"" +
+           ",\"lastMs\":" + String(lastRecoveryMs) + "}";
+}
+
 bool CameraManager::changeResolution(int resValue)
 {
+    if (resValue < RES_QQVGA || resValue > RES_QXGA)
+    {
+        return false;
+    }
     framesize_t newResolution = mapResolution(resValue);
 
     // ADVERTENCIA para resoluciones peligrosas
@@ -158,53 +373,41 @@ bool CameraManager::changeResolution(int resValue)
 
     sensor_t *s = esp_camera_sensor_get();
 
-    if (s && newResolution != currentResolution)
+    // Salir de la ROI siempre reprograma la ventana completa, aunque la
+    // resolución coincida con la usada para recortar
+    bool leavingRoi = roiActive;
+
+    if (s && (newResolution != currentResolution || leavingRoi))
     {
         Serial.printf("[CAM] Cambiando resolución de %d a %d\n",
                       currentResolution, resValue);
 
-        // Intentar cambio normal
+        // Sin delays ni capturas de prueba: el sensor aplica el cambio en el
+        // siguiente inicio de frame y captureFrame valida el primer frame real
+        // con las dimensiones nuevas
         esp_err_t err = s->set_framesize(s, newResolution);
 
         if (err == ESP_OK)
         {
-            framesize_t oldResolution = currentResolution;
-            currentResolution = newResolution;
-
-            // Delay adaptativo según resolución
-            int stabilizationDelay = DELAY_CAMERA_STABILIZATION;
-            if (resValue >= RES_FHD)
+            // Si el cambio anterior no llegó a validarse, se vuelve al último válido
+            if (!switchPending)
             {
-                stabilizationDelay = 300; // 3x más delay para resoluciones altas
-                Serial.printf("[CAM] 🐢 Delay extendido: %dms\n", stabilizationDelay);
+                switchFromRes = leavingRoi ? roiPrevRes : getResolutionIndex();
             }
-            delay(stabilizationDelay);
-
-            // VALIDAR que el cambio funcionó
-            bool validated = validateResolutionChange(newResolution);
+            roiActive = false;
+            currentResolution = newResolution;
+            switchRes = resValue;
+            switchWidth = resolution[newResolution].width;
+            switchHeight = resolution[newResolution].height;
+            switchStart = millis();
+            switchPending = true;
 
-            if (!validated)
+            // Intervalo RSTn ya conocido: se programa junto al cambio para
+            // que el primer frame nuevo ya venga por franjas
+            if (restartMarkers && resStates[resValue].mcuCols > 0)
             {
-                Serial.println("[CAM] ❌ Validación falló - Intentando recovery...");
-
-                // Intentar volver a resolución anterior
-                err = s->set_framesize(s, oldResolution);
-                if (err == ESP_OK)
-                {
-                    currentResolution = oldResolution;
-                    delay(DELAY_CAMERA_STABILIZATION);
-                    Serial.printf("[CAM] ✓ Revertido a: %s\n", getResolutionName().c_str());
-                }
-                else
-                {
-                    // Si no puede revertir, resetear sensor completo
-                    Serial.println("[CAM] 🔴 No puede revertir - Reseteando sensor...");
-                    resetSensor();
-                }
-                return false;
+                writeRestartInterval(resStates[resValue].mcuCols);
             }
-
-            Serial.printf("[CAM] ✓ Resolución validada: %s\n", getResolutionName().c_str());
             return true;
         }
         else
@@ -222,58 +425,225 @@ bool CameraManager::changeResolution(int resValue)
     return false;
 }
 
-bool CameraManager::validateResolutionChange(framesize_t expectedResolution)
+camera_fb_t *CameraManager::completeSwitch(camera_fb_t *fb)
 {
     /**
-     * Valida que el sensor realmente cambió de resolución
-     * capturando frames de prueba
+     * Primer frame tras un cambio de resolución: se descartan los que ya
+     * estaban en cola con el perfil anterior y el primero con las
+     * dimensiones nuevas se valida y se entrega como frame normal
      */
-    Serial.println("[CAM] 🔍 Validando cambio de resolución...");
+    JpegLayout layout;
+    bool matched = false;
+    while (fb)
+    {
+        matched = JpegParser::parse(fb->buf, fb->len, layout) &&
+                  layout.width == switchWidth && layout.height == switchHeight;
+        if (matched || millis() - switchStart >= RESOLUTION_SWITCH_TIMEOUT_MS)
+        {
+            break;
+        }
+        esp_camera_fb_return(fb);
+        fb = esp_camera_fb_get();
+    }
 
-    // Limpiar buffer viejo
-    for (int i = 0; i < 3; i++)
+    // Resolución ya validada antes: el sensor la sostiene, basta con que
+    // lleguen las dimensiones nuevas (sin comprobar tamaño ni frame negro)
+    bool known = switchRes >= 0 && resStates[switchRes].validated;
+    if (matched && (known || (fb->len >= 1000 && !isFrameBlack(fb))))
     {
-        camera_fb_t *fb = esp_camera_fb_get();
-        if (fb)
-            esp_camera_fb_return(fb);
-        delay(50);
+        switchPending = false;
+        lastSwitchMs = millis() - switchStart;
+
+        // MCUs por fila cambian con la resolución (la ROI no se cachea)
+        uint16_t cachedCols = 0;
+        if (switchRes >= 0)
+        {
+            ResolutionState &state = resStates[switchRes];
+            state.validated = true;
+            state.switchMs = lastSwitchMs;
+            cachedCols = state.mcuCols;
+            state.mcuCols = layout.mcuCols;
+        }
+        if (restartMarkers && cachedCols != layout.mcuCols)
+        {
+            writeRestartInterval(layout.mcuCols);
+        }
+
+        Serial.printf("[CAM] ✓ %s %s: %dx%d en %lums\n", switchRes >= 0 ? "Resolución" : "ROI",
+                      known ? "conocida" : "validada", switchWidth, switchHeight, lastSwitchMs);
+        return fb;
     }
 
-    // Capturar frame de validación
-    camera_fb_t *fb = esp_camera_fb_get();
+    // Aún sin frame pero dentro del plazo: se reintenta en la próxima captura
+    if (!fb && millis() - switchStart < RESOLUTION_SWITCH_TIMEOUT_MS)
+    {
+        return nullptr;
+    }
 
-    if (!fb)
+    if (fb)
+    {
+        esp_camera_fb_return(fb);
+    }
+    revertSwitch();
+    return nullptr;
+}
+
+void CameraManager::revertSwitch()
+{
+    Serial.println("[CAM] ❌ Validación falló - Volviendo a la resolución anterior...");
+    switchPending = false;
+    switchesFailed++;
+    roiActive = false;
+    if (switchRes >= 0)
+    {
+        resStates[switchRes].validated = false;
+    }
+
+    sensor_t *s = esp_camera_sensor_get();
+    framesize_t oldResolution = mapResolution(switchFromRes);
+    if (s && switchFromRes >= 0 && s->set_framesize(s, oldResolution) == ESP_OK)
+    {
+        currentResolution = oldResolution;
+        if (restartMarkers && resStates[switchFromRes].mcuCols > 0)
+        {
+            writeRestartInterval(resStates[switchFromRes].mcuCols);
+        }
+        Serial.printf("[CAM] ✓ Revertido a: %s\n", getResolutionName().c_str());
+    }
+    else
+    {
+        // Si no puede revertir, resetear sensor
+        Serial.println("[CAM] 🔴 No puede revertir - Reseteando sensor...");
+        resetSensor();
+    }
+
+    // El comando ya se confirmó al aplicarlo: avisar al servidor de que el
+    // cambio no se sostuvo (lo envía FrameSender, ver takeRevertNotice)
+    revertNotice = "{\"type\":\"resolution_reverted\",\"requested\":" +
+                   (switchRes >= 0 ? String(switchRes) : String("\"roi\"")) +
+                   ",\"requestedSize\":\"" + String(switchWidth) + "x" + String(switchHeight) +
+                   "\",\"restored\":" + String(getResolutionIndex()) +
+                   ",\"restoredName\":\"" + getResolutionName() + "\"}";
+}
+
+bool CameraManager::takeRevertNotice(String &json)
+{
+    if (revertNotice.length() == 0)
+        return false;
+
+    json = revertNotice;
+    revertNotice = "";
+    return true;
+}
+
+bool CameraManager::setRoi(const RoiWindow &window)
+{
+    // Ventana dentro del array y salida no mayor que la ventana (solo se reduce)
+    if (window.width < ROI_MIN_SIZE || window.height < ROI_MIN_SIZE ||
+        window.x + window.width > OV3660_ARRAY_WIDTH || window.y + window.height > OV3660_ARRAY_HEIGHT ||
+        window.outWidth < ROI_MIN_SIZE || window.outHeight < ROI_MIN_SIZE ||
+        window.outWidth > window.width || window.outHeight > window.height ||
+        window.outWidth % 16 != 0 || window.outHeight % 8 != 0)
     {
-        Serial.println("[CAM] ✗ No se pudo capturar frame de validación");
         return false;
     }
 
-    bool valid = true;
+    sensor_t *s = esp_camera_sensor_get();
+    if (!s || !s->set_res_raw)
+    {
+        return false;
+    }
 
-    // Verificar tamaño mínimo
-    if (fb->len < 1000)
+    if (!switchPending)
     {
-        Serial.printf("[CAM] ✗ Frame muy pequeño: %d bytes\n", fb->len);
-        valid = false;
+        switchFromRes = roiActive ? roiPrevRes : getResolutionIndex();
+    }
+    if (!roiActive)
+    {
+        roiPrevRes = getResolutionIndex();
     }
 
-    // Verificar que no es todo negro
-    if (isFrameBlack(fb))
+    // Modo completo sin binning (PLL y tiempos de línea), después la ventana
+    if (currentResolution != FRAMESIZE_QXGA && s->set_framesize(s, FRAMESIZE_QXGA) != ESP_OK)
     {
-        Serial.println("[CAM] ✗ Frame completamente negro");
-        valid = false;
+        return false;
     }
+    currentResolution = FRAMESIZE_QXGA;
 
-    // Verificar marcadores JPEG
-    if (fb->buf[0] != 0xFF || fb->buf[1] != 0xD8)
+    roi = window;
+    roiActive = true;
+    if (!applyRoi())
     {
-        Serial.println("[CAM] ✗ No es JPEG válido (sin SOI)");
-        valid = false;
+        Serial.println("[CAM] ✗ El sensor rechazó la ventana ROI");
+        switchRes = -1;
+        revertSwitch();
+        return false;
     }
 
-    esp_camera_fb_return(fb);
+    switchRes = -1;
+    switchWidth = window.outWidth;
+    switchHeight = window.outHeight;
+    switchStart = millis();
+    switchPending = true;
 
-    return valid;
+    Serial.printf("[CAM] 🔍 ROI %dx%d en (%d,%d) → %dx%d\n", window.width, window.height,
+                  window.x, window.y, window.outWidth, window.outHeight);
+    return true;
+}
+
+bool CameraManager::applyRoi()
+{
+    sensor_t *s = esp_camera_sensor_get();
+    if (!s || !s->set_res_raw)
+    {
+        return false;
+    }
+
+    bool scale = roi.outWidth != roi.width || roi.outHeight != roi.height;
+    int windowHeight = roi.height + OV3660_WINDOW_PAD_Y;
+    return s->set_res_raw(s, roi.x, roi.y,
+                          roi.x + roi.width + OV3660_WINDOW_PAD_X - 1, roi.y + windowHeight - 1,
+                          OV3660_ISP_OFFSET_X, OV3660_ISP_OFFSET_Y,
+                          OV3660_HTS, windowHeight + ROI_VBLANK_LINES,
+                          roi.outWidth, roi.outHeight, scale, false) == 0;
+}
+
+bool CameraManager::clearRoi()
+{
+    if (!roiActive)
+    {
+        return false;
+    }
+    return changeResolution(roiPrevRes >= 0 ? roiPrevRes : RES_VGA);
+}
+
+bool CameraManager::isRoiActive() const
+{
+    return roiActive;
+}
+
+String CameraManager::getRoiJson()
+{
+    return "\"roi\":[" + String(roi.x) + "," + String(roi.y) + "," + String(roi.width) + "," +
+           String(roi.height) + "," + String(roi.outWidth) + "," + String(roi.outHeight) + "]";
+}
+
+String CameraManager::getSwitchJson()
+{
+    // Última latencia por resolución validada (índice RES_*)
+    String byRes;
+    for (int r = RES_QQVGA; r <= RES_QXGA; r++)
+    {
+        if (resStates[r].validated)
+        {
+            byRes += String(byRes.length() ? "," : "") + "\"" + String(r) + "\":" + String(resStates[r].switchMs);
+        }
+    }
+
+    return "\"resSwitch\":{\"lastMs\":" + String(lastSwitchMs) +
+           ",\"failed\":" + String(switchesFailed) +
+           ",\"pending\":" + String(switchPending ? "true" : "false") +
+           ",\"byRes\":{" + byRes + "}}";
 }
 
 bool CameraManager::isFrameBlack(camera_fb_t *fb)
@@ -412,6 +782,185 @@ bool CameraManager::setVFlip(bool enable)
     return false;
 }
 
+SensorSettings CameraManager::getSensorSettings()
+{
+    SensorSettings settings;
+    settings.resolution = roiActive ? -1 : getResolutionIndex();
+    settings.quality = currentQuality;
+
+    sensor_t *s = esp_camera_sensor_get();
+    settings.brightness = s ? s->status.brightness : 0;
+    settings.contrast = s ? s->status.contrast : 0;
+    settings.exposure = s && s->status.aec;
+    settings.gain = s && s->status.agc;
+    settings.whiteBalance = s && s->status.awb;
+    settings.hmirror = s && s->status.hmirror;
+    settings.vflip = s && s->status.vflip;
+    return settings;
+}
+
+bool CameraManager::applySensorSettings(const SensorSettings &settings)
+{
+    SensorSettings current = getSensorSettings();
+    bool ok = true;
+
+    if (settings.resolution >= 0 && settings.resolution != current.resolution)
+        ok &= changeResolution(settings.resolution);
+    if (settings.quality != current.quality)
+        ok &= setQuality(settings.quality);
+    if (settings.brightness != current.brightness)
+        ok &= setBrightness(settings.brightness);
+    if (settings.contrast != current.contrast)
+        ok &= setContrast(settings.contrast);
+    if (settings.exposure != current.exposure)
+        ok &= setExposure(settings.exposure);
+    if (settings.gain != current.gain)
+        ok &= setGain(settings.gain);
+    if (settings.whiteBalance != current.whiteBalance)
+        ok &= setWhiteBalance(settings.whiteBalance);
+    if (settings.hmirror != current.hmirror)
+        ok &= setHMirror(settings.hmirror);
+    if (settings.vflip != current.vflip)
+        ok &= setVFlip(settings.vflip);
+
+    return ok;
+}
+
+void CameraManager::setStartupSettings(const SensorSettings &settings)
+{
+    // Resolución y calidad van directas a la configuración del driver
+    if (settings.resolution >= RES_QQVGA && settings.resolution <= RES_QXGA)
+    {
+        currentResolution = mapResolution(settings.resolution);
+    }
+    if (settings.quality >= MIN_QUALITY && settings.quality <= MAX_QUALITY)
+    {
+        currentQuality = settings.quality;
+    }
+
+    startupSettings = settings;
+    hasStartupSettings = true;
+}
+
+bool CameraManager::setRestartMarkers(bool enable)
+{
+    restartMarkers = enable;
+    if (applyRestartInterval())
+    {
+        Serial.printf("[CAM] ✓ Marcadores RSTn %s\n", enable ? "ON" : "OFF");
+        return true;
+    }
+    restartMarkers = false;
+    return false;
+}
+
+bool CameraManager::isRestartMarkersEnabled() const
+{
+    return restartMarkers;
+}
+
+bool CameraManager::applyRestartInterval()
+{
+    sensor_t *s = esp_camera_sensor_get();
+    if (!s || !s->set_reg || !s->get_reg)
+    {
+        return false;
+    }
+
+    if (!restartMarkers)
+    {
+        restoreRestartRegisters();
+        return true;
+    }
+
+    // Geometría MCU de la resolución actual
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (!fb)
+    {
+        return false;
+    }
+    JpegLayout layout;
+    bool parsed = JpegParser::parse(fb->buf, fb->len, layout) && layout.mcuCols > 0;
+    esp_camera_fb_return(fb);
+    if (!parsed)
+    {
+        Serial.println("[CAM] ✗ No se pudo leer la geometría JPEG");
+        return false;
+    }
+
+    int prevH = s->get_reg(s, OV3660_REG_JPEG_RESTART_H, 0xFF);
+    int prevL = s->get_reg(s, OV3660_REG_JPEG_RESTART_L, 0xFF);
+
+    // Valor del sensor antes del primer RSTn: lo que se restaura al desactivar
+    if (restartSavedH < 0 || restartSavedL < 0)
+    {
+        restartSavedH = prevH;
+        restartSavedL = prevL;
+    }
+
+    // Un intervalo por fila de MCUs: cada RSTn cierra una franja completa
+    uint16_t interval = layout.mcuCols;
+    writeRestartInterval(interval);
+
+    // Verificar sobre un frame nuevo (el siguiente puede venir del buffer)
+    for (int i = 0; i < 2; i++)
+    {
+        fb = esp_camera_fb_get();
+        if (fb)
+            esp_camera_fb_return(fb);
+    }
+    fb = esp_camera_fb_get();
+    bool ok = fb && JpegParser::parse(fb->buf, fb->len, layout) && layout.restartInterval > 0;
+    if (fb)
+        esp_camera_fb_return(fb);
+
+    if (!ok)
+    {
+        restoreRestartRegisters();
+        Serial.println("[CAM] ⚠️ El sensor no emite DRI - Chunks por bytes");
+        return false;
+    }
+
+    // Se reutiliza en los próximos cambios a esta resolución
+    int res = getResolutionIndex();
+    if (res >= 0 && !roiActive)
+    {
+        resStates[res].mcuCols = interval;
+    }
+
+    Serial.printf("[CAM] ✓ Intervalo de reinicio: %d MCUs (%d filas de %dpx)\n",
+                  layout.restartInterval, layout.mcuRows, layout.mcuHeight);
+    return true;
+}
+
+void CameraManager::restoreRestartRegisters()
+{
+    // Nada guardado: el sensor nunca se tocó (o no se pudo leer)
+    if (restartSavedH < 0 || restartSavedL < 0)
+    {
+        return;
+    }
+
+    sensor_t *s = esp_camera_sensor_get();
+    if (s && s->set_reg)
+    {
+        s->set_reg(s, OV3660_REG_JPEG_RESTART_H, 0xFF, restartSavedH);
+        s->set_reg(s, OV3660_REG_JPEG_RESTART_L, 0xFF, restartSavedL);
+    }
+    restartSavedH = -1;
+    restartSavedL = -1;
+}
+
+void CameraManager::writeRestartInterval(uint16_t interval)
+{
+    sensor_t *s = esp_camera_sensor_get();
+    if (s && s->set_reg)
+    {
+        s->set_reg(s, OV3660_REG_JPEG_RESTART_H, 0xFF, interval >> 8);
+        s->set_reg(s, OV3660_REG_JPEG_RESTART_L, 0xFF, interval & 0xFF);
+    }
+}
+
 camera_fb_t *CameraManager::captureFrame()
 {
     // Limpiar buffer para obtener frame fresco
@@ -425,6 +974,19 @@ camera_fb_t *CameraManager::captureFrame()
     // Capturar frame actual
     camera_fb_t *fb = esp_camera_fb_get();
 
+    // Cambio de resolución pendiente: validar sobre este mismo frame
+    if (switchPending)
+    {
+        fb = completeSwitch(fb);
+    }
+
+    // El driver rellena las dimensiones del framesize, no las de la ventana
+    if (fb && roiActive)
+    {
+        fb->width = roi.outWidth;
+        fb->height = roi.outHeight;
+    }
+
     // DETECTAR FRAMES NEGROS (sensor corrupto)
     static int consecutiveBlackFrames = 0;
 
@@ -467,6 +1029,99 @@ camera_fb_t *CameraManager::captureFrame()
     return fb;
 }
 
+bool CameraManager::makeProfile(int resValue, int quality, CaptureProfile &profile)
+{
+    if (resValue < RES_QQVGA || resValue > CAMERA_FB_MAX_RES ||
+        quality < MIN_QUALITY || quality > MAX_QUALITY)
+    {
+        return false;
+    }
+
+    profile.frameSize = mapResolution(resValue);
+    profile.quality = quality;
+    profile.width = resolution[profile.frameSize].width;
+    profile.height = resolution[profile.frameSize].height;
+    return true;
+}
+
+camera_fb_t *CameraManager::captureWithProfile(const CaptureProfile &profile,
+                                               unsigned long &switchMs, unsigned long &restoreMs)
+{
+    switchMs = 0;
+    restoreMs = 0;
+
+    sensor_t *s = esp_camera_sensor_get();
+    if (!s)
+    {
+        return nullptr;
+    }
+
+    unsigned long start = millis();
+    bool qualityChanged = profile.quality != currentQuality;
+    bool sizeChanged = profile.frameSize != currentResolution || roiActive;
+
+    if (qualityChanged)
+    {
+        s->set_quality(s, profile.quality);
+    }
+    if (sizeChanged && s->set_framesize(s, profile.frameSize) != ESP_OK)
+    {
+        Serial.println("[CAM] ✗ Perfil de snapshot rechazado por el sensor");
+        if (qualityChanged)
+        {
+            s->set_quality(s, currentQuality);
+        }
+        return nullptr;
+    }
+
+    // Descartar los frames del perfil anterior que ya estaban en cola: el
+    // primero cuyo SOF trae las dimensiones del perfil es el snapshot
+    camera_fb_t *fb = nullptr;
+    int settle = SNAPSHOT_SETTLE_FRAMES;
+    while (millis() - start < SNAPSHOT_SWITCH_TIMEOUT)
+    {
+        fb = esp_camera_fb_get();
+        if (!fb)
+        {
+            continue;
+        }
+
+        JpegLayout layout;
+        if (JpegParser::parse(fb->buf, fb->len, layout) &&
+            layout.width == profile.width && layout.height == profile.height &&
+            settle-- <= 0)
+        {
+            break;
+        }
+        esp_camera_fb_return(fb);
+        fb = nullptr;
+    }
+    switchMs = millis() - start;
+
+    // Volver al perfil del stream mientras se retiene el snapshot
+    unsigned long restoreStart = millis();
+    if (sizeChanged || roiActive)
+    {
+        s->set_framesize(s, currentResolution);
+        if (roiActive)
+        {
+            applyRoi();
+        }
+    }
+    if (qualityChanged)
+    {
+        s->set_quality(s, currentQuality);
+    }
+    restoreMs = millis() - restoreStart;
+
+    if (!fb)
+    {
+        Serial.printf("[CAM] ✗ Sin frame %dx%d tras %lums\n",
+                      profile.width, profile.height, switchMs);
+    }
+    return fb;
+}
+
 void CameraManager::returnFrame(camera_fb_t *fb)
 {
     esp_camera_fb_return(fb);
@@ -477,6 +1132,16 @@ framesize_t CameraManager::getCurrentResolution()
     return currentResolution;
 }
 
+int CameraManager::getResolutionIndex()
+{
+    for (int res = RES_QQVGA; res <= RES_QXGA; res++)
+    {
+        if (mapResolution(res) == currentResolution)
+            return res;
+    }
+    return -1;
+}
+
 int CameraManager::getCurrentQuality()
 {
     return currentQuality;
@@ -3,9 +3,48 @@
 
 #include <Arduino.h>
 #include <esp_camera.h>
+#include <Preferences.h>
 #include "../configuration/pins.h"
 #include "../configuration/config.h"
 
+// Perfil de captura precalculado: cambiar de perfil solo escribe lo que difiere
+struct CaptureProfile
+{
+    framesize_t frameSize;
+    int quality;
+    uint16_t width; // Dimensiones esperadas en el SOF del JPEG
+    uint16_t height;
+};
+
+// Ventana del sensor (coordenadas del array) y tamaño de salida del JPEG
+struct RoiWindow
+{
+    uint16_t x, y, width, height;
+    uint16_t outWidth, outHeight;
+};
+
+// Ajustes del sensor aplicables en bloque (lotes de comandos y su reversión)
+struct SensorSettings
+{
+    int resolution; // RES_*, -1 con ROI activa (no se toca al aplicar)
+    int quality;
+    int brightness;
+    int contrast;
+    bool exposure;
+    bool gain;
+    bool whiteBalance;
+    bool hmirror;
+    bool vflip;
+};
+
+// Estado validado por resolución: evita repetir validaciones y mediciones
+struct ResolutionState
+{
+    bool validated;         // Ya entregó un frame correcto: los cambios siguientes solo esperan las dimensiones
+    uint16_t mcuCols;       // Intervalo RSTn (0 = aún no medido)
+    unsigned long switchMs; // Última latencia de cambio medida (getSwitchJson)
+};
+
 class CameraManager
 {
 public:
@@ -21,26 +60,96 @@ public:
     bool setWhiteBalance(bool enable);
     bool setHMirror(bool enable);
     bool setVFlip(bool enable);
+    SensorSettings getSensorSettings();
+    bool applySensorSettings(const SensorSettings &settings); // Solo escribe lo que difiere
+    void setStartupSettings(const SensorSettings &settings);  // Antes de init(): se aplican antes del calentamiento
+    bool setRestartMarkers(bool enable); // RSTn por fila de MCUs (chunks por franjas)
+    bool isRestartMarkersEnabled() const;
 
     camera_fb_t *captureFrame();
     void returnFrame(camera_fb_t *fb);
 
+    // Snapshot: cambia al perfil, toma un frame y vuelve al perfil del stream
+    // sin delays ni capturas de validación. El frame devuelto se libera con returnFrame
+    bool makeProfile(int resValue, int quality, CaptureProfile &profile);
+    camera_fb_t *captureWithProfile(const CaptureProfile &profile,
+                                    unsigned long &switchMs, unsigned long &restoreMs);
+
+    // Reloj del sensor, número de buffers y modo de captura (reinicia el driver)
+    bool reconfigure(int xclkHz, int fbCount, camera_grab_mode_t grabMode);
+    bool saveSensorConfig(); // Persiste la configuración actual en NVS
+    int getXclkHz();
+    int getFbCount();
+    camera_grab_mode_t getGrabMode();
+
+    // ROI: recorte del array a densidad nativa; cualquier cambio de resolución lo desactiva
+    bool setRoi(const RoiWindow &window);
+    bool clearRoi();
+    bool isRoiActive() const;
+    String getRoiJson(); // "roi":[x,y,w,h,outW,outH]
+
     framesize_t getCurrentResolution();
+    int getResolutionIndex(); // RES_* actual, -1 si no corresponde a ninguno
     int getCurrentQuality();
     String getResolutionName();
     String getSupportedResolutions();
 
     // NUEVO: Recovery y validación
-    bool resetSensor();                                  // Reset completo del sensor
-    bool validateResolutionChange(framesize_t expected); // Validar cambio de resolución
+    bool resetSensor();                                  // Reset por niveles: SCCB y, si falla, reinicio completo
+    String getRecoveryJson();                            // Recuperaciones por nivel y la última
+    String getSwitchJson();                              // Latencia del último cambio de resolución
+    bool takeRevertNotice(String &json);                 // Aviso resolution_reverted pendiente
     bool isFrameBlack(camera_fb_t *fb);                  // Detectar frames negros
 
 private:
     bool initCamera();
+    bool softRecover();
+    bool waitForValidFrame(unsigned long timeoutMs); // Peor caso: timeoutMs + un timeout del driver
     framesize_t mapResolution(int resValue);
+    bool applyRestartInterval();
+    void writeRestartInterval(uint16_t interval);
+    void restoreRestartRegisters(); // Valores previos al primer RSTn
+    camera_fb_t *completeSwitch(camera_fb_t *fb);
+    void revertSwitch();
+    bool applyRoi();
 
     framesize_t currentResolution;
     int currentQuality;
+    bool restartMarkers;
+    int restartSavedH; // Registros del intervalo antes de activarlo (-1 = sin guardar)
+    int restartSavedL;
+
+    int xclkHz;
+    int fbCount;
+    camera_grab_mode_t grabMode;
+    Preferences preferences;
+
+    // Estadísticas de recuperación
+    unsigned long softRecoveries;
+    unsigned long hardRecoveries;
+    unsigned long failedRecoveries;
+    const char *lastRecoveryTier;
+    unsigned long lastRecoveryMs;
+
+    // Cambio de resolución en curso (se valida en captureFrame)
+    ResolutionState resStates[RES_QXGA + 1];
+    bool switchPending;
+    int switchRes;     // -1 = ventana ROI
+    uint16_t switchWidth; // Dimensiones esperadas en el SOF
+    uint16_t switchHeight;
+    int switchFromRes; // Última resolución validada, destino si el cambio falla
+    unsigned long switchStart;
+    unsigned long lastSwitchMs;
+    unsigned long switchesFailed;
+    String revertNotice; // Cambio revertido aún sin notificar
+
+    RoiWindow roi;
+    bool roiActive;
+    int roiPrevRes; // Resolución a la que vuelve roi off
+
+    // Preset de arranque (solo el primer init)
+    SensorSettings startupSettings;
+    bool hasStartupSettings;
 };
 
 #endif
\ No newline at end of file
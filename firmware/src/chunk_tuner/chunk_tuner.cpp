@@ -0,0 +1,369 @@
+#include "chunk_tuner.h"
+#include "../frame_sender/frame_sender.h"
+#include <WiFi.h>
+#include <Arduino.h>
+#include <algorithm>
+
+ChunkTuner::ChunkTuner()
+    : candidateCount(0), networkHash(0), enabled(CHUNK_TUNER_ENABLED), generationsLoaded(false)
+{
+    exploration.active = false;
+    monitor.bytes = 0;
+    monitor.ms = 0;
+    monitor.frames = 0;
+
+    for (int m = 0; m < STREAM_PROFILE_MAX; m++)
+    {
+        for (int r = 0; r < FRAMESIZE_INVALID; r++)
+        {
+            tuned[m][r] = {false, 0, 0.0f};
+        }
+        generation[m] = 0;
+    }
+
+    buildCandidates();
+}
+
+void ChunkTuner::buildCandidates()
+{
+    // Tamaños "clásicos" de la tabla estática + múltiplos del MSS TCP,
+    // para que cada chunk llene segmentos completos. El candidato es el
+    // payload: al mensaje se suman la ChunkHeader y el framing WebSocket
+    const uint32_t base[] = {CHUNK_SIZE_TINY, CHUNK_SIZE_SMALL, 4096,
+                             CHUNK_SIZE_MEDIUM, CHUNK_SIZE_LARGE, CHUNK_SIZE_XLARGE};
+    const uint32_t mssMultipliers[] = {1, 2, 4, 8, 16};
+
+    uint32_t all[sizeof(base) / sizeof(base[0]) + sizeof(mssMultipliers) / sizeof(mssMultipliers[0])];
+    size_t n = 0;
+    for (uint32_t b : base)
+        all[n++] = b;
+    for (uint32_t m : mssMultipliers)
+        all[n++] = CHUNK_TUNER_MSS * m - sizeof(ChunkHeader) - BWCAP_FRAME_OVERHEAD;
+
+    std::sort(all, all + n);
+
+    candidateCount = 0;
+    for (size_t i = 0; i < n && candidateCount < CHUNK_TUNER_MAX_CANDIDATES; i++)
+    {
+        if (all[i] > UINT16_MAX)
+            break;
+        if (candidateCount > 0 && candidates[candidateCount - 1] == all[i])
+            continue;
+        candidates[candidateCount++] = all[i];
+    }
+}
+
+uint32_t ChunkTuner::hashString(const String &value)
+{
+    // FNV-1a de 32 bits
+    uint32_t hash = 2166136261u;
+    for (unsigned int i = 0; i < value.length(); i++)
+    {
+        hash ^= (uint8_t)value[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void ChunkTuner::checkNetwork()
+{
+    uint32_t hash = hashString(WiFi.SSID());
+    if (hash == networkHash)
+        return;
+
+    // Red distinta: los resultados en RAM ya no aplican
+    networkHash = hash;
+    exploration.active = false;
+    monitor.frames = 0;
+    for (int m = 0; m < STREAM_PROFILE_MAX; m++)
+    {
+        for (int r = 0; r < FRAMESIZE_INVALID; r++)
+        {
+            tuned[m][r] = {false, 0, 0.0f};
+        }
+    }
+
+    Serial.printf("[TUNE] 📶 Red %s (%08lx)\n", WiFi.SSID().c_str(), networkHash);
+}
+
+void ChunkTuner::loadGenerations()
+{
+    if (generationsLoaded)
+        return;
+
+    preferences.begin("chunktune", true);
+    for (int m = 0; m < STREAM_PROFILE_MAX; m++)
+    {
+        generation[m] = preferences.getUShort(("g" + String(m)).c_str(), 0);
+    }
+    preferences.end();
+    generationsLoaded = true;
+}
+
+String ChunkTuner::nvsKey(uint8_t mode, framesize_t res)
+{
+    loadGenerations();
+
+    // Claves NVS <= 15 caracteres: hhhhhhhhm0r10. La generación 0 deja el
+    // hash de la red tal cual (claves anteriores siguen valiendo)
+    uint32_t hash = networkHash ^ (generation[mode < STREAM_PROFILE_MAX ? mode : MODE_STABILITY] * 0x9E3779B1u);
+    char key[16];
+    snprintf(key, sizeof(key), "%08lxm%ur%u", (unsigned long)hash, mode, (unsigned)res);
+    return String(key);
+}
+
+ChunkTuner::TunedEntry &ChunkTuner::entryFor(uint8_t mode, framesize_t res)
+{
+    TunedEntry &entry = tuned[mode < STREAM_PROFILE_MAX ? mode : MODE_STABILITY][res];
+    if (!entry.loaded)
+    {
+        String key = nvsKey(mode, res);
+        preferences.begin("chunktune", true);
+        entry.chunkSize = preferences.getUShort(key.c_str(), 0);
+        entry.kbps = preferences.getFloat((key + "k").c_str(), 0.0f);
+        preferences.end();
+        entry.loaded = true;
+
+        // Afinado con otra lista de candidatos (p. ej. MSS sin descontar la
+        // cabecera): se vuelve a explorar
+        if (entry.chunkSize && std::find(candidates, candidates + candidateCount, entry.chunkSize) ==
+                                   candidates + candidateCount)
+        {
+            entry.chunkSize = 0;
+            entry.kbps = 0;
+        }
+
+        if (entry.chunkSize)
+        {
+            Serial.printf("[TUNE] 💾 Chunk afinado (modo %u, res %d): %uB @ %.1f KB/s\n",
+                          mode, res, entry.chunkSize, entry.kbps);
+        }
+    }
+    return entry;
+}
+
+size_t ChunkTuner::selectChunkSize(uint8_t mode, framesize_t res, size_t frameSize, size_t fallback)
+{
+    if (!enabled || res >= FRAMESIZE_INVALID)
+        return fallback;
+
+    checkNetwork();
+    TunedEntry &entry = entryFor(mode, res);
+
+    bool exploringThis = exploration.active && exploration.mode == mode && exploration.res == res;
+
+    if (!exploringThis)
+    {
+        if (entry.chunkSize)
+            return entry.chunkSize;
+        startExploration(mode, res);
+    }
+
+    // Saltar candidatos que no tienen sentido para este frame (1 solo chunk)
+    while (exploration.candidate < candidateCount &&
+           candidates[exploration.candidate] >= frameSize)
+    {
+        exploration.candidate++;
+        exploration.samples = 0;
+    }
+
+    if (exploration.candidate >= candidateCount)
+    {
+        finishExploration();
+        return entry.chunkSize ? entry.chunkSize : fallback;
+    }
+
+    return candidates[exploration.candidate];
+}
+
+void ChunkTuner::report(uint8_t mode, framesize_t res, size_t chunkSize,
+                        size_t bytes, unsigned long durationMs, bool success)
+{
+    if (!enabled || res >= FRAMESIZE_INVALID || durationMs == 0)
+        return;
+
+    bool exploringThis = exploration.active && exploration.mode == mode && exploration.res == res;
+
+    if (exploringThis && exploration.candidate < candidateCount &&
+        candidates[exploration.candidate] == chunkSize)
+    {
+        // Un frame fallido cuenta su tiempo sin aportar bytes
+        exploration.bytes[exploration.candidate] += success ? bytes : 0;
+        exploration.ms[exploration.candidate] += durationMs;
+
+        if (++exploration.samples >= CHUNK_TUNER_SAMPLES)
+        {
+            exploration.candidate++;
+            exploration.samples = 0;
+            if (exploration.candidate >= candidateCount)
+                finishExploration();
+        }
+        return;
+    }
+
+    TunedEntry &entry = entryFor(mode, res);
+    if (!entry.chunkSize || entry.chunkSize != chunkSize)
+        return;
+
+    // Vigilar que el resultado afinado siga siendo bueno
+    monitor.bytes += success ? bytes : 0;
+    monitor.ms += durationMs;
+    if (++monitor.frames < CHUNK_TUNER_CHECK_FRAMES)
+        return;
+
+    float kbps = (monitor.bytes / 1024.0f) / (monitor.ms / 1000.0f);
+    monitor.bytes = 0;
+    monitor.ms = 0;
+    monitor.frames = 0;
+
+    if (kbps < entry.kbps * CHUNK_TUNER_DEGRADE_PCT / 100.0f)
+    {
+        Serial.printf("[TUNE] 📉 Rendimiento degradado (%.1f vs %.1f KB/s) - Re-explorando\n",
+                      kbps, entry.kbps);
+        startExploration(mode, res);
+    }
+}
+
+void ChunkTuner::startExploration(uint8_t mode, framesize_t res)
+{
+    exploration.active = true;
+    exploration.mode = mode;
+    exploration.res = res;
+    exploration.candidate = 0;
+    exploration.samples = 0;
+    memset(exploration.bytes, 0, sizeof(exploration.bytes));
+    memset(exploration.ms, 0, sizeof(exploration.ms));
+
+    Serial.printf("[TUNE] 🔍 Explorando %d candidatos (modo %u, res %d)\n",
+                  candidateCount, mode, res);
+}
+
+void ChunkTuner::finishExploration()
+{
+    exploration.active = false;
+
+    int best = -1;
+    float bestKbps = 0.0f;
+    for (int i = 0; i < candidateCount; i++)
+    {
+        if (exploration.ms[i] == 0)
+            continue;
+        float kbps = (exploration.bytes[i] / 1024.0f) / (exploration.ms[i] / 1000.0f);
+        Serial.printf("[TUNE]    %5uB → %.1f KB/s\n", candidates[i], kbps);
+        if (kbps > bestKbps)
+        {
+            bestKbps = kbps;
+            best = i;
+        }
+    }
+
+    if (best < 0)
+    {
+        Serial.println("[TUNE] ⚠️ Sin mediciones válidas - Usando tabla estática");
+        return;
+    }
+
+    TunedEntry &entry = entryFor(exploration.mode, exploration.res);
+    entry.chunkSize = candidates[best];
+    entry.kbps = bestKbps;
+    monitor.frames = 0;
+    monitor.bytes = 0;
+    monitor.ms = 0;
+
+    String key = nvsKey(exploration.mode, exploration.res);
+    preferences.begin("chunktune", false);
+    preferences.putUShort(key.c_str(), entry.chunkSize);
+    preferences.putFloat((key + "k").c_str(), entry.kbps);
+    preferences.end();
+
+    Serial.printf("[TUNE] ✅ Mejor chunk (modo %u, res %d): %uB @ %.1f KB/s (guardado)\n",
+                  exploration.mode, exploration.res, entry.chunkSize, entry.kbps);
+}
+
+void ChunkTuner::setEnabled(bool enabled)
+{
+    this->enabled = enabled;
+    exploration.active = false;
+    Serial.printf("[TUNE] %s\n", enabled ? "✓ Activado" : "✗ Desactivado");
+}
+
+bool ChunkTuner::isEnabled() const
+{
+    return enabled;
+}
+
+void ChunkTuner::forgetProfile(uint8_t mode)
+{
+    if (mode >= STREAM_PROFILE_MAX)
+        return;
+
+    checkNetwork();
+    loadGenerations();
+    if (exploration.active && exploration.mode == mode)
+        exploration.active = false;
+    monitor.frames = 0;
+
+    // Claves de la red actual fuera; las de otras redes quedan inalcanzables
+    // al cambiar la generación (chunktune reset las borra todas)
+    preferences.begin("chunktune", false);
+    for (int r = 0; r < FRAMESIZE_INVALID; r++)
+    {
+        String key = nvsKey(mode, (framesize_t)r);
+        preferences.remove(key.c_str());
+        preferences.remove((key + "k").c_str());
+        tuned[mode][r] = {true, 0, 0.0f};
+    }
+    generation[mode]++;
+    preferences.putUShort(("g" + String(mode)).c_str(), generation[mode]);
+    preferences.end();
+
+    Serial.printf("[TUNE] 🗑️ Resultados del perfil %u olvidados\n", mode);
+}
+
+void ChunkTuner::reset()
+{
+    preferences.begin("chunktune", false);
+    preferences.clear();
+    preferences.end();
+
+    networkHash = 0; // Fuerza recarga en el próximo frame
+    generationsLoaded = false;
+    exploration.active = false;
+    Serial.println("[TUNE] 🗑️ Resultados borrados (todas las redes)");
+}
+
+String ChunkTuner::getStatusJson()
+{
+    checkNetwork();
+
+    String json = "{\"type\":\"chunktune\",\"enabled\":" + String(enabled ? "true" : "false");
+    json += ",\"mss\":" + String(CHUNK_TUNER_MSS);
+
+    if (exploration.active)
+    {
+        json += ",\"exploring\":{\"mode\":" + String(exploration.mode) +
+                ",\"res\":" + String((int)exploration.res) +
+                ",\"candidate\":" + String(candidates[exploration.candidate]) + "}";
+    }
+
+    json += ",\"tuned\":[";
+    bool first = true;
+    for (int m = 0; m < STREAM_PROFILE_MAX; m++)
+    {
+        for (int r = 0; r < FRAMESIZE_INVALID; r++)
+        {
+            const TunedEntry &entry = tuned[m][r];
+            if (!entry.loaded || !entry.chunkSize)
+                continue;
+            if (!first)
+                json += ",";
+            first = false;
+            json += "{\"mode\":" + String(m) + ",\"res\":" + String(r) +
+                    ",\"chunk\":" + String(entry.chunkSize) +
+                    ",\"kbps\":" + String(entry.kbps, 1) + "}";
+        }
+    }
+    json += "]}";
+
+    return json;
+}
@@ -0,0 +1,80 @@
+#ifndef CHUNK_TUNER_H
+#define CHUNK_TUNER_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_camera.h>
+#include "../configuration/config.h"
+
+#define CHUNK_TUNER_MAX_CANDIDATES 12
+
+class ChunkTuner
+{
+public:
+    ChunkTuner();
+
+    // Tamaño de chunk para el próximo frame (explorando o ya afinado)
+    size_t selectChunkSize(uint8_t mode, framesize_t res, size_t frameSize, size_t fallback);
+
+    // Resultado de una transferencia chunked
+    void report(uint8_t mode, framesize_t res, size_t chunkSize,
+                size_t bytes, unsigned long durationMs, bool success);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    void reset(); // Borra resultados (RAM + NVS) de todas las redes
+    void forgetProfile(uint8_t mode); // Perfil editado o borrado: sus resultados ya no valen
+
+    String getStatusJson();
+
+private:
+    // Resultado afinado por (modo, resolución)
+    struct TunedEntry
+    {
+        bool loaded;
+        uint16_t chunkSize; // 0 = sin afinar
+        float kbps;
+    };
+
+    // Exploración en curso (solo una combinación a la vez)
+    struct Exploration
+    {
+        bool active;
+        uint8_t mode;
+        framesize_t res;
+        uint8_t candidate;
+        uint8_t samples;
+        uint32_t bytes[CHUNK_TUNER_MAX_CANDIDATES];
+        uint32_t ms[CHUNK_TUNER_MAX_CANDIDATES];
+    } exploration;
+
+    // Vigilancia del resultado afinado
+    struct
+    {
+        uint32_t bytes;
+        uint32_t ms;
+        uint16_t frames;
+    } monitor;
+
+    Preferences preferences;
+    TunedEntry tuned[STREAM_PROFILE_MAX][FRAMESIZE_INVALID]; // Por perfil de streaming
+    uint16_t candidates[CHUNK_TUNER_MAX_CANDIDATES];
+    uint8_t candidateCount;
+    uint32_t networkHash;
+    bool enabled;
+    // Generación por perfil (NVS "g<m>"): entra en la clave, de modo que los
+    // resultados de un perfil olvidado no se leen en ninguna red
+    uint16_t generation[STREAM_PROFILE_MAX];
+    bool generationsLoaded;
+
+    void buildCandidates();
+    void checkNetwork();
+    void startExploration(uint8_t mode, framesize_t res);
+    void finishExploration();
+    TunedEntry &entryFor(uint8_t mode, framesize_t res);
+    void loadGenerations();
+    String nvsKey(uint8_t mode, framesize_t res);
+    static uint32_t hashString(const String &value);
+};
+
+#endif
@@ -4,14 +4,137 @@
 #include "../camera_manager/camera_manager.h"
 #include "../health_monitor/health_monitor.h"
 #include "../frame_sender/frame_sender.h"
+#include "../chunk_tuner/chunk_tuner.h"
+#include "../bandwidth_probe/bandwidth_probe.h"
+#include "../delta_encoder/delta_encoder.h"
+#include "../preview_generator/preview_generator.h"
+#include "../snapshot_scheduler/snapshot_scheduler.h"
+#include "../event_buffer/event_buffer.h"
+#include "../recorder/recorder.h"
+#include "../sensor_bench/sensor_bench.h"
+#include "../boot_profiler/boot_profiler.h"
+#include "../session_manager/session_manager.h"
+#include "../preset_manager/preset_manager.h"
+#include "../stream_profiles/stream_profiles.h"
+#include "../mode_governor/mode_governor.h"
+#include "../frame_pacer/frame_pacer.h"
 #include <Arduino.h>
 
 // Forward declaration del FrameSender global
 extern class FrameSender frameSender;
 
+// Tabla de despacho (hash calculado en compilación)
+const CommandEntry CommandProcessor::commandTable[] = {
+    {commandHash(CMD_REBOOT), CMD_REBOOT, &CommandProcessor::handleReboot, false},
+    {commandHash(CMD_RESOLUTION), CMD_RESOLUTION, &CommandProcessor::handleResolution, true},
+    {commandHash(CMD_QUALITY), CMD_QUALITY, &CommandProcessor::handleQuality, true},
+    {commandHash(CMD_FPS), CMD_FPS, &CommandProcessor::handleFPS, true},
+    {commandHash(CMD_MODE), CMD_MODE, &CommandProcessor::handleMode, true},
+    {commandHash(CMD_STATS), CMD_STATS, &CommandProcessor::handleStats, false},
+    {commandHash(CMD_BRIGHTNESS), CMD_BRIGHTNESS, &CommandProcessor::handleBrightness, true},
+    {commandHash(CMD_CONTRAST), CMD_CONTRAST, &CommandProcessor::handleContrast, true},
+    {commandHash(CMD_EXPOSURE), CMD_EXPOSURE, &CommandProcessor::handleExposure, true},
+    {commandHash(CMD_GAIN), CMD_GAIN, &CommandProcessor::handleGain, true},
+    {commandHash(CMD_WHITEBALANCE), CMD_WHITEBALANCE, &CommandProcessor::handleWhiteBalance, true},
+    {commandHash(CMD_HMIRROR), CMD_HMIRROR, &CommandProcessor::handleHMirror, true},
+    {commandHash(CMD_VFLIP), CMD_VFLIP, &CommandProcessor::handleVFlip, true},
+    {commandHash(CMD_CHUNKTUNE), CMD_CHUNKTUNE, &CommandProcessor::handleChunkTune, false},
+    {commandHash(CMD_PROBE), CMD_PROBE, &CommandProcessor::handleProbe, false},
+    {commandHash(CMD_ABBREV), CMD_ABBREV, &CommandProcessor::handleAbbrev, false},
+    {commandHash(CMD_SLICES), CMD_SLICES, &CommandProcessor::handleSlices, false},
+    {commandHash(CMD_DELTA), CMD_DELTA, &CommandProcessor::handleDelta, false},
+    {commandHash(CMD_PREVIEW), CMD_PREVIEW, &CommandProcessor::handlePreview, false},
+    {commandHash(CMD_SNAPSHOT), CMD_SNAPSHOT, &CommandProcessor::handleSnapshot, false},
+    {commandHash(CMD_EVENT), CMD_EVENT, &CommandProcessor::handleEvent, false},
+    {commandHash(CMD_RECORD), CMD_RECORD, &CommandProcessor::handleRecord, false},
+    {commandHash(CMD_RECBENCH), CMD_RECBENCH, &CommandProcessor::handleRecBench, false},
+    {commandHash(CMD_SENSORBENCH), CMD_SENSORBENCH, &CommandProcessor::handleSensorBench, false},
+    {commandHash(CMD_ROI), CMD_ROI, &CommandProcessor::handleRoi, false},
+    {commandHash(CMD_PRESET), CMD_PRESET, &CommandProcessor::handlePreset, false},
+    {commandHash(CMD_PROFILE), CMD_PROFILE, &CommandProcessor::handleProfile, false},
+    {commandHash(CMD_BWCAP), CMD_BWCAP, &CommandProcessor::handleBwcap, false},
+    {commandHash(CMD_PACE), CMD_PACE, &CommandProcessor::handlePace, false},
+};
+
+const size_t CommandProcessor::commandCount = sizeof(commandTable) / sizeof(commandTable[0]);
+
 CommandProcessor::CommandProcessor(WebSocketManager *ws, CameraManager *cam, HealthMonitor *health, FPSController *fps)
-    : wsManager(ws), camManager(cam), healthMonitor(health), fpsController(fps)
+    : wsManager(ws), camManager(cam), healthMonitor(health), fpsController(fps), chunkTuner(nullptr),
+      bandwidthProbe(nullptr), deltaEncoder(nullptr),
+      previewGenerator(nullptr), snapshotScheduler(nullptr), eventBuffer(nullptr), recorder(nullptr),
+      sensorBench(nullptr), bootProfiler(nullptr), sessionManager(nullptr), presetManager(nullptr),
+      streamProfiles(nullptr), modeGovernor(nullptr), framePacer(nullptr), batchMode(false)
+{
+}
+
+void CommandProcessor::setChunkTuner(ChunkTuner *tuner)
+{
+    chunkTuner = tuner;
+}
+
+void CommandProcessor::setBandwidthProbe(BandwidthProbe *probe)
+{
+    bandwidthProbe = probe;
+}
+
+void CommandProcessor::setDeltaEncoder(DeltaEncoder *encoder)
+{
+    deltaEncoder = encoder;
+}
+
+void CommandProcessor::setPreviewGenerator(PreviewGenerator *generator)
+{
+    previewGenerator = generator;
+}
+
+void CommandProcessor::setSnapshotScheduler(SnapshotScheduler *scheduler)
+{
+    snapshotScheduler = scheduler;
+}
+
+void CommandProcessor::setEventBuffer(EventBuffer *buffer)
+{
+    eventBuffer = buffer;
+}
+
+void CommandProcessor::setRecorder(Recorder *rec)
+{
+    recorder = rec;
+}
+
+void CommandProcessor::setSensorBench(SensorBench *bench)
+{
+    sensorBench = bench;
+}
+
+void CommandProcessor::setBootProfiler(BootProfiler *profiler)
+{
+    bootProfiler = profiler;
+}
+
+void CommandProcessor::setSessionManager(SessionManager *session)
+{
+    sessionManager = session;
+}
+
+void CommandProcessor::setPresetManager(PresetManager *presets)
+{
+    presetManager = presets;
+}
+
+void CommandProcessor::setStreamProfiles(StreamProfiles *profiles)
+{
+    streamProfiles = profiles;
+}
+
+void CommandProcessor::setModeGovernor(ModeGovernor *governor)
+{
+    modeGovernor = governor;
+}
+
+void CommandProcessor::setFramePacer(FramePacer *pacer)
 {
+    framePacer = pacer;
 }
 
 void CommandProcessor::processMessage(const String &message)
@@ -25,7 +148,61 @@ void CommandProcessor::processMessage(const String &message)
     }
 
     const char *type = doc["type"];
-    if (!type || strcmp(type, "command") != 0) {
+    if (!type) {
+        return;
+    }
+
+    // Confirmaciones de frames chunked (ACK / NACK selectivo)
+    if (strcmp(type, "img_complete") == 0) {
+        frameSender.onFrameAck(doc["id"] | 0);
+        return;
+    }
+    if (strcmp(type, "img_nack") == 0) {
+        handleFrameNack(doc);
+        return;
+    }
+
+    // Primer frame recibido tras el registro o la reanudación: cierra la
+    // línea de tiempo del arranque y mide la reconexión
+    if (strcmp(type, "first_frame_ack") == 0) {
+        if (bootProfiler) {
+            bootProfiler->onFirstFrameAck();
+        }
+        if (sessionManager) {
+            sessionManager->onFirstFrameAck();
+        }
+        return;
+    }
+
+    // Token de sesión (registro) o resultado de la reanudación
+    if (sessionManager && strcmp(type, "session") == 0) {
+        sessionManager->onSession(doc);
+        return;
+    }
+
+    // El receptor perdió la referencia del modo delta
+    if (deltaEncoder && strcmp(type, "keyframe_request") == 0) {
+        deltaEncoder->forceKeyframe();
+        return;
+    }
+
+    // Respuestas del probe sink
+    if (bandwidthProbe && strcmp(type, "probe_pong") == 0) {
+        bandwidthProbe->onPong(doc["id"] | 0, doc["seq"] | 0);
+        return;
+    }
+    if (strcmp(type, "probe_report") == 0) {
+        handleProbeReport(doc);
+        return;
+    }
+
+    // Varios ajustes aplicados de forma atómica con una sola respuesta
+    if (strcmp(type, "batch") == 0) {
+        handleBatch(doc);
+        return;
+    }
+
+    if (strcmp(type, "command") != 0) {
         return;
     }
 
@@ -37,78 +214,231 @@ void CommandProcessor::processMessage(const String &message)
         return;
     }
 
-    String command = String(cmd);
-    String value = val ? String(val) : "";
+    processCommand(cmd, val ? String(val) : "");
+}
+
+void CommandProcessor::handleFrameNack(JsonDocument &doc)
+{
+    uint32_t frameId = doc["id"] | 0;
+    JsonArray missing = doc["missing"];
+
+    uint16_t indices[NACK_MAX_INDICES];
+    size_t count = 0;
+    for (JsonVariant v : missing) {
+        if (count >= NACK_MAX_INDICES) {
+            break;
+        }
+        indices[count++] = v.as<uint16_t>();
+    }
+
+    Serial.printf("[CMD] 🔁 NACK frame #%lu: %d chunks perdidos\n", frameId, count);
+    frameSender.onFrameNack(frameId, indices, count);
+}
+
+void CommandProcessor::handleProbeReport(JsonDocument &doc)
+{
+    if (!bandwidthProbe) {
+        return;
+    }
 
-    // PRIORIDAD CRÍTICA: REBOOT
-    if (command == CMD_REBOOT) {
-        Serial.println("\n╔════════════════════════════════╗");
-        Serial.println("║  ⚠️  COMANDO DE REINICIO      ║");
-        Serial.println("║     PRIORIDAD CRÍTICA          ║");
-        Serial.println("╚════════════════════════════════╝");
-        handleReboot(value);
-        return;  // No procesar nada más
+    uint32_t received[PROBE_STEPS_MAX];
+    size_t count = 0;
+    for (JsonVariant v : doc["received"].as<JsonArray>()) {
+        if (count >= PROBE_STEPS_MAX) {
+            break;
+        }
+        received[count++] = v.as<uint32_t>();
     }
 
-    // Procesar otros comandos
-    processCommand(command, value);
+    bandwidthProbe->onReport(doc["id"] | 0, received, count);
+}
+
+const CommandEntry *CommandProcessor::findCommand(uint32_t hash)
+{
+    for (size_t i = 0; i < commandCount; i++) {
+        if (commandTable[i].hash == hash) {
+            return &commandTable[i];
+        }
+    }
+    return nullptr;
 }
 
 void CommandProcessor::processCommand(const String &command, const String &value)
 {
-    Serial.printf("[CMD] Procesando: %s=%s\n", command.c_str(), value.c_str());
+    const CommandEntry *entry = findCommand(commandHash(command.c_str()));
+
+    // El nombre se compara solo una vez, para descartar colisiones del hash
+    if (!entry || command != entry->name) {
+        sendError(command, "comando desconocido");
+        Serial.printf("[CMD] ✗ Comando desconocido: %s\n", command.c_str());
+        return;
+    }
+
+    dispatch(entry, value);
+}
+
+void CommandProcessor::dispatch(const CommandEntry *entry, const String &value)
+{
+    Serial.printf("[CMD] Procesando: %s=%s\n", entry->name, value.c_str());
+    (this->*entry->handler)(value);
+}
+
+void CommandProcessor::processBinary(const uint8_t *data, size_t length)
+{
+    // [magic][count][batchId u16] y por entrada [hash u32][len u8][valor]
+    if (length < 4 || data[0] != CMD_MAGIC) {
+        return;
+    }
+
+    size_t count = data[1];
+    uint16_t batchId = data[2] | (data[3] << 8);
 
-    if (command == CMD_RESOLUTION) {
-        handleResolution(value);
+    if (count == 0 || count > CMD_BATCH_MAX) {
+        Serial.printf("[CMD] ✗ Lote binario con %d entradas\n", count);
+        sendBatchResult(batchId, "error", 0, "entre 1 y " + String(CMD_BATCH_MAX) + " comandos");
+        return;
     }
-    else if (command == CMD_QUALITY) {
-        handleQuality(value);
+
+    const CommandEntry *entries[CMD_BATCH_MAX];
+    String values[CMD_BATCH_MAX];
+    size_t offset = 4;
+
+    for (size_t i = 0; i < count; i++) {
+        if (offset + 5 > length || offset + 5 + data[offset + 4] > length) {
+            Serial.println("[CMD] ✗ Comando binario truncado");
+            sendBatchResult(batchId, "error", 0, "mensaje truncado");
+            return;
+        }
+
+        uint32_t hash = data[offset] | (data[offset + 1] << 8) | (data[offset + 2] << 16) |
+                        ((uint32_t)data[offset + 3] << 24);
+        uint8_t valueLen = data[offset + 4];
+        offset += 5;
+
+        char value[256];
+        memcpy(value, data + offset, valueLen);
+        value[valueLen] = '\0';
+        offset += valueLen;
+
+        entries[i] = findCommand(hash);
+        values[i] = value;
+
+        if (!entries[i]) {
+            Serial.printf("[CMD] ✗ Hash de comando desconocido: %08lx\n", (unsigned long)hash);
+            sendBatchResult(batchId, "error", 0, "comando desconocido #" + String(i));
+            return;
+        }
     }
-    else if (command == CMD_STATS) {
-        handleStats(value);
+
+    // Id 0 con una sola entrada = comando suelto con su respuesta habitual
+    if (count == 1 && batchId == 0) {
+        dispatch(entries[0], values[0]);
+        return;
     }
-    else if (command == CMD_FPS) {
-        handleFPS(value);
+
+    runBatch(batchId, entries, values, count);
+}
+
+void CommandProcessor::handleBatch(JsonDocument &doc)
+{
+    uint16_t batchId = doc["id"] | 0;
+    JsonArray cmds = doc["cmds"];
+
+    if (cmds.size() == 0 || cmds.size() > CMD_BATCH_MAX) {
+        sendBatchResult(batchId, "error", 0, "entre 1 y " + String(CMD_BATCH_MAX) + " comandos");
+        return;
     }
-    else if (command == CMD_MODE) {
-        handleMode(value);
+
+    const CommandEntry *entries[CMD_BATCH_MAX];
+    String values[CMD_BATCH_MAX];
+    size_t count = 0;
+
+    for (JsonVariant item : cmds) {
+        const char *cmd = item["cmd"] | "";
+        const char *val = item["val"] | "";
+
+        entries[count] = findCommand(commandHash(cmd));
+        if (!entries[count] || strcmp(cmd, entries[count]->name) != 0) {
+            sendBatchResult(batchId, "error", 0, "comando desconocido: " + String(cmd));
+            return;
+        }
+        values[count++] = val;
     }
-    else if (command == CMD_BRIGHTNESS) {
-        handleBrightness(value);
+
+    runBatch(batchId, entries, values, count);
+}
+
+void CommandProcessor::runBatch(uint16_t batchId, const CommandEntry **entries, const String *values, size_t count)
+{
+    // Validación completa antes de tocar nada: o se aplica todo o nada
+    for (size_t i = 0; i < count; i++) {
+        if (!entries[i]->batchable) {
+            sendBatchResult(batchId, "error", 0, String(entries[i]->name) + " no admitido en lotes");
+            return;
+        }
     }
-    else if (command == CMD_CONTRAST) {
-        handleContrast(value);
+
+    SensorSettings previous = camManager->getSensorSettings();
+    int previousFps = fpsController->getFPS();
+    uint8_t previousMode = frameSender.getMode();
+    bool previousAuto = modeGovernor && modeGovernor->isEnabled();
+
+    batchMode = true;
+    batchError = "";
+    size_t applied = 0;
+
+    for (; applied < count; applied++) {
+        (this->*entries[applied]->handler)(values[applied]);
+        if (batchError.length() > 0) {
+            break;
+        }
     }
-    else if (command == CMD_EXPOSURE) {
-        handleExposure(value);
+    batchMode = false;
+
+    if (applied == count) {
+        Serial.printf("[CMD] ✓ Lote #%u: %d ajustes aplicados\n", batchId, count);
+        sendBatchResult(batchId, "ok", applied, "");
+        return;
     }
-    else if (command == CMD_GAIN) {
-        handleGain(value);
+
+    // Revertir lo ya aplicado
+    SensorSettings current = camManager->getSensorSettings();
+    camManager->applySensorSettings(previous);
+    if (current.resolution != previous.resolution || current.quality != previous.quality) {
+        frameSender.invalidateJpegTables();
     }
-    else if (command == CMD_WHITEBALANCE) {
-        handleWhiteBalance(value);
+    if (fpsController->getFPS() != previousFps) {
+        fpsController->setFPS(previousFps);
     }
-    else if (command == CMD_HMIRROR) {
-        handleHMirror(value);
+    if (frameSender.getMode() != previousMode) {
+        frameSender.setMode(previousMode);
     }
-    else if (command == CMD_VFLIP) {
-        handleVFlip(value);
+    if (modeGovernor) {
+        modeGovernor->setEnabled(previousAuto);
     }
-    else {
-        sendError(command, "comando desconocido");
-        Serial.printf("[CMD] ✗ Comando desconocido: %s\n", command.c_str());
+
+    Serial.printf("[CMD] ✗ Lote #%u revertido en %s: %s\n", batchId, entries[applied]->name,
+                  batchError.c_str());
+    sendBatchResult(batchId, "error", applied, String(entries[applied]->name) + ": " + batchError);
+}
+
+void CommandProcessor::sendBatchResult(uint16_t batchId, const char *status, size_t applied, const String &error)
+{
+    String msg = "{\"type\":\"batch_result\",\"id\":" + String(batchId) +
+                 ",\"status\":\"" + status + "\",\"applied\":" + String(applied);
+    if (error.length() > 0) {
+        msg += ",\"error\":\"" + error + "\"";
     }
+    wsManager->sendText(msg + "}");
 }
 
 void CommandProcessor::handleResolution(const String &value)
 {
     int resValue = value.toInt();
     if (camManager->changeResolution(resValue)) {
+        frameSender.invalidateJpegTables();
         String resName = camManager->getResolutionName();
         sendSuccess(CMD_RESOLUTION, value + " (" + resName + ")");
-        
-        // Pequeña pausa para estabilizar
-        delay(DELAY_CAMERA_STABILIZATION);
     } else {
         sendError(CMD_RESOLUTION, "valor no válido (0-12)");
     }
@@ -117,7 +447,15 @@ void CommandProcessor::handleResolution(const String &value)
 void CommandProcessor::handleQuality(const String &value)
 {
     int quality = value.toInt();
+    const StreamProfile &profile = frameSender.getProfile();
+    if (quality < profile.qualityMin || quality > profile.qualityMax) {
+        sendError(CMD_QUALITY, "fuera de los límites del perfil " + String(profile.name) + " (" +
+                  String(profile.qualityMin) + "-" + String(profile.qualityMax) + ")");
+        return;
+    }
     if (camManager->setQuality(quality)) {
+        frameSender.invalidateJpegTables();
+        frameSender.clearBudgetQuality();
         sendSuccess(CMD_QUALITY, value);
     } else {
         sendError(CMD_QUALITY, "valor no válido (0-63)");
@@ -127,6 +465,10 @@ void CommandProcessor::handleQuality(const String &value)
 void CommandProcessor::handleReboot(const String &value)
 {
     // ⚠️ PRIORIDAD CRÍTICA - NO INTERRUMPIR
+    Serial.println("\n╔════════════════════════════════╗");
+    Serial.println("║  ⚠️  COMANDO DE REINICIO      ║");
+    Serial.println("║     PRIORIDAD CRÍTICA          ║");
+    Serial.println("╚════════════════════════════════╝");
     
     Serial.println("\n╔════════════════════════════════════════╗");
     Serial.println("║  🔴 INICIANDO SECUENCIA DE REINICIO  ║");
@@ -166,6 +508,11 @@ void CommandProcessor::handleStats(const String &value)
 
 void CommandProcessor::handleFPS(const String &value)
 {
+    if (value == "status") {
+        wsManager->sendText("{\"type\":\"fps_status\"," + fpsController->getStatsJson() + "}");
+        return;
+    }
+
     int fps = value.toInt();
 
     if (fps < MIN_FPS || fps > MAX_FPS) {
@@ -182,22 +529,46 @@ void CommandProcessor::handleFPS(const String &value)
     Serial.printf("[CMD] ✓ FPS cambiado a: %d\n", fps);
 }
 
+void CommandProcessor::selectMode(uint8_t mode)
+{
+    // Un modo elegido a mano manda sobre la selección automática
+    if (modeGovernor) {
+        modeGovernor->setEnabled(false);
+    }
+    frameSender.setMode(mode);
+}
+
 void CommandProcessor::handleMode(const String &value)
 {
-    uint8_t mode;
+    int mode = -1;
     
-    if (value == "0" || value == "speed" || value == "velocidad") {
+    if (value == "auto" && modeGovernor) {
+        // El gobernador decide a partir de aquí, empezando por el modo actual
+        modeGovernor->setEnabled(true);
+        sendSuccess(CMD_MODE, "auto (" + frameSender.getModeName() + ")");
+        Serial.println("[CMD] ✓ Modo automático");
+        return;
+    }
+    else if (value == "speed" || value == "velocidad") {
         mode = MODE_SPEED;
     } 
-    else if (value == "1" || value == "stability" || value == "estabilidad") {
+    else if (value == "stability" || value == "estabilidad") {
         mode = MODE_STABILITY;
     }
-    else {
-        sendError(CMD_MODE, "valor no válido (0=velocidad, 1=estabilidad)");
+    else if (streamProfiles) {
+        // Índice o nombre de cualquier perfil de streaming
+        mode = streamProfiles->find(value);
+    }
+    else if (value == "0" || value == "1") {
+        mode = value.toInt();
+    }
+
+    if (mode < 0) {
+        sendError(CMD_MODE, "valor no válido (0=velocidad, 1=estabilidad, auto o nombre de perfil)");
         return;
     }
     
-    frameSender.setMode(mode);
+    selectMode(mode);
     String modeName = frameSender.getModeName();
     sendSuccess(CMD_MODE, modeName);
     
@@ -274,12 +645,614 @@ void CommandProcessor::handleVFlip(const String &value)
     }
 }
 
+void CommandProcessor::handleChunkTune(const String &value)
+{
+    if (!chunkTuner) {
+        sendError(CMD_CHUNKTUNE, "no disponible");
+        return;
+    }
+
+    if (value == "reset") {
+        chunkTuner->reset();
+        sendSuccess(CMD_CHUNKTUNE, "reset");
+    }
+    else if (value == "1" || value == "on") {
+        chunkTuner->setEnabled(true);
+        sendSuccess(CMD_CHUNKTUNE, "on");
+    }
+    else if (value == "0" || value == "off") {
+        chunkTuner->setEnabled(false);
+        sendSuccess(CMD_CHUNKTUNE, "off");
+    }
+    else if (value == "" || value == "status") {
+        wsManager->sendText(chunkTuner->getStatusJson());
+        sendSuccess(CMD_CHUNKTUNE, "status");
+    }
+    else {
+        sendError(CMD_CHUNKTUNE, "valor no válido (on/off/reset/status)");
+    }
+}
+
+void CommandProcessor::handleProbe(const String &value)
+{
+    if (!bandwidthProbe) {
+        sendError(CMD_PROBE, "no disponible");
+        return;
+    }
+
+    // "" = 3s y aplicar, "dry" = solo medir, número = duración en ms
+    bool apply = (value != "dry");
+    unsigned long duration = value.toInt() > 0 ? value.toInt() : PROBE_DURATION_MS;
+
+    // La sonda corre en el loop principal, fuera del callback del WebSocket
+    bandwidthProbe->request(duration, apply);
+    sendSuccess(CMD_PROBE, String(duration) + "ms" + (apply ? "" : " (dry)"));
+}
+
+void CommandProcessor::handleAbbrev(const String &value)
+{
+    bool enable = (value == "1" || value == "true" || value == "on");
+    frameSender.setAbbreviatedJpeg(enable);
+    sendSuccess(CMD_ABBREV, enable ? "on" : "off");
+}
+
+void CommandProcessor::handleSlices(const String &value)
+{
+    bool enable = (value == "1" || value == "true" || value == "on");
+    if (frameSender.setSliceChunking(enable)) {
+        sendSuccess(CMD_SLICES, enable ? "on" : "off");
+    } else {
+        sendError(CMD_SLICES, "el sensor no emite marcadores RSTn");
+    }
+}
+
+void CommandProcessor::handleDelta(const String &value)
+{
+    if (!deltaEncoder) {
+        sendError(CMD_DELTA, "no disponible");
+        return;
+    }
+
+    // "period:N" y "threshold:N" ajustan keyframes y umbral de cambio
+    int sep = value.indexOf(':');
+    String key = sep >= 0 ? value.substring(0, sep) : value;
+    int number = sep >= 0 ? value.substring(sep + 1).toInt() : 0;
+
+    if (key == "1" || key == "on") {
+        // Los intervalos RSTn son la unidad de reemplazo
+        if (!camManager->isRestartMarkersEnabled() && !camManager->setRestartMarkers(true)) {
+            sendError(CMD_DELTA, "el sensor no emite marcadores RSTn");
+            return;
+        }
+        deltaEncoder->setEnabled(true);
+        sendSuccess(CMD_DELTA, "on");
+    }
+    else if (key == "0" || key == "off") {
+        deltaEncoder->setEnabled(false);
+        sendSuccess(CMD_DELTA, "off");
+    }
+    else if (key == "key") {
+        deltaEncoder->forceKeyframe();
+        sendSuccess(CMD_DELTA, "key");
+    }
+    else if (key == "period" && number > 0) {
+        deltaEncoder->setKeyframePeriod(number);
+        sendSuccess(CMD_DELTA, "period:" + String(number));
+    }
+    else if (key == "threshold" && number >= 0 && sep >= 0) {
+        deltaEncoder->setThreshold(number);
+        sendSuccess(CMD_DELTA, "threshold:" + String(number));
+    }
+    else if (key == "" || key == "status") {
+        wsManager->sendText(deltaEncoder->getStatusJson());
+        sendSuccess(CMD_DELTA, "status");
+    }
+    else {
+        sendError(CMD_DELTA, "valor no válido (on/off/key/period:N/threshold:N/status)");
+    }
+}
+
+void CommandProcessor::handlePreview(const String &value)
+{
+    if (!previewGenerator) {
+        sendError(CMD_PREVIEW, "no disponible");
+        return;
+    }
+
+    // "interval:N" en ms; "only" = solo vista previa (sin frames completos)
+    int sep = value.indexOf(':');
+    String key = sep >= 0 ? value.substring(0, sep) : value;
+    int number = sep >= 0 ? value.substring(sep + 1).toInt() : 0;
+
+    if (key == "1" || key == "on") {
+        previewGenerator->setEnabled(true);
+        previewGenerator->setPreviewOnly(false);
+        sendSuccess(CMD_PREVIEW, "on");
+    }
+    else if (key == "0" || key == "off") {
+        previewGenerator->setEnabled(false);
+        sendSuccess(CMD_PREVIEW, "off");
+    }
+    else if (key == "only") {
+        previewGenerator->setPreviewOnly(true);
+        sendSuccess(CMD_PREVIEW, "only");
+    }
+    else if (key == "raw" || key == "jpeg") {
+        previewGenerator->setFormat(key == "raw" ? PREVIEW_FORMAT_RAW : PREVIEW_FORMAT_JPEG);
+        sendSuccess(CMD_PREVIEW, key);
+    }
+    else if (key == "interval" && number > 0) {
+        previewGenerator->setInterval(number);
+        sendSuccess(CMD_PREVIEW, "interval:" + String(number));
+    }
+    else if (key == "" || key == "status") {
+        wsManager->sendText(previewGenerator->getStatusJson());
+        sendSuccess(CMD_PREVIEW, "status");
+    }
+    else {
+        sendError(CMD_PREVIEW, "valor no válido (on/off/only/raw/jpeg/interval:N/status)");
+    }
+}
+
+void CommandProcessor::handleSnapshot(const String &value)
+{
+    if (!snapshotScheduler) {
+        sendError(CMD_SNAPSHOT, "no disponible");
+        return;
+    }
+
+    // "interval:N" en segundos (0 = solo bajo comando); "res:N" usa RES_*
+    int sep = value.indexOf(':');
+    String key = sep >= 0 ? value.substring(0, sep) : value;
+    int number = sep >= 0 ? value.substring(sep + 1).toInt() : 0;
+
+    if (key == "" || key == "now") {
+        // Se ejecuta desde el loop principal: aquí solo se programa
+        snapshotScheduler->request();
+        sendSuccess(CMD_SNAPSHOT, "now");
+    }
+    else if (key == "interval" && number >= 0) {
+        snapshotScheduler->setInterval(number);
+        sendSuccess(CMD_SNAPSHOT, "interval:" + String(number));
+    }
+    else if (key == "res") {
+        // Conserva la calidad del perfil actual
+        if (snapshotScheduler->setProfile(number, snapshotScheduler->getQuality())) {
+            sendSuccess(CMD_SNAPSHOT, "res:" + String(number));
+        } else {
+            sendError(CMD_SNAPSHOT, "resolución fuera de rango (0-" + String(CAMERA_FB_MAX_RES) + ")");
+        }
+    }
+    else if (key == "quality") {
+        if (snapshotScheduler->setProfile(snapshotScheduler->getResolution(), number)) {
+            sendSuccess(CMD_SNAPSHOT, "quality:" + String(number));
+        } else {
+            sendError(CMD_SNAPSHOT, "calidad fuera de rango");
+        }
+    }
+    else if (key == "status") {
+        wsManager->sendText(snapshotScheduler->getStatusJson());
+        sendSuccess(CMD_SNAPSHOT, "status");
+    }
+    else {
+        sendError(CMD_SNAPSHOT, "valor no válido (now/interval:N/res:N/quality:N/status)");
+    }
+}
+
+void CommandProcessor::handleEvent(const String &value)
+{
+    if (!eventBuffer) {
+        sendError(CMD_EVENT, "no disponible");
+        return;
+    }
+
+    // "trigger:N" sube solo los últimos N segundos; "budget:N" en KB
+    int sep = value.indexOf(':');
+    String key = sep >= 0 ? value.substring(0, sep) : value;
+    int number = sep >= 0 ? value.substring(sep + 1).toInt() : 0;
+
+    if (key == "1" || key == "on") {
+        if (eventBuffer->setEnabled(true)) {
+            sendSuccess(CMD_EVENT, "on");
+        } else {
+            sendError(CMD_EVENT, "sin PSRAM para el historial");
+        }
+    }
+    else if (key == "0" || key == "off") {
+        eventBuffer->setEnabled(false);
+        sendSuccess(CMD_EVENT, "off");
+    }
+    else if (key == "trigger") {
+        if (eventBuffer->trigger("command", (unsigned long)number * 1000)) {
+            sendSuccess(CMD_EVENT, value);
+        } else {
+            sendError(CMD_EVENT, "historial vacío, desactivado o ya subiéndose");
+        }
+    }
+    else if (key == "motion" && sep >= 0) {
+        eventBuffer->setMotionDetection(number != 0);
+        sendSuccess(CMD_EVENT, "motion:" + String(number != 0 ? 1 : 0));
+    }
+    else if (key == "threshold" && number > 0 && number <= 100) {
+        eventBuffer->setMotionThreshold(number);
+        sendSuccess(CMD_EVENT, "threshold:" + String(number));
+    }
+    else if (key == "budget") {
+        if (eventBuffer->setBudget(number)) {
+            sendSuccess(CMD_EVENT, "budget:" + String(number));
+        } else {
+            sendError(CMD_EVENT, "presupuesto no válido (64-" + String(EVENT_BUFFER_BUDGET_MAX_KB) + " KB)");
+        }
+    }
+    else if (key == "" || key == "status") {
+        wsManager->sendText(eventBuffer->getStatusJson());
+        sendSuccess(CMD_EVENT, "status");
+    }
+    else {
+        sendError(CMD_EVENT, "valor no válido (on/off/trigger[:s]/motion:0|1/threshold:N/budget:KB/status)");
+    }
+}
+
+void CommandProcessor::handleRecord(const String &value)
+{
+    if (!recorder) {
+        sendError(CMD_RECORD, "no disponible");
+        return;
+    }
+
+    if (value == "0" || value == "off") {
+        recorder->setMode(RECORDER_MODE_OFF);
+        sendSuccess(CMD_RECORD, "off");
+    }
+    else if (value == "1" || value == "continuous" || value == "2" || value == "disconnected") {
+        uint8_t mode = (value == "1" || value == "continuous") ? RECORDER_MODE_CONTINUOUS
+                                                               : RECORDER_MODE_DISCONNECTED;
+        if (recorder->setMode(mode)) {
+            sendSuccess(CMD_RECORD, value);
+        } else {
+            sendError(CMD_RECORD, "almacenamiento no disponible");
+        }
+    }
+    else if (value == "" || value == "status") {
+        wsManager->sendText(recorder->getStatusJson());
+        sendSuccess(CMD_RECORD, "status");
+    }
+    else {
+        sendError(CMD_RECORD, "valor no válido (off/continuous/disconnected/status)");
+    }
+}
+
+void CommandProcessor::handleRecBench(const String &value)
+{
+    if (!recorder) {
+        sendError(CMD_RECBENCH, "no disponible");
+        return;
+    }
+
+    // Se ejecuta desde el loop principal (varios segundos por resolución)
+    recorder->requestBenchmark();
+    sendSuccess(CMD_RECBENCH, "programado");
+}
+
+void CommandProcessor::handleSensorBench(const String &value)
+{
+    if (!sensorBench) {
+        sendError(CMD_SENSORBENCH, "no disponible");
+        return;
+    }
+
+    if (value == "status") {
+        sendSuccess(CMD_SENSORBENCH, "XCLK " + String(camManager->getXclkHz() / 1000000) + "MHz, " +
+                    String(camManager->getFbCount()) + " buffers, " +
+                    (camManager->getGrabMode() == CAMERA_GRAB_LATEST ? "latest" : "when_empty"));
+        return;
+    }
+
+    // [all|current][:apply]; "apply" solo = resolución actual y aplicar
+    String scope = value;
+    bool apply = false;
+    if (scope == "apply") {
+        scope = "current";
+        apply = true;
+    }
+    else if (scope.endsWith(":apply")) {
+        scope = scope.substring(0, scope.length() - 6);
+        apply = true;
+    }
+    if (scope == "") {
+        scope = "all";
+    }
+    if (scope != "all" && scope != "current") {
+        sendError(CMD_SENSORBENCH, "valor no válido (all/current[:apply]/apply/status)");
+        return;
+    }
+
+    // Se ejecuta desde el loop principal: reinicia el driver en cada combinación
+    sensorBench->request(scope == "all", apply);
+    sendSuccess(CMD_SENSORBENCH, scope + (apply ? " + apply" : "") + " programado");
+}
+
+void CommandProcessor::handleRoi(const String &value)
+{
+    if (value == "status") {
+        String msg = "{\"type\":\"roi_status\",\"active\":" + String(camManager->isRoiActive() ? "true" : "false");
+        if (camManager->isRoiActive()) {
+            msg += "," + camManager->getRoiJson();
+        }
+        wsManager->sendText(msg + "}");
+        return;
+    }
+
+    if (value == "off") {
+        if (camManager->clearRoi()) {
+            frameSender.invalidateJpegTables();
+            sendSuccess(CMD_ROI, "off (" + camManager->getResolutionName() + ")");
+            wsManager->sendText("{\"type\":\"roi_status\",\"active\":false}");
+        } else {
+            sendError(CMD_ROI, "ROI no activa");
+        }
+        return;
+    }
+
+    // x,y,w,h[,outW,outH] en píxeles del array; sin salida = densidad nativa
+    int v[6];
+    int count = 0;
+    int start = 0;
+    while (count < 6) {
+        int comma = value.indexOf(',', start);
+        v[count++] = (comma < 0 ? value.substring(start) : value.substring(start, comma)).toInt();
+        if (comma < 0) {
+            break;
+        }
+        start = comma + 1;
+    }
+    if (count != 4 && count != 6) {
+        sendError(CMD_ROI, "formato: x,y,w,h[,outW,outH] | off | status");
+        return;
+    }
+
+    RoiWindow window;
+    window.x = v[0];
+    window.y = v[1];
+    window.width = v[2];
+    window.height = v[3];
+    window.outWidth = count == 6 ? v[4] : v[2];
+    window.outHeight = count == 6 ? v[5] : v[3];
+
+    if (v[0] < 0 || v[1] < 0 || v[2] <= 0 || v[3] <= 0 || (count == 6 && (v[4] <= 0 || v[5] <= 0)) ||
+        !camManager->setRoi(window)) {
+        sendError(CMD_ROI, "ventana no válida (dentro de " + String(OV3660_ARRAY_WIDTH) + "x" +
+                  String(OV3660_ARRAY_HEIGHT) + ", salida múltiplo de 16x8 y no mayor que la ventana)");
+        return;
+    }
+
+    frameSender.invalidateJpegTables();
+    sendSuccess(CMD_ROI, value);
+    wsManager->sendText("{\"type\":\"roi_status\",\"active\":true," + camManager->getRoiJson() + "}");
+}
+
+void CommandProcessor::handlePreset(const String &value)
+{
+    if (!presetManager) {
+        sendError(CMD_PRESET, "no disponible");
+        return;
+    }
+
+    // "save:nombre", "apply:nombre", "delete:nombre", "boot:nombre|none"
+    int sep = value.indexOf(':');
+    String key = sep >= 0 ? value.substring(0, sep) : value;
+    String name = sep >= 0 ? value.substring(sep + 1) : "";
+
+    if (key == "" || key == "list" || key == "status") {
+        wsManager->sendText(presetManager->getStatusJson());
+        sendSuccess(CMD_PRESET, "status");
+    }
+    else if (key == "save") {
+        if (!PresetManager::isValidName(name)) {
+            sendError(CMD_PRESET, "nombre no válido (1-" + String(PRESET_NAME_MAX) + " caracteres a-z 0-9 _ -)");
+        } else if (presetManager->save(name)) {
+            sendSuccess(CMD_PRESET, "save:" + name);
+        } else {
+            sendError(CMD_PRESET, "sin espacio (máximo " + String(PRESET_MAX) + " presets)");
+        }
+    }
+    else if (key == "apply") {
+        if (!presetManager->exists(name)) {
+            sendError(CMD_PRESET, "preset no encontrado: " + name);
+            return;
+        }
+
+        // Un cambio de resolución desactiva la ROI
+        bool roiWasActive = camManager->isRoiActive();
+        // El preset trae su modo: el gobernador no debe cambiarlo después
+        if (modeGovernor) {
+            modeGovernor->setEnabled(false);
+        }
+        if (presetManager->apply(name)) {
+            sendSuccess(CMD_PRESET, "apply:" + name + " (" + camManager->getResolutionName() + ")");
+        } else {
+            sendError(CMD_PRESET, "apply:" + name + " aplicado parcialmente");
+        }
+        if (roiWasActive && !camManager->isRoiActive()) {
+            wsManager->sendText("{\"type\":\"roi_status\",\"active\":false}");
+        }
+    }
+    else if (key == "delete") {
+        if (presetManager->remove(name)) {
+            sendSuccess(CMD_PRESET, "delete:" + name);
+        } else {
+            sendError(CMD_PRESET, "preset no encontrado: " + name);
+        }
+    }
+    else if (key == "boot") {
+        if (presetManager->setBootPreset(name == "none" ? "" : name)) {
+            sendSuccess(CMD_PRESET, "boot:" + (name.length() > 0 ? name : String("none")));
+        } else {
+            sendError(CMD_PRESET, "preset no encontrado: " + name);
+        }
+    }
+    else {
+        sendError(CMD_PRESET, "valor no válido (list/save:N/apply:N/delete:N/boot:N|none)");
+    }
+}
+
+void CommandProcessor::handleProfile(const String &value)
+{
+    if (!streamProfiles) {
+        sendError(CMD_PROFILE, "no disponible");
+        return;
+    }
+
+    // "use:P", "new:nombre[,base]", "set:P,campo=valor,...", "reset:P";
+    // P = nombre o índice del perfil
+    int sep = value.indexOf(':');
+    String key = sep >= 0 ? value.substring(0, sep) : value;
+    String args = sep >= 0 ? value.substring(sep + 1) : "";
+    int comma = args.indexOf(',');
+    String target = comma >= 0 ? args.substring(0, comma) : args;
+    String rest = comma >= 0 ? args.substring(comma + 1) : "";
+
+    if (key == "" || key == "list" || key == "status") {
+        wsManager->sendText(streamProfiles->getStatusJson(frameSender.getMode()));
+        sendSuccess(CMD_PROFILE, "status");
+    }
+    else if (key == "use") {
+        int index = streamProfiles->find(target);
+        if (index < 0) {
+            sendError(CMD_PROFILE, "perfil no encontrado: " + target);
+            return;
+        }
+        selectMode(index);
+        sendSuccess(CMD_PROFILE, "use:" + frameSender.getModeName());
+    }
+    else if (key == "new") {
+        int base = rest.length() > 0 ? streamProfiles->find(rest) : frameSender.getMode();
+        int index = base >= 0 ? streamProfiles->create(target, base) : -1;
+        if (index >= 0) {
+            sendSuccess(CMD_PROFILE, "new:" + target + " (" + String(index) + ")");
+        } else {
+            sendError(CMD_PROFILE, "no se pudo crear (nombre repetido o no válido, base inexistente o sin huecos)");
+        }
+    }
+    else if (key == "set") {
+        int index = streamProfiles->find(target);
+        String error;
+        if (index < 0) {
+            sendError(CMD_PROFILE, "perfil no encontrado: " + target);
+        } else if (streamProfiles->edit(index, rest, error)) {
+            if (index == frameSender.getMode()) {
+                frameSender.refreshProfile();
+            }
+            sendSuccess(CMD_PROFILE, "set:" + target);
+        } else {
+            sendError(CMD_PROFILE, error + " (chunks=a/b/c/d/e, gap, header, frame, footer, small, "
+                                           "pace=KB/s, direct, ack, grab=latest|empty|keep, qmin, qmax)");
+        }
+    }
+    else if (key == "reset" || key == "delete") {
+        int index = streamProfiles->find(target);
+        if (index < 0 || !streamProfiles->reset(index)) {
+            sendError(CMD_PROFILE, "perfil no encontrado: " + target);
+            return;
+        }
+        // El perfil activo se borró o volvió a sus valores de fábrica
+        if (index == frameSender.getMode()) {
+            if (streamProfiles->isValid(index)) {
+                frameSender.refreshProfile();
+            } else {
+                frameSender.setMode(MODE_STABILITY);
+            }
+        }
+        sendSuccess(CMD_PROFILE, key + ":" + target);
+    }
+    else {
+        sendError(CMD_PROFILE, "valor no válido (list/use:P/new:N[,base]/set:P,campo=valor,.../reset:P)");
+    }
+}
+
+void CommandProcessor::handleBwcap(const String &value)
+{
+    // "KB/s", "KB/s,ráfagaKB", "off" o "status"
+    if (value == "" || value == "status") {
+        wsManager->sendText("{\"type\":\"bwcap_status\"," + wsManager->getBandwidthJson() + "}");
+        sendSuccess(CMD_BWCAP, "status");
+        return;
+    }
+
+    uint32_t rate = 0;
+    uint32_t burst = 0;
+    if (value != "off") {
+        int comma = value.indexOf(',');
+        rate = (comma < 0 ? value : value.substring(0, comma)).toInt() * 1024;
+        burst = comma < 0 ? 0 : value.substring(comma + 1).toInt() * 1024;
+    }
+
+    if (value != "off" && value != "0" && rate == 0) {
+        sendError(CMD_BWCAP, "valor no válido (KB/s[,ráfaga KB] u off)");
+        return;
+    }
+    if (!wsManager->setBandwidthCap(rate, burst)) {
+        sendError(CMD_BWCAP, "fuera de rango (" + String(BWCAP_MIN_KBPS) + "-" + String(BWCAP_MAX_KBPS) + " KB/s)");
+        return;
+    }
+
+    if (rate == 0) {
+        sendSuccess(CMD_BWCAP, "off");
+    } else {
+        sendSuccess(CMD_BWCAP, String(rate / 1024) + " KB/s, ráfaga " +
+                                   String(wsManager->getBandwidthBurst() / 1024) + " KB");
+    }
+}
+
+void CommandProcessor::handlePace(const String &value)
+{
+    if (!framePacer) {
+        sendError(CMD_PACE, "no disponible");
+        return;
+    }
+
+    // "burst", "spread", "spread,porcentaje" o "status"
+    if (value == "" || value == "status") {
+        wsManager->sendText("{\"type\":\"pace_status\"," + framePacer->getStatsJson() + "}");
+        sendSuccess(CMD_PACE, "status");
+        return;
+    }
+
+    int comma = value.indexOf(',');
+    String key = comma < 0 ? value : value.substring(0, comma);
+
+    if (key == "burst" || key == "off") {
+        framePacer->setSpread(false, framePacer->getSpreadPercent());
+        sendSuccess(CMD_PACE, "burst");
+    }
+    else if (key == "spread" || key == "on") {
+        int percent = comma < 0 ? framePacer->getSpreadPercent() : value.substring(comma + 1).toInt();
+        if (percent < PACE_SPREAD_PCT_MIN || percent > PACE_SPREAD_PCT_MAX) {
+            sendError(CMD_PACE, "porcentaje no válido (" + String(PACE_SPREAD_PCT_MIN) + "-" +
+                                    String(PACE_SPREAD_PCT_MAX) + ")");
+            return;
+        }
+        framePacer->setSpread(true, percent);
+        sendSuccess(CMD_PACE, "spread," + String(percent));
+    }
+    else {
+        sendError(CMD_PACE, "valor no válido (burst, spread[,porcentaje] o status)");
+    }
+}
+
 void CommandProcessor::sendSuccess(const String &cmd, const String &value)
 {
+    if (batchMode) {
+        return;
+    }
     wsManager->sendCommandResponse(cmd, "ok", value);
 }
 
 void CommandProcessor::sendError(const String &cmd, const String &message)
 {
+    if (batchMode) {
+        batchError = message.length() > 0 ? message : "error";
+        return;
+    }
     wsManager->sendCommandResponse(cmd, "error", message);
 }
\ No newline at end of file
@@ -10,6 +10,37 @@ class WebSocketManager;
 class CameraManager;
 class HealthMonitor;
 class FPSController;
+class ChunkTuner;
+class BandwidthProbe;
+class DeltaEncoder;
+class PreviewGenerator;
+class SnapshotScheduler;
+class EventBuffer;
+class Recorder;
+class SensorBench;
+class BootProfiler;
+class SessionManager;
+class PresetManager;
+class StreamProfiles;
+class ModeGovernor;
+class FramePacer;
+class CommandProcessor;
+
+// Hash FNV-1a de 32 bits del nombre, evaluable en compilación. Es la clave
+// de la tabla de despacho y el identificador del comando en formato binario
+constexpr uint32_t commandHash(const char *s, uint32_t h = 2166136261u)
+{
+    return *s ? commandHash(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+// Entrada de la tabla de despacho
+struct CommandEntry
+{
+    uint32_t hash;
+    const char *name;
+    void (CommandProcessor::*handler)(const String &value);
+    bool batchable; // Ajuste que puede aplicarse (y revertirse) dentro de un lote
+};
 
 class CommandProcessor
 {
@@ -18,12 +49,56 @@ public:
 
     void processMessage(const String &message);
     void processCommand(const String &command, const String &value);
+    void processBinary(const uint8_t *data, size_t length); // Comandos y lotes binarios (CMD_MAGIC)
+    void setChunkTuner(ChunkTuner *tuner);
+    void setBandwidthProbe(BandwidthProbe *probe);
+    void setDeltaEncoder(DeltaEncoder *encoder);
+    void setPreviewGenerator(PreviewGenerator *generator);
+    void setSnapshotScheduler(SnapshotScheduler *scheduler);
+    void setEventBuffer(EventBuffer *buffer);
+    void setRecorder(Recorder *rec);
+    void setSensorBench(SensorBench *bench);
+    void setBootProfiler(BootProfiler *profiler);
+    void setSessionManager(SessionManager *session);
+    void setPresetManager(PresetManager *presets);
+    void setStreamProfiles(StreamProfiles *profiles);
+    void setModeGovernor(ModeGovernor *governor);
+    void setFramePacer(FramePacer *pacer);
 
 private:
     WebSocketManager *wsManager;
     CameraManager *camManager;
     HealthMonitor *healthMonitor;
     FPSController *fpsController;
+    ChunkTuner *chunkTuner;
+    BandwidthProbe *bandwidthProbe;
+    DeltaEncoder *deltaEncoder;
+    PreviewGenerator *previewGenerator;
+    SnapshotScheduler *snapshotScheduler;
+    EventBuffer *eventBuffer;
+    Recorder *recorder;
+    SensorBench *sensorBench;
+    BootProfiler *bootProfiler;
+    SessionManager *sessionManager;
+    PresetManager *presetManager;
+    StreamProfiles *streamProfiles;
+    ModeGovernor *modeGovernor;
+    FramePacer *framePacer;
+
+    // Tabla de despacho: hash → handler
+    static const CommandEntry commandTable[];
+    static const size_t commandCount;
+    static const CommandEntry *findCommand(uint32_t hash);
+
+    // Lote en curso: las respuestas individuales se suprimen y el primer
+    // error se guarda para la respuesta única
+    bool batchMode;
+    String batchError;
+
+    void dispatch(const CommandEntry *entry, const String &value);
+    void runBatch(uint16_t batchId, const CommandEntry **entries, const String *values, size_t count);
+    void sendBatchResult(uint16_t batchId, const char *status, size_t applied, const String &error);
+    void selectMode(uint8_t mode); // Modo elegido a mano: desactiva el gobernador
 
     // Handlers de comandos (ordenados por prioridad)
     void handleReboot(const String &value);           // PRIORIDAD CRÍTICA
@@ -39,6 +114,27 @@ private:
     void handleWhiteBalance(const String &value);     // PRIORIDAD NORMAL
     void handleHMirror(const String &value);          // PRIORIDAD NORMAL
     void handleVFlip(const String &value);            // PRIORIDAD NORMAL
+    void handleChunkTune(const String &value);        // PRIORIDAD NORMAL
+    void handleProbe(const String &value);            // PRIORIDAD NORMAL
+    void handleAbbrev(const String &value);           // PRIORIDAD NORMAL
+    void handleSlices(const String &value);           // PRIORIDAD NORMAL
+    void handleDelta(const String &value);            // PRIORIDAD NORMAL
+    void handlePreview(const String &value);          // PRIORIDAD NORMAL
+    void handleSnapshot(const String &value);         // PRIORIDAD NORMAL
+    void handleEvent(const String &value);            // PRIORIDAD NORMAL
+    void handleRecord(const String &value);           // PRIORIDAD NORMAL
+    void handleRecBench(const String &value);         // PRIORIDAD NORMAL
+    void handleSensorBench(const String &value);      // PRIORIDAD NORMAL
+    void handleRoi(const String &value);              // PRIORIDAD ALTA
+    void handlePreset(const String &value);           // PRIORIDAD ALTA
+    void handleProfile(const String &value);          // PRIORIDAD NORMAL
+    void handleBwcap(const String &value);            // PRIORIDAD ALTA
+    void handlePace(const String &value);             // PRIORIDAD NORMAL
+
+    // Confirmaciones de transferencia
+    void handleFrameNack(JsonDocument &doc);
+    void handleProbeReport(JsonDocument &doc);
+    void handleBatch(JsonDocument &doc);
 
     void sendSuccess(const String &cmd, const String &value = "");
     void sendError(const String &cmd, const String &message = "");
@@ -11,8 +11,37 @@
 // === MODOS DE OPERACIÓN ===
 #define MODE_SPEED 0     // Velocidad: FPS altos, menos pausas
 #define MODE_STABILITY 1 // Estabilidad: Transferencias confiables (DEFAULT)
+#define MODE_LOW_LATENCY 2 // Sin pausas, envío directo hasta 30KB, siempre el frame más reciente
+#define MODE_ARCHIVE 3     // Calidad JPEG alta, transferencias de estabilidad
+#define MODE_METERED 4     // Tasa limitada y calidad baja para enlaces con cuota
 #define DEFAULT_MODE MODE_STABILITY
 
+// === PERFILES DE STREAMING (comandos mode y profile) ===
+// Cada modo es un perfil editable en tiempo de ejecución y guardado en NVS
+// (namespace "profiles"): tabla de chunks, pausas, techo de pacing,
+// umbrales de método de envío, modo de captura y límites de calidad
+#define STREAM_PROFILE_MAX 8       // Perfiles integrados + propios
+#define STREAM_PROFILE_BUILTIN 5   // Los MODE_* anteriores (no se pueden borrar)
+#define STREAM_PROFILE_NAME_MAX 15
+#define STREAM_PROFILE_TIERS 5     // Tramos de la tabla de chunks (ver THRESHOLD_*)
+#define STREAM_PROFILE_GRAB_KEEP 0xFF // No cambiar el modo de captura
+
+// === SELECCIÓN AUTOMÁTICA DE MODO (comando mode auto) ===
+// Escalera velocidad ↔ estabilidad según éxito, variabilidad del tiempo de
+// transferencia y calidad del enlace, con histéresis y permanencia mínima
+#define GOVERNOR_DEFAULT false          // Arrancar en modo automático
+#define GOVERNOR_EVAL_MS 2000           // Evaluación de la ventana de frames
+#define GOVERNOR_MIN_FRAMES 8           // Frames mínimos para evaluar una ventana
+#define GOVERNOR_DOWN_SUCCESS 0.90f     // Bajo este éxito: modo más seguro
+#define GOVERNOR_UP_SUCCESS 0.99f       // Éxito necesario para subir
+#define GOVERNOR_DOWN_CV 0.60f          // Variabilidad (desv/media) que fuerza bajar
+#define GOVERNOR_UP_CV 0.30f            // Variabilidad máxima para subir
+#define GOVERNOR_UP_LINK_SCORE 60       // Puntuación del enlace mínima para subir
+#define GOVERNOR_UP_WINDOWS 3           // Ventanas buenas consecutivas para subir
+#define GOVERNOR_DOWN_DWELL_MS 5000     // Permanencia mínima antes de bajar
+#define GOVERNOR_UP_DWELL_MS 30000      // Permanencia mínima antes de subir
+#define GOVERNOR_UP_DWELL_MAX_MS 300000 // Tope del backoff tras una subida fallida
+
 // === TIMEOUTS Y DELAYS (CONFIGURABLES) ===
 // Modo Estabilidad
 #define DELAY_BETWEEN_CHUNKS_STABILITY 30 // ms entre chunks (estabilidad)
@@ -32,8 +61,77 @@
 #define DELAY_MAIN_LOOP 5              // ms en el loop principal
 #define DELAY_WS_PROCESSING 2          // ms para procesamiento WS
 #define DELAY_CAMERA_STABILIZATION 100 // ms después de cambiar resolución
+#define RESOLUTION_SWITCH_TIMEOUT_MS 1500 // ms máximos hasta el primer frame válido tras cambiar
+#define RECOVERY_SOFT_TIMEOUT_MS 1000  // ms esperando un frame válido tras el reset por SCCB (+ hasta un timeout del driver, ~4 s)
+#define RECOVERY_HARD_DELAY_MS 500     // ms tras esp_camera_deinit antes de reinicializar
 #define DELAY_BEFORE_REBOOT 500        // ms antes de reiniciar (URGENTE)
 
+// === ARRANQUE (cámara en paralelo con el WiFi) ===
+#define BOOT_MAX_STAGES 16            // Etapas de la línea de tiempo del arranque
+#define BOOT_CAMERA_TASK_STACK 8192   // Pila de la tarea de init de la cámara
+#define BOOT_CAMERA_TASK_CORE 1       // Mismo núcleo que loop(): las IRQ del driver quedan ahí
+#define CAMERA_WARMUP_FRAMES 5        // Frames descartados para que AEC/AGC converjan
+#define BOOT_MAX_PENDING_MESSAGES 8   // Mensajes del servidor retenidos hasta terminar el init de la cámara
+
+// === PRESETS DE CÁMARA EN NVS (comando preset) ===
+#define PRESET_MAX 8          // Presets guardados
+#define PRESET_NAME_MAX 12    // Caracteres por nombre (clave NVS "p.<nombre>")
+
+// === REANUDACIÓN DE SESIÓN WEBSOCKET ===
+#define SESSION_RESUME_TIMEOUT_MS 1000 // Sin respuesta al resume: registro completo
+
+// === CONEXIÓN WIFI RÁPIDA (BSSID/canal en caché + escaneo) ===
+// Ruta rápida: último AP (BSSID y canal en NVS) sin escanear. Si falla,
+// un único escaneo ordena las redes conocidas visibles por RSSI.
+#define WIFI_FAST_TIMEOUT_MS 3000     // Máximo para la ruta rápida antes de escanear
+#define WIFI_CONNECT_TIMEOUT_MS 8000  // Máximo por red en escaneo/lista
+#define WIFI_POLL_MS 50               // Sondeo del estado de la conexión
+#define WIFI_SCAN_MS_PER_CHANNEL 120  // Escaneo activo por canal
+#define WIFI_MAX_CANDIDATES 8         // Redes conocidas visibles que se prueban
+#define WIFI_STATIC_IP_CACHE false    // Reutilizar la última IP (solo con reserva DHCP)
+
+// === ESTIMADOR DE CALIDAD DEL ENLACE ===
+#define LINK_SAMPLE_MS 1000            // Muestreo de RSSI, PHY y contadores TCP
+#define LINK_PING_INTERVAL_MS 2000     // Ping WebSocket con marca de tiempo (RTT)
+#define LINK_EWMA_ALPHA 0.3f           // Suavizado de RTT, goodput y tasas de pérdida
+#define LINK_SCORE_ALPHA 0.2f          // Suavizado de la puntuación
+#define LINK_RTT_GOOD_MS 20            // RTT con puntuación 100
+#define LINK_RTT_BAD_MS 400            // RTT con puntuación 0
+#define LINK_RETRANS_BAD_PER_SEC 5     // Retransmisiones/s con puntuación 0
+#define LINK_GOODPUT_GOOD_KBPS 1000    // Goodput con puntuación 100
+#define LINK_SCORE_POOR 40             // Bajo este valor el enlace se considera malo
+// Pesos de cada componente en la puntuación
+#define LINK_WEIGHT_RSSI 15
+#define LINK_WEIGHT_PHY 10
+#define LINK_WEIGHT_LOSS 25
+#define LINK_WEIGHT_RTT 25
+#define LINK_WEIGHT_GOODPUT 25
+
+// === TOPE DE ANCHO DE BANDA (comando bwcap) ===
+// Token bucket sobre todo lo que sale por el WebSocket (frames, chunks,
+// telemetría y pings). Sin presupuesto el frame se descarta antes de
+// enviarse y la calidad JPEG baja un paso. Se guarda en NVS ("bwcap")
+#define BWCAP_MIN_KBPS 8                // Tope mínimo aceptado
+#define BWCAP_MAX_KBPS 10000            // Tope máximo aceptado
+#define BWCAP_BURST_DEFAULT_MS 1000     // Ráfaga por defecto: un segundo de tasa
+#define BWCAP_BURST_MIN 8192            // Ráfaga mínima (bytes)
+#define BWCAP_FRAME_OVERHEAD 8          // Cabecera + máscara WebSocket por mensaje
+#define BWCAP_QUALITY_STEP 2            // Paso de calidad JPEG por falta de presupuesto
+#define BWCAP_QUALITY_HOLD_MS 2000      // Tiempo mínimo entre pasos de calidad
+#define BWCAP_QUALITY_RECOVER_MS 10000  // Sin descartes durante este tiempo: recuperar un paso
+
+// === PACING REPARTIDO (comando pace) ===
+// Los bytes de cada frame salen a tasa constante sobre parte del intervalo
+// de frame en lugar de en ráfaga seguida de espera
+#define PACE_SPREAD_DEFAULT false  // Arrancar con reparto
+#define PACE_SPREAD_PCT 75         // Parte del intervalo usada (el resto absorbe ACK y retrasos)
+#define PACE_SPREAD_PCT_MIN 20
+#define PACE_SPREAD_PCT_MAX 95
+#define PACE_YIELD_US 2000         // Esperas mayores atienden el WebSocket; el resto, espera activa
+#define PACE_BURST_GAP_US 2000     // Chunks separados por menos cuentan como una misma ráfaga
+#define PACE_STATS_ALPHA 0.2f      // Suavizado de las métricas por frame
+#define PACE_LATENCY_WINDOW 32     // Tiempos de transferencia para p50/p95/p99
+
 // === CHUNK SIZES ADAPTATIVOS ===
 // Para imágenes pequeñas (<30KB)
 #define CHUNK_SIZE_TINY 1024 // 1KB
@@ -62,6 +160,141 @@
 #define THRESHOLD_XLARGE 200000  // 200KB
 #define THRESHOLD_XXLARGE 400000 // 400KB
 
+// === AUTO-TUNING DE CHUNK SIZE ===
+// Explora tamaños candidatos (incluyendo múltiplos del MSS TCP) por
+// resolución, modo y red; el mejor se guarda en NVS (namespace "chunktune")
+#ifdef CONFIG_LWIP_TCP_MSS
+#define CHUNK_TUNER_MSS CONFIG_LWIP_TCP_MSS
+#else
+#define CHUNK_TUNER_MSS 1436 // MSS por defecto de lwIP en arduino-esp32
+#endif
+#define CHUNK_TUNER_SAMPLES 3          // Frames medidos por candidato
+#define CHUNK_TUNER_DEGRADE_PCT 60     // Re-explorar si cae bajo este % del mejor
+#define CHUNK_TUNER_CHECK_FRAMES 20    // Frames promediados al vigilar degradación
+#define CHUNK_TUNER_ENABLED true
+
+// === SONDA DE ANCHO DE BANDA (comando probe) ===
+#define PROBE_MAGIC 0xB7               // Primer byte de los paquetes sintéticos
+#define PROBE_DURATION_MS 3000         // Duración total por defecto
+#define PROBE_DURATION_MAX 10000       // Límite duro de la medición
+#define PROBE_STEPS 5                  // Reparto de la duración: tiempo de cada escalón
+#define PROBE_STEPS_MAX 12             // Tope de escalones; la tasa se dobla hasta saturar
+#define PROBE_START_KBPS 100           // Tasa del primer escalón (se duplica)
+#define PROBE_PACKET_SIZE 4096         // Bytes por paquete sintético
+#define PROBE_PING_INTERVAL 200        // ms entre probe_ping (RTT)
+#define PROBE_REPORT_TIMEOUT 2000      // ms esperando probe_report del servidor
+#define PROBE_SATURATION_PCT 80        // Escalón saturado si se logra < 80% de la tasa
+#define PROBE_RTT_INFLATION 2.0f       // Escalón saturado si su RTT medio supera el mínimo x factor
+#define PROBE_RTT_INFLATION_MIN_MS 20  // ... y lo supera en al menos estos ms (ruido con RTT bajos)
+#define PROBE_UTILIZATION_PCT 70       // % del throughput usable por el stream
+#define PROBE_PACING_PCT 90            // % del throughput usado para pacing
+
+// === JPEG ABREVIADO (tablas DQT/DHT una sola vez) ===
+#define JPEG_ABBREV_DEFAULT false // Activable con el comando "abbrev"
+
+// === CHUNKS ALINEADOS A MARCADORES RSTn (comando slices) ===
+// El encoder JPEG del sensor inserta un RSTn por cada fila de MCUs y los chunks
+// se cortan en esos límites: el receptor muestra cada franja al llegar.
+// Registros del intervalo de reinicio del bloque JPEG (familia OV5640/OV3660).
+// SIN VERIFICAR: no están contrastados con el datasheet ni con una captura del
+// sensor. Por eso no se da nada por hecho: se guardan los valores previos, se
+// comprueba que el frame siguiente trae DRI y, si no, o al desactivar, se
+// restauran los valores guardados y se sigue cortando por bytes.
+#define OV3660_REG_JPEG_RESTART_H 0x4404
+#define OV3660_REG_JPEG_RESTART_L 0x4405
+#define SLICE_CHUNKING_DEFAULT false
+
+// === REPOSICIÓN CONDICIONAL (comando delta) ===
+// Con RSTn activos solo se envían los intervalos que cambiaron respecto al
+// último keyframe; el receptor parchea su último frame
+#define DELTA_MAGIC 0xD3            // Primer byte de un frame delta
+#define DELTA_KEYFRAME_PERIOD 30    // Frames entre keyframes completos
+#define DELTA_THRESHOLD_PCT 3       // Intervalo "igual" si su tamaño varía <= 3%
+#define DELTA_MAX_PCT 70            // Delta mayor que este % del frame → keyframe
+
+// === VISTA PREVIA 1/8 (comando preview) ===
+// Decodificación solo-DC del frame capturado → gris 8 bits a 1/8 de escala,
+// enviada como substream binario aparte a baja tasa
+#define PREVIEW_MAGIC 0xA7          // Primer byte de cada vista previa
+#define PREVIEW_FORMAT_RAW 0        // Gris 8 bits sin comprimir
+#define PREVIEW_FORMAT_JPEG 1       // Gris recomprimido con fmt2jpg
+#define PREVIEW_FORMAT_DEFAULT PREVIEW_FORMAT_JPEG
+#define PREVIEW_JPEG_QUALITY 60     // Calidad fmt2jpg (0-100, mayor = mejor)
+#define PREVIEW_INTERVAL_MS 1000    // ms entre vistas previas
+#define PREVIEW_INTERVAL_MAX 10000
+
+// === SNAPSHOTS EN ALTA RESOLUCIÓN (comando snapshot) ===
+// El stream sigue en su perfil normal; cada N segundos (o bajo comando) se
+// cambia al perfil de snapshot, se toma un frame y se vuelve sin validaciones
+#define SNAPSHOT_RESOLUTION RES_UXGA   // Perfil de snapshot por defecto
+#define SNAPSHOT_QUALITY 8             // Calidad JPEG del snapshot
+#define SNAPSHOT_INTERVAL_S 0          // Segundos entre snapshots (0 = solo bajo comando)
+#define SNAPSHOT_INTERVAL_MAX_S 3600
+#define SNAPSHOT_SWITCH_TIMEOUT 1500   // ms máximos esperando el primer frame del perfil
+#define SNAPSHOT_SETTLE_FRAMES 0       // Frames extra descartados tras el cambio
+#define CAMERA_FB_MAX_RES RES_QXGA     // Buffers dimensionados para el perfil más grande
+
+// === ROI: ZOOM DIGITAL POR VENTANA DEL SENSOR (comando roi) ===
+// Ventana del array del OV3660 programada con set_res_raw: recorte a densidad
+// nativa (o reescalado si la salida es menor). Geometría del modo 4:3 sin binning
+#define OV3660_ARRAY_WIDTH 2048
+#define OV3660_ARRAY_HEIGHT 1536
+#define OV3660_WINDOW_PAD_X 32   // Píxeles extra de la ventana que consume el ISP
+#define OV3660_WINDOW_PAD_Y 12
+#define OV3660_ISP_OFFSET_X 16
+#define OV3660_ISP_OFFSET_Y 6
+#define OV3660_HTS 2300          // Píxeles por línea (reloj de línea del modo completo)
+#define ROI_VBLANK_LINES 16      // VTS = alto de la ventana + margen: ventana baja → más fps
+#define ROI_MIN_SIZE 64
+
+// === RELOJ Y BUFFERS DEL SENSOR (comando sensorbench) ===
+// Valores por defecto; sensorbench puede guardar en NVS la combinación
+// más rápida estable medida para la resolución del stream
+#define CAMERA_XCLK_HZ 10000000
+#define CAMERA_FB_COUNT 2
+#define CAMERA_GRAB_MODE CAMERA_GRAB_WHEN_EMPTY
+#define SENSORBENCH_MS 1000            // Medición por combinación
+#define SENSORBENCH_SETTLE_FRAMES 2    // Frames descartados tras cada cambio
+#define SENSORBENCH_MAX_SAMPLES 64     // Tamaños guardados para la distribución
+
+// === HISTORIAL PRE-EVENTO EN PSRAM (comando event) ===
+// Anillo de los últimos JPEG capturados; un trigger o un salto de tamaño del
+// JPEG (movimiento) sube la ventana guardada intercalada con el stream en vivo
+#define EVENT_BUFFER_DEFAULT false
+#define EVENT_BUFFER_BUDGET_KB 2048    // Presupuesto en PSRAM (se desalojan los más viejos)
+#define EVENT_BUFFER_BUDGET_MAX_KB 4096
+#define EVENT_BUFFER_MAX_FRAMES 256    // Entradas del índice
+#define EVENT_MOTION_DEFAULT false
+#define EVENT_MOTION_THRESHOLD_PCT 25  // Salto de tamaño vs. la media móvil que dispara
+#define EVENT_MOTION_WARMUP 8          // Frames antes de evaluar movimiento
+#define EVENT_MOTION_COOLDOWN_MS 15000 // Espera mínima entre eventos por movimiento
+
+// === GRABACIÓN LOCAL AVI/MJPEG (comandos record y recbench) ===
+// Segmentos AVI con índice idx1; escrituras en bloques múltiplos del sector.
+// Los segmentos grabados sin conexión se suben (backfill) al reconectar
+#define RECORDER_STORAGE_LITTLEFS 0     // Partición spiffs de la flash
+#define RECORDER_STORAGE_SD 1           // Tarjeta SD (SD_MMC 1 bit, pines en pins.h)
+#define RECORDER_STORAGE RECORDER_STORAGE_LITTLEFS
+#define RECORDER_MODE_OFF 0
+#define RECORDER_MODE_CONTINUOUS 1      // Graba todo lo capturado
+#define RECORDER_MODE_DISCONNECTED 2    // Graba solo mientras no hay conexión
+#define RECORDER_MODE_DEFAULT RECORDER_MODE_OFF
+#define RECORDER_SECTOR_SIZE 512
+#define RECORDER_WRITE_BUFFER (16 * 1024) // Múltiplo de RECORDER_SECTOR_SIZE
+#define RECORDER_MAX_FRAMES 3000        // Frames por segmento (índice en memoria)
+#define RECORDER_MIN_FREE_KB 128        // Por debajo se deja de grabar
+#define RECORDER_BACKFILL_QUEUE 8       // Segmentos sin conexión pendientes de subir
+#define RECBENCH_MS 3000                // Duración de escritura por resolución
+#define RECBENCH_FILE "/recbench.avi"
+
+// === INTEGRIDAD Y RETRANSMISIÓN DE CHUNKS ===
+#define CHUNK_MAGIC 0xC5            // Primer byte de la cabecera binaria de cada chunk
+#define CHUNK_FLAG_RETRANSMIT 0x01  // Chunk reenviado tras un NACK
+#define CHUNK_FLAG_SLICE 0x02       // Chunk = intervalos RSTn completos (decodificable)
+#define NACK_DEADLINE_MS 1500       // ms reteniendo el frame a la espera de ACK/NACK
+#define NACK_MAX_ROUNDS 3           // Rondas de retransmisión por frame
+#define NACK_MAX_INDICES 64         // Índices máximos aceptados en un NACK
+
 // === RESOLUCIONES DISPONIBLES PARA OV3660/ESP32-S3 ===
 #define RES_QQVGA 0 // 160x120     - Muy rápida, baja calidad
 #define RES_QCIF 1  // 176x144     - QCIF standard
@@ -86,6 +319,8 @@
 #define MIN_FPS 1
 #define MAX_FPS 30
 #define DEFAULT_FPS 20
+#define FPS_LATE_TOLERANCE_PCT 50 // Retraso máximo (% del intervalo) para enviar aún en su slot
+#define FPS_JITTER_WINDOW 64      // Intervalos entre frames entregados para FPS real y percentiles
 
 // === COMANDOS DISPONIBLES ===
 #define CMD_RESOLUTION "resolution"
@@ -102,6 +337,26 @@
 #define CMD_VFLIP "vflip"
 #define CMD_FRAMESIZE "framesize"
 #define CMD_MODE "mode"
+#define CMD_CHUNKTUNE "chunktune"
+#define CMD_PROBE "probe"
+#define CMD_ABBREV "abbrev"
+#define CMD_SLICES "slices"
+#define CMD_DELTA "delta"
+#define CMD_PREVIEW "preview"
+#define CMD_SNAPSHOT "snapshot"
+#define CMD_EVENT "event"
+#define CMD_RECORD "record"
+#define CMD_RECBENCH "recbench"
+#define CMD_SENSORBENCH "sensorbench"
+#define CMD_ROI "roi"
+#define CMD_PRESET "preset"
+#define CMD_PROFILE "profile"
+#define CMD_BWCAP "bwcap"
+#define CMD_PACE "pace"
+
+// === COMANDOS BINARIOS Y LOTES ATÓMICOS ===
+#define CMD_MAGIC 0xCB    // Primer byte de un comando o lote binario
+#define CMD_BATCH_MAX 16  // Ajustes máximos por lote
 
 // === PRIORIDADES DE COMANDOS ===
 #define PRIORITY_CRITICAL 0 // Reboot, emergencias
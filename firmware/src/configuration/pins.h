@@ -19,4 +19,9 @@
 #define HREF_GPIO_NUM 7
 #define PCLK_GPIO_NUM 13
 
+// === PINES TARJETA SD (SD_MMC 1 bit) ===
+#define SD_MMC_CLK_GPIO_NUM 39
+#define SD_MMC_CMD_GPIO_NUM 38
+#define SD_MMC_D0_GPIO_NUM 40
+
 #endif
\ No newline at end of file
@@ -0,0 +1,254 @@
+#include "delta_encoder.h"
+#include "../jpeg_utils/jpeg_utils.h"
+#include <Arduino.h>
+#include <esp_crc.h>
+
+DeltaEncoder::DeltaEncoder()
+    : enabled(false), keyframeNeeded(true), keyframePeriod(DELTA_KEYFRAME_PERIOD),
+      thresholdPct(DELTA_THRESHOLD_PCT), current(nullptr), reference(nullptr), markers(nullptr),
+      refCount(0), refHeaderCrc(0), seq(0), framesSinceKey(0), buffer(nullptr), bufferSize(0),
+      bytesSaved(0), deltaFrames(0), keyframes(0)
+{
+}
+
+bool DeltaEncoder::allocate()
+{
+    if (current)
+        return true;
+
+    // Solo se reserva al usar el modo delta (~6KB)
+    current = (Interval *)malloc(sizeof(Interval) * (JPEG_MAX_RESTART_MARKERS + 1));
+    reference = (Interval *)malloc(sizeof(Interval) * (JPEG_MAX_RESTART_MARKERS + 1));
+    markers = (uint32_t *)malloc(sizeof(uint32_t) * JPEG_MAX_RESTART_MARKERS);
+    if (!current || !reference || !markers)
+    {
+        free(current);
+        free(reference);
+        free(markers);
+        current = nullptr;
+        reference = nullptr;
+        markers = nullptr;
+        Serial.println("[DELTA] ✗ Sin memoria para huellas de intervalos");
+        return false;
+    }
+    return true;
+}
+
+uint16_t DeltaEncoder::splitIntervals(const camera_fb_t &frame, uint32_t &headerCrc)
+{
+    JpegLayout layout;
+    if (!JpegParser::parse(frame.buf, frame.len, layout) || layout.restartInterval == 0)
+        return 0;
+
+    size_t count = JpegParser::findRestartMarkers(frame.buf, frame.len, layout,
+                                                  markers, JPEG_MAX_RESTART_MARKERS);
+    if (count == 0 || count >= JPEG_MAX_RESTART_MARKERS)
+        return 0;
+
+    // Cabecera (tablas, SOF, DRI, SOS): si cambia, la referencia ya no sirve
+    headerCrc = esp_crc32_le(0, frame.buf, layout.scanOffset);
+
+    // Intervalo k = datos entrópicos + su RSTn final; el último termina en el EOI
+    size_t eoi = frame.len;
+    if (frame.len >= 2 && frame.buf[frame.len - 2] == 0xFF && frame.buf[frame.len - 1] == 0xD9)
+        eoi = frame.len - 2;
+
+    for (size_t k = 0; k <= count; k++)
+    {
+        size_t start = k ? markers[k - 1] + 2 : layout.scanOffset;
+        size_t end = (k < count) ? markers[k] + 2 : eoi;
+        current[k].start = start;
+        current[k].length = end - start;
+        current[k].crc = esp_crc32_le(0, frame.buf + start, end - start);
+    }
+
+    return count + 1;
+}
+
+bool DeltaEncoder::isChanged(uint16_t index) const
+{
+    const Interval &cur = current[index];
+    const Interval &ref = reference[index];
+    if (cur.crc == ref.crc)
+        return false;
+
+    // Casi idéntico: ruido del sensor que apenas cambia el tamaño codificado.
+    // Se compara contra la referencia enviada, así la deriva se acumula y acaba
+    // superando el umbral.
+    uint32_t diff = cur.length > ref.length ? cur.length - ref.length : ref.length - cur.length;
+    return diff * 100 > (uint32_t)thresholdPct * ref.length;
+}
+
+void DeltaEncoder::storeKeyframe(uint16_t count, uint32_t headerCrc)
+{
+    memcpy(reference, current, sizeof(Interval) * count);
+    refCount = count;
+    refHeaderCrc = headerCrc;
+    seq = 0;
+    framesSinceKey = 0;
+    keyframeNeeded = false;
+    keyframes++;
+}
+
+bool DeltaEncoder::encode(camera_fb_t &frame)
+{
+    if (!enabled || !allocate())
+        return false;
+
+    uint32_t headerCrc = 0;
+    uint16_t count = splitIntervals(frame, headerCrc);
+    if (count == 0)
+    {
+        // Sin RSTn no hay unidades reemplazables: frames completos
+        keyframeNeeded = true;
+        return false;
+    }
+
+    if (keyframeNeeded || count != refCount || headerCrc != refHeaderCrc ||
+        framesSinceKey + 1 >= keyframePeriod)
+    {
+        storeKeyframe(count, headerCrc);
+        return false;
+    }
+
+    // Tamaño del delta: cabecera + un DeltaRun por racha de intervalos cambiados
+    size_t deltaSize = sizeof(DeltaHeader);
+    uint16_t runs = 0;
+    for (uint16_t k = 0; k < count; k++)
+    {
+        if (!isChanged(k))
+            continue;
+        if (k == 0 || !isChanged(k - 1))
+        {
+            runs++;
+            deltaSize += sizeof(DeltaRun);
+        }
+        deltaSize += current[k].length;
+    }
+
+    // Escena con mucho movimiento: el keyframe cuesta casi lo mismo
+    if (deltaSize * 100 > frame.len * DELTA_MAX_PCT)
+    {
+        storeKeyframe(count, headerCrc);
+        return false;
+    }
+
+    if (deltaSize > bufferSize)
+    {
+        uint8_t *resized = (uint8_t *)realloc(buffer, deltaSize);
+        if (!resized)
+        {
+            storeKeyframe(count, headerCrc);
+            return false;
+        }
+        buffer = resized;
+        bufferSize = deltaSize;
+    }
+
+    DeltaHeader header;
+    header.magic = DELTA_MAGIC;
+    header.headerLen = sizeof(DeltaHeader);
+    header.intervals = count;
+    header.seq = ++seq;
+    header.runs = runs;
+    header.reserved = 0;
+    memcpy(buffer, &header, sizeof(DeltaHeader));
+
+    size_t pos = sizeof(DeltaHeader);
+    uint16_t k = 0;
+    while (k < count)
+    {
+        if (!isChanged(k))
+        {
+            k++;
+            continue;
+        }
+
+        // Racha de intervalos cambiados: contiguos también en el frame
+        uint16_t first = k;
+        while (k < count && isChanged(k))
+            k++;
+
+        DeltaRun run;
+        run.first = first;
+        run.count = k - first;
+        run.length = current[k - 1].start + current[k - 1].length - current[first].start;
+        memcpy(buffer + pos, &run, sizeof(DeltaRun));
+        pos += sizeof(DeltaRun);
+        memcpy(buffer + pos, frame.buf + current[first].start, run.length);
+        pos += run.length;
+
+        for (uint16_t i = first; i < k; i++)
+            reference[i] = current[i];
+    }
+
+    framesSinceKey++;
+    deltaFrames++;
+    bytesSaved += frame.len - pos;
+
+    frame.buf = buffer;
+    frame.len = pos;
+    return true;
+}
+
+void DeltaEncoder::onFrameResult(bool success)
+{
+    // El receptor puede no tener la referencia o el delta: resincronizar
+    if (!success)
+        keyframeNeeded = true;
+}
+
+void DeltaEncoder::setEnabled(bool enabled)
+{
+    this->enabled = enabled;
+    keyframeNeeded = true;
+    Serial.printf("[DELTA] %s\n", enabled ? "✓ Activado" : "✗ Desactivado");
+}
+
+bool DeltaEncoder::isEnabled() const
+{
+    return enabled;
+}
+
+void DeltaEncoder::setKeyframePeriod(uint16_t frames)
+{
+    keyframePeriod = max(frames, (uint16_t)1);
+    Serial.printf("[DELTA] ✓ Keyframe cada %u frames\n", keyframePeriod);
+}
+
+void DeltaEncoder::setThreshold(uint8_t pct)
+{
+    thresholdPct = min(pct, (uint8_t)100);
+    Serial.printf("[DELTA] ✓ Umbral de cambio: %u%%\n", thresholdPct);
+}
+
+void DeltaEncoder::forceKeyframe()
+{
+    keyframeNeeded = true;
+}
+
+unsigned long DeltaEncoder::getBytesSaved() const
+{
+    return bytesSaved;
+}
+
+unsigned long DeltaEncoder::getDeltaFrames() const
+{
+    return deltaFrames;
+}
+
+unsigned long DeltaEncoder::getKeyframes() const
+{
+    return keyframes;
+}
+
+String DeltaEncoder::getStatusJson()
+{
+    return "{\"type\":\"delta\",\"enabled\":" + String(enabled ? "true" : "false") +
+           ",\"period\":" + String(keyframePeriod) +
+           ",\"threshold\":" + String(thresholdPct) +
+           ",\"intervals\":" + String(refCount) +
+           ",\"keyframes\":" + String(keyframes) +
+           ",\"deltas\":" + String(deltaFrames) +
+           ",\"saved\":" + String(bytesSaved) + "}";
+}
@@ -0,0 +1,83 @@
+#ifndef DELTA_ENCODER_H
+#define DELTA_ENCODER_H
+
+#include <Arduino.h>
+#include <esp_camera.h>
+#include "../configuration/config.h"
+
+// Cabecera de un frame delta (little-endian). La siguen `runs` DeltaRun, cada
+// uno seguido de los bytes de sus intervalos RSTn consecutivos.
+struct __attribute__((packed)) DeltaHeader
+{
+    uint8_t magic;      // DELTA_MAGIC
+    uint8_t headerLen;  // sizeof(DeltaHeader)
+    uint16_t intervals; // Intervalos RSTn del keyframe de referencia
+    uint32_t seq;       // 1, 2, 3... desde el último keyframe
+    uint16_t runs;
+    uint16_t reserved;
+};
+
+struct __attribute__((packed)) DeltaRun
+{
+    uint16_t first;  // Primer intervalo reemplazado
+    uint16_t count;  // Intervalos consecutivos
+    uint32_t length; // Bytes que siguen
+};
+
+class DeltaEncoder
+{
+public:
+    DeltaEncoder();
+
+    // Reemplaza el frame por un delta si compensa. false = enviar el JPEG
+    // completo (keyframe), que pasa a ser la referencia.
+    bool encode(camera_fb_t &frame);
+    void onFrameResult(bool success); // Un frame perdido fuerza keyframe
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    void setKeyframePeriod(uint16_t frames);
+    void setThreshold(uint8_t pct);
+    void forceKeyframe(); // Reconexión o petición del receptor
+
+    unsigned long getBytesSaved() const;
+    unsigned long getDeltaFrames() const;
+    unsigned long getKeyframes() const;
+    String getStatusJson();
+
+private:
+    struct Interval
+    {
+        uint32_t start;
+        uint32_t length;
+        uint32_t crc;
+    };
+
+    bool enabled;
+    bool keyframeNeeded;
+    uint16_t keyframePeriod;
+    uint8_t thresholdPct;
+
+    // Referencia: lo que el receptor tiene reconstruido
+    Interval *current;
+    Interval *reference;
+    uint32_t *markers;
+    uint16_t refCount;
+    uint32_t refHeaderCrc;
+    uint32_t seq;
+    uint16_t framesSinceKey;
+
+    uint8_t *buffer;
+    size_t bufferSize;
+
+    unsigned long bytesSaved;
+    unsigned long deltaFrames;
+    unsigned long keyframes;
+
+    bool allocate();
+    uint16_t splitIntervals(const camera_fb_t &frame, uint32_t &headerCrc);
+    bool isChanged(uint16_t index) const;
+    void storeKeyframe(uint16_t count, uint32_t headerCrc);
+};
+
+#endif
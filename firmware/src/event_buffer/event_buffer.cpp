@@ -0,0 +1,381 @@
+#include "event_buffer.h"
+#include "../websocket_manager/websocket_manager.h"
+#include "../frame_sender/frame_sender.h"
+#include <Arduino.h>
+
+EventBuffer::EventBuffer(WebSocketManager *ws, FrameSender *sender)
+    : wsManager(ws), frameSender(sender), enabled(false), arena(nullptr),
+      capacity((size_t)EVENT_BUFFER_BUDGET_KB * 1024), head(0), frames(nullptr), first(0), count(0),
+      nextSeq(0), bytesStored(0), motionDetection(EVENT_MOTION_DEFAULT),
+      motionThreshold(EVENT_MOTION_THRESHOLD_PCT), sizeAverage(0), motionSamples(0),
+      lastMotionEvent(0), lastWidth(0), flushing(false), eventId(0), flushStartSeq(0), flushSeq(0),
+      flushEndSeq(0), triggerTime(0), eventSent(0), eventLost(0), sending(false), pendingRelease(false), framesRecorded(0),
+      framesEvicted(0), eventsTriggered(0), framesUploaded(0), framesLost(0)
+{
+}
+
+bool EventBuffer::setEnabled(bool enable)
+{
+    if (enable == enabled)
+        return true;
+
+    if (!enable)
+    {
+        if (flushing)
+            finishFlush();
+        // Con un frame de la arena en vuelo la liberación espera a service()
+        if (sending)
+            pendingRelease = true;
+        else
+            release();
+        enabled = false;
+        Serial.println("[EVT] ✓ Historial pre-evento desactivado");
+        return true;
+    }
+
+    if (sending)
+    {
+        // Arena nueva al terminar el envío en curso
+        pendingRelease = true;
+        enabled = true;
+        return true;
+    }
+    if (!allocate(capacity))
+        return false;
+    enabled = true;
+    Serial.printf("[EVT] ✓ Historial pre-evento: %u KB en PSRAM\n", (unsigned)(capacity / 1024));
+    return true;
+}
+
+bool EventBuffer::isEnabled() const
+{
+    return enabled;
+}
+
+bool EventBuffer::setBudget(size_t kb)
+{
+    if (kb < 64 || kb > EVENT_BUFFER_BUDGET_MAX_KB)
+        return false;
+
+    capacity = kb * 1024;
+    if (!enabled)
+        return true;
+
+    // Cambiar el presupuesto vacía el historial
+    if (flushing)
+        finishFlush();
+    if (sending)
+    {
+        pendingRelease = true;
+        Serial.printf("[EVT] ✓ Presupuesto: %u KB (al terminar el envío en curso)\n", (unsigned)kb);
+        return true;
+    }
+    release();
+    if (!allocate(capacity))
+    {
+        enabled = false;
+        return false;
+    }
+    Serial.printf("[EVT] ✓ Presupuesto: %u KB\n", (unsigned)kb);
+    return true;
+}
+
+void EventBuffer::setMotionDetection(bool enable)
+{
+    motionDetection = enable;
+    motionSamples = 0;
+}
+
+void EventBuffer::setMotionThreshold(uint8_t pct)
+{
+    motionThreshold = pct;
+}
+
+bool EventBuffer::allocate(size_t bytes)
+{
+    arena = (uint8_t *)ps_malloc(bytes);
+    frames = (EventFrame *)malloc(sizeof(EventFrame) * EVENT_BUFFER_MAX_FRAMES);
+    if (!arena || !frames)
+    {
+        Serial.printf("[EVT] ✗ Sin PSRAM para %u KB\n", (unsigned)(bytes / 1024));
+        release();
+        return false;
+    }
+
+    head = 0;
+    first = 0;
+    count = 0;
+    bytesStored = 0;
+    return true;
+}
+
+void EventBuffer::release()
+{
+    free(arena);
+    free(frames);
+    arena = nullptr;
+    frames = nullptr;
+    head = 0;
+    first = 0;
+    count = 0;
+    bytesStored = 0;
+}
+
+void EventBuffer::evictOldest()
+{
+    bytesStored -= frames[first].length;
+    first = (first + 1) % EVENT_BUFFER_MAX_FRAMES;
+    count--;
+    framesEvicted++;
+}
+
+bool EventBuffer::overlaps(const EventFrame &frame, size_t start, size_t length) const
+{
+    return frame.offset < start + length && start < frame.offset + frame.length;
+}
+
+void EventBuffer::record(camera_fb_t *fb)
+{
+    if (!enabled || !arena)
+        return;
+
+    bool motion = motionDetection && checkMotion(fb);
+
+    if (fb->len <= capacity)
+    {
+        // Asignación secuencial en la arena; al no caber hasta el final se vuelve al inicio
+        size_t start = head;
+        if (start + fb->len > capacity)
+            start = 0;
+
+        // Desalojar los más viejos hasta liberar el rango y una entrada del índice
+        while (count > 0)
+        {
+            bool blocked = count >= EVENT_BUFFER_MAX_FRAMES;
+            for (uint16_t i = 0; i < count && !blocked; i++)
+            {
+                blocked = overlaps(frames[(first + i) % EVENT_BUFFER_MAX_FRAMES], start, fb->len);
+            }
+            if (!blocked)
+                break;
+            evictOldest();
+        }
+
+        memcpy(arena + start, fb->buf, fb->len);
+
+        EventFrame &frame = frames[(first + count) % EVENT_BUFFER_MAX_FRAMES];
+        frame.offset = start;
+        frame.length = fb->len;
+        frame.seq = nextSeq++;
+        frame.timestamp = millis();
+        frame.width = fb->width;
+        frame.height = fb->height;
+        count++;
+
+        head = start + fb->len;
+        bytesStored += fb->len;
+        framesRecorded++;
+    }
+
+    // La ventana incluye el frame que disparó el evento
+    if (motion)
+    {
+        trigger("motion", 0);
+    }
+}
+
+bool EventBuffer::checkMotion(camera_fb_t *fb)
+{
+    // Heurística barata: la escena cambia → el JPEG cambia de tamaño
+    if (fb->width != lastWidth)
+    {
+        lastWidth = fb->width;
+        motionSamples = 0;
+    }
+
+    if (motionSamples < EVENT_MOTION_WARMUP)
+    {
+        sizeAverage = motionSamples ? (sizeAverage * 7 + fb->len) / 8 : fb->len;
+        motionSamples++;
+        return false;
+    }
+
+    uint32_t average = sizeAverage;
+    sizeAverage = (sizeAverage * 7 + fb->len) / 8;
+
+    uint32_t diff = fb->len > average ? fb->len - average : average - fb->len;
+    if (diff * 100 < (uint32_t)motionThreshold * average)
+        return false;
+
+    if (flushing || millis() - lastMotionEvent < EVENT_MOTION_COOLDOWN_MS)
+        return false;
+    lastMotionEvent = millis();
+
+    Serial.printf("[EVT] 🏃 Movimiento: %u KB vs media %u KB\n",
+                  (unsigned)(fb->len / 1024), (unsigned)(average / 1024));
+    return true;
+}
+
+bool EventBuffer::trigger(const char *reason, unsigned long windowMs)
+{
+    if (!enabled || count == 0)
+    {
+        Serial.println("[EVT] ⚠️ Historial vacío o desactivado");
+        return false;
+    }
+    if (flushing)
+    {
+        Serial.println("[EVT] ⚠️ Ya hay una ventana subiéndose");
+        return false;
+    }
+
+    triggerTime = millis();
+    const EventFrame &newest = frames[(first + count - 1) % EVENT_BUFFER_MAX_FRAMES];
+
+    // Primer frame dentro de la ventana pedida
+    uint16_t start = 0;
+    while (windowMs > 0 && start < count - 1 &&
+           triggerTime - frames[(first + start) % EVENT_BUFFER_MAX_FRAMES].timestamp > windowMs)
+    {
+        start++;
+    }
+    const EventFrame &oldest = frames[(first + start) % EVENT_BUFFER_MAX_FRAMES];
+
+    size_t windowBytes = 0;
+    for (uint16_t i = start; i < count; i++)
+    {
+        windowBytes += frames[(first + i) % EVENT_BUFFER_MAX_FRAMES].length;
+    }
+
+    eventId++;
+    eventsTriggered++;
+    flushStartSeq = oldest.seq;
+    flushSeq = oldest.seq;
+    flushEndSeq = newest.seq;
+    eventSent = 0;
+    eventLost = 0;
+    flushing = true;
+
+    String msg = "{\"type\":\"event_start\",\"event\":" + String(eventId) +
+                 ",\"reason\":\"" + String(reason) + "\"" +
+                 ",\"frames\":" + String(flushEndSeq - flushStartSeq + 1) +
+                 ",\"bytes\":" + String(windowBytes) +
+                 ",\"spanMs\":" + String(newest.timestamp - oldest.timestamp) + "}";
+    wsManager->sendText(msg);
+
+    Serial.printf("[EVT] 🚨 Evento #%lu (%s): %lu frames, %u KB, %lums de historial\n",
+                  (unsigned long)eventId, reason, (unsigned long)(flushEndSeq - flushStartSeq + 1),
+                  (unsigned)(windowBytes / 1024), newest.timestamp - oldest.timestamp);
+    return true;
+}
+
+bool EventBuffer::isFlushing() const
+{
+    return flushing;
+}
+
+const EventFrame *EventBuffer::findFrom(uint32_t seq) const
+{
+    for (uint16_t i = 0; i < count; i++)
+    {
+        const EventFrame &frame = frames[(first + i) % EVENT_BUFFER_MAX_FRAMES];
+        if (frame.seq >= seq)
+            return &frame;
+    }
+    return nullptr;
+}
+
+void EventBuffer::service()
+{
+    if (!flushing || !wsManager->isConnected())
+        return;
+
+    // Los frames desalojados mientras se subía la ventana se cuentan como perdidos
+    const EventFrame *frame = findFrom(flushSeq);
+    if (!frame || frame->seq > flushEndSeq)
+    {
+        eventLost += flushEndSeq + 1 - flushSeq;
+        finishFlush();
+        return;
+    }
+    eventLost += frame->seq - flushSeq;
+
+    camera_fb_t fb = {};
+    fb.buf = arena + frame->offset;
+    fb.len = frame->length;
+    fb.width = frame->width;
+    fb.height = frame->height;
+    fb.format = PIXFORMAT_JPEG;
+
+    String info = "{\"type\":\"event_frame\",\"event\":" + String(eventId) +
+                  ",\"index\":" + String(frame->seq - flushStartSeq) +
+                  ",\"count\":" + String(flushEndSeq - flushStartSeq + 1) +
+                  ",\"ageMs\":" + String(triggerTime - frame->timestamp) + "}";
+
+    // Enviar no graba frames nuevos, pero atiende el WebSocket: un comando
+    // event off/budget llegado a mitad del envío aplaza la liberación de la
+    // arena hasta aquí (pendingRelease)
+    uint32_t seq = frame->seq;
+    sending = true;
+    if (frameSender->sendTaggedFrame(&fb, info))
+        eventSent++;
+    else
+        eventLost++;
+    sending = false;
+
+    if (pendingRelease)
+    {
+        pendingRelease = false;
+        release();
+        if (enabled && !allocate(capacity))
+        {
+            enabled = false;
+            Serial.println("[EVT] ❌ Sin PSRAM para el historial: desactivado");
+        }
+        return;
+    }
+
+    flushSeq = seq + 1;
+    if (flushing && flushSeq > flushEndSeq)
+        finishFlush();
+}
+
+void EventBuffer::finishFlush()
+{
+    flushing = false;
+    framesUploaded += eventSent;
+    framesLost += eventLost;
+
+    String msg = "{\"type\":\"event_end\",\"event\":" + String(eventId) +
+                 ",\"sent\":" + String(eventSent) +
+                 ",\"lost\":" + String(eventLost) +
+                 ",\"ms\":" + String(millis() - triggerTime) + "}";
+    wsManager->sendText(msg);
+
+    Serial.printf("[EVT] ✅ Evento #%lu subido: %u frames, %u perdidos, %lums\n",
+                  (unsigned long)eventId, eventSent, eventLost, millis() - triggerTime);
+}
+
+String EventBuffer::getStatusJson()
+{
+    unsigned long spanMs = 0;
+    if (count > 0)
+    {
+        spanMs = frames[(first + count - 1) % EVENT_BUFFER_MAX_FRAMES].timestamp -
+                 frames[first].timestamp;
+    }
+
+    return "{\"type\":\"event_status\",\"enabled\":" + String(enabled ? "true" : "false") +
+           ",\"budgetKB\":" + String(capacity / 1024) +
+           ",\"storedKB\":" + String(bytesStored / 1024) +
+           ",\"frames\":" + String(count) +
+           ",\"spanMs\":" + String(spanMs) +
+           ",\"motion\":" + String(motionDetection ? "true" : "false") +
+           ",\"threshold\":" + String(motionThreshold) +
+           ",\"flushing\":" + String(flushing ? "true" : "false") +
+           ",\"recorded\":" + String(framesRecorded) +
+           ",\"evicted\":" + String(framesEvicted) +
+           ",\"events\":" + String(eventsTriggered) +
+           ",\"uploaded\":" + String(framesUploaded) +
+           ",\"lost\":" + String(framesLost) + "}";
+}
@@ -0,0 +1,98 @@
+#ifndef EVENT_BUFFER_H
+#define EVENT_BUFFER_H
+
+#include <Arduino.h>
+#include <esp_camera.h>
+#include "../configuration/config.h"
+
+class WebSocketManager;
+class FrameSender;
+
+// Frame guardado en el anillo (los bytes viven en la arena de PSRAM)
+struct EventFrame
+{
+    uint32_t offset;
+    uint32_t length;
+    uint32_t seq;
+    unsigned long timestamp; // millis() de la captura
+    uint16_t width;
+    uint16_t height;
+};
+
+// Historial pre-evento: anillo de JPEG en PSRAM con presupuesto en bytes.
+// Un trigger (comando o movimiento) sube la ventana guardada frame a frame
+// desde el loop principal, intercalada con el stream en vivo
+class EventBuffer
+{
+public:
+    EventBuffer(WebSocketManager *ws, FrameSender *sender);
+
+    bool setEnabled(bool enabled);        // Reserva/libera la arena
+    bool isEnabled() const;
+    bool setBudget(size_t kb);            // Vacía el historial
+    void setMotionDetection(bool enabled);
+    void setMotionThreshold(uint8_t pct);
+
+    // Llamado con cada frame capturado (JPEG original)
+    void record(camera_fb_t *fb);
+
+    // Sube la ventana de los últimos windowMs (0 = todo el historial)
+    bool trigger(const char *reason, unsigned long windowMs);
+    bool isFlushing() const;
+    void service(); // Desde el loop: envía el siguiente frame de la ventana
+
+    String getStatusJson();
+
+private:
+    WebSocketManager *wsManager;
+    FrameSender *frameSender;
+
+    bool enabled;
+    uint8_t *arena;
+    size_t capacity; // Presupuesto en bytes
+    size_t head; // Próxima posición de escritura en la arena
+
+    // Índice circular, del más viejo (first) al más nuevo
+    EventFrame *frames;
+    uint16_t first;
+    uint16_t count;
+    uint32_t nextSeq;
+    size_t bytesStored;
+
+    // Movimiento: salto de tamaño del JPEG respecto a la media móvil
+    bool motionDetection;
+    uint8_t motionThreshold;
+    uint32_t sizeAverage;
+    uint16_t motionSamples;
+    unsigned long lastMotionEvent;
+    uint16_t lastWidth; // Un cambio de resolución reinicia la media
+
+    // Subida en curso
+    bool flushing;
+    uint32_t eventId;
+    uint32_t flushStartSeq; // Primer seq de la ventana
+    uint32_t flushSeq;      // Siguiente seq a enviar
+    uint32_t flushEndSeq;   // Último seq de la ventana
+    unsigned long triggerTime;
+    uint16_t eventSent;
+    uint16_t eventLost;
+    bool sending;        // Frame de la arena en vuelo (sendTaggedFrame)
+    bool pendingRelease; // Liberar/reservar la arena al terminar ese envío
+
+    // Estadísticas
+    unsigned long framesRecorded;
+    unsigned long framesEvicted;
+    unsigned long eventsTriggered;
+    unsigned long framesUploaded;
+    unsigned long framesLost; // Desalojados antes de poder subirlos
+
+    bool allocate(size_t bytes);
+    void release();
+    void evictOldest();
+    bool overlaps(const EventFrame &frame, size_t start, size_t length) const;
+    const EventFrame *findFrom(uint32_t seq) const;
+    bool checkMotion(camera_fb_t *fb);
+    void finishFlush();
+};
+
+#endif
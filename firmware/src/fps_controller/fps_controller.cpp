@@ -1,20 +1,22 @@
 #include "fps_controller.h"
 #include <Arduino.h>
+#include <esp_timer.h>
+#include <algorithm>
 
 FPSController::FPSController()
     : targetFPS(DEFAULT_FPS),
       frameInterval(1000 / DEFAULT_FPS),
-      lastFrameTime(0),
+      intervalUs(1000000LL / DEFAULT_FPS),
+      nextDeadline(0),
+      scheduled(false),
+      lastSentTime(0),
       enabled(true),
       frameIndex(0),
-      totalFrameTime(0)
+      frameCount(0),
+      totalFrameTime(0),
+      framesSkipped(0),
+      framesLate(0)
 {
-
-    // Inicializar array de tiempos
-    for (int i = 0; i < 10; i++)
-    {
-        frameTimes[i] = frameInterval;
-    }
 }
 
 void FPSController::setFPS(int fps)
@@ -26,6 +28,13 @@ void FPSController::setFPS(int fps)
 
     targetFPS = fps;
     frameInterval = 1000 / fps;
+    intervalUs = 1000000LL / fps;
+
+    // Nueva rejilla: las medidas anteriores corresponden a otro objetivo
+    frameIndex = 0;
+    frameCount = 0;
+    totalFrameTime = 0;
+    resync();
 
     Serial.printf("[FPS] ✓ Objetivo: %d FPS (intervalo: %lums)\n", fps, frameInterval);
 }
@@ -40,30 +49,125 @@ unsigned long FPSController::getFrameInterval()
     return frameInterval;
 }
 
+int64_t FPSController::getTimeToDeadlineUs()
+{
+    if (!enabled || !scheduled)
+        return intervalUs;
+    return nextDeadline - esp_timer_get_time();
+}
+
 bool FPSController::shouldSendFrame()
 {
     if (!enabled)
         return true;
 
-    unsigned long now = millis();
-    return (now - lastFrameTime >= frameInterval);
+    return esp_timer_get_time() >= nextDeadline;
 }
 
-void FPSController::frameSent()
+bool FPSController::beginFrame()
 {
+    int64_t now = esp_timer_get_time();
+
     if (!enabled)
+    {
+        nextDeadline = now;
+        return true;
+    }
+
+    // Primer frame tras resync(): arranca una rejilla nueva
+    if (!scheduled)
+    {
+        scheduled = true;
+        nextDeadline = now + intervalUs;
+        return true;
+    }
+
+    if (now < nextDeadline)
+        return false;
+
+    int64_t late = now - nextDeadline;
+
+    // Aún dentro de su slot: se envía y el siguiente deadline sigue en la rejilla
+    if (late <= intervalUs * FPS_LATE_TOLERANCE_PCT / 100)
+    {
+        if (late > intervalUs / 10)
+            framesLate++;
+        nextDeadline += intervalUs;
+        return true;
+    }
+
+    // Slot(s) perdidos: saltar al siguiente punto de la rejilla en vez de
+    // enviar tarde y arrastrar el retraso a los frames siguientes
+    int64_t missed = late / intervalUs + 1;
+    framesSkipped += missed;
+    nextDeadline += missed * intervalUs;
+    return false;
+}
+
+void FPSController::frameSent()
+{
+    int64_t now = esp_timer_get_time();
+
+    if (lastSentTime != 0)
+    {
+        uint32_t frameTime = (uint32_t)(now - lastSentTime);
+
+        // FPS real e intervalos de los últimos FPS_JITTER_WINDOW frames
+        if (frameCount == FPS_JITTER_WINDOW)
+            totalFrameTime -= frameTimes[frameIndex];
+        else
+            frameCount++;
+
+        frameTimes[frameIndex] = frameTime;
+        totalFrameTime += frameTime;
+        frameIndex = (frameIndex + 1) % FPS_JITTER_WINDOW;
+    }
+
+    lastSentTime = now;
+}
+
+void FPSController::resync()
+{
+    // Tras un hueco (desconexión, sonda, benchmark) la rejilla empieza de
+    // nuevo: ni slots perdidos ni un intervalo gigante en las estadísticas
+    nextDeadline = esp_timer_get_time();
+    scheduled = false;
+    lastSentTime = 0;
+}
+
+void FPSController::idle(unsigned long maxMs)
+{
+    // Sin control de FPS o sin frame programado (enlace caído, tras un
+    // resync): dormir el máximo en vez de girar al 100% de CPU
+    if (!enabled || !scheduled)
+    {
+        vTaskDelay(pdMS_TO_TICKS(maxMs));
         return;
+    }
 
-    unsigned long now = millis();
-    unsigned long frameTime = now - lastFrameTime;
-    lastFrameTime = now;
+    // Deadline vencido: volver enseguida a enviar
+    int64_t remaining = nextDeadline - esp_timer_get_time();
+    if (remaining <= 0)
+    {
+        vTaskDelay(0);
+        return;
+    }
+
+    // Dormir hasta el deadline, acotado para seguir atendiendo el WebSocket
+    int64_t maxUs = (int64_t)maxMs * 1000;
+    if (remaining > maxUs)
+    {
+        vTaskDelay(pdMS_TO_TICKS(maxMs));
+        return;
+    }
 
-    // Calcular FPS real (promedio de últimos 10 frames)
-    totalFrameTime -= frameTimes[frameIndex];
-    frameTimes[frameIndex] = frameTime;
-    totalFrameTime += frameTime;
+    // Último tramo: ticks enteros y el resto (<1ms) en espera activa
+    if (remaining >= 1000)
+        vTaskDelay(pdMS_TO_TICKS(remaining / 1000));
 
-    frameIndex = (frameIndex + 1) % 10;
+    remaining = nextDeadline - esp_timer_get_time();
+    if (remaining > 0)
+        delayMicroseconds((unsigned int)remaining);
 }
 
 void FPSController::setEnabled(bool enabled)
@@ -79,9 +183,48 @@ bool FPSController::isEnabled()
 
 float FPSController::getActualFPS()
 {
-    if (totalFrameTime == 0)
+    if (frameCount == 0 || totalFrameTime == 0)
         return 0;
 
-    float avgFrameTime = totalFrameTime / 10.0;
-    return 1000.0 / avgFrameTime;
-}
\ No newline at end of file
+    return 1000000.0 * frameCount / totalFrameTime;
+}
+
+unsigned long FPSController::getJitterPercentile(int pct)
+{
+    if (frameCount == 0)
+        return 0;
+
+    // Desviación absoluta de cada intervalo respecto al objetivo (µs)
+    uint32_t deviations[FPS_JITTER_WINDOW];
+    for (int i = 0; i < frameCount; i++)
+    {
+        int64_t diff = (int64_t)frameTimes[i] - intervalUs;
+        deviations[i] = (uint32_t)(diff < 0 ? -diff : diff);
+    }
+
+    int idx = (frameCount - 1) * pct / 100;
+    std::nth_element(deviations, deviations + idx, deviations + frameCount);
+    return deviations[idx];
+}
+
+unsigned long FPSController::getFramesSkipped()
+{
+    return framesSkipped;
+}
+
+unsigned long FPSController::getFramesLate()
+{
+    return framesLate;
+}
+
+String FPSController::getStatsJson()
+{
+    String json = "\"fpsTarget\":" + String(targetFPS) + ",";
+    json += "\"fpsActual\":" + String(getActualFPS(), 1) + ",";
+    json += "\"jitterP50\":" + String(getJitterPercentile(50)) + ",";
+    json += "\"jitterP95\":" + String(getJitterPercentile(95)) + ",";
+    json += "\"jitterP99\":" + String(getJitterPercentile(99)) + ",";
+    json += "\"skipped\":" + String(framesSkipped) + ",";
+    json += "\"late\":" + String(framesLate);
+    return json;
+}
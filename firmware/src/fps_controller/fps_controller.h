@@ -4,6 +4,9 @@
 #include <Arduino.h>
 #include "../configuration/config.h"
 
+// Planificador por deadlines absolutos (esp_timer, µs): cada frame tiene su
+// slot en una rejilla fija de periodo 1/FPS. Si un slot ya no se puede
+// cumplir se salta y se realinea a la rejilla, sin acumular retraso.
 class FPSController
 {
 public:
@@ -12,24 +15,40 @@ public:
     void setFPS(int fps);
     int getFPS();
     unsigned long getFrameInterval();
+    int64_t getTimeToDeadlineUs(); // Hasta el próximo slot de la rejilla (intervalo si no hay)
 
     bool shouldSendFrame();
+    bool beginFrame();
     void frameSent();
+    void resync();
+    void idle(unsigned long maxMs);
 
     void setEnabled(bool enabled);
     bool isEnabled();
 
     float getActualFPS();
+    unsigned long getJitterPercentile(int pct);
+    unsigned long getFramesSkipped();
+    unsigned long getFramesLate();
+    String getStatsJson();
 
 private:
     int targetFPS;
     unsigned long frameInterval;
-    unsigned long lastFrameTime;
+    int64_t intervalUs;
+    int64_t nextDeadline;
+    bool scheduled; // false tras resync(): no hay frame en la rejilla
+    int64_t lastSentTime;
     bool enabled;
 
-    unsigned long frameTimes[10];
+    // Intervalos reales entre frames entregados (µs)
+    uint32_t frameTimes[FPS_JITTER_WINDOW];
     int frameIndex;
-    unsigned long totalFrameTime;
+    int frameCount;
+    uint64_t totalFrameTime;
+
+    unsigned long framesSkipped;
+    unsigned long framesLate;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,222 @@
+#include "frame_pacer.h"
+#include "../websocket_manager/websocket_manager.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <algorithm>
+
+FramePacer::FramePacer(WebSocketManager *ws)
+    : wsManager(ws), spread(PACE_SPREAD_DEFAULT), spreadPercent(PACE_SPREAD_PCT),
+      inFrame(false), frameStartUs(0), frameIntervalUs(0), nextReleaseUs(0), lastReleaseUs(0),
+      lastSentUs(0), lastChunkBytes(0), frameRate(0), frameBytes(0), burstBytes(0), frameMaxBurst(0),
+      gapCount(0), gapMean(0), gapM2(0), peakRate(0),
+      gapCv(0), peakToMean(0), lateUs(0), dutyPct(0), maxBurstBytes(0), lastRate(0), framesPaced(0),
+      transferIndex(0), transferCount(0)
+{
+}
+
+void FramePacer::setSpread(bool enable, uint8_t percent)
+{
+    spread = enable;
+    spreadPercent = constrain(percent, PACE_SPREAD_PCT_MIN, PACE_SPREAD_PCT_MAX);
+
+    // Métricas nuevas para comparar con el patrón anterior
+    gapCv = 0;
+    peakToMean = 0;
+    lateUs = 0;
+    dutyPct = 0;
+    maxBurstBytes = 0;
+    transferCount = 0;
+    transferIndex = 0;
+
+    if (spread)
+        Serial.printf("[PACE] ✓ Reparto sobre el %u%% del intervalo de frame\n", spreadPercent);
+    else
+        Serial.println("[PACE] ✓ Envío en ráfaga");
+}
+
+bool FramePacer::isSpread() const
+{
+    return spread;
+}
+
+uint8_t FramePacer::getSpreadPercent() const
+{
+    return spreadPercent;
+}
+
+void FramePacer::beginFrame(size_t bytes, unsigned long intervalMs, int64_t remainingUs, uint32_t ceilingBps)
+{
+    inFrame = true;
+    frameStartUs = esp_timer_get_time();
+    frameIntervalUs = (int64_t)intervalMs * 1000;
+    nextReleaseUs = frameStartUs;
+    lastReleaseUs = 0;
+    lastSentUs = 0;
+    lastChunkBytes = 0;
+    frameBytes = 0;
+    burstBytes = 0;
+    frameMaxBurst = 0;
+    gapCount = 0;
+    gapMean = 0;
+    gapM2 = 0;
+    peakRate = 0;
+    frameRate = 0;
+
+    if (!spread || frameIntervalUs <= 0)
+        return;
+
+    // Captura y codificación ya consumieron parte del intervalo: el reparto
+    // usa la parte configurada de lo que queda hasta el siguiente deadline.
+    // Sin tiempo restante el frame sale a la tasa del techo (o en ráfaga)
+    int64_t budgetUs = min(remainingUs, frameIntervalUs) * spreadPercent / 100;
+    uint64_t rate = budgetUs > 0 ? (uint64_t)bytes * 1000000ULL / budgetUs : 0;
+    if (ceilingBps > 0 && (rate == 0 || rate > ceilingBps))
+        rate = ceilingBps;
+    frameRate = min(rate, (uint64_t)UINT32_MAX);
+    lastRate = frameRate;
+}
+
+void FramePacer::release(size_t chunkBytes)
+{
+    if (!inFrame)
+        return;
+
+    if (frameRate > 0)
+    {
+        waitUntil(nextReleaseUs);
+        int64_t now = esp_timer_get_time();
+        lateUs += PACE_STATS_ALPHA * ((float)(now - nextReleaseUs) - lateUs);
+
+        // El siguiente chunk sale cuando este "termina" a la tasa del reparto;
+        // un retraso no se recupera con una ráfaga
+        nextReleaseUs = max(nextReleaseUs, now) + (int64_t)chunkBytes * 1000000LL / frameRate;
+    }
+
+    int64_t now = esp_timer_get_time();
+
+    // Tasa instantánea entre salidas consecutivas
+    if (lastReleaseUs > 0 && now > lastReleaseUs)
+    {
+        peakRate = max(peakRate, (float)lastChunkBytes * 1000000.0f / (now - lastReleaseUs));
+    }
+
+    // Hueco sin transmitir desde el chunk anterior: los chunks separados por
+    // menos de PACE_BURST_GAP_US forman una misma ráfaga
+    if (lastSentUs > 0)
+    {
+        float gap = now - lastSentUs;
+        gapCount++;
+        float delta = gap - gapMean;
+        gapMean += delta / gapCount;
+        gapM2 += delta * (gap - gapMean);
+
+        if (gap < PACE_BURST_GAP_US)
+        {
+            burstBytes += chunkBytes;
+        }
+        else
+        {
+            frameMaxBurst = max(frameMaxBurst, burstBytes);
+            burstBytes = chunkBytes;
+        }
+    }
+    else
+    {
+        burstBytes = chunkBytes;
+    }
+
+    lastReleaseUs = now;
+    lastChunkBytes = chunkBytes;
+    frameBytes += chunkBytes;
+}
+
+void FramePacer::chunkSent()
+{
+    if (inFrame)
+        lastSentUs = esp_timer_get_time();
+}
+
+void FramePacer::endFrame()
+{
+    if (!inFrame)
+        return;
+    inFrame = false;
+
+    frameMaxBurst = max(frameMaxBurst, burstBytes);
+    maxBurstBytes = max(maxBurstBytes, frameMaxBurst);
+
+    int64_t duration = lastSentUs - frameStartUs;
+    if (frameBytes == 0 || duration <= 0)
+        return;
+
+    float cv = gapCount > 1 && gapMean > 0 ? sqrtf(gapM2 / (gapCount - 1)) / gapMean : 0;
+    float meanRate = (float)frameBytes * 1000000.0f / duration;
+
+    gapCv += PACE_STATS_ALPHA * (cv - gapCv);
+    if (peakRate > 0)
+        peakToMean += PACE_STATS_ALPHA * (peakRate / meanRate - peakToMean);
+    if (frameIntervalUs > 0)
+        dutyPct += PACE_STATS_ALPHA * ((float)duration * 100.0f / frameIntervalUs - dutyPct);
+    framesPaced++;
+}
+
+void FramePacer::recordTransfer(unsigned long transferMs)
+{
+    transferTimes[transferIndex] = transferMs;
+    transferIndex = (transferIndex + 1) % PACE_LATENCY_WINDOW;
+    if (transferCount < PACE_LATENCY_WINDOW)
+        transferCount++;
+}
+
+void FramePacer::waitUntil(int64_t deadlineUs)
+{
+    int64_t remaining = deadlineUs - esp_timer_get_time();
+
+    // Esperas largas: ticks enteros atendiendo el WebSocket
+    while (remaining > PACE_YIELD_US)
+    {
+        wsManager->loop();
+        vTaskDelay(pdMS_TO_TICKS((remaining - PACE_YIELD_US / 2) / 1000));
+        remaining = deadlineUs - esp_timer_get_time();
+    }
+
+    // Último tramo: espera activa con resolución de µs
+    if (remaining > 0)
+        delayMicroseconds((unsigned int)remaining);
+}
+
+unsigned long FramePacer::getTransferPercentile(int pct)
+{
+    if (transferCount == 0)
+        return 0;
+
+    uint32_t sorted[PACE_LATENCY_WINDOW];
+    memcpy(sorted, transferTimes, sizeof(uint32_t) * transferCount);
+
+    int idx = (transferCount - 1) * pct / 100;
+    std::nth_element(sorted, sorted + idx, sorted + transferCount);
+    return sorted[idx];
+}
+
+String FramePacer::getStatsJson()
+{
+    String json = "\"pacing\":{\"mode\":\"" + String(spread ? "spread" : "burst") + "\",";
+    json += "\"spreadPct\":" + String(spreadPercent) + ",";
+    json += "\"rateKBps\":" + String(spread ? lastRate / 1024 : 0) + ",";
+    json += "\"frames\":" + String(framesPaced) + ",";
+    json += "\"gapCv\":" + String(gapCv, 2) + ",";
+    json += "\"peakToMean\":" + String(peakToMean, 2) + ",";
+    json += "\"maxBurstKB\":" + String(maxBurstBytes / 1024) + ",";
+    json += "\"lateUs\":" + String(lateUs, 0) + ",";
+    json += "\"dutyPct\":" + String(dutyPct, 0) + ",";
+    json += "\"transferP50\":" + String(getTransferPercentile(50)) + ",";
+    json += "\"transferP95\":" + String(getTransferPercentile(95)) + ",";
+    json += "\"transferP99\":" + String(getTransferPercentile(99)) + "}";
+    return json;
+}
+
+void FramePacer::resetWindow()
+{
+    // Solo el informe de salud cierra la ventana: pace status no la consume
+    maxBurstBytes = 0;
+}
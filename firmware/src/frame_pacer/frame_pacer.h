@@ -0,0 +1,78 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <Arduino.h>
+#include "../configuration/config.h"
+
+// Forward declarations
+class WebSocketManager;
+
+// Pacing repartido: en lugar de soltar los chunks seguidos y esperar al
+// siguiente frame, reparte los bytes de cada frame a tasa constante sobre
+// una parte del tiempo que queda hasta el siguiente frame. El instante de
+// salida de cada chunk se calcula en µs (esp_timer_get_time); la espera
+// cede con vTaskDelay y el último tramo es activo (delayMicroseconds).
+// Las métricas de ráfaga se miden siempre, también sin reparto, para
+// comparar ambos patrones.
+class FramePacer
+{
+public:
+    FramePacer(WebSocketManager *ws);
+
+    void setSpread(bool enable, uint8_t percent);
+    bool isSpread() const;
+    uint8_t getSpreadPercent() const;
+
+    // Frame en chunks: bytes totales, intervalo de frame, tiempo que queda
+    // hasta el siguiente deadline y techo de tasa (sonda/perfil, 0 = sin techo)
+    void beginFrame(size_t bytes, unsigned long intervalMs, int64_t remainingUs, uint32_t ceilingBps);
+    void release(size_t chunkBytes); // Espera al instante de salida del chunk
+    void chunkSent();                // Fin del envío del chunk en curso
+    void endFrame();
+
+    void recordTransfer(unsigned long transferMs); // Todos los frames (cola de latencia)
+
+    String getStatsJson(); // Fragmento "pacing":{...}
+    void resetWindow();    // Nueva ventana de ráfaga máxima (informe de salud)
+
+private:
+    WebSocketManager *wsManager;
+    bool spread;
+    uint8_t spreadPercent;
+
+    // Frame en curso
+    bool inFrame;
+    int64_t frameStartUs;
+    int64_t frameIntervalUs;
+    int64_t nextReleaseUs;
+    int64_t lastReleaseUs;
+    int64_t lastSentUs;
+    size_t lastChunkBytes;
+    uint32_t frameRate; // Bytes/s del reparto (0 = ráfaga)
+    size_t frameBytes;
+    size_t burstBytes;
+    size_t frameMaxBurst;
+    uint16_t gapCount;
+    float gapMean;
+    float gapM2;
+    float peakRate;
+
+    // Métricas suavizadas por frame
+    float gapCv;
+    float peakToMean;
+    float lateUs;
+    float dutyPct;
+    size_t maxBurstBytes; // Desde el último informe de salud
+    uint32_t lastRate;
+    unsigned long framesPaced;
+
+    // Tiempos de transferencia recientes (ms)
+    uint32_t transferTimes[PACE_LATENCY_WINDOW];
+    int transferIndex;
+    int transferCount;
+
+    void waitUntil(int64_t deadlineUs);
+    unsigned long getTransferPercentile(int pct);
+};
+
+#endif
@@ -2,26 +2,261 @@
 #include "../websocket_manager/websocket_manager.h"
 #include "../camera_manager/camera_manager.h"
 #include "../fps_controller/fps_controller.h"
+#include "../chunk_tuner/chunk_tuner.h"
+#include "../delta_encoder/delta_encoder.h"
+#include "../preview_generator/preview_generator.h"
+#include "../event_buffer/event_buffer.h"
+#include "../recorder/recorder.h"
+#include "../link_estimator/link_estimator.h"
+#include "../stream_profiles/stream_profiles.h"
+#include "../mode_governor/mode_governor.h"
+#include "../frame_pacer/frame_pacer.h"
+#include "../jpeg_utils/jpeg_utils.h"
 #include <WiFi.h>
 #include <Arduino.h>
+#include <esp_crc.h>
 
 FrameSender::FrameSender(WebSocketManager *ws, CameraManager *cam, FPSController *fps)
-    : wsManager(ws), camManager(cam), fpsController(fps),
+    : wsManager(ws), camManager(cam), fpsController(fps), chunkTuner(nullptr), deltaEncoder(nullptr), previewGenerator(nullptr), eventBuffer(nullptr), recorder(nullptr), linkEstimator(nullptr), streamProfiles(nullptr), modeGovernor(nullptr), framePacer(nullptr),
       framesSent(0), framesDropped(0), framesFailed(0),
-      lastFrameSize(0), successRate(1.0f), lastSendTime(0),
+      lastFrameSize(0), successRate(1.0f), lastSendTime(0), chunksRetransmitted(0),
       totalFrameTime(0), frameTimeCount(0), averageFrameTime(0),
-      operationMode(DEFAULT_MODE)
+      operationMode(DEFAULT_MODE), profileCapturePending(false), linkPoorApplied(false), pacingRate(0), lastChunkStartUs(0), lastChunkBytes(0),
+      budgetBaseQuality(-1), lastBudgetDeferral(0), lastBudgetQualityChange(0),
+      abbreviatedJpeg(JPEG_ABBREV_DEFAULT), tablesSent(false), sentTablesHash(0), abbrevBytesSaved(0),
+      sliceChunking(false), sliceFrame(false), slicePlan(nullptr), restartOffsets(nullptr),
+      sliceCount(0), sliceInterval(0), sliceMcuCols(0), sliceMcuRows(0),
+      txBuffer(nullptr), txBufferSize(0)
 {
     sync.waitingForAck = false;
     sync.ackTimeout = 0;
     sync.frameId = 0;
+    sync.ackedFrameId = 0;
+    sync.nackFrameId = 0;
+    sync.missingCount = 0;
 
     updateDelaysForMode();
 }
 
+void FrameSender::setChunkTuner(ChunkTuner *tuner)
+{
+    chunkTuner = tuner;
+}
+
+void FrameSender::setEventBuffer(EventBuffer *buffer)
+{
+    eventBuffer = buffer;
+}
+
+void FrameSender::setRecorder(Recorder *rec)
+{
+    recorder = rec;
+}
+
+void FrameSender::setLinkEstimator(LinkEstimator *estimator)
+{
+    linkEstimator = estimator;
+}
+
+void FrameSender::setStreamProfiles(StreamProfiles *profiles)
+{
+    streamProfiles = profiles;
+}
+
+void FrameSender::setModeGovernor(ModeGovernor *governor)
+{
+    modeGovernor = governor;
+}
+
+void FrameSender::setFramePacer(FramePacer *pacer)
+{
+    framePacer = pacer;
+}
+
+void FrameSender::setDeltaEncoder(DeltaEncoder *encoder)
+{
+    deltaEncoder = encoder;
+}
+
+void FrameSender::setPreviewGenerator(PreviewGenerator *generator)
+{
+    previewGenerator = generator;
+}
+
+void FrameSender::setPacingRate(uint32_t bytesPerSecond)
+{
+    pacingRate = bytesPerSecond;
+    Serial.printf("[📷] ✓ Pacing: %s\n",
+                  pacingRate ? (String(pacingRate / 1024) + " KB/s").c_str() : "desactivado");
+}
+
+uint32_t FrameSender::getPacingRate() const
+{
+    return pacingRate;
+}
+
+void FrameSender::setAbbreviatedJpeg(bool enabled)
+{
+    abbreviatedJpeg = enabled;
+    tablesSent = false;
+    Serial.printf("[📷] ✓ JPEG abreviado: %s\n", enabled ? "ON" : "OFF");
+}
+
+bool FrameSender::isAbbreviatedJpeg() const
+{
+    return abbreviatedJpeg;
+}
+
+void FrameSender::invalidateJpegTables()
+{
+    tablesSent = false;
+}
+
+void FrameSender::resumeJpegTables(uint32_t receiverHash)
+{
+    // Las tablas cacheadas en el servidor siguen valiendo si son las últimas enviadas
+    tablesSent = abbreviatedJpeg && sentTablesHash != 0 && receiverHash == sentTablesHash;
+}
+
+bool FrameSender::setSliceChunking(bool enabled)
+{
+    if (!camManager->setRestartMarkers(enabled))
+    {
+        sliceChunking = false;
+        Serial.println("[📷] ✗ Chunks por franjas no disponibles");
+        return false;
+    }
+
+    sliceChunking = enabled;
+    Serial.printf("[📷] ✓ Chunks por franjas RSTn: %s\n", enabled ? "ON" : "OFF");
+    return true;
+}
+
+bool FrameSender::isSliceChunking() const
+{
+    return sliceChunking;
+}
+
+bool FrameSender::buildSlicePlan(camera_fb_t *fb, size_t chunkSize)
+{
+    JpegLayout layout;
+    if (!JpegParser::parse(fb->buf, fb->len, layout) || layout.restartInterval == 0 ||
+        layout.mcuCols == 0)
+        return false;
+
+    if (!slicePlan)
+    {
+        slicePlan = (ChunkSlice *)malloc(sizeof(ChunkSlice) * JPEG_MAX_RESTART_MARKERS);
+        restartOffsets = (uint32_t *)malloc(sizeof(uint32_t) * JPEG_MAX_RESTART_MARKERS);
+        if (!slicePlan || !restartOffsets)
+        {
+            free(slicePlan);
+            free(restartOffsets);
+            slicePlan = nullptr;
+            restartOffsets = nullptr;
+            return false;
+        }
+    }
+
+    size_t markers = JpegParser::findRestartMarkers(fb->buf, fb->len, layout,
+                                                    restartOffsets, JPEG_MAX_RESTART_MARKERS);
+    // Sin RSTn, o más intervalos de los que caben en el plan: cortar por bytes
+    if (markers == 0 || markers >= JPEG_MAX_RESTART_MARKERS)
+        return false;
+
+    // Intervalo k = [fin del RSTn k-1, fin del RSTn k); el primero arrastra la
+    // cabecera y el último el EOI. Se agrupan intervalos enteros hasta chunkSize.
+    sliceCount = 0;
+    size_t start = 0;
+    uint16_t first = 0;
+    for (size_t k = 0; k <= markers; k++)
+    {
+        size_t end = (k < markers) ? restartOffsets[k] + 2 : fb->len;
+        size_t nextEnd = (k + 1 < markers) ? restartOffsets[k + 1] + 2 : fb->len;
+
+        if (k == markers || nextEnd - start > chunkSize)
+        {
+            slicePlan[sliceCount++] = {(uint32_t)start, (uint32_t)(end - start),
+                                       first, (uint16_t)(k - first + 1)};
+            start = end;
+            first = k + 1;
+        }
+    }
+
+    sliceInterval = layout.restartInterval;
+    sliceMcuCols = layout.mcuCols;
+    sliceMcuRows = layout.mcuRows;
+    return true;
+}
+
+bool FrameSender::getChunkBounds(camera_fb_t *fb, uint16_t index, size_t chunkSize,
+                                 size_t &offset, size_t &length)
+{
+    if (sliceFrame)
+    {
+        if (index >= sliceCount)
+            return false;
+        offset = slicePlan[index].offset;
+        length = slicePlan[index].length;
+        return true;
+    }
+
+    offset = (size_t)index * chunkSize;
+    if (offset >= fb->len)
+        return false;
+    length = min(chunkSize, fb->len - offset);
+    return true;
+}
+
+void FrameSender::prepareAbbreviated(camera_fb_t &frame)
+{
+    JpegLayout layout;
+    if (!JpegParser::parse(frame.buf, frame.len, layout) || layout.tableCount == 0)
+        return;
+
+    // Tablas nuevas (calidad distinta, reconexión...): enviarlas primero
+    if (!tablesSent || layout.tablesHash != sentTablesHash)
+    {
+        if (!sendJpegTables(frame.buf, layout))
+            return; // Enviar el frame completo como respaldo
+    }
+
+    size_t start = JpegParser::stripTables(frame.buf, frame.len, layout);
+    if (start == 0)
+        return;
+
+    frame.buf += start;
+    frame.len -= start;
+    abbrevBytesSaved += start;
+}
+
+bool FrameSender::sendJpegTables(const uint8_t *buf, const JpegLayout &layout)
+{
+    size_t size = layout.tablesBytes + 4;
+    uint8_t *tables = (uint8_t *)malloc(size);
+    if (!tables)
+        return false;
+
+    size_t len = JpegParser::buildTablesOnly(buf, layout, tables, size);
+
+    String msg = "{\"type\":\"jpeg_tables\",\"hash\":" + String(layout.tablesHash) +
+                 ",\"size\":" + String(len) + "}";
+    bool ok = len > 0 && wsManager->sendText(msg) && wsManager->sendBinary(tables, len);
+    free(tables);
+
+    if (ok)
+    {
+        tablesSent = true;
+        sentTablesHash = layout.tablesHash;
+        Serial.printf("[📷] 📋 Tablas JPEG enviadas (%dB, hash %08lx)\n", len, layout.tablesHash);
+    }
+    return ok;
+}
+
 void FrameSender::setMode(uint8_t mode)
 {
-    if (mode != MODE_SPEED && mode != MODE_STABILITY)
+    bool valid = streamProfiles ? streamProfiles->isValid(mode) : mode < STREAM_PROFILE_BUILTIN;
+    if (!valid)
     {
         Serial.println("[📷] ⚠️ Modo inválido, usando estabilidad");
         mode = MODE_STABILITY;
@@ -30,6 +265,14 @@ void FrameSender::setMode(uint8_t mode)
     operationMode = mode;
     updateDelaysForMode();
 
+    // Calidad y modo de captura se aplican antes de la siguiente captura
+    // (en el arranque la cámara aún se está iniciando)
+    profileCapturePending = true;
+    if (streamProfiles)
+    {
+        streamProfiles->onActivated(mode);
+    }
+
     Serial.printf("[📷] ✓ Modo cambiado a: %s\n", getModeName().c_str());
 }
 
@@ -40,62 +283,97 @@ uint8_t FrameSender::getMode() const
 
 String FrameSender::getModeName() const
 {
-    return (operationMode == MODE_SPEED) ? "Velocidad" : "Estabilidad";
+    return getProfile().name;
+}
+
+const StreamProfile &FrameSender::getProfile() const
+{
+    return streamProfiles ? streamProfiles->get(operationMode) : StreamProfiles::builtin(operationMode);
+}
+
+void FrameSender::refreshProfile()
+{
+    updateDelaysForMode();
+    profileCapturePending = true;
+}
+
+const StreamProfile &FrameSender::getTransferProfile() const
+{
+    // Con el enlace degradado, pausas y chunks de estabilidad: cada pérdida cuesta menos
+    if (linkPoorApplied && operationMode != MODE_STABILITY)
+        return streamProfiles ? streamProfiles->get(MODE_STABILITY) : StreamProfiles::builtin(MODE_STABILITY);
+    return getProfile();
+}
+
+void FrameSender::checkLinkFallback()
+{
+    bool linkPoor = linkEstimator && linkEstimator->isPoor();
+    if (linkPoor == linkPoorApplied)
+        return;
+
+    linkPoorApplied = linkPoor;
+    Serial.printf("[📷] %s\n", linkPoor ? "⚠️ Enlace degradado: pausas y chunks de estabilidad"
+                                        : "✓ Enlace recuperado: pausas y chunks del perfil");
+    updateDelaysForMode();
 }
 
 void FrameSender::updateDelaysForMode()
 {
-    if (operationMode == MODE_SPEED)
-    {
-        delays.betweenChunks = DELAY_BETWEEN_CHUNKS_SPEED;
-        delays.afterHeader = DELAY_AFTER_HEADER_SPEED;
-        delays.afterFrame = DELAY_AFTER_FRAME_SPEED;
-        delays.afterFooter = DELAY_AFTER_FOOTER_SPEED;
-        delays.smallFrame = DELAY_SMALL_FRAME_SPEED;
-    }
-    else
-    {
-        delays.betweenChunks = DELAY_BETWEEN_CHUNKS_STABILITY;
-        delays.afterHeader = DELAY_AFTER_HEADER_STABILITY;
-        delays.afterFrame = DELAY_AFTER_FRAME_STABILITY;
-        delays.afterFooter = DELAY_AFTER_FOOTER_STABILITY;
-        delays.smallFrame = DELAY_SMALL_FRAME_STABILITY;
-    }
+    const StreamProfile &profile = getTransferProfile();
+
+    delays.betweenChunks = profile.betweenChunks;
+    delays.afterHeader = profile.afterHeader;
+    delays.afterFrame = profile.afterFrame;
+    delays.afterFooter = profile.afterFooter;
+    delays.smallFrame = profile.smallFrame;
 
     Serial.printf("[📷] Delays configurados: chunks=%dms, header=%dms, frame=%dms\n",
                   delays.betweenChunks, delays.afterHeader, delays.afterFrame);
 }
 
-size_t FrameSender::getOptimalChunkSize(size_t frameSize)
+void FrameSender::applyProfileCapture()
 {
-    // Sistema adaptativo de chunks para soportar resoluciones altas
+    profileCapturePending = false;
+    const StreamProfile &profile = getProfile();
 
-    if (operationMode == MODE_SPEED)
+    // Calidad dentro de los límites del perfil
+    int quality = camManager->getCurrentQuality();
+    int bounded = constrain(quality, (int)profile.qualityMin, (int)profile.qualityMax);
+    if (bounded != quality && camManager->setQuality(bounded))
     {
-        // Modo Velocidad: Chunks más grandes para mayor throughput
-        if (frameSize > THRESHOLD_XXLARGE)
-            return CHUNK_SIZE_XLARGE; // >400KB: 16KB chunks (FHD, QXGA)
-        if (frameSize > THRESHOLD_XLARGE)
-            return CHUNK_SIZE_LARGE; // >200KB: 8KB chunks
-        if (frameSize > THRESHOLD_LARGE)
-            return CHUNK_SIZE_MEDIUM; // >100KB: 4KB chunks
-        if (frameSize > THRESHOLD_MEDIUM)
-            return CHUNK_SIZE_SMALL; // >30KB: 2KB chunks
-        return CHUNK_SIZE_TINY;      // ≤30KB: 1KB chunks
+        invalidateJpegTables();
     }
-    else
+
+    // Cambiar el modo de captura reinicia el driver: solo si difiere, y
+    // conservando los ajustes del sensor
+    if (profile.grabMode != STREAM_PROFILE_GRAB_KEEP && profile.grabMode != camManager->getGrabMode())
     {
-        // Modo Estabilidad: Balance entre velocidad y confiabilidad
-        if (frameSize > THRESHOLD_XXLARGE)
-            return CHUNK_SIZE_LARGE; // >400KB: 8KB chunks
-        if (frameSize > THRESHOLD_XLARGE)
-            return CHUNK_SIZE_MEDIUM; // >200KB: 4KB chunks
-        if (frameSize > THRESHOLD_LARGE)
-            return CHUNK_SIZE_SMALL; // >100KB: 2KB chunks
-        return CHUNK_SIZE_TINY;      // ≤100KB: 1KB chunks
+        SensorSettings settings = camManager->getSensorSettings();
+        if (camManager->reconfigure(camManager->getXclkHz(), camManager->getFbCount(),
+                                    (camera_grab_mode_t)profile.grabMode))
+        {
+            camManager->applySensorSettings(settings);
+        }
     }
 }
 
+size_t FrameSender::getOptimalChunkSize(size_t frameSize)
+{
+    // Tabla de chunks del perfil activo (o de estabilidad con el enlace
+    // degradado) por tramo de tamaño de frame
+    const StreamProfile &profile = getTransferProfile();
+
+    if (frameSize > THRESHOLD_XXLARGE)
+        return profile.chunkSizes[4];
+    if (frameSize > THRESHOLD_XLARGE)
+        return profile.chunkSizes[3];
+    if (frameSize > THRESHOLD_LARGE)
+        return profile.chunkSizes[2];
+    if (frameSize > THRESHOLD_MEDIUM)
+        return profile.chunkSizes[1];
+    return profile.chunkSizes[0];
+}
+
 void FrameSender::smartDelay(uint16_t maxDelay)
 {
     if (maxDelay == 0)
@@ -118,6 +396,105 @@ void FrameSender::smartDelay(uint16_t maxDelay)
     }
 }
 
+uint32_t FrameSender::getEffectivePacingRate() const
+{
+    // La tasa medida por la sonda, limitada por el techo del perfil
+    uint32_t ceiling = getProfile().pacingMaxBps;
+    if (ceiling == 0)
+        return pacingRate;
+    return pacingRate > 0 && pacingRate < ceiling ? pacingRate : ceiling;
+}
+
+void FrameSender::paceChunk(size_t chunkBytes)
+{
+    // Con reparto, FramePacer fija el instante de salida de cada chunk
+    bool spread = framePacer && framePacer->isSpread();
+    uint32_t rate = spread ? 0 : getEffectivePacingRate();
+    if (rate > 0 && lastChunkBytes > 0)
+    {
+        // El chunk anterior "ocupa" el enlace durante bytes/tasa. A tasas
+        // altas el hueco es de décimas de ms: la parte larga atiende el
+        // WebSocket y el resto se espera con resolución de µs
+        unsigned long slotUs = (uint64_t)lastChunkBytes * 1000000ULL / rate;
+        unsigned long elapsedUs = micros() - lastChunkStartUs;
+        if (elapsedUs < slotUs && slotUs - elapsedUs > PACE_YIELD_US)
+        {
+            smartDelay((slotUs - elapsedUs - PACE_YIELD_US / 2) / 1000);
+            elapsedUs = micros() - lastChunkStartUs;
+        }
+        if (elapsedUs < slotUs)
+        {
+            delayMicroseconds(slotUs - elapsedUs);
+        }
+    }
+
+    // Tope de ancho de banda: esperar a que el cubo cubra el chunk
+    unsigned long budgetWaitMs = wsManager->getBudgetWaitMs(chunkBytes);
+    if (budgetWaitMs > 0)
+    {
+        smartDelay(min(budgetWaitMs, 60000UL));
+    }
+    if (framePacer)
+    {
+        framePacer->release(chunkBytes);
+    }
+
+    lastChunkStartUs = micros();
+    lastChunkBytes = chunkBytes;
+}
+
+void FrameSender::clearBudgetQuality()
+{
+    budgetBaseQuality = -1;
+}
+
+void FrameSender::adaptQualityToBudget(bool deferred)
+{
+    unsigned long now = millis();
+    if (deferred)
+    {
+        lastBudgetDeferral = now;
+    }
+    if (now - lastBudgetQualityChange < BWCAP_QUALITY_HOLD_MS)
+        return;
+
+    int quality = camManager->getCurrentQuality();
+    int target = quality;
+    if (deferred)
+    {
+        // Frames más pequeños antes que menos frames, dentro del perfil
+        target = min(quality + BWCAP_QUALITY_STEP, (int)getProfile().qualityMax);
+    }
+    else if (budgetBaseQuality >= 0 && now - lastBudgetDeferral >= BWCAP_QUALITY_RECOVER_MS)
+    {
+        // Solo se vuelve hacia la calidad previa desde abajo; si ya es igual
+        // o mejor, la rebaja terminó
+        if (quality <= budgetBaseQuality)
+        {
+            budgetBaseQuality = -1;
+            return;
+        }
+        target = max(quality - BWCAP_QUALITY_STEP, budgetBaseQuality);
+    }
+    if (target == quality)
+        return;
+
+    if (deferred && budgetBaseQuality < 0)
+    {
+        budgetBaseQuality = quality;
+    }
+    if (!camManager->setQuality(target))
+        return;
+
+    invalidateJpegTables();
+    lastBudgetQualityChange = now;
+    if (target <= budgetBaseQuality)
+    {
+        budgetBaseQuality = -1;
+    }
+    Serial.printf("[📷] 🪣 Calidad %d → %d por el tope de ancho de banda\n", quality, target);
+}
+
 void FrameSender::sendReliable()
 {
     if (!wsManager->isConnected())
@@ -125,10 +502,23 @@ void FrameSender::sendReliable()
         return;
     }
 
+    if (profileCapturePending)
+    {
+        applyProfileCapture();
+    }
+    checkLinkFallback();
+
     unsigned long startTime = millis();
 
     camera_fb_t *fb = camManager->captureFrame();
 
+    // Un cambio de resolución que no validó se revierte en la captura
+    String revertNotice;
+    if (camManager->takeRevertNotice(revertNotice))
+    {
+        wsManager->sendText(revertNotice);
+    }
+
     if (!fb || fb->len == 0 || !fb->buf)
     {
         framesDropped++;
@@ -146,38 +536,68 @@ void FrameSender::sendReliable()
         return;
     }
 
-    Serial.printf("\n[📷] 🚀 Frame #%lu | %d KB | %dx%d\n",
-                  framesSent + 1, fb->len / 1024, fb->width, fb->height);
+    // Historial pre-evento: copia del JPEG original, también en modo solo vista previa
+    if (eventBuffer)
+    {
+        eventBuffer->record(fb);
+    }
 
-    // Advertencia para imágenes muy grandes
-    if (fb->len > THRESHOLD_XXLARGE)
+    // Grabación local continua (AVI)
+    if (recorder)
     {
-        Serial.printf("[📷] ⚠️ IMAGEN MUY GRANDE: %dKB - Usando chunks de ", fb->len / 1024);
-        size_t chunkSize = getOptimalChunkSize(fb->len);
-        Serial.printf("%dKB\n", chunkSize / 1024);
+        recorder->onFrame(fb);
     }
 
-    bool success = false;
+    // Vista previa 1/8 desde el JPEG original (abreviar/delta lo modifican)
+    if (previewGenerator)
+    {
+        previewGenerator->process(fb);
+        if (previewGenerator->isPreviewOnly())
+        {
+            camManager->returnFrame(fb);
+            return;
+        }
+    }
 
-    // Decidir método basado en tamaño
-    if (fb->len <= FRAME_SIZE_SMALL)
+    // Tope de ancho de banda: sin presupuesto el frame se descarta antes de
+    // codificarlo (delta, tablas JPEG) en lugar de encolar chunks, y la
+    // calidad baja para que los siguientes quepan. Se admite por el tamaño
+    // del JPEG completo: un delta nunca es mayor
+    if (!wsManager->admit(fb->len))
     {
-        Serial.printf("[📷] Método: Directo (%s)\n", getModeName().c_str());
-        success = sendFrameSynchronous(fb);
+        framesDropped++;
+        adaptQualityToBudget(true);
+        camManager->returnFrame(fb);
+        return;
     }
-    else if (fb->len <= FRAME_SIZE_MEDIUM)
+    if (wsManager->getBandwidthCap() > 0 || budgetBaseQuality >= 0)
     {
-        Serial.printf("[📷] Método: Con ACK (%s)\n", getModeName().c_str());
-        success = sendFrameWithAck(fb);
+        adaptQualityToBudget(false);
     }
-    else
+
+    // Vista del frame a transmitir (puede apuntar a un JPEG abreviado
+    // o a un delta con solo los intervalos RSTn que cambiaron)
+    camera_fb_t frame = *fb;
+    bool isDelta = deltaEncoder && deltaEncoder->encode(frame);
+    if (!isDelta && abbreviatedJpeg)
     {
-        size_t chunkSize = getOptimalChunkSize(fb->len);
-        Serial.printf("[📷] Método: Chunking (%s, chunks=%dB)\n",
-                      getModeName().c_str(), chunkSize);
-        success = sendFrameChunkedReliable(fb, chunkSize);
+        prepareAbbreviated(frame);
     }
 
+    Serial.printf("\n[📷] 🚀 Frame #%lu | %d KB | %dx%d%s\n",
+                  framesSent + 1, frame.len / 1024, frame.width, frame.height,
+                  isDelta ? " | delta" : "");
+
+    // Advertencia para imágenes muy grandes
+    if (frame.len > THRESHOLD_XXLARGE)
+    {
+        Serial.printf("[📷] ⚠️ IMAGEN MUY GRANDE: %dKB - Usando chunks de ", frame.len / 1024);
+        size_t chunkSize = getOptimalChunkSize(frame.len);
+        Serial.printf("%dKB\n", chunkSize / 1024);
+    }
+
+    bool success = dispatchFrame(&frame, startTime, true);
+
     unsigned long transferTime = millis() - startTime;
 
     // Actualizar estadísticas
@@ -185,6 +605,15 @@ void FrameSender::sendReliable()
     {
         framesSent++;
         lastSendTime = millis();
+        fpsController->frameSent();
+        if (linkEstimator)
+        {
+            linkEstimator->onFrameDelivered(frame.len, transferTime);
+        }
+        if (framePacer)
+        {
+            framePacer->recordTransfer(transferTime);
+        }
 
         // Calcular tiempo promedio
         totalFrameTime += transferTime;
@@ -201,6 +630,18 @@ void FrameSender::sendReliable()
     }
 
     successRate = (float)framesSent / (framesSent + framesFailed);
+    if (streamProfiles)
+    {
+        streamProfiles->record(operationMode, frame.len, transferTime, success);
+    }
+    if (modeGovernor)
+    {
+        modeGovernor->onFrameResult(success, transferTime);
+    }
+    if (deltaEncoder)
+    {
+        deltaEncoder->onFrameResult(success);
+    }
     logTransferStats(fb, success, transferTime);
 
     camManager->returnFrame(fb);
@@ -220,7 +661,12 @@ bool FrameSender::sendFrameWithAck(camera_fb_t *fb)
     uint32_t frameId = ++sync.frameId;
 
     String header = "{\"type\":\"frame_start\",\"id\":" + String(frameId) +
-                    ",\"size\":" + String(fb->len) + "}";
+                    ",\"size\":" + String(fb->len);
+    if (camManager->isRoiActive())
+    {
+        header += "," + camManager->getRoiJson();
+    }
+    header += "}";
     wsManager->sendText(header);
 
     smartDelay(delays.afterHeader);
@@ -241,10 +687,13 @@ bool FrameSender::sendFrameChunkedReliable(camera_fb_t *fb, size_t chunkSize)
 {
     uint32_t frameId = ++sync.frameId;
     size_t totalSize = fb->len;
-    size_t numChunks = (totalSize + chunkSize - 1) / chunkSize;
 
-    Serial.printf("[📷] 📦 %d chunks de %dB (Total: %dKB)\n",
-                  numChunks, chunkSize, totalSize / 1024);
+    // Con RSTn en el frame los chunks siguen los límites de franja
+    sliceFrame = sliceChunking && buildSlicePlan(fb, chunkSize);
+    size_t numChunks = sliceFrame ? sliceCount : (totalSize + chunkSize - 1) / chunkSize;
+
+    Serial.printf("[📷] 📦 %d chunks de %dB%s (Total: %dKB)\n",
+                  numChunks, chunkSize, sliceFrame ? " máx, por franjas" : "", totalSize / 1024);
 
     // Delay adaptativo: imágenes muy grandes necesitan un poco más de tiempo
     uint16_t adaptiveChunkDelay = delays.betweenChunks;
@@ -261,28 +710,57 @@ bool FrameSender::sendFrameChunkedReliable(camera_fb_t *fb, size_t chunkSize)
                     ",\"chunks\":" + String(numChunks) +
                     ",\"chunkSize\":" + String(chunkSize) +
                     ",\"width\":" + String(fb->width) +
-                    ",\"height\":" + String(fb->height) + "}";
+                    ",\"height\":" + String(fb->height);
+    if (sliceFrame)
+    {
+        header += ",\"slices\":true,\"mcuRows\":" + String(sliceMcuRows);
+    }
+    if (camManager->isRoiActive())
+    {
+        header += "," + camManager->getRoiJson();
+    }
+    header += "}";
 
     wsManager->sendText(header);
     smartDelay(delays.afterHeader);
 
     // CHUNKS
+    bool spread = framePacer && framePacer->isSpread();
+    if (framePacer)
+    {
+        framePacer->beginFrame(totalSize, fpsController->getFrameInterval(),
+                               fpsController->getTimeToDeadlineUs(), getEffectivePacingRate());
+    }
     size_t sent = 0;
-    int chunkNum = 0;
+    bool allSent = true;
     unsigned long lastProgressLog = millis();
     unsigned long chunkStartTime = millis();
 
-    while (sent < totalSize)
+    for (size_t chunkNum = 0; chunkNum < numChunks; chunkNum++)
     {
-        size_t remaining = totalSize - sent;
-        size_t currentChunkSize = (remaining < chunkSize) ? remaining : chunkSize;
+        size_t offset, currentChunkSize;
+        if (!getChunkBounds(fb, chunkNum, chunkSize, offset, currentChunkSize))
+        {
+            allSent = false;
+            break;
+        }
 
-        wsManager->sendBinary(fb->buf + sent, currentChunkSize);
+        paceChunk(currentChunkSize);
+        if (!sendChunk(fb, frameId, chunkNum, numChunks, chunkSize, 0))
+        {
+            allSent = false;
+        }
+        if (framePacer)
+        {
+            framePacer->chunkSent();
+        }
         sent += currentChunkSize;
-        chunkNum++;
 
-        // Delay inteligente adaptativo
-        smartDelay(adaptiveChunkDelay);
+        // Delay inteligente adaptativo (con reparto, el hueco ya lo marca el pacer)
+        if (!spread)
+        {
+            smartDelay(adaptiveChunkDelay);
+        }
 
         // Log de progreso cada 500ms o cada 20%
         unsigned long now = millis();
@@ -292,11 +770,16 @@ bool FrameSender::sendFrameChunkedReliable(camera_fb_t *fb, size_t chunkSize)
         {
             float speed = (float)sent / ((now - chunkStartTime) / 1000.0) / 1024.0; // KB/s
             Serial.printf("[📷] 📦 %d%% (%d/%d KB) | %.1f KB/s | Chunk #%d/%d\n",
-                          percent, sent / 1024, totalSize / 1024, speed, chunkNum, numChunks);
+                          percent, sent / 1024, totalSize / 1024, speed, chunkNum + 1, numChunks);
             lastProgressLog = now;
         }
     }
 
+    if (framePacer)
+    {
+        framePacer->endFrame();
+    }
+
     // Calcular velocidad final
     unsigned long transferTime = millis() - chunkStartTime;
     float avgSpeed = (float)totalSize / (transferTime / 1000.0) / 1024.0;
@@ -305,14 +788,154 @@ bool FrameSender::sendFrameChunkedReliable(camera_fb_t *fb, size_t chunkSize)
     // FOOTER
     String footer = "{\"type\":\"img_end\",\"id\":" + String(frameId) +
                     ",\"size\":" + String(totalSize) +
-                    ",\"success\":true}";
+                    ",\"success\":" + String(allSent ? "true" : "false") + "}";
 
     wsManager->sendText(footer);
-    smartDelay(delays.afterFooter);
 
-    Serial.println("[📷] ✅ Chunks completos");
+    if (!allSent)
+    {
+        Serial.println("[📷] ❌ Error enviando chunks");
+        sliceFrame = false;
+        return false;
+    }
 
-    return true;
+    // Retener el frame hasta ACK o deadline para reenviar solo lo perdido
+    bool acked = waitForFrameAck(fb, frameId, numChunks, chunkSize);
+    sliceFrame = false;
+    return acked;
+}
+
+bool FrameSender::sendChunk(camera_fb_t *fb, uint32_t frameId, uint16_t index, uint16_t count,
+                            size_t chunkSize, uint8_t flags)
+{
+    size_t offset, length;
+    if (!getChunkBounds(fb, index, chunkSize, offset, length))
+    {
+        return false;
+    }
+    size_t needed = sizeof(ChunkHeader) + length;
+
+    if (needed > txBufferSize)
+    {
+        uint8_t *buffer = (uint8_t *)realloc(txBuffer, needed);
+        if (!buffer)
+        {
+            Serial.printf("[📷] ✗ Sin memoria para buffer de chunk (%dB)\n", needed);
+            return false;
+        }
+        txBuffer = buffer;
+        txBufferSize = needed;
+    }
+
+    ChunkHeader header;
+    memset(&header, 0, sizeof(ChunkHeader));
+    header.magic = CHUNK_MAGIC;
+    header.headerLen = sizeof(ChunkHeader);
+    header.flags = flags;
+    header.frameId = frameId;
+    header.offset = offset;
+    header.index = index;
+    header.count = count;
+    header.crc = esp_crc32_le(0, fb->buf + offset, length); // CRC por hardware/ROM
+
+    if (sliceFrame)
+    {
+        const ChunkSlice &slice = slicePlan[index];
+        uint32_t lastMcu = min((uint32_t)(slice.rstFirst + slice.rstCount) * sliceInterval,
+                               (uint32_t)sliceMcuCols * sliceMcuRows) - 1;
+        header.flags |= CHUNK_FLAG_SLICE;
+        header.rstFirst = slice.rstFirst;
+        header.rstCount = slice.rstCount;
+        header.mcuRowStart = (uint32_t)slice.rstFirst * sliceInterval / sliceMcuCols;
+        header.mcuRowEnd = lastMcu / sliceMcuCols;
+    }
+
+    memcpy(txBuffer, &header, sizeof(ChunkHeader));
+    memcpy(txBuffer + sizeof(ChunkHeader), fb->buf + offset, length);
+
+    return wsManager->sendBinary(txBuffer, needed);
+}
+
+bool FrameSender::waitForFrameAck(camera_fb_t *fb, uint32_t frameId, uint16_t count, size_t chunkSize)
+{
+    sync.waitingForAck = true;
+    sync.ackTimeout = millis() + NACK_DEADLINE_MS;
+    int rounds = 0;
+
+    while (sync.ackedFrameId != frameId && (long)(sync.ackTimeout - millis()) > 0)
+    {
+        wsManager->loop();
+
+        // Conexión perdida: el ACK ya no llegará, no esperar al deadline
+        if (!wsManager->isConnected())
+        {
+            break;
+        }
+
+        if (sync.nackFrameId == frameId && sync.missingCount > 0)
+        {
+            if (++rounds > NACK_MAX_ROUNDS)
+            {
+                Serial.printf("[📷] ✗ Demasiadas rondas de NACK para frame #%lu\n", frameId);
+                break;
+            }
+
+            Serial.printf("[📷] 🔁 NACK ronda %d: reenviando %d chunks\n", rounds, sync.missingCount);
+
+            for (size_t i = 0; i < sync.missingCount; i++)
+            {
+                if (sync.missing[i] < count &&
+                    sendChunk(fb, frameId, sync.missing[i], count, chunkSize, CHUNK_FLAG_RETRANSMIT))
+                {
+                    chunksRetransmitted++;
+                }
+                smartDelay(delays.betweenChunks);
+            }
+            sync.missingCount = 0;
+
+            String footer = "{\"type\":\"img_end\",\"id\":" + String(frameId) +
+                            ",\"size\":" + String(fb->len) +
+                            ",\"round\":" + String(rounds) +
+                            ",\"success\":true}";
+            wsManager->sendText(footer);
+
+            sync.ackTimeout = millis() + NACK_DEADLINE_MS;
+        }
+
+        delay(DELAY_WS_PROCESSING);
+    }
+
+    sync.waitingForAck = false;
+    bool acked = (sync.ackedFrameId == frameId);
+
+    if (acked)
+    {
+        smartDelay(delays.afterFooter);
+        Serial.println("[📷] ✅ Chunks completos (ACK)");
+    }
+    else
+    {
+        Serial.printf("[📷] ⏱️ Sin ACK para frame #%lu\n", frameId);
+    }
+
+    return acked;
+}
+
+void FrameSender::onFrameAck(uint32_t frameId)
+{
+    sync.ackedFrameId = frameId;
+}
+
+void FrameSender::onFrameNack(uint32_t frameId, const uint16_t *missing, size_t count)
+{
+    if (!sync.waitingForAck || frameId != sync.frameId)
+    {
+        return;
+    }
+
+    sync.missingCount = min(count, (size_t)NACK_MAX_INDICES);
+    memcpy(sync.missing, missing, sync.missingCount * sizeof(uint16_t));
+    sync.nackFrameId = frameId;
 }
 
 bool FrameSender::validateFrame(camera_fb_t *fb)
@@ -355,6 +978,7 @@ void FrameSender::logTransferStats(camera_fb_t *fb, bool success, unsigned long
         Serial.println("\n[📊] ===== ESTADÍSTICAS =====");
         Serial.printf("    Frames: %lu exitosos, %lu fallos\n", framesSent, framesFailed);
         Serial.printf("    Tasa éxito: %.1f%%\n", successRate * 100);
+        Serial.printf("    Chunks reenviados: %lu\n", chunksRetransmitted);
         Serial.printf("    Tiempo promedio: %lums\n", averageFrameTime);
         Serial.printf("    Modo: %s\n", getModeName().c_str());
         Serial.printf("    RSSI: %d dBm\n", WiFi.RSSI());
@@ -363,18 +987,71 @@ void FrameSender::logTransferStats(camera_fb_t *fb, bool success, unsigned long
     }
 }
 
-void FrameSender::sendHighQuality()
+bool FrameSender::dispatchFrame(camera_fb_t *frame, unsigned long startTime, bool tune)
 {
-    static unsigned long lastFrameTime = 0;
-    unsigned long now = millis();
+    bool success = false;
 
-    if (now - lastFrameTime < 2000)
+    // Decidir método basado en tamaño
+    const StreamProfile &profile = getProfile();
+    if (frame->len <= profile.directMax)
     {
-        return;
+        Serial.printf("[📷] Método: Directo (%s)\n", getModeName().c_str());
+        success = sendFrameSynchronous(frame);
+    }
+    else if (frame->len <= profile.ackMax)
+    {
+        Serial.printf("[📷] Método: Con ACK (%s)\n", getModeName().c_str());
+        success = sendFrameWithAck(frame);
     }
+    else
+    {
+        size_t chunkSize = getOptimalChunkSize(frame->len);
+        framesize_t res = camManager->getCurrentResolution();
+        // El ajuste fino sigue a la tabla de chunks en uso
+        uint8_t tuneMode = linkPoorApplied ? MODE_STABILITY : operationMode;
+        if (chunkTuner && tune)
+        {
+            chunkSize = chunkTuner->selectChunkSize(tuneMode, res, frame->len, chunkSize);
+        }
+
+        Serial.printf("[📷] Método: Chunking (%s, chunks=%dB)\n",
+                      getModeName().c_str(), chunkSize);
+        success = sendFrameChunkedReliable(frame, chunkSize);
+
+        if (chunkTuner && tune)
+        {
+            chunkTuner->report(tuneMode, res, chunkSize, frame->len,
+                               millis() - startTime, success);
+        }
+    }
+
+    return success;
+}
+
+bool FrameSender::sendTaggedFrame(camera_fb_t *fb, const String &info)
+{
+    if (!wsManager->isConnected() || !validateFrame(fb))
+    {
+        return false;
+    }
+
+    // Aviso previo: el receptor no trata el siguiente frame como parte del
+    // stream (no es referencia delta ni pasa por la vista previa)
+    if (!wsManager->sendText(info))
+    {
+        return false;
+    }
+
+    Serial.printf("\n[📷] 🏷️ Frame etiquetado | %d KB | %dx%d\n",
+                  fb->len / 1024, fb->width, fb->height);
+
+    // Sin auto-tuning: el tamaño no corresponde a la resolución del stream
+    unsigned long startTime = millis();
+    bool success = dispatchFrame(fb, startTime, false);
 
-    sendReliable();
-    lastFrameTime = now;
+    Serial.printf("[📷] %s Frame etiquetado | Tiempo: %lums\n",
+                  success ? "✅" : "❌", millis() - startTime);
+    return success;
 }
 
 unsigned long FrameSender::getFramesSent() { return framesSent; }
@@ -382,4 +1059,8 @@ unsigned long FrameSender::getFramesDropped() { return framesDropped; }
 size_t FrameSender::getLastFrameSize() { return lastFrameSize; }
 float FrameSender::getSuccessRate() const { return successRate; }
 unsigned long FrameSender::getLastSendTime() const { return lastSendTime; }
-unsigned long FrameSender::getAverageFrameTime() const { return averageFrameTime; }
\ No newline at end of file
+unsigned long FrameSender::getAverageFrameTime() const { return averageFrameTime; }
+unsigned long FrameSender::getChunksRetransmitted() const { return chunksRetransmitted; }
+unsigned long FrameSender::getAbbreviatedBytesSaved() const { return abbrevBytesSaved; }
+unsigned long FrameSender::getDeltaBytesSaved() const { return deltaEncoder ? deltaEncoder->getBytesSaved() : 0; }
+uint32_t FrameSender::getLastFrameId() const { return sync.frameId; }
\ No newline at end of file
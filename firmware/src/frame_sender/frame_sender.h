@@ -8,6 +8,47 @@
 class WebSocketManager;
 class CameraManager;
 class FPSController;
+class ChunkTuner;
+class DeltaEncoder;
+class PreviewGenerator;
+class EventBuffer;
+class Recorder;
+class LinkEstimator;
+class StreamProfiles;
+class ModeGovernor;
+class FramePacer;
+struct JpegLayout;
+struct StreamProfile;
+
+// Cabecera binaria que precede a cada chunk (little-endian).
+// El receptor verifica el CRC y puede pedir por NACK los índices perdidos.
+struct __attribute__((packed)) ChunkHeader
+{
+    uint8_t magic;     // CHUNK_MAGIC
+    uint8_t headerLen; // sizeof(ChunkHeader), permite extender la cabecera
+    uint8_t flags;     // CHUNK_FLAG_*
+    uint8_t reserved;
+    uint32_t frameId;
+    uint32_t offset;   // Posición del payload dentro del frame
+    uint16_t index;    // Índice del chunk
+    uint16_t count;    // Total de chunks del frame
+    uint32_t crc;      // esp_crc32_le del payload
+
+    // Solo con CHUNK_FLAG_SLICE: intervalos RSTn y filas MCU [start, end] del chunk
+    uint16_t rstFirst;
+    uint16_t rstCount;
+    uint16_t mcuRowStart;
+    uint16_t mcuRowEnd;
+};
+
+// Rango de bytes de un chunk alineado a marcadores RSTn
+struct ChunkSlice
+{
+    uint32_t offset;
+    uint32_t length;
+    uint16_t rstFirst;
+    uint16_t rstCount;
+};
 
 class FrameSender
 {
@@ -15,12 +56,44 @@ public:
     FrameSender(WebSocketManager *ws, CameraManager *cam, FPSController *fps);
 
     void sendReliable();
-    void sendHighQuality();
 
-    // Gestión de modos
+    // Frame fuera del stream (snapshot, ventana de evento): precedido por el
+    // JSON info, sin delta/abreviado/vista previa. fb sigue siendo del llamador
+    bool sendTaggedFrame(camera_fb_t *fb, const String &info);
+
+    // Confirmaciones del receptor (llamadas desde CommandProcessor)
+    void onFrameAck(uint32_t frameId);
+    void onFrameNack(uint32_t frameId, const uint16_t *missing, size_t count);
+
+    void setChunkTuner(ChunkTuner *tuner);
+    void setDeltaEncoder(DeltaEncoder *encoder);
+    void setPreviewGenerator(PreviewGenerator *generator);
+    void setEventBuffer(EventBuffer *buffer);
+    void setRecorder(Recorder *rec);
+    void setLinkEstimator(LinkEstimator *estimator);
+    void setStreamProfiles(StreamProfiles *profiles);
+    void setModeGovernor(ModeGovernor *governor);
+    void setFramePacer(FramePacer *pacer);
+    void setPacingRate(uint32_t bytesPerSecond); // 0 = sin pacing
+    void clearBudgetQuality(); // Calidad fijada a mano: el tope no la recupera
+    uint32_t getPacingRate() const;
+
+    // JPEG abreviado: tablas DQT/DHT solo cuando cambian
+    void setAbbreviatedJpeg(bool enabled);
+    bool isAbbreviatedJpeg() const;
+    void invalidateJpegTables(); // Tras reconexión o cambio de calidad/resolución
+    void resumeJpegTables(uint32_t receiverHash); // Sesión reanudada: el receptor conserva sus tablas
+
+    // Chunks por franjas de filas MCU (activa los RSTn del sensor)
+    bool setSliceChunking(bool enabled);
+    bool isSliceChunking() const;
+
+    // Gestión de modos (índice en la tabla de perfiles de streaming)
     void setMode(uint8_t mode);
     uint8_t getMode() const;
     String getModeName() const;
+    const StreamProfile &getProfile() const;
+    void refreshProfile(); // Tras editar el perfil activo
 
     // Estadísticas
     unsigned long getFramesSent();
@@ -29,11 +102,24 @@ public:
     float getSuccessRate() const;
     unsigned long getLastSendTime() const;
     unsigned long getAverageFrameTime() const;
+    unsigned long getChunksRetransmitted() const;
+    unsigned long getAbbreviatedBytesSaved() const;
+    unsigned long getDeltaBytesSaved() const;
+    uint32_t getLastFrameId() const; // Último id de frame chunked enviado
 
 private:
     WebSocketManager *wsManager;
     CameraManager *camManager;
     FPSController *fpsController;
+    ChunkTuner *chunkTuner;
+    DeltaEncoder *deltaEncoder;
+    PreviewGenerator *previewGenerator;
+    EventBuffer *eventBuffer;
+    Recorder *recorder;
+    LinkEstimator *linkEstimator;
+    StreamProfiles *streamProfiles;
+    ModeGovernor *modeGovernor;
+    FramePacer *framePacer;
 
     // Estadísticas
     unsigned long framesSent;
@@ -42,6 +128,7 @@ private:
     size_t lastFrameSize;
     float successRate;
     unsigned long lastSendTime;
+    unsigned long chunksRetransmitted;
     
     // Tiempos de procesamiento
     unsigned long totalFrameTime;
@@ -50,6 +137,8 @@ private:
 
     // Modo de operación
     uint8_t operationMode;
+    bool profileCapturePending; // Calidad/captura del perfil aún sin aplicar a la cámara
+    bool linkPoorApplied;       // Pausas y chunks de estabilidad por enlace degradado
 
     // Delays configurables según modo
     struct DelayConfig {
@@ -65,19 +154,70 @@ private:
         bool waitingForAck;
         unsigned long ackTimeout;
         uint32_t frameId;
+        uint32_t ackedFrameId;
+        uint32_t nackFrameId;
+        uint16_t missing[NACK_MAX_INDICES];
+        size_t missingCount;
     } sync;
 
+    // Pacing: inicio de cada chunk espaciado según la tasa objetivo
+    uint32_t pacingRate;
+    unsigned long lastChunkStartUs;
+    size_t lastChunkBytes;
+
+    // Tope de ancho de banda: calidad rebajada por falta de presupuesto
+    int budgetBaseQuality; // Calidad previa a la rebaja (-1 = sin rebaja)
+    unsigned long lastBudgetDeferral;
+    unsigned long lastBudgetQualityChange;
+
+    // JPEG abreviado
+    bool abbreviatedJpeg;
+    bool tablesSent;
+    uint32_t sentTablesHash;
+    unsigned long abbrevBytesSaved;
+
+    // Chunks alineados a RSTn del frame en curso
+    bool sliceChunking;
+    bool sliceFrame;
+    ChunkSlice *slicePlan;
+    uint32_t *restartOffsets;
+    uint16_t sliceCount;
+    uint16_t sliceInterval; // MCUs por intervalo RSTn
+    uint16_t sliceMcuCols;
+    uint16_t sliceMcuRows;
+
+    // Buffer de transmisión (cabecera + payload del chunk)
+    uint8_t *txBuffer;
+    size_t txBufferSize;
+
     // Métodos de envío
+    bool dispatchFrame(camera_fb_t *frame, unsigned long startTime, bool tune); // Método según tamaño
     bool sendFrameSynchronous(camera_fb_t *fb);
     bool sendFrameWithAck(camera_fb_t *fb);
     bool sendFrameChunkedReliable(camera_fb_t *fb, size_t chunkSize);
+    bool sendChunk(camera_fb_t *fb, uint32_t frameId, uint16_t index, uint16_t count,
+                   size_t chunkSize, uint8_t flags);
+    bool buildSlicePlan(camera_fb_t *fb, size_t chunkSize);
+    bool getChunkBounds(camera_fb_t *fb, uint16_t index, size_t chunkSize,
+                        size_t &offset, size_t &length);
+    bool waitForFrameAck(camera_fb_t *fb, uint32_t frameId, uint16_t count, size_t chunkSize);
+
+    // JPEG abreviado
+    void prepareAbbreviated(camera_fb_t &frame);
+    bool sendJpegTables(const uint8_t *buf, const JpegLayout &layout);
 
     // Métodos auxiliares
     bool validateFrame(camera_fb_t *fb);
     void logTransferStats(camera_fb_t *fb, bool success, unsigned long duration);
+    const StreamProfile &getTransferProfile() const; // Perfil de pausas y chunks en uso
+    void checkLinkFallback();                       // Una vez por frame
     void updateDelaysForMode();
+    void applyProfileCapture();
+    uint32_t getEffectivePacingRate() const;
     size_t getOptimalChunkSize(size_t frameSize);
     void smartDelay(uint16_t maxDelay);
+    void paceChunk(size_t chunkBytes);
+    void adaptQualityToBudget(bool deferred);
 };
 
 #endif
\ No newline at end of file
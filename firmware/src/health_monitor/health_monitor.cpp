@@ -1,13 +1,18 @@
 #include "health_monitor.h"
 #include "../websocket_manager/websocket_manager.h"
 #include "../frame_sender/frame_sender.h"
+#include "../fps_controller/fps_controller.h"
+#include "../camera_manager/camera_manager.h"
+#include "../link_estimator/link_estimator.h"
+#include "../mode_governor/mode_governor.h"
+#include "../frame_pacer/frame_pacer.h"
 #include "../configuration/config.h" // <-- Añade esta línea
 #include <WiFi.h>
 #include <Arduino.h>
 #include <esp_camera.h>
 
 HealthMonitor::HealthMonitor(WebSocketManager *ws)
-    : wsManager(ws), frameSender(nullptr), lastHealthTime(0), systemStartTime(0)
+    : wsManager(ws), frameSender(nullptr), fpsController(nullptr), camManager(nullptr), linkEstimator(nullptr), modeGovernor(nullptr), framePacer(nullptr), lastHealthTime(0), systemStartTime(0)
 {
 }
 
@@ -21,6 +26,31 @@ void HealthMonitor::setFrameSender(FrameSender *fs)
     frameSender = fs;
 }
 
+void HealthMonitor::setFPSController(FPSController *fps)
+{
+    fpsController = fps;
+}
+
+void HealthMonitor::setCameraManager(CameraManager *cam)
+{
+    camManager = cam;
+}
+
+void HealthMonitor::setLinkEstimator(LinkEstimator *estimator)
+{
+    linkEstimator = estimator;
+}
+
+void HealthMonitor::setModeGovernor(ModeGovernor *governor)
+{
+    modeGovernor = governor;
+}
+
+void HealthMonitor::setFramePacer(FramePacer *pacer)
+{
+    framePacer = pacer;
+}
+
 void HealthMonitor::sendPeriodic()
 {
     unsigned long now = millis();
@@ -48,6 +78,9 @@ String HealthMonitor::generateHealthJson()
     {
         json += "\"frames\":" + String(frameSender->getFramesSent()) + ",";
         json += "\"dropped\":" + String(frameSender->getFramesDropped()) + ",";
+        json += "\"retransmits\":" + String(frameSender->getChunksRetransmitted()) + ",";
+        json += "\"abbrevSaved\":" + String(frameSender->getAbbreviatedBytesSaved()) + ",";
+        json += "\"deltaSaved\":" + String(frameSender->getDeltaBytesSaved()) + ",";
     }
     else
     {
@@ -55,9 +88,31 @@ String HealthMonitor::generateHealthJson()
         json += "\"dropped\":0,";
     }
 
+    // FPS entregado frente al objetivo y jitter entre frames (µs)
+    if (fpsController)
+    {
+        json += fpsController->getStatsJson() + ",";
+    }
+
     json += "\"heap\":" + String(esp_get_free_heap_size()) + ",";
     json += "\"minHeap\":" + String(esp_get_minimum_free_heap_size()) + ",";
     json += "\"rssi\":" + String(WiFi.RSSI()) + ",";
+
+    // Calidad del enlace: RSSI, PHY, pérdidas TCP, RTT y goodput combinados
+    if (linkEstimator)
+    {
+        json += linkEstimator->getStatsJson() + ",";
+    }
+    if (modeGovernor)
+    {
+        json += modeGovernor->getStatsJson() + ",";
+    }
+    json += wsManager->getBandwidthJson() + ",";
+    if (framePacer)
+    {
+        json += framePacer->getStatsJson() + ",";
+        framePacer->resetWindow(); // Ráfaga máxima por intervalo de salud
+    }
     json += "\"uptime\":\"" + formatUptime(uptime) + "\",";
 
     // Camera metadata
@@ -104,6 +159,13 @@ String HealthMonitor::generateHealthJson()
         }
     }
     json += "\"resolution\":\"" + resolution + "\",";
+
+    // Recuperaciones del sensor por nivel (suave por SCCB / reinicio completo)
+    if (camManager)
+    {
+        json += camManager->getRecoveryJson() + ",";
+        json += camManager->getSwitchJson() + ",";
+    }
     if (s) {
         json += "\"quality\":" + String(s->status.quality);
     } else {
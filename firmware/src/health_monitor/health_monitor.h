@@ -6,6 +6,11 @@
 // Forward declarations
 class WebSocketManager;
 class FrameSender;
+class FPSController;
+class CameraManager;
+class LinkEstimator;
+class ModeGovernor;
+class FramePacer;
 
 class HealthMonitor
 {
@@ -16,10 +21,20 @@ public:
     void sendImmediate();
     void setStartTime(unsigned long startTime);
     void setFrameSender(FrameSender *fs);
+    void setFPSController(FPSController *fps);
+    void setCameraManager(CameraManager *cam);
+    void setLinkEstimator(LinkEstimator *estimator);
+    void setModeGovernor(ModeGovernor *governor);
+    void setFramePacer(FramePacer *pacer);
 
 private:
     WebSocketManager *wsManager;
     FrameSender *frameSender;
+    FPSController *fpsController;
+    CameraManager *camManager;
+    LinkEstimator *linkEstimator;
+    ModeGovernor *modeGovernor;
+    FramePacer *framePacer;
     unsigned long lastHealthTime;
     unsigned long systemStartTime;
 
@@ -0,0 +1,165 @@
+#include "jpeg_utils.h"
+#include <esp_crc.h>
+
+bool JpegParser::parse(const uint8_t *buf, size_t len, JpegLayout &layout)
+{
+    memset(&layout, 0, sizeof(JpegLayout));
+
+    if (len < 4 || buf[0] != 0xFF || buf[1] != 0xD8)
+        return false;
+
+    size_t i = 2;
+    while (i + 4 <= len)
+    {
+        if (buf[i] != 0xFF)
+            return false;
+
+        uint8_t marker = buf[i + 1];
+        if (marker == 0xFF) // Relleno
+        {
+            i++;
+            continue;
+        }
+
+        size_t segLen = ((size_t)buf[i + 2] << 8) | buf[i + 3];
+        if (segLen < 2 || i + 2 + segLen > len)
+            return false;
+
+        if (marker == 0xDB || marker == 0xC4) // DQT / DHT
+        {
+            if (layout.tableCount >= JPEG_MAX_TABLE_SEGMENTS)
+                return false;
+            if (layout.tableCount == 0)
+                layout.tablesStart = i;
+            layout.tables[layout.tableCount++] = {i, segLen + 2, marker};
+            layout.tablesEnd = i + 2 + segLen;
+            layout.tablesBytes += segLen + 2;
+            layout.tablesHash = esp_crc32_le(layout.tablesHash, buf + i, segLen + 2);
+        }
+        else if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC8 && marker != 0xCC)
+        {
+            // SOFn: precisión(1) alto(2) ancho(2) componentes(1) + 3 bytes por componente
+            if (segLen >= 8)
+            {
+                layout.height = ((uint16_t)buf[i + 5] << 8) | buf[i + 6];
+                layout.width = ((uint16_t)buf[i + 7] << 8) | buf[i + 8];
+
+                // Tamaño de MCU = 8 x factor de muestreo máximo (4:2:2 → 16x8)
+                uint8_t components = buf[i + 9];
+                uint8_t maxH = 1, maxV = 1;
+                for (uint8_t c = 0; c < components && 10 + c * 3u < segLen; c++)
+                {
+                    uint8_t sampling = buf[i + 11 + c * 3];
+                    maxH = max(maxH, (uint8_t)(sampling >> 4));
+                    maxV = max(maxV, (uint8_t)(sampling & 0x0F));
+                }
+                layout.mcuWidth = 8 * maxH;
+                layout.mcuHeight = 8 * maxV;
+                layout.mcuCols = (layout.width + layout.mcuWidth - 1) / layout.mcuWidth;
+                layout.mcuRows = (layout.height + layout.mcuHeight - 1) / layout.mcuHeight;
+            }
+        }
+        else if (marker == 0xDD && segLen >= 4) // DRI
+        {
+            layout.restartInterval = ((uint16_t)buf[i + 4] << 8) | buf[i + 5];
+        }
+        else if (marker == 0xDA) // SOS: fin de la cabecera
+        {
+            layout.sosOffset = i;
+            layout.scanOffset = i + 2 + segLen;
+            layout.valid = true;
+            return true;
+        }
+
+        i += 2 + segLen;
+    }
+
+    return false;
+}
+
+size_t JpegParser::stripTables(uint8_t *buf, size_t len, const JpegLayout &layout)
+{
+    if (!layout.valid || layout.tableCount == 0)
+        return 0;
+
+    // Bytes de cabecera que NO son tablas dentro de [0, tablesEnd)
+    size_t keep = layout.tablesEnd - layout.tablesBytes;
+    uint8_t *header = (uint8_t *)malloc(keep);
+    if (!header)
+        return 0;
+
+    size_t pos = 0;
+    size_t cursor = 0;
+    for (uint8_t t = 0; t < layout.tableCount; t++)
+    {
+        const JpegSegment &seg = layout.tables[t];
+        memcpy(header + pos, buf + cursor, seg.offset - cursor);
+        pos += seg.offset - cursor;
+        cursor = seg.offset + seg.length;
+    }
+
+    // Mover solo la cabecera (cientos de bytes) junto a los datos restantes:
+    // evita copiar el frame completo
+    size_t newStart = layout.tablesEnd - keep;
+    memcpy(buf + newStart, header, keep);
+    free(header);
+
+    return newStart;
+}
+
+size_t JpegParser::findRestartMarkers(const uint8_t *buf, size_t len, const JpegLayout &layout,
+                                     uint32_t *offsets, size_t maxOffsets)
+{
+    if (!layout.valid || layout.restartInterval == 0)
+        return 0;
+
+    // En los datos entrópicos un 0xFF real va seguido de 0x00 (byte stuffing):
+    // solo FFD0-FFD7 son RSTn y FFD9 es el EOI
+    size_t count = 0;
+    size_t i = layout.scanOffset;
+    while (i + 1 < len && count < maxOffsets)
+    {
+        const uint8_t *next = (const uint8_t *)memchr(buf + i, 0xFF, len - i - 1);
+        if (!next)
+            break;
+        i = next - buf;
+
+        uint8_t marker = buf[i + 1];
+        if (marker >= 0xD0 && marker <= 0xD7)
+        {
+            offsets[count++] = i;
+            i += 2;
+        }
+        else if (marker == 0xD9)
+        {
+            break;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    return count;
+}
+
+size_t JpegParser::buildTablesOnly(const uint8_t *buf, const JpegLayout &layout,
+                                   uint8_t *out, size_t outSize)
+{
+    size_t needed = layout.tablesBytes + 4;
+    if (!layout.valid || layout.tableCount == 0 || needed > outSize)
+        return 0;
+
+    size_t pos = 0;
+    out[pos++] = 0xFF;
+    out[pos++] = 0xD8;
+    for (uint8_t t = 0; t < layout.tableCount; t++)
+    {
+        memcpy(out + pos, buf + layout.tables[t].offset, layout.tables[t].length);
+        pos += layout.tables[t].length;
+    }
+    out[pos++] = 0xFF;
+    out[pos++] = 0xD9;
+
+    return pos;
+}
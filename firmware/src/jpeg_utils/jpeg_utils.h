@@ -0,0 +1,60 @@
+#ifndef JPEG_UTILS_H
+#define JPEG_UTILS_H
+
+#include <Arduino.h>
+
+#define JPEG_MAX_TABLE_SEGMENTS 8
+#define JPEG_MAX_RESTART_MARKERS 256 // Una fila MCU por intervalo: QXGA 4:2:2 = 192 filas
+
+// Segmento de cabecera JPEG (incluye marcador FFxx y campo de longitud)
+struct JpegSegment
+{
+    size_t offset;
+    size_t length;
+    uint8_t marker;
+};
+
+// Resultado de la pasada de marcadores hasta el SOS
+struct JpegLayout
+{
+    bool valid;
+    uint16_t width;
+    uint16_t height;
+    uint16_t restartInterval; // DRI en MCUs (0 = sin marcadores RSTn)
+    uint8_t mcuWidth;         // Píxeles por MCU según el muestreo del SOF (8/16)
+    uint8_t mcuHeight;
+    uint16_t mcuCols;         // MCUs por fila
+    uint16_t mcuRows;         // Filas de MCUs
+    size_t sosOffset;         // Offset del marcador SOS
+    size_t scanOffset;        // Inicio de los datos entrópicos
+
+    // Tablas DQT/DHT y su rango [tablesStart, tablesEnd)
+    uint8_t tableCount;
+    JpegSegment tables[JPEG_MAX_TABLE_SEGMENTS];
+    size_t tablesStart;
+    size_t tablesEnd;
+    size_t tablesBytes;
+    uint32_t tablesHash;
+};
+
+class JpegParser
+{
+public:
+    // Recorre los marcadores de cabecera (sin decodificar datos entrópicos)
+    static bool parse(const uint8_t *buf, size_t len, JpegLayout &layout);
+
+    // Quita las tablas DQT/DHT moviendo en sitio la cabecera restante.
+    // Devuelve el nuevo inicio del JPEG abreviado dentro de buf.
+    static size_t stripTables(uint8_t *buf, size_t len, const JpegLayout &layout);
+
+    // Offsets de los marcadores RSTn dentro de los datos entrópicos, en orden.
+    // Devuelve cuántos encontró (como mucho maxOffsets)
+    static size_t findRestartMarkers(const uint8_t *buf, size_t len, const JpegLayout &layout,
+                                     uint32_t *offsets, size_t maxOffsets);
+
+    // Escribe SOI + tablas + EOI (JPEG abreviado "solo tablas")
+    static size_t buildTablesOnly(const uint8_t *buf, const JpegLayout &layout,
+                                  uint8_t *out, size_t outSize);
+};
+
+#endif
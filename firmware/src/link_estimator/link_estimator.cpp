@@ -0,0 +1,251 @@
+#include "link_estimator.h"
+#include "../websocket_manager/websocket_manager.h"
+#include "../configuration/secrets.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <lwip/tcp.h>
+#include <lwip/stats.h>
+#include <lwip/priv/tcp_priv.h>
+#include <lwip/priv/tcpip_priv.h>
+
+// Marca de los pings propios (el heartbeat de la librería va sin payload)
+static const uint8_t PING_MAGIC[2] = {'L', 'Q'};
+
+// Lectura del PCB del WebSocket desde el hilo de lwIP (tcp_active_pcbs no
+// es seguro fuera de él)
+struct TcpSampleCall
+{
+    struct tcpip_api_call_data call;
+    uint16_t port;
+    bool found;
+    uint8_t nrtx;
+    uint8_t dupacks;
+};
+
+static err_t readServerPcb(struct tcpip_api_call_data *data)
+{
+    TcpSampleCall *msg = (TcpSampleCall *)data;
+    for (struct tcp_pcb *pcb = tcp_active_pcbs; pcb != nullptr; pcb = pcb->next)
+    {
+        if (pcb->remote_port == msg->port)
+        {
+            msg->found = true;
+            msg->nrtx = pcb->nrtx;
+            msg->dupacks = pcb->dupacks;
+            break;
+        }
+    }
+    return ERR_OK;
+}
+
+static float ewma(float current, float sample, float alpha)
+{
+    return current <= 0 ? sample : current + alpha * (sample - current);
+}
+
+LinkEstimator::LinkEstimator(WebSocketManager *ws)
+    : wsManager(ws), lastSample(0), lastPing(0),
+      score(-1), rttMs(0), goodputKBps(0), retransPerSec(0), dupAcksPerSec(0), rssi(0), phyMbps(0),
+      tcpRetrans(0), tcpDupAcks(0), lastRetrans(0), lastDupAcks(0), pcbNrtx(0), pcbDupAcks(0)
+{
+}
+
+void LinkEstimator::service()
+{
+    unsigned long now = millis();
+
+    if (wsManager->isConnected() && now - lastPing >= LINK_PING_INTERVAL_MS)
+    {
+        uint8_t payload[6];
+        uint32_t sentAt = now;
+        memcpy(payload, PING_MAGIC, sizeof(PING_MAGIC));
+        memcpy(payload + 2, &sentAt, sizeof(sentAt));
+        wsManager->sendPing(payload, sizeof(payload));
+        lastPing = now;
+    }
+
+    if (now - lastSample < LINK_SAMPLE_MS)
+        return;
+
+    float elapsed = lastSample ? (now - lastSample) / 1000.0f : 0;
+    lastSample = now;
+
+    rssi = WiFi.RSSI();
+    samplePhy();
+    sampleTcp();
+
+    // Tasas por segundo de los eventos TCP desde el muestreo anterior
+    if (elapsed > 0)
+    {
+        retransPerSec += LINK_EWMA_ALPHA * ((tcpRetrans - lastRetrans) / elapsed - retransPerSec);
+        dupAcksPerSec += LINK_EWMA_ALPHA * ((tcpDupAcks - lastDupAcks) / elapsed - dupAcksPerSec);
+    }
+    lastRetrans = tcpRetrans;
+    lastDupAcks = tcpDupAcks;
+
+    updateScore();
+}
+
+void LinkEstimator::onPong(const uint8_t *payload, size_t length)
+{
+    if (length != 6 || memcmp(payload, PING_MAGIC, sizeof(PING_MAGIC)) != 0)
+        return;
+
+    uint32_t sentAt;
+    memcpy(&sentAt, payload + 2, sizeof(sentAt));
+    rttMs = ewma(rttMs, (float)(millis() - sentAt), LINK_EWMA_ALPHA);
+}
+
+void LinkEstimator::onFrameDelivered(size_t bytes, unsigned long transferMs)
+{
+    // Frames muy pequeños no dan una medida útil
+    if (transferMs == 0 || bytes < FRAME_SIZE_SMALL)
+        return;
+
+    goodputKBps = ewma(goodputKBps, bytes * 1000.0f / 1024.0f / transferMs, LINK_EWMA_ALPHA);
+}
+
+void LinkEstimator::reset()
+{
+    rttMs = 0;
+    lastPing = 0;
+    pcbNrtx = 0;
+    pcbDupAcks = 0;
+}
+
+void LinkEstimator::samplePhy()
+{
+    // Sin API pública para la tasa TX real: máximo del modo negociado
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK)
+    {
+        phyMbps = 0;
+        return;
+    }
+
+    wifi_bandwidth_t bandwidth = WIFI_BW_HT20;
+    esp_wifi_get_bandwidth(WIFI_IF_STA, &bandwidth);
+
+    if (ap.phy_11n)
+        phyMbps = bandwidth == WIFI_BW_HT40 ? 150 : 72;
+    else if (ap.phy_11g)
+        phyMbps = 54;
+    else if (ap.phy_11b)
+        phyMbps = 11;
+    else
+        phyMbps = 0;
+}
+
+void LinkEstimator::sampleTcp()
+{
+    TcpSampleCall msg = {};
+    msg.port = server_port;
+    tcpip_api_call(readServerPcb, &msg.call);
+
+    if (msg.found)
+    {
+        // nrtx y dupacks vuelven a 0 al llegar un ACK nuevo: se acumulan los
+        // incrementos vistos entre muestreos
+        tcpRetrans += msg.nrtx >= pcbNrtx ? msg.nrtx - pcbNrtx : msg.nrtx;
+        tcpDupAcks += msg.dupacks >= pcbDupAcks ? msg.dupacks - pcbDupAcks : msg.dupacks;
+        pcbNrtx = msg.nrtx;
+        pcbDupAcks = msg.dupacks;
+    }
+
+#if LWIP_STATS && MIB2_STATS
+    // Con estadísticas MIB2 compiladas el contador global es exacto
+    tcpRetrans = lwip_stats.mib2.tcpretranssegs;
+#endif
+}
+
+void LinkEstimator::updateScore()
+{
+    float total = 0;
+    float weight = 0;
+
+    // RSSI: -90 dBm → 0, -50 dBm → 100
+    total += LINK_WEIGHT_RSSI * constrain((rssi + 90) * 2.5f, 0.0f, 100.0f);
+    weight += LINK_WEIGHT_RSSI;
+
+    if (phyMbps > 0)
+    {
+        total += LINK_WEIGHT_PHY * constrain(phyMbps * 100.0f / 150.0f, 0.0f, 100.0f);
+        weight += LINK_WEIGHT_PHY;
+    }
+
+    // Pérdidas: cada 3 ACK duplicados equivalen a una retransmisión rápida
+    float losses = retransPerSec + dupAcksPerSec / 3.0f;
+    total += LINK_WEIGHT_LOSS * constrain(100.0f - losses * 100.0f / LINK_RETRANS_BAD_PER_SEC, 0.0f, 100.0f);
+    weight += LINK_WEIGHT_LOSS;
+
+    if (rttMs > 0)
+    {
+        float rttScore = (LINK_RTT_BAD_MS - rttMs) * 100.0f / (LINK_RTT_BAD_MS - LINK_RTT_GOOD_MS);
+        total += LINK_WEIGHT_RTT * constrain(rttScore, 0.0f, 100.0f);
+        weight += LINK_WEIGHT_RTT;
+    }
+
+    if (goodputKBps > 0)
+    {
+        total += LINK_WEIGHT_GOODPUT * constrain(goodputKBps * 100.0f / LINK_GOODPUT_GOOD_KBPS, 0.0f, 100.0f);
+        weight += LINK_WEIGHT_GOODPUT;
+    }
+
+    float instant = total / weight;
+    score = score < 0 ? instant : score + LINK_SCORE_ALPHA * (instant - score);
+}
+
+float LinkEstimator::getScore() const
+{
+    return score < 0 ? 0 : score;
+}
+
+bool LinkEstimator::isPoor() const
+{
+    return score >= 0 && score < LINK_SCORE_POOR;
+}
+
+float LinkEstimator::getRttMs() const
+{
+    return rttMs;
+}
+
+float LinkEstimator::getGoodputKBps() const
+{
+    return goodputKBps;
+}
+
+float LinkEstimator::getRetransPerSec() const
+{
+    return retransPerSec;
+}
+
+float LinkEstimator::getDupAcksPerSec() const
+{
+    return dupAcksPerSec;
+}
+
+int LinkEstimator::getRSSI() const
+{
+    return rssi;
+}
+
+int LinkEstimator::getPhyMbps() const
+{
+    return phyMbps;
+}
+
+String LinkEstimator::getStatsJson()
+{
+    String json = "\"link\":{\"score\":" + String(getScore(), 0) + ",";
+    json += "\"rssi\":" + String(rssi) + ",";
+    json += "\"phyMbps\":" + String(phyMbps) + ",";
+    json += "\"rttMs\":" + String(rttMs, 1) + ",";
+    json += "\"goodputKBps\":" + String(goodputKBps, 1) + ",";
+    json += "\"retransPerSec\":" + String(retransPerSec, 2) + ",";
+    json += "\"dupAcksPerSec\":" + String(dupAcksPerSec, 2) + ",";
+    json += "\"tcpRetrans\":" + String(tcpRetrans) + ",";
+    json += "\"tcpDupAcks\":" + String(tcpDupAcks) + "}";
+    return json;
+}
@@ -0,0 +1,67 @@
+#ifndef LINK_ESTIMATOR_H
+#define LINK_ESTIMATOR_H
+
+#include <Arduino.h>
+#include "../configuration/config.h"
+
+// Forward declarations
+class WebSocketManager;
+
+// Estimador de calidad del enlace: combina RSSI, tasa PHY nominal,
+// retransmisiones y ACK duplicados de TCP (lwIP), RTT por ping/pong del
+// WebSocket y goodput medido por frame en una puntuación 0-100 suavizada.
+// Con interferencia cocanal el RSSI solo no predice la entrega.
+class LinkEstimator
+{
+public:
+    LinkEstimator(WebSocketManager *ws);
+
+    // Muestreo periódico (loop principal) y ping con marca de tiempo
+    void service();
+    void onPong(const uint8_t *payload, size_t length);
+
+    // Frame entregado: bytes y tiempo de transferencia (FrameSender)
+    void onFrameDelivered(size_t bytes, unsigned long transferMs);
+    void reset(); // Nueva conexión: RTT y contadores TCP empiezan de cero
+
+    // API para FrameSender y controladores de tasa
+    float getScore() const;          // 0-100 suavizado
+    bool isPoor() const;             // Puntuación bajo LINK_SCORE_POOR
+    float getRttMs() const;          // RTT suavizado (0 sin medida)
+    float getGoodputKBps() const;    // Goodput suavizado (0 sin medida)
+    float getRetransPerSec() const;  // Retransmisiones TCP por segundo
+    float getDupAcksPerSec() const;  // ACK duplicados por segundo
+    int getRSSI() const;
+    int getPhyMbps() const;          // Tasa PHY máxima negociada (nominal)
+
+    String getStatsJson(); // Fragmento "link":{...}
+
+private:
+    WebSocketManager *wsManager;
+
+    unsigned long lastSample;
+    unsigned long lastPing;
+
+    // Medidas suavizadas (EWMA)
+    float score;
+    float rttMs;
+    float goodputKBps;
+    float retransPerSec;
+    float dupAcksPerSec;
+    int rssi;
+    int phyMbps;
+
+    // Contadores TCP acumulados y estado del último muestreo
+    uint32_t tcpRetrans;
+    uint32_t tcpDupAcks;
+    uint32_t lastRetrans;
+    uint32_t lastDupAcks;
+    uint8_t pcbNrtx;
+    uint8_t pcbDupAcks;
+
+    void sampleTcp();
+    void samplePhy();
+    void updateScore();
+};
+
+#endif
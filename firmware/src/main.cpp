@@ -7,19 +7,140 @@
 #include "health_monitor/health_monitor.h"
 #include "command_processor/command_processor.h"
 #include "fps_controller/fps_controller.h"
+#include "chunk_tuner/chunk_tuner.h"
+#include "bandwidth_probe/bandwidth_probe.h"
+#include "delta_encoder/delta_encoder.h"
+#include "preview_generator/preview_generator.h"
+#include "snapshot_scheduler/snapshot_scheduler.h"
+#include "event_buffer/event_buffer.h"
+#include "storage/storage.h"
+#include "recorder/recorder.h"
+#include "sensor_bench/sensor_bench.h"
+#include "boot_profiler/boot_profiler.h"
+#include "session_manager/session_manager.h"
+#include "link_estimator/link_estimator.h"
+#include "preset_manager/preset_manager.h"
+#include "stream_profiles/stream_profiles.h"
+#include "mode_governor/mode_governor.h"
+#include "frame_pacer/frame_pacer.h"
 
 // === VARIABLES GLOBALES ===
 unsigned long lastConnectionCheck = 0;
 unsigned long systemStartTime = 0;
 
+// Init de la cámara en su propia tarea (en paralelo con el WiFi)
+volatile bool cameraInitDone = false;
+volatile bool cameraInitOk = false;
+bool registrationPending = false;
+
+// Mensajes del servidor recibidos mientras el driver de la cámara arranca:
+// ningún comando debe llegar al sensor hasta cameraInitDone
+struct PendingMessage {
+    bool binary;
+    String text;
+    uint8_t *data;
+    size_t length;
+};
+PendingMessage pendingMessages[BOOT_MAX_PENDING_MESSAGES];
+int pendingMessageCount = 0;
+
 // === INSTANCIAS ===
 WifiManager wifiManager;
 CameraManager cameraManager;
 WebSocketManager wsManager;
 FPSController fpsController;
+ChunkTuner chunkTuner;
+DeltaEncoder deltaEncoder;
+PreviewGenerator previewGenerator(&wsManager);
 FrameSender frameSender(&wsManager, &cameraManager, &fpsController);
 HealthMonitor healthMonitor(&wsManager);
 CommandProcessor commandProcessor(&wsManager, &cameraManager, &healthMonitor, &fpsController);
+BandwidthProbe bandwidthProbe(&wsManager, &cameraManager, &frameSender, &fpsController);
+SnapshotScheduler snapshotScheduler(&cameraManager, &frameSender, &fpsController);
+EventBuffer eventBuffer(&wsManager, &frameSender);
+ArduinoFsStorage recorderStorage(RECORDER_STORAGE);
+Recorder recorder(&recorderStorage, &cameraManager, &wsManager, &frameSender);
+SensorBench sensorBench(&wsManager, &cameraManager);
+BootProfiler bootProfiler(&wsManager);
+LinkEstimator linkEstimator(&wsManager);
+SessionManager sessionManager(&wsManager, &frameSender, &cameraManager, &fpsController);
+StreamProfiles streamProfiles;
+ModeGovernor modeGovernor(&wsManager, &frameSender);
+FramePacer framePacer(&wsManager);
+PresetManager presetManager(&cameraManager, &fpsController, &frameSender);
+
+// === REGISTRO EN EL SERVIDOR ===
+void registerCamera()
+{
+    registrationPending = false;
+
+    // Registro sin pausas: los mensajes salen en orden por el mismo socket
+    // 1. Registrar como cámara
+    String registerMsg = "{\"type\":\"register\",\"device\":\"camera\"}";
+    wsManager.sendText(registerMsg);
+    Serial.printf("[WS] 📝 Registro: %s\n", registerMsg.c_str());
+
+    // 2. Enviar información de configuración
+    String resolutions = cameraManager.getSupportedResolutions();
+    String infoMsg = "{\"type\":\"info\",\"resolutions\":\"" + resolutions + 
+                    "\",\"mode\":\"" + frameSender.getModeName() + 
+                    "\",\"fps\":" + String(fpsController.getFPS()) +
+                    ",\"preset\":\"" + presetManager.getActivePreset() + "\"" +
+                    "," + wifiManager.getConnectJson() + "}";
+    wsManager.sendText(infoMsg);
+    Serial.printf("[WS] 📋 Info enviada\n");
+
+    // 3. Health inicial
+    healthMonitor.sendImmediate();
+
+    bootProfiler.markOnce("registered");
+    Serial.println("[WS] ✅ Registro completo");
+}
+
+// === MENSAJES DURANTE EL INIT DE LA CÁMARA ===
+void deferMessage(bool binary, const uint8_t *payload, size_t length)
+{
+    if (pendingMessageCount >= BOOT_MAX_PENDING_MESSAGES) {
+        Serial.println("[WS] ⚠️ Cola de arranque llena - Mensaje descartado");
+        return;
+    }
+
+    PendingMessage &pending = pendingMessages[pendingMessageCount];
+    pending.binary = binary;
+    pending.data = nullptr;
+    pending.length = length;
+    if (binary) {
+        pending.data = (uint8_t *)malloc(length);
+        if (!pending.data) {
+            Serial.println("[WS] ⚠️ Sin memoria - Mensaje de arranque descartado");
+            return;
+        }
+        memcpy(pending.data, payload, length);
+    } else {
+        pending.text = String((const char *)payload);
+    }
+    pendingMessageCount++;
+    Serial.printf("[WS] ⏳ Mensaje retenido hasta terminar la cámara (%d)\n", pendingMessageCount);
+}
+
+// process = false descarta la cola (la conexión que los envió ya no existe)
+void flushPendingMessages(bool process)
+{
+    for (int i = 0; i < pendingMessageCount; i++) {
+        PendingMessage &pending = pendingMessages[i];
+        if (process) {
+            if (pending.binary) {
+                commandProcessor.processBinary(pending.data, pending.length);
+            } else {
+                commandProcessor.processMessage(pending.text);
+            }
+        }
+        free(pending.data);
+        pending.data = nullptr;
+        pending.text = "";
+    }
+    pendingMessageCount = 0;
+}
 
 // === FUNCIÓN DE EVENTOS WEBSOCKET ===
 void webSocketEvent(WStype_t type, uint8_t *payload, size_t length)
@@ -29,48 +150,55 @@ void webSocketEvent(WStype_t type, uint8_t *payload, size_t length)
     case WStype_DISCONNECTED:
         Serial.println("[WS] ✗ Desconectado del servidor");
         wsManager.setConnected(false);
+        recorder.onConnectionChange(false);
+        flushPendingMessages(false);
         break;
 
     case WStype_CONNECTED:
     {
         Serial.printf("[WS] ✓ CONECTADO: %s:%d\n", server_host, server_port);
         wsManager.setConnected(true);
+        recorder.onConnectionChange(true);
 
-        // Secuencia de registro optimizada
-        delay(50);  // Pausa mínima inicial
-
-        // 1. Registrar como cámara
-        String registerMsg = "{\"type\":\"register\",\"device\":\"camera\"}";
-        wsManager.sendText(registerMsg);
-        Serial.printf("[WS] 📝 Registro: %s\n", registerMsg.c_str());
-        
-        delay(100);
-
-        // 2. Enviar información de configuración
-        String resolutions = cameraManager.getSupportedResolutions();
-        String infoMsg = "{\"type\":\"info\",\"resolutions\":\"" + resolutions + 
-                        "\",\"mode\":\"" + frameSender.getModeName() + 
-                        "\",\"fps\":" + String(fpsController.getFPS()) + "}";
-        wsManager.sendText(infoMsg);
-        Serial.printf("[WS] 📋 Info enviada\n");
+        // El servidor pudo perder las tablas JPEG cacheadas y la referencia delta
+        frameSender.invalidateJpegTables();
+        deltaEncoder.forceKeyframe();
 
-        delay(100);
+        bootProfiler.markOnce("ws_connected");
+        linkEstimator.reset();
 
-        // 3. Health inicial
-        healthMonitor.sendImmediate();
-
-        Serial.println("[WS] ✅ Registro completo");
+        // Reanudar la sesión o registrarse; espera a la cámara (el info y
+        // el health la consultan)
+        if (cameraInitDone) {
+            sessionManager.onConnected();
+        } else {
+            registrationPending = true;
+            Serial.println("[WS] ⏳ Registro al terminar la cámara");
+        }
     }
     break;
 
     case WStype_TEXT:
     {
-        String message = String((char *)payload);
         Serial.printf("[WS] 📩 RX: %s\n", payload);
+        if (!cameraInitDone) {
+            deferMessage(false, payload, length);
+            break;
+        }
+        String message = String((char *)payload);
         commandProcessor.processMessage(message);
     }
     break;
 
+    case WStype_BIN:
+        // Comandos y lotes en formato binario compacto
+        if (!cameraInitDone) {
+            deferMessage(true, payload, length);
+            break;
+        }
+        commandProcessor.processBinary(payload, length);
+        break;
+
     case WStype_ERROR:
         Serial.printf("[WS] ✗ Error: %s\n", payload);
         break;
@@ -80,16 +208,26 @@ void webSocketEvent(WStype_t type, uint8_t *payload, size_t length)
         break;
 
     case WStype_PONG:
-        Serial.println("[WS] 🏓 Pong");
+        linkEstimator.onPong(payload, length);
         break;
     }
 }
 
+// === INIT DE CÁMARA EN PARALELO ===
+void cameraInitTask(void *param)
+{
+    bootProfiler.mark("camera_start");
+    cameraInitOk = cameraManager.init();
+    bootProfiler.mark("camera_ready");
+    cameraInitDone = true;
+    vTaskDelete(nullptr);
+}
+
 // === SETUP ===
 void setup()
 {
     Serial.begin(115200);
-    delay(1000);
+    bootProfiler.mark("setup");
 
     Serial.println("\n╔════════════════════════════════════╗");
     Serial.println("║  ESP32-S3 CAMERA STREAMING v7.0    ║");
@@ -99,19 +237,63 @@ void setup()
     systemStartTime = millis();
     healthMonitor.setStartTime(systemStartTime);
     healthMonitor.setFrameSender(&frameSender);
+    healthMonitor.setFPSController(&fpsController);
+    healthMonitor.setCameraManager(&cameraManager);
+    healthMonitor.setLinkEstimator(&linkEstimator);
+    frameSender.setLinkEstimator(&linkEstimator);
+    frameSender.setChunkTuner(&chunkTuner);
+    frameSender.setDeltaEncoder(&deltaEncoder);
+    commandProcessor.setDeltaEncoder(&deltaEncoder);
+    frameSender.setPreviewGenerator(&previewGenerator);
+    commandProcessor.setPreviewGenerator(&previewGenerator);
+    commandProcessor.setChunkTuner(&chunkTuner);
+    commandProcessor.setBandwidthProbe(&bandwidthProbe);
+    commandProcessor.setSnapshotScheduler(&snapshotScheduler);
+    frameSender.setEventBuffer(&eventBuffer);
+    commandProcessor.setEventBuffer(&eventBuffer);
+    frameSender.setRecorder(&recorder);
+    commandProcessor.setRecorder(&recorder);
+    commandProcessor.setSensorBench(&sensorBench);
+    commandProcessor.setBootProfiler(&bootProfiler);
+    commandProcessor.setSessionManager(&sessionManager);
+    commandProcessor.setPresetManager(&presetManager);
+    frameSender.setStreamProfiles(&streamProfiles);
+    streamProfiles.setChunkTuner(&chunkTuner);
+    commandProcessor.setStreamProfiles(&streamProfiles);
+    modeGovernor.setLinkEstimator(&linkEstimator);
+    frameSender.setModeGovernor(&modeGovernor);
+    commandProcessor.setModeGovernor(&modeGovernor);
+    healthMonitor.setModeGovernor(&modeGovernor);
+    frameSender.setFramePacer(&framePacer);
+    commandProcessor.setFramePacer(&framePacer);
+    healthMonitor.setFramePacer(&framePacer);
+    sessionManager.setRegisterCallback(registerCamera);
 
-    // Configurar sistema por defecto
+    // Configurar sistema por defecto (perfiles editados antes de elegir modo)
+    streamProfiles.begin();
+    wsManager.beginBandwidthCap();
     fpsController.setFPS(DEFAULT_FPS);
     frameSender.setMode(DEFAULT_MODE);
 
-    // Inicializar cámara
-    Serial.println("[INIT] Inicializando cámara...");
-    if (!cameraManager.init()) {
-        Serial.println("[ERROR] ✗ Cámara falló - RESTART en 3s");
-        delay(3000);
-        ESP.restart();
+    // Preset de arranque: la cámara se inicia ya con sus ajustes
+    presetManager.begin();
+    // El modo del preset de arranque es una elección explícita
+    modeGovernor.setEnabled(GOVERNOR_DEFAULT && presetManager.getActivePreset().length() == 0);
+
+    // Inicializar cámara (init + calentamiento) mientras el WiFi asocia
+    Serial.println("[INIT] Inicializando cámara en paralelo...");
+    if (xTaskCreatePinnedToCore(cameraInitTask, "cam_init", BOOT_CAMERA_TASK_STACK, nullptr, 1,
+                                nullptr, BOOT_CAMERA_TASK_CORE) != pdPASS) {
+        cameraInitTask(nullptr); // Sin memoria para la tarea: init secuencial
     }
-    Serial.println("[INIT] ✓ Cámara iniciada");
+
+    // Almacenamiento para la grabación local (antes del WiFi: graba huecos desde el arranque)
+    if (recorder.begin()) {
+        recorder.setMode(RECORDER_MODE_DEFAULT);
+    } else {
+        Serial.println("[INIT] ⚠️ Sin almacenamiento: grabación local desactivada");
+    }
+    bootProfiler.mark("storage");
 
     // Conectar WiFi
     Serial.println("[INIT] Conectando WiFi...");
@@ -120,14 +302,41 @@ void setup()
         delay(3000);
         ESP.restart();
     }
+    bootProfiler.mark("wifi_ip");
     Serial.println("[INIT] ✓ WiFi conectado");
 
-    // Configurar WebSocket
+    // Configurar WebSocket: el handshake avanza mientras termina la cámara
     Serial.println("[INIT] Configurando WebSocket...");
     wsManager.setEventCallback(webSocketEvent);
     wsManager.init();
     Serial.println("[INIT] ✓ WebSocket configurado");
 
+    while (!cameraInitDone) {
+        wsManager.loop();
+        delay(1);
+    }
+    if (!cameraInitOk) {
+        Serial.println("[ERROR] ✗ Cámara falló - RESTART en 3s");
+        delay(3000);
+        ESP.restart();
+    }
+    Serial.println("[INIT] ✓ Cámara iniciada");
+
+    if (registrationPending && wsManager.isConnected()) {
+        registrationPending = false;
+        sessionManager.onConnected();
+    }
+    // Lo recibido durante el init, en orden y ya registrado
+    flushPendingMessages(true);
+
+    if (SLICE_CHUNKING_DEFAULT) {
+        frameSender.setSliceChunking(true);
+    }
+
+    if (EVENT_BUFFER_DEFAULT) {
+        eventBuffer.setEnabled(true);
+    }
+
     // Resumen del sistema
     Serial.println("\n╔════════════════════════════════════╗");
     Serial.println("║        CONFIGURACIÓN ACTUAL        ║");
@@ -150,6 +359,7 @@ void loop()
 
     // 1. Procesar WebSocket (siempre prioritario)
     wsManager.loop();
+    sessionManager.service();
 
     // 2. Verificar conexión periódicamente
     if (now - lastConnectionCheck >= CONNECTION_CHECK) {
@@ -157,17 +367,47 @@ void loop()
         lastConnectionCheck = now;
     }
 
-    // 3. Envío de frames con control inteligente
-    static unsigned long lastFrameAttempt = 0;
-    
-    // Usar el intervalo del FPS controller
-    unsigned long frameInterval = fpsController.getFrameInterval();
-    
-    if (now - lastFrameAttempt >= frameInterval) {
+    // 3. Sonda de ancho de banda pendiente (bloquea el stream ~3s)
+    if (bandwidthProbe.isPending()) {
+        bandwidthProbe.run();
+        fpsController.resync();
+    }
+
+    // 4. Benchmark de escritura pendiente (bloquea el stream)
+    if (recorder.isBenchmarkPending()) {
+        recorder.runBenchmark();
+        fpsController.resync();
+    }
+
+    // 5. Benchmark del sensor pendiente (reinicia el driver varias veces)
+    if (sensorBench.isPending()) {
+        sensorBench.run();
+        fpsController.resync();
+    }
+
+    // 6. Snapshot en alta resolución (programado o pedido por comando)
+    if (snapshotScheduler.isDue() && wsManager.isConnected()) {
+        snapshotScheduler.run();
+    }
+
+    // 7. Envío de frames en su deadline (los slots que ya no llegan se saltan)
+    if (fpsController.shouldSendFrame()) {
         if (WiFi.status() == WL_CONNECTED && wsManager.isConnected()) {
-            frameSender.sendReliable();
-            lastFrameAttempt = now;
+            if (fpsController.beginFrame()) {
+                frameSender.sendReliable();
+                snapshotScheduler.update();
+                bootProfiler.markOnce("first_frame");
+            }
         } else {
+            // Sin enlace: grabar localmente si el modo lo pide (backfill al reconectar)
+            if (recorder.wantsOfflineFrames()) {
+                if (fpsController.beginFrame()) {
+                    recorder.recordOffline();
+                }
+            } else {
+                fpsController.resync();
+            }
+
             // Log estado solo cada 5 segundos
             static unsigned long lastStatusLog = 0;
             if (now - lastStatusLog >= 5000) {
@@ -179,13 +419,34 @@ void loop()
         }
     }
 
-    // 4. Health periódico
+    // 8. Ventana pre-evento pendiente: un frame por vuelta, intercalado con el
+    //    stream y solo con presupuesto del tope de ancho de banda
+    if (eventBuffer.isFlushing() && wsManager.hasBudget()) {
+        eventBuffer.service();
+    }
+
+    // 9. Backfill de segmentos grabados sin conexión, también intercalado
+    if (recorder.isBackfilling() && wsManager.hasBudget()) {
+        recorder.service();
+    }
+
+    // 10. Calidad del enlace (muestreo y ping con RTT)
+    if (WiFi.status() == WL_CONNECTED) {
+        linkEstimator.service();
+    }
+
+    // 11. Selección automática de modo (evalúa la ventana de frames)
+    if (wsManager.isConnected()) {
+        modeGovernor.service();
+    }
+
+    // 12. Health periódico
     static unsigned long lastHealth = 0;
     if (wsManager.isConnected() && now - lastHealth >= HEALTH_INTERVAL) {
         healthMonitor.sendPeriodic();
         lastHealth = now;
     }
 
-    // 5. Delay mínimo del sistema
-    delay(DELAY_MAIN_LOOP);
+    // 13. Esperar al próximo deadline (acotado para atender el WebSocket)
+    fpsController.idle(DELAY_MAIN_LOOP);
 }
\ No newline at end of file
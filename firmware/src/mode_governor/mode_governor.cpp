@@ -0,0 +1,178 @@
+#include "mode_governor.h"
+#include "../websocket_manager/websocket_manager.h"
+#include "../frame_sender/frame_sender.h"
+#include "../link_estimator/link_estimator.h"
+#include <Arduino.h>
+
+// Escalera de modos, del más rápido al más seguro. Los perfiles que no
+// están en ella (elegidos a mano) quedan fuera del control automático
+static const uint8_t MODE_LADDER[] = {MODE_SPEED, MODE_STABILITY};
+static const int MODE_LADDER_SIZE = sizeof(MODE_LADDER) / sizeof(MODE_LADDER[0]);
+
+ModeGovernor::ModeGovernor(WebSocketManager *ws, FrameSender *fs)
+    : wsManager(ws), frameSender(fs), linkEstimator(nullptr), enabled(false),
+      frames(0), failures(0), meanMs(0), m2(0), lastEval(0), lastSuccess(1.0f), lastCv(0),
+      lastSwitch(0), upDwellMs(GOVERNOR_UP_DWELL_MS), goodWindows(0), lastSwitchWasUp(false),
+      switches(0), lastReason("-")
+{
+}
+
+void ModeGovernor::setLinkEstimator(LinkEstimator *estimator)
+{
+    linkEstimator = estimator;
+}
+
+void ModeGovernor::setEnabled(bool enable)
+{
+    if (enable == enabled)
+        return;
+
+    enabled = enable;
+    resetWindow();
+    goodWindows = 0;
+    lastSwitch = millis();
+    upDwellMs = GOVERNOR_UP_DWELL_MS;
+
+    Serial.printf("[GOV] %s Selección automática de modo\n", enabled ? "✓ Activada" : "✗ Desactivada");
+}
+
+bool ModeGovernor::isEnabled() const
+{
+    return enabled;
+}
+
+void ModeGovernor::onFrameResult(bool success, unsigned long transferMs)
+{
+    if (!enabled)
+        return;
+
+    frames++;
+    if (!success)
+    {
+        failures++;
+        return;
+    }
+
+    // Varianza del tiempo de transferencia de los frames entregados
+    uint16_t delivered = frames - failures;
+    float delta = transferMs - meanMs;
+    meanMs += delta / delivered;
+    m2 += delta * (transferMs - meanMs);
+}
+
+void ModeGovernor::service()
+{
+    unsigned long now = millis();
+    if (!enabled || now - lastEval < GOVERNOR_EVAL_MS)
+        return;
+    lastEval = now;
+
+    if (frames < GOVERNOR_MIN_FRAMES)
+        return;
+
+    uint16_t delivered = frames - failures;
+    lastSuccess = (float)delivered / frames;
+    lastCv = delivered > 1 && meanMs > 0 ? sqrtf(m2 / (delivered - 1)) / meanMs : 0;
+    float score = linkEstimator ? linkEstimator->getScore() : 100;
+    bool linkPoor = linkEstimator && linkEstimator->isPoor();
+    resetWindow();
+
+    int rung = rungOf(frameSender->getMode());
+    if (rung < 0)
+        return;
+
+    unsigned long dwell = now - lastSwitch;
+
+    // Bajar: cualquier síntoma basta
+    if (lastSuccess < GOVERNOR_DOWN_SUCCESS || lastCv > GOVERNOR_DOWN_CV || linkPoor)
+    {
+        goodWindows = 0;
+        if (rung + 1 >= MODE_LADDER_SIZE || dwell < GOVERNOR_DOWN_DWELL_MS)
+            return;
+
+        String reason = lastSuccess < GOVERNOR_DOWN_SUCCESS ? "éxito " + String(lastSuccess * 100, 0) + "%"
+                        : lastCv > GOVERNOR_DOWN_CV         ? "variabilidad " + String(lastCv, 2)
+                                                            : "enlace " + String(score, 0) + "/100";
+
+        // Una subida que termina en bajada dentro de su permanencia dobla la
+        // espera para volver a intentarlo
+        if (lastSwitchWasUp && dwell < upDwellMs)
+        {
+            upDwellMs = min(upDwellMs * 2, (unsigned long)GOVERNOR_UP_DWELL_MAX_MS);
+        }
+        switchTo(MODE_LADDER[rung + 1], false, reason);
+        return;
+    }
+
+    // Subir: todas las condiciones durante varias ventanas seguidas
+    bool clean = lastSuccess >= GOVERNOR_UP_SUCCESS && lastCv <= GOVERNOR_UP_CV &&
+                 score >= GOVERNOR_UP_LINK_SCORE;
+    goodWindows = clean ? goodWindows + 1 : 0;
+
+    // Estable en el modo tras una subida: el backoff se olvida
+    if (lastSwitchWasUp && dwell >= upDwellMs)
+    {
+        upDwellMs = GOVERNOR_UP_DWELL_MS;
+    }
+
+    if (rung > 0 && goodWindows >= GOVERNOR_UP_WINDOWS && dwell >= upDwellMs)
+    {
+        switchTo(MODE_LADDER[rung - 1], true,
+                 "estable: éxito " + String(lastSuccess * 100, 0) + "%, variabilidad " + String(lastCv, 2) +
+                     ", enlace " + String(score, 0) + "/100");
+    }
+}
+
+void ModeGovernor::switchTo(uint8_t mode, bool up, const String &reason)
+{
+    String from = frameSender->getModeName();
+    frameSender->setMode(mode);
+
+    switches++;
+    lastSwitch = millis();
+    lastSwitchWasUp = up;
+    lastReason = reason;
+    goodWindows = 0;
+
+    Serial.printf("[GOV] %s %s → %s (%s)\n", up ? "⬆️" : "⬇️", from.c_str(),
+                  frameSender->getModeName().c_str(), reason.c_str());
+
+    wsManager->sendText("{\"type\":\"mode_switch\",\"from\":\"" + from +
+                        "\",\"to\":\"" + frameSender->getModeName() +
+                        "\",\"direction\":\"" + (up ? "up" : "down") +
+                        "\",\"reason\":\"" + reason +
+                        "\",\"success\":" + String(lastSuccess, 3) +
+                        ",\"cv\":" + String(lastCv, 2) +
+                        ",\"linkScore\":" + String(linkEstimator ? linkEstimator->getScore() : 0, 0) +
+                        ",\"nextUpDwellMs\":" + String(upDwellMs) + "}");
+}
+
+int ModeGovernor::rungOf(uint8_t mode) const
+{
+    for (int i = 0; i < MODE_LADDER_SIZE; i++)
+    {
+        if (MODE_LADDER[i] == mode)
+            return i;
+    }
+    return -1;
+}
+
+void ModeGovernor::resetWindow()
+{
+    frames = 0;
+    failures = 0;
+    meanMs = 0;
+    m2 = 0;
+}
+
+String ModeGovernor::getStatsJson()
+{
+    String json = "\"governor\":{\"enabled\":" + String(enabled ? "true" : "false") + ",";
+    json += "\"mode\":\"" + frameSender->getModeName() + "\",";
+    json += "\"success\":" + String(lastSuccess, 3) + ",";
+    json += "\"cv\":" + String(lastCv, 2) + ",";
+    json += "\"switches\":" + String(switches) + ",";
+    json += "\"upDwellMs\":" + String(upDwellMs) + ",";
+    json += "\"lastReason\":\"" + lastReason + "\"}";
+    return json;
+}
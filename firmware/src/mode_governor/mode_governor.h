@@ -0,0 +1,60 @@
+#ifndef MODE_GOVERNOR_H
+#define MODE_GOVERNOR_H
+
+#include <Arduino.h>
+#include "../configuration/config.h"
+
+// Forward declarations
+class WebSocketManager;
+class FrameSender;
+class LinkEstimator;
+
+// Selección automática de modo: mantiene la cámara en el modo más rápido de
+// la escalera que sigue funcionando. Baja ante fallos, variabilidad alta del
+// tiempo de transferencia o enlace malo; sube solo tras varias ventanas
+// limpias. Umbrales distintos para subir y bajar (histéresis), permanencia
+// mínima en cada modo y backoff si una subida acaba en bajada.
+class ModeGovernor
+{
+public:
+    ModeGovernor(WebSocketManager *ws, FrameSender *fs);
+
+    void setLinkEstimator(LinkEstimator *estimator);
+    void setEnabled(bool enable); // Un modo elegido a mano lo desactiva
+    bool isEnabled() const;
+
+    void onFrameResult(bool success, unsigned long transferMs); // FrameSender
+    void service();                                            // Loop principal
+
+    String getStatsJson(); // Fragmento "governor":{...}
+
+private:
+    WebSocketManager *wsManager;
+    FrameSender *frameSender;
+    LinkEstimator *linkEstimator;
+    bool enabled;
+
+    // Ventana de frames en curso (Welford para la varianza)
+    uint16_t frames;
+    uint16_t failures;
+    float meanMs;
+    float m2;
+    unsigned long lastEval;
+
+    // Última ventana evaluada
+    float lastSuccess;
+    float lastCv;
+
+    unsigned long lastSwitch;
+    unsigned long upDwellMs;
+    uint8_t goodWindows;
+    bool lastSwitchWasUp;
+    unsigned long switches;
+    String lastReason;
+
+    int rungOf(uint8_t mode) const; // -1 = perfil fuera de la escalera
+    void switchTo(uint8_t mode, bool up, const String &reason);
+    void resetWindow();
+};
+
+#endif
@@ -0,0 +1,262 @@
+#include "preset_manager.h"
+#include "../fps_controller/fps_controller.h"
+#include "../frame_sender/frame_sender.h"
+#include <Arduino.h>
+
+static String presetKey(const String &name)
+{
+    return "p." + name;
+}
+
+PresetManager::PresetManager(CameraManager *cam, FPSController *fps, FrameSender *fs)
+    : camManager(cam), fpsController(fps), frameSender(fs)
+{
+}
+
+void PresetManager::begin()
+{
+    preferences.begin("presets", true);
+    names = preferences.getString("names", "");
+    bootPreset = preferences.getString("boot", "");
+    preferences.end();
+
+    if (bootPreset.length() == 0)
+        return;
+
+    CameraPreset preset;
+    if (!load(bootPreset, preset))
+    {
+        Serial.printf("[PRESET] ⚠️ Preset de arranque '%s' no encontrado\n", bootPreset.c_str());
+        bootPreset = "";
+        return;
+    }
+
+    // La cámara aún no está iniciada: resolución y calidad entran en la
+    // configuración del driver y el resto se aplica antes del calentamiento
+    camManager->setStartupSettings(preset.sensor);
+    fpsController->setFPS(preset.fps);
+    frameSender->setMode(preset.mode);
+    activePreset = bootPreset;
+
+    Serial.printf("[PRESET] ✓ Arranque con preset '%s'\n", bootPreset.c_str());
+}
+
+bool PresetManager::save(const String &name)
+{
+    if (!isValidName(name))
+        return false;
+
+    bool isNew = !exists(name);
+    if (isNew && countNames() >= PRESET_MAX)
+        return false;
+
+    CameraPreset preset;
+    memset(&preset, 0, sizeof(preset));
+    preset.sensor = camManager->getSensorSettings();
+    preset.fps = fpsController->getFPS();
+    preset.mode = frameSender->getMode();
+
+    preferences.begin("presets", false);
+    bool ok = preferences.putBytes(presetKey(name).c_str(), &preset, sizeof(preset)) == sizeof(preset);
+    if (ok && isNew)
+    {
+        names += (names.length() > 0 ? "," : "") + name;
+        preferences.putString("names", names);
+    }
+    preferences.end();
+
+    if (ok)
+    {
+        activePreset = name;
+        Serial.printf("[PRESET] 💾 Preset '%s' guardado\n", name.c_str());
+    }
+    return ok;
+}
+
+bool PresetManager::apply(const String &name)
+{
+    CameraPreset preset;
+    if (!load(name, preset))
+        return false;
+
+    unsigned long start = millis();
+    SensorSettings previous = camManager->getSensorSettings();
+
+    // Solo se escriben los registros que cambian, todos seguidos y sin
+    // capturas intermedias; el cambio de resolución se valida con el
+    // siguiente frame
+    bool ok = camManager->applySensorSettings(preset.sensor);
+    if (preset.sensor.resolution != previous.resolution || preset.sensor.quality != previous.quality)
+    {
+        frameSender->invalidateJpegTables();
+    }
+    frameSender->clearBudgetQuality(); // La calidad del preset manda sobre la rebaja del tope
+    if (fpsController->getFPS() != preset.fps)
+    {
+        fpsController->setFPS(preset.fps);
+    }
+    if (frameSender->getMode() != preset.mode)
+    {
+        frameSender->setMode(preset.mode);
+    }
+
+    activePreset = name;
+    if (bootPreset != name)
+    {
+        setBootPreset(name);
+    }
+
+    Serial.printf("[PRESET] ✓ Preset '%s' aplicado en %lums%s\n", name.c_str(), millis() - start,
+                  ok ? "" : " (con ajustes rechazados)");
+    return ok;
+}
+
+bool PresetManager::remove(const String &name)
+{
+    if (!exists(name))
+        return false;
+
+    // Reconstruir la lista sin el nombre
+    String remaining;
+    int start = 0;
+    while (start <= (int)names.length())
+    {
+        int comma = names.indexOf(',', start);
+        String item = comma < 0 ? names.substring(start) : names.substring(start, comma);
+        if (item.length() > 0 && item != name)
+        {
+            remaining += (remaining.length() > 0 ? "," : "") + item;
+        }
+        if (comma < 0)
+            break;
+        start = comma + 1;
+    }
+    names = remaining;
+
+    preferences.begin("presets", false);
+    preferences.remove(presetKey(name).c_str());
+    preferences.putString("names", names);
+    preferences.end();
+
+    if (bootPreset == name)
+    {
+        setBootPreset("");
+    }
+    if (activePreset == name)
+    {
+        activePreset = "";
+    }
+
+    Serial.printf("[PRESET] 🗑️ Preset '%s' eliminado\n", name.c_str());
+    return true;
+}
+
+bool PresetManager::setBootPreset(const String &name)
+{
+    if (name.length() > 0 && !exists(name))
+        return false;
+
+    preferences.begin("presets", false);
+    if (name.length() > 0)
+    {
+        preferences.putString("boot", name);
+    }
+    else
+    {
+        preferences.remove("boot");
+    }
+    preferences.end();
+
+    bootPreset = name;
+    return true;
+}
+
+bool PresetManager::exists(const String &name)
+{
+    return isValidName(name) && ("," + names + ",").indexOf("," + name + ",") >= 0;
+}
+
+bool PresetManager::isValidName(const String &name)
+{
+    if (name.length() == 0 || name.length() > PRESET_NAME_MAX)
+        return false;
+
+    for (unsigned int i = 0; i < name.length(); i++)
+    {
+        char c = name[i];
+        if (!isalnum(c) && c != '_' && c != '-')
+            return false;
+    }
+    return true;
+}
+
+String PresetManager::getBootPreset() const
+{
+    return bootPreset;
+}
+
+String PresetManager::getActivePreset() const
+{
+    return activePreset;
+}
+
+String PresetManager::getStatusJson()
+{
+    String json = "{\"type\":\"presets\",\"active\":\"" + activePreset + "\",\"boot\":\"" + bootPreset +
+                  "\",\"presets\":[";
+
+    int start = 0;
+    bool first = true;
+    while (names.length() > 0)
+    {
+        int comma = names.indexOf(',', start);
+        String item = comma < 0 ? names.substring(start) : names.substring(start, comma);
+
+        CameraPreset preset;
+        if (load(item, preset))
+        {
+            if (!first)
+                json += ",";
+            first = false;
+            json += "{\"name\":\"" + item + "\",\"res\":" + String(preset.sensor.resolution) +
+                    ",\"quality\":" + String(preset.sensor.quality) +
+                    ",\"fps\":" + String(preset.fps) +
+                    ",\"mode\":" + String(preset.mode) + "}";
+        }
+
+        if (comma < 0)
+            break;
+        start = comma + 1;
+    }
+
+    json += "],\"max\":" + String(PRESET_MAX) + "}";
+    return json;
+}
+
+bool PresetManager::load(const String &name, CameraPreset &preset)
+{
+    if (!exists(name))
+        return false;
+
+    String key = presetKey(name);
+    preferences.begin("presets", true);
+    // Un blob de otro tamaño es de una versión anterior del firmware
+    bool ok = preferences.getBytesLength(key.c_str()) == sizeof(preset) &&
+              preferences.getBytes(key.c_str(), &preset, sizeof(preset)) == sizeof(preset);
+    preferences.end();
+    return ok;
+}
+
+int PresetManager::countNames()
+{
+    if (names.length() == 0)
+        return 0;
+
+    int count = 1;
+    for (unsigned int i = 0; i < names.length(); i++)
+    {
+        if (names[i] == ',')
+            count++;
+    }
+    return count;
+}
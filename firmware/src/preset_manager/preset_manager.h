@@ -0,0 +1,57 @@
+#ifndef PRESET_MANAGER_H
+#define PRESET_MANAGER_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "../configuration/config.h"
+#include "../camera_manager/camera_manager.h"
+
+// Forward declarations
+class FPSController;
+class FrameSender;
+
+// Ajustes completos de un preset (blob en NVS)
+struct CameraPreset
+{
+    SensorSettings sensor;
+    int fps;
+    uint8_t mode;
+};
+
+// Presets con nombre guardados en NVS. El preset de arranque se carga antes
+// del init de la cámara (resolución y calidad en la configuración del driver,
+// resto antes del calentamiento) y cambiar de preset escribe en un solo paso
+// solo los registros que difieren.
+class PresetManager
+{
+public:
+    PresetManager(CameraManager *cam, FPSController *fps, FrameSender *fs);
+
+    void begin(); // Antes de lanzar el init de la cámara
+
+    bool save(const String &name);  // Ajustes actuales
+    bool apply(const String &name); // Aplica y lo deja como preset de arranque
+    bool remove(const String &name);
+    bool setBootPreset(const String &name); // "" = arrancar con los valores por defecto
+
+    bool exists(const String &name);
+    static bool isValidName(const String &name);
+    String getBootPreset() const;
+    String getActivePreset() const;
+    String getStatusJson(); // {"type":"presets",...}
+
+private:
+    CameraManager *camManager;
+    FPSController *fpsController;
+    FrameSender *frameSender;
+    Preferences preferences;
+
+    String names; // Lista separada por comas (NVS no enumera claves)
+    String bootPreset;
+    String activePreset;
+
+    bool load(const String &name, CameraPreset &preset);
+    int countNames();
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include "preview_generator.h"
+#include "../websocket_manager/websocket_manager.h"
+#include <Arduino.h>
+#include <esp_jpg_decode.h>
+#include <img_converters.h>
+
+PreviewGenerator::PreviewGenerator(WebSocketManager *ws)
+    : wsManager(ws), enabled(false), previewOnly(false), format(PREVIEW_FORMAT_DEFAULT),
+      intervalMs(PREVIEW_INTERVAL_MS), lastPreview(0), seq(0), gray(nullptr), graySize(0),
+      width(0), height(0), source(nullptr), previewsSent(0), bytesSent(0), lastDecodeMs(0)
+{
+}
+
+void PreviewGenerator::process(camera_fb_t *fb)
+{
+    if (!enabled || millis() - lastPreview < intervalMs)
+        return;
+    lastPreview = millis();
+
+    unsigned long start = millis();
+    if (!render(fb))
+    {
+        Serial.println("[PREV] ✗ Error decodificando vista previa");
+        return;
+    }
+    lastDecodeMs = millis() - start;
+
+    send();
+}
+
+size_t PreviewGenerator::readJpeg(void *arg, size_t index, uint8_t *buf, size_t len)
+{
+    const camera_fb_t *fb = ((PreviewGenerator *)arg)->source;
+    if (index >= fb->len)
+        return 0;
+    if (index + len > fb->len)
+        len = fb->len - index;
+    if (buf)
+        memcpy(buf, fb->buf + index, len);
+    return len;
+}
+
+bool PreviewGenerator::writeBlock(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data)
+{
+    PreviewGenerator *self = (PreviewGenerator *)arg;
+
+    if (!data)
+    {
+        // Inicio de la decodificación: dimensiones ya escaladas
+        if (x == 0 && y == 0)
+        {
+            size_t needed = (size_t)w * h;
+            if (needed > self->graySize)
+            {
+                uint8_t *resized = (uint8_t *)realloc(self->gray, needed);
+                if (!resized)
+                    return false;
+                self->gray = resized;
+                self->graySize = needed;
+            }
+            self->width = w;
+            self->height = h;
+        }
+        return true;
+    }
+
+    // Bloque RGB888 → luma (BT.601 en enteros)
+    for (uint16_t row = 0; row < h && y + row < self->height; row++)
+    {
+        uint8_t *dst = self->gray + (size_t)(y + row) * self->width + x;
+        const uint8_t *src = data + (size_t)row * w * 3;
+        for (uint16_t col = 0; col < w && x + col < self->width; col++)
+        {
+            dst[col] = (77 * src[0] + 150 * src[1] + 29 * src[2]) >> 8;
+            src += 3;
+        }
+    }
+    return true;
+}
+
+bool PreviewGenerator::render(camera_fb_t *fb)
+{
+    // A escala 1/8 cada bloque 8x8 se reduce a su coeficiente DC: no hay IDCT
+    source = fb;
+    esp_err_t err = esp_jpg_decode(fb->len, JPG_SCALE_8X, readJpeg, writeBlock, this);
+    source = nullptr;
+    return err == ESP_OK && width > 0 && height > 0;
+}
+
+bool PreviewGenerator::send()
+{
+    PreviewHeader header;
+    header.magic = PREVIEW_MAGIC;
+    header.headerLen = sizeof(PreviewHeader);
+    header.format = format;
+    header.reserved = 0;
+    header.width = width;
+    header.height = height;
+    header.seq = ++seq;
+
+    const uint8_t *payload = gray;
+    size_t payloadLen = (size_t)width * height;
+    uint8_t *jpeg = nullptr;
+    size_t jpegLen = 0;
+
+    if (format == PREVIEW_FORMAT_JPEG)
+    {
+        if (!fmt2jpg(gray, payloadLen, width, height, PIXFORMAT_GRAYSCALE,
+                     PREVIEW_JPEG_QUALITY, &jpeg, &jpegLen))
+        {
+            Serial.println("[PREV] ✗ Error comprimiendo vista previa");
+            return false;
+        }
+        payload = jpeg;
+        payloadLen = jpegLen;
+    }
+
+    size_t total = sizeof(PreviewHeader) + payloadLen;
+    uint8_t *message = (uint8_t *)malloc(total);
+    if (!message)
+    {
+        free(jpeg);
+        return false;
+    }
+    memcpy(message, &header, sizeof(PreviewHeader));
+    memcpy(message + sizeof(PreviewHeader), payload, payloadLen);
+    free(jpeg);
+
+    bool ok = wsManager->sendBinary(message, total);
+    free(message);
+
+    if (ok)
+    {
+        previewsSent++;
+        bytesSent += total;
+    }
+    return ok;
+}
+
+void PreviewGenerator::setEnabled(bool enabled)
+{
+    this->enabled = enabled;
+    if (!enabled)
+        previewOnly = false;
+    lastPreview = 0;
+    Serial.printf("[PREV] %s\n", enabled ? "✓ Vista previa activada" : "✗ Vista previa desactivada");
+}
+
+bool PreviewGenerator::isEnabled() const
+{
+    return enabled;
+}
+
+void PreviewGenerator::setPreviewOnly(bool only)
+{
+    previewOnly = only;
+    if (only)
+        enabled = true;
+    Serial.printf("[PREV] %s\n", only ? "📉 Solo vista previa (sin frames completos)" : "✓ Frames completos + vista previa");
+}
+
+bool PreviewGenerator::isPreviewOnly() const
+{
+    return previewOnly;
+}
+
+void PreviewGenerator::setFormat(uint8_t format)
+{
+    this->format = (format == PREVIEW_FORMAT_JPEG) ? PREVIEW_FORMAT_JPEG : PREVIEW_FORMAT_RAW;
+}
+
+void PreviewGenerator::setInterval(unsigned long ms)
+{
+    intervalMs = constrain(ms, (unsigned long)FRAME_INTERVAL_MIN, (unsigned long)PREVIEW_INTERVAL_MAX);
+}
+
+unsigned long PreviewGenerator::getPreviewsSent() const
+{
+    return previewsSent;
+}
+
+unsigned long PreviewGenerator::getBytesSent() const
+{
+    return bytesSent;
+}
+
+String PreviewGenerator::getStatusJson()
+{
+    return "{\"type\":\"preview\",\"enabled\":" + String(enabled ? "true" : "false") +
+           ",\"only\":" + String(previewOnly ? "true" : "false") +
+           ",\"format\":\"" + String(format == PREVIEW_FORMAT_JPEG ? "jpeg" : "raw") + "\"" +
+           ",\"interval\":" + String(intervalMs) +
+           ",\"width\":" + String(width) + ",\"height\":" + String(height) +
+           ",\"decodeMs\":" + String(lastDecodeMs) +
+           ",\"sent\":" + String(previewsSent) +
+           ",\"bytes\":" + String(bytesSent) + "}";
+}
@@ -0,0 +1,69 @@
+#ifndef PREVIEW_GENERATOR_H
+#define PREVIEW_GENERATOR_H
+
+#include <Arduino.h>
+#include <esp_camera.h>
+#include "../configuration/config.h"
+
+class WebSocketManager;
+
+// Cabecera del substream de vista previa (little-endian)
+struct __attribute__((packed)) PreviewHeader
+{
+    uint8_t magic;     // PREVIEW_MAGIC
+    uint8_t headerLen; // sizeof(PreviewHeader)
+    uint8_t format;    // PREVIEW_FORMAT_*
+    uint8_t reserved;
+    uint16_t width;
+    uint16_t height;
+    uint32_t seq;
+};
+
+class PreviewGenerator
+{
+public:
+    PreviewGenerator(WebSocketManager *ws);
+
+    // Llamado con cada frame capturado (antes de abreviar/delta)
+    void process(camera_fb_t *fb);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    void setPreviewOnly(bool only); // Sin frames completos: solo la vista previa
+    bool isPreviewOnly() const;
+    void setFormat(uint8_t format);
+    void setInterval(unsigned long ms);
+
+    unsigned long getPreviewsSent() const;
+    unsigned long getBytesSent() const;
+    String getStatusJson();
+
+private:
+    WebSocketManager *wsManager;
+
+    bool enabled;
+    bool previewOnly;
+    uint8_t format;
+    unsigned long intervalMs;
+    unsigned long lastPreview;
+    uint32_t seq;
+
+    // Decodificación DC (escala 1/8) directamente a gris
+    uint8_t *gray;
+    size_t graySize;
+    uint16_t width;
+    uint16_t height;
+    const camera_fb_t *source;
+
+    unsigned long previewsSent;
+    unsigned long bytesSent;
+    unsigned long lastDecodeMs;
+
+    bool render(camera_fb_t *fb);
+    bool send();
+
+    static size_t readJpeg(void *arg, size_t index, uint8_t *buf, size_t len);
+    static bool writeBlock(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data);
+};
+
+#endif
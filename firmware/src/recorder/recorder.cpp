@@ -0,0 +1,450 @@
+#include "recorder.h"
+#include "../camera_manager/camera_manager.h"
+#include "../websocket_manager/websocket_manager.h"
+#include "../frame_sender/frame_sender.h"
+#include <Arduino.h>
+
+Recorder::Recorder(Storage *storage, CameraManager *cam, WebSocketManager *ws, FrameSender *sender)
+    : storage(storage), camManager(cam), wsManager(ws), frameSender(sender), mounted(false),
+      storageFull(false), mode(RECORDER_MODE_OFF), connected(false), recordFile(nullptr),
+      segmentId(0), segmentIsGap(false), nextSegment(0), backfillCount(0), readFile(nullptr),
+      backfillSegment(0), backfillIndex(0), backfillSent(0), backfillFailed(0),
+      frameBuffer(nullptr), frameBufferSize(0), benchmarkPending(false), framesRecorded(0),
+      bytesRecorded(0), writeErrors(0), writeMicros(0), segmentsClosed(0), framesBackfilled(0)
+{
+}
+
+bool Recorder::begin()
+{
+    mounted = storage->begin();
+    if (!mounted)
+        return false;
+
+    preferences.begin("recorder", true);
+    nextSegment = preferences.getUInt("seg", 0);
+    preferences.end();
+    return true;
+}
+
+bool Recorder::setMode(uint8_t newMode)
+{
+    if (newMode > RECORDER_MODE_DISCONNECTED)
+        return false;
+    if (newMode != RECORDER_MODE_OFF && !mounted)
+        return false;
+
+    if (newMode == RECORDER_MODE_OFF)
+        closeSegment();
+
+    mode = newMode;
+    storageFull = false;
+    Serial.printf("[REC] ✓ Modo: %s (%s)\n",
+                  mode == RECORDER_MODE_CONTINUOUS ? "continuo" : mode == RECORDER_MODE_DISCONNECTED ? "desconexión" : "off",
+                  storage->name());
+    return true;
+}
+
+uint8_t Recorder::getMode() const
+{
+    return mode;
+}
+
+void Recorder::onFrame(camera_fb_t *fb)
+{
+    if (mode == RECORDER_MODE_CONTINUOUS && connected)
+        writeFrame(fb);
+}
+
+void Recorder::onConnectionChange(bool isConnected)
+{
+    connected = isConnected;
+
+    // Fin del hueco: cerrar su segmento deja en cola el backfill.
+    // Al desconectar, la siguiente escritura rota sola a un segmento de hueco
+    if (connected && writer.isOpen() && segmentIsGap)
+        closeSegment();
+}
+
+bool Recorder::wantsOfflineFrames() const
+{
+    return mounted && mode != RECORDER_MODE_OFF && !storageFull;
+}
+
+void Recorder::recordOffline()
+{
+    camera_fb_t *fb = camManager->captureFrame();
+    if (!fb)
+        return;
+    if (fb->len > 0)
+        writeFrame(fb);
+    camManager->returnFrame(fb);
+}
+
+void Recorder::segmentPath(uint32_t id, bool gap, char *out, size_t outSize) const
+{
+    snprintf(out, outSize, "/%s_%05lu.avi", gap ? "gap" : "rec", (unsigned long)id);
+}
+
+bool Recorder::checkFreeSpace()
+{
+    uint64_t total = storage->totalBytes();
+    uint64_t used = storage->usedBytes();
+    if (total > used && total - used >= (uint64_t)RECORDER_MIN_FREE_KB * 1024)
+        return true;
+
+    if (!storageFull)
+        Serial.printf("[REC] ⚠️ %s lleno: grabación detenida\n", storage->name());
+    storageFull = true;
+    return false;
+}
+
+bool Recorder::openSegment(uint16_t width, uint16_t height, bool gap)
+{
+    if (!checkFreeSpace())
+        return false;
+
+    segmentId = nextSegment++;
+    preferences.begin("recorder", false);
+    preferences.putUInt("seg", nextSegment);
+    preferences.end();
+
+    char path[32];
+    segmentPath(segmentId, gap, path, sizeof(path));
+    recordFile = storage->open(path, true);
+    if (!recordFile)
+    {
+        Serial.printf("[REC] ✗ No se pudo crear %s\n", path);
+        writeErrors++;
+        return false;
+    }
+
+    if (!writer.begin(recordFile, width, height, RECORDER_MAX_FRAMES))
+    {
+        Serial.println("[REC] ✗ Sin memoria para el buffer/índice del segmento");
+        recordFile->close();
+        delete recordFile;
+        recordFile = nullptr;
+        storage->remove(path);
+        return false;
+    }
+
+    segmentIsGap = gap;
+    Serial.printf("[REC] ⏺️ Segmento %s (%dx%d)\n", path, width, height);
+    return true;
+}
+
+void Recorder::closeSegment()
+{
+    if (!writer.isOpen())
+        return;
+
+    uint32_t frames = writer.getFrameCount();
+    bool ok = writer.finish();
+    delete recordFile;
+    recordFile = nullptr;
+    segmentsClosed++;
+
+    char path[32];
+    segmentPath(segmentId, segmentIsGap, path, sizeof(path));
+    Serial.printf("[REC] 💾 %s cerrado: %lu frames, %lu KB%s\n", path, (unsigned long)frames,
+                  (unsigned long)(writer.getFileSize() / 1024), ok ? "" : " (sin índice)");
+
+    if (frames == 0)
+    {
+        storage->remove(path);
+        return;
+    }
+    if (ok && segmentIsGap)
+        queueBackfill(segmentId);
+}
+
+bool Recorder::writeFrame(camera_fb_t *fb)
+{
+    if (!mounted || storageFull)
+        return false;
+
+    // Rotar al cambiar de hueco/enlace, de resolución o al llenar el índice
+    bool gap = !connected;
+    if (writer.isOpen() &&
+        (segmentIsGap != gap || fb->width != writer.getWidth() ||
+         fb->height != writer.getHeight() || writer.isFull()))
+    {
+        closeSegment();
+    }
+    if (!writer.isOpen() && !openSegment(fb->width, fb->height, gap))
+        return false;
+
+    unsigned long start = micros();
+    bool ok = writer.addFrame(fb->buf, fb->len, millis());
+    writeMicros += micros() - start;
+
+    if (!ok)
+    {
+        Serial.println("[REC] ✗ Error de escritura: cerrando segmento");
+        writeErrors++;
+        closeSegment();
+        checkFreeSpace();
+        return false;
+    }
+
+    framesRecorded++;
+    bytesRecorded += fb->len;
+    if (framesRecorded % 32 == 0 && !checkFreeSpace())
+        closeSegment();
+    return true;
+}
+
+void Recorder::queueBackfill(uint32_t id)
+{
+    if (backfillCount == RECORDER_BACKFILL_QUEUE)
+    {
+        // El más viejo se queda en el almacenamiento sin subir
+        Serial.printf("[REC] ⚠️ Cola de backfill llena: gap_%05lu queda solo en local\n",
+                      (unsigned long)backfillQueue[0]);
+        memmove(backfillQueue, backfillQueue + 1, sizeof(uint32_t) * (RECORDER_BACKFILL_QUEUE - 1));
+        backfillCount--;
+    }
+    backfillQueue[backfillCount++] = id;
+}
+
+bool Recorder::isBackfilling() const
+{
+    return readFile != nullptr || backfillCount > 0;
+}
+
+bool Recorder::ensureFrameBuffer(size_t size)
+{
+    if (size <= frameBufferSize)
+        return true;
+
+    free(frameBuffer);
+    frameBuffer = (uint8_t *)ps_malloc(size);
+    frameBufferSize = frameBuffer ? size : 0;
+    return frameBuffer != nullptr;
+}
+
+bool Recorder::startBackfill()
+{
+    while (backfillCount > 0)
+    {
+        backfillSegment = backfillQueue[0];
+        memmove(backfillQueue, backfillQueue + 1, sizeof(uint32_t) * (backfillCount - 1));
+        backfillCount--;
+
+        char path[32];
+        segmentPath(backfillSegment, true, path, sizeof(path));
+        readFile = storage->open(path, false);
+        if (readFile && reader.open(readFile))
+            break;
+
+        Serial.printf("[REC] ✗ %s ilegible: se omite\n", path);
+        if (readFile)
+        {
+            readFile->close();
+            delete readFile;
+            readFile = nullptr;
+        }
+    }
+    if (!readFile)
+        return false;
+
+    backfillIndex = 0;
+    backfillSent = 0;
+    backfillFailed = 0;
+
+    String msg = "{\"type\":\"backfill_start\",\"event\":" + String(backfillSegment) +
+                 ",\"frames\":" + String(reader.getFrameCount()) +
+                 ",\"usPerFrame\":" + String(reader.getMicrosPerFrame()) +
+                 ",\"width\":" + String(reader.getWidth()) +
+                 ",\"height\":" + String(reader.getHeight()) + "}";
+    wsManager->sendText(msg);
+
+    Serial.printf("[REC] ⏫ Backfill gap_%05lu: %lu frames\n",
+                  (unsigned long)backfillSegment, (unsigned long)reader.getFrameCount());
+    return true;
+}
+
+void Recorder::service()
+{
+    if (!connected || !wsManager->isConnected())
+        return;
+    if (!readFile && !startBackfill())
+        return;
+
+    uint32_t count = reader.getFrameCount();
+    if (backfillIndex < count)
+    {
+        size_t len = 0;
+        uint32_t size = reader.getFrameSize(backfillIndex);
+        if (ensureFrameBuffer(size))
+            len = reader.readFrame(backfillIndex, frameBuffer, frameBufferSize);
+
+        camera_fb_t fb = {};
+        fb.buf = frameBuffer;
+        fb.len = len;
+        fb.width = reader.getWidth();
+        fb.height = reader.getHeight();
+        fb.format = PIXFORMAT_JPEG;
+
+        // Tiempo relativo al inicio del hueco según el intervalo medio del segmento
+        String info = "{\"type\":\"backfill_frame\",\"event\":" + String(backfillSegment) +
+                      ",\"index\":" + String(backfillIndex) +
+                      ",\"count\":" + String(count) +
+                      ",\"ms\":" + String((unsigned long)((uint64_t)backfillIndex * reader.getMicrosPerFrame() / 1000)) + "}";
+
+        if (len > 0 && frameSender->sendTaggedFrame(&fb, info))
+            backfillSent++;
+        else
+            backfillFailed++;
+        backfillIndex++;
+    }
+
+    if (backfillIndex >= count)
+        finishBackfill();
+}
+
+void Recorder::finishBackfill()
+{
+    readFile->close();
+    delete readFile;
+    readFile = nullptr;
+    framesBackfilled += backfillSent;
+
+    String msg = "{\"type\":\"backfill_end\",\"event\":" + String(backfillSegment) +
+                 ",\"sent\":" + String(backfillSent) +
+                 ",\"lost\":" + String(backfillFailed) + "}";
+    wsManager->sendText(msg);
+
+    // Subido entero: ya no hace falta la copia local
+    if (backfillFailed == 0)
+    {
+        char path[32];
+        segmentPath(backfillSegment, true, path, sizeof(path));
+        storage->remove(path);
+        storageFull = false;
+    }
+
+    Serial.printf("[REC] ✅ Backfill gap_%05lu: %lu enviados, %lu fallidos\n",
+                  (unsigned long)backfillSegment, (unsigned long)backfillSent,
+                  (unsigned long)backfillFailed);
+}
+
+void Recorder::requestBenchmark()
+{
+    benchmarkPending = true;
+}
+
+bool Recorder::isBenchmarkPending() const
+{
+    return benchmarkPending;
+}
+
+void Recorder::runBenchmark()
+{
+    benchmarkPending = false;
+    if (!mounted)
+    {
+        wsManager->sendText("{\"type\":\"recbench\",\"error\":\"almacenamiento no disponible\"}");
+        return;
+    }
+
+    // Libera el buffer/índice del segmento en curso (se reabre con el siguiente frame)
+    closeSegment();
+
+    Serial.printf("\n[REC] 🏁 Benchmark de escritura en %s\n", storage->name());
+    int originalRes = camManager->getResolutionIndex();
+    static const int resolutions[] = {RES_QVGA, RES_VGA, RES_SVGA, RES_XGA, RES_HD, RES_UXGA};
+    String results = "";
+
+    for (int res : resolutions)
+    {
+        if (res > CAMERA_FB_MAX_RES)
+            continue;
+        if (res != camManager->getResolutionIndex() && !camManager->changeResolution(res))
+            continue;
+
+        StorageFile *file = storage->open(RECBENCH_FILE, true);
+        if (!file)
+            break;
+
+        AviWriter bench;
+        unsigned long frames = 0, bytes = 0, benchWriteUs = 0;
+        bool ok = true;
+        unsigned long start = millis();
+
+        while (ok && millis() - start < RECBENCH_MS)
+        {
+            camera_fb_t *fb = camManager->captureFrame();
+            if (!fb)
+                continue;
+
+            unsigned long t = micros();
+            if (frames == 0)
+                ok = bench.begin(file, fb->width, fb->height, RECORDER_MAX_FRAMES);
+            ok = ok && bench.addFrame(fb->buf, fb->len, millis());
+            benchWriteUs += micros() - t;
+
+            frames++;
+            bytes += fb->len;
+            camManager->returnFrame(fb);
+            wsManager->loop(); // Mantener viva la conexión
+        }
+        unsigned long elapsed = millis() - start;
+
+        // El volcado final (idx1 + cabecera) cuenta como escritura
+        unsigned long t = micros();
+        ok = bench.finish() && ok;
+        benchWriteUs += micros() - t;
+        delete file;
+        storage->remove(RECBENCH_FILE);
+
+        float writeKBps = benchWriteUs ? (bytes / 1024.0f) * 1000000.0f / benchWriteUs : 0;
+        float writeFps = benchWriteUs ? frames * 1000000.0f / benchWriteUs : 0;
+        float captureFps = elapsed ? frames * 1000.0f / elapsed : 0;
+
+        Serial.printf("[REC]   res %2d | %3lu frames | %5.1f KB/frame | %7.1f KB/s | máx %5.1f fps | real %4.1f fps%s\n",
+                      res, frames, frames ? bytes / 1024.0f / frames : 0, writeKBps, writeFps, captureFps,
+                      ok ? "" : " | ✗ error");
+
+        if (results.length() > 0)
+            results += ",";
+        results += "{\"res\":" + String(res) +
+                   ",\"frames\":" + String(frames) +
+                   ",\"avgKB\":" + String(frames ? bytes / 1024.0f / frames : 0, 1) +
+                   ",\"writeKBps\":" + String(writeKBps, 1) +
+                   ",\"writeFps\":" + String(writeFps, 1) +
+                   ",\"captureFps\":" + String(captureFps, 1) +
+                   ",\"ok\":" + String(ok ? "true" : "false") + "}";
+        if (!ok)
+            break; // Almacenamiento lleno o con errores
+    }
+
+    if (originalRes >= 0 && originalRes != camManager->getResolutionIndex())
+        camManager->changeResolution(originalRes);
+
+    wsManager->sendText("{\"type\":\"recbench\",\"storage\":\"" + String(storage->name()) +
+                        "\",\"results\":[" + results + "]}");
+}
+
+String Recorder::getStatusJson()
+{
+    uint64_t total = mounted ? storage->totalBytes() : 0;
+    uint64_t used = mounted ? storage->usedBytes() : 0;
+    unsigned long avgWriteUs = framesRecorded ? writeMicros / framesRecorded : 0;
+
+    return "{\"type\":\"record_status\",\"mode\":" + String(mode) +
+           ",\"storage\":\"" + String(storage->name()) + "\"" +
+           ",\"mounted\":" + String(mounted ? "true" : "false") +
+           ",\"full\":" + String(storageFull ? "true" : "false") +
+           ",\"usedKB\":" + String((unsigned long)(used / 1024)) +
+           ",\"totalKB\":" + String((unsigned long)(total / 1024)) +
+           ",\"recording\":" + String(writer.isOpen() ? "true" : "false") +
+           ",\"segment\":" + String(segmentId) +
+           ",\"frames\":" + String(framesRecorded) +
+           ",\"bytes\":" + String(bytesRecorded) +
+           ",\"avgWriteUs\":" + String(avgWriteUs) +
+           ",\"errors\":" + String(writeErrors) +
+           ",\"segments\":" + String(segmentsClosed) +
+           ",\"backfillPending\":" + String(backfillCount + (readFile ? 1 : 0)) +
+           ",\"backfilled\":" + String(framesBackfilled) + "}";
+}
@@ -0,0 +1,97 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <Arduino.h>
+#include <esp_camera.h>
+#include <Preferences.h>
+#include "../configuration/config.h"
+#include "../storage/storage.h"
+#include "../avi_writer/avi_writer.h"
+
+class CameraManager;
+class WebSocketManager;
+class FrameSender;
+
+// Grabación local en segmentos AVI/MJPEG. En modo continuo graba todo lo
+// capturado; en modo desconexión solo los huecos sin enlace. Los segmentos
+// de un hueco se suben al reconectar (backfill) y se borran si llegan completos
+class Recorder
+{
+public:
+    Recorder(Storage *storage, CameraManager *cam, WebSocketManager *ws, FrameSender *sender);
+
+    bool begin(); // Monta el almacenamiento (en setup)
+
+    bool setMode(uint8_t mode); // RECORDER_MODE_*
+    uint8_t getMode() const;
+
+    void onFrame(camera_fb_t *fb); // Frame capturado con conexión (modo continuo)
+    void onConnectionChange(bool connected);
+    bool wantsOfflineFrames() const;
+    void recordOffline(); // Desde el loop sin conexión: captura y graba
+
+    bool isBackfilling() const;
+    void service(); // Desde el loop: un frame del backfill por vuelta
+
+    // Benchmark de escritura sostenida por resolución (bloquea el stream)
+    void requestBenchmark();
+    bool isBenchmarkPending() const;
+    void runBenchmark();
+
+    String getStatusJson();
+
+private:
+    Storage *storage;
+    CameraManager *camManager;
+    WebSocketManager *wsManager;
+    FrameSender *frameSender;
+    Preferences preferences;
+
+    bool mounted;
+    bool storageFull;
+    uint8_t mode;
+    bool connected;
+
+    // Segmento en escritura
+    AviWriter writer;
+    StorageFile *recordFile;
+    uint32_t segmentId;
+    bool segmentIsGap;
+    uint32_t nextSegment; // Persistido en NVS para no pisar segmentos viejos
+
+    // Segmentos de huecos pendientes de subir
+    uint32_t backfillQueue[RECORDER_BACKFILL_QUEUE];
+    uint8_t backfillCount;
+
+    // Backfill en curso
+    AviReader reader;
+    StorageFile *readFile;
+    uint32_t backfillSegment;
+    uint32_t backfillIndex;
+    uint32_t backfillSent;
+    uint32_t backfillFailed;
+    uint8_t *frameBuffer;
+    size_t frameBufferSize;
+
+    bool benchmarkPending;
+
+    // Estadísticas
+    unsigned long framesRecorded;
+    unsigned long bytesRecorded;
+    unsigned long writeErrors;
+    unsigned long writeMicros;
+    unsigned long segmentsClosed;
+    unsigned long framesBackfilled;
+
+    void segmentPath(uint32_t id, bool gap, char *out, size_t outSize) const;
+    bool openSegment(uint16_t width, uint16_t height, bool gap);
+    void closeSegment();
+    bool writeFrame(camera_fb_t *fb);
+    bool checkFreeSpace();
+    void queueBackfill(uint32_t id);
+    bool startBackfill();
+    void finishBackfill();
+    bool ensureFrameBuffer(size_t size);
+};
+
+#endif
@@ -0,0 +1,262 @@
+#include "sensor_bench.h"
+#include "../websocket_manager/websocket_manager.h"
+#include "../camera_manager/camera_manager.h"
+#include <Arduino.h>
+#include <esp_log.h>
+#include <algorithm>
+
+// El driver no expone contadores de error: se cuentan sus avisos de log
+// (cam_hal: FB-OVF, NO-EOI, NO-SOI) mientras dura el barrido
+static volatile uint32_t driverErrors = 0;
+static vprintf_like_t previousVprintf = nullptr;
+
+static int countDriverErrors(const char *fmt, va_list args)
+{
+    if (strstr(fmt, "FB-OVF") || strstr(fmt, "NO-EOI") || strstr(fmt, "NO-SOI"))
+    {
+        driverErrors++;
+    }
+    return previousVprintf ? previousVprintf(fmt, args) : vprintf(fmt, args);
+}
+
+static const char *grabModeName(camera_grab_mode_t mode)
+{
+    return mode == CAMERA_GRAB_LATEST ? "latest" : "when_empty";
+}
+
+// SOI al inicio y EOI en la cola (el driver puede dejar relleno tras FFD9)
+static bool isCompleteJpeg(const camera_fb_t *fb)
+{
+    if (fb->len < 4 || fb->buf[0] != 0xFF || fb->buf[1] != 0xD8)
+    {
+        return false;
+    }
+    size_t tail = fb->len > 64 ? fb->len - 64 : 2;
+    for (size_t i = fb->len - 1; i > tail; i--)
+    {
+        if (fb->buf[i] == 0xD9 && fb->buf[i - 1] == 0xFF)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+SensorBench::SensorBench(WebSocketManager *ws, CameraManager *cam)
+    : wsManager(ws), camManager(cam), pending(false), allResolutions(true), applyBest(false)
+{
+}
+
+void SensorBench::request(bool all, bool apply)
+{
+    allResolutions = all;
+    applyBest = apply;
+    pending = true;
+}
+
+bool SensorBench::isPending() const
+{
+    return pending;
+}
+
+void SensorBench::run()
+{
+    pending = false;
+
+    static const int resolutions[] = {RES_QVGA, RES_VGA, RES_SVGA, RES_XGA, RES_HD, RES_UXGA, RES_QXGA};
+    static const int xclks[] = {10000000, 16000000, 20000000};
+    static const camera_grab_mode_t grabModes[] = {CAMERA_GRAB_WHEN_EMPTY, CAMERA_GRAB_LATEST};
+
+    int streamRes = camManager->getResolutionIndex();
+
+    int benchRes[sizeof(resolutions) / sizeof(resolutions[0])];
+    int resCount = 0;
+    for (int res : resolutions)
+    {
+        if (allResolutions ? res <= CAMERA_FB_MAX_RES : res == streamRes)
+            benchRes[resCount++] = res;
+    }
+    if (resCount == 0)
+        benchRes[resCount++] = streamRes; // Resolución fuera de la lista
+
+    int originalXclk = camManager->getXclkHz();
+    int originalFbCount = camManager->getFbCount();
+    camera_grab_mode_t originalGrab = camManager->getGrabMode();
+
+    Serial.printf("\n[SENSOR] 🏁 Benchmark del sensor (%s)\n",
+                  allResolutions ? "todas las resoluciones" : "resolución actual");
+
+    previousVprintf = esp_log_set_vprintf(countDriverErrors);
+    esp_log_level_set("cam_hal", ESP_LOG_WARN);
+
+    SensorBenchResult best = {};
+    bool haveBest = false;
+    int combos = 0;
+
+    for (int xclk : xclks)
+    {
+        for (int fbCount = 1; fbCount <= 3; fbCount++)
+        {
+            for (camera_grab_mode_t grab : grabModes)
+            {
+                SensorBenchResult result = {};
+                result.xclkHz = xclk;
+                result.fbCount = fbCount;
+                result.grabMode = grab;
+
+                if (!camManager->reconfigure(xclk, fbCount, grab))
+                {
+                    // Sin arranque: fila inestable para la resolución del stream
+                    result.res = streamRes;
+                    sendResult(result);
+                    combos++;
+                    continue;
+                }
+
+                for (int i = 0; i < resCount; i++)
+                {
+                    int res = benchRes[i];
+                    if (res != camManager->getResolutionIndex() && !camManager->changeResolution(res))
+                        continue;
+
+                    result.res = res;
+                    measure(result);
+                    sendResult(result);
+                    combos++;
+
+                    // Más rápida estable a la resolución del stream (a igual
+                    // tasa se queda la primera: menos reloj y menos buffers)
+                    if (res == streamRes && result.stable && result.fps > best.fps)
+                    {
+                        best = result;
+                        haveBest = true;
+                    }
+
+                    wsManager->loop(); // Mantener viva la conexión
+                }
+            }
+        }
+    }
+
+    esp_log_set_vprintf(previousVprintf);
+    esp_log_level_set("cam_hal", (esp_log_level_t)CONFIG_LOG_DEFAULT_LEVEL);
+
+    // Volver a la resolución del stream y a la configuración original o a la mejor
+    if (streamRes >= 0 && streamRes != camManager->getResolutionIndex())
+        camManager->changeResolution(streamRes);
+
+    bool applied = false;
+    if (applyBest && haveBest)
+    {
+        applied = camManager->reconfigure(best.xclkHz, best.fbCount, best.grabMode) &&
+                  camManager->saveSensorConfig();
+    }
+    if (!applied)
+    {
+        camManager->reconfigure(originalXclk, originalFbCount, originalGrab);
+    }
+
+    String msg = "{\"type\":\"sensorbench\",\"combos\":" + String(combos) +
+                 ",\"res\":" + String(streamRes) +
+                 ",\"applied\":" + String(applied ? "true" : "false");
+    if (haveBest)
+    {
+        msg += ",\"best\":{\"xclkMHz\":" + String(best.xclkHz / 1000000) +
+               ",\"fb\":" + String(best.fbCount) +
+               ",\"grab\":\"" + String(grabModeName(best.grabMode)) + "\"" +
+               ",\"fps\":" + String(best.fps, 1) + "}";
+        Serial.printf("[SENSOR] 🏆 Mejor estable en res %d: XCLK %dMHz, %d buffers, %s → %.1f fps%s\n",
+                      streamRes, best.xclkHz / 1000000, best.fbCount, grabModeName(best.grabMode),
+                      best.fps, applied ? " (aplicada)" : "");
+    }
+    else
+    {
+        Serial.println("[SENSOR] ⚠️ Ninguna combinación estable en la resolución del stream");
+    }
+    msg += "}";
+    wsManager->sendText(msg);
+}
+
+bool SensorBench::measure(SensorBenchResult &result)
+{
+    // Descartar lo capturado antes del cambio
+    for (int i = 0; i < SENSORBENCH_SETTLE_FRAMES; i++)
+    {
+        camera_fb_t *fb = esp_camera_fb_get();
+        if (fb)
+            esp_camera_fb_return(fb);
+    }
+
+    uint32_t sizes[SENSORBENCH_MAX_SAMPLES];
+    uint32_t samples = 0;
+    result.frames = 0;
+    result.timeouts = 0;
+    result.corrupt = 0;
+    uint32_t errorsAtStart = driverErrors;
+    unsigned long start = millis();
+
+    while (millis() - start < SENSORBENCH_MS)
+    {
+        camera_fb_t *fb = esp_camera_fb_get();
+        if (!fb)
+        {
+            result.timeouts++;
+            continue;
+        }
+
+        if (isCompleteJpeg(fb))
+        {
+            result.frames++;
+            if (samples < SENSORBENCH_MAX_SAMPLES)
+                sizes[samples++] = fb->len;
+        }
+        else
+        {
+            result.corrupt++;
+        }
+        esp_camera_fb_return(fb);
+    }
+
+    unsigned long elapsed = millis() - start;
+    result.overflows = driverErrors - errorsAtStart;
+    result.fps = elapsed ? result.frames * 1000.0f / elapsed : 0;
+
+    // Distribución de tamaños
+    result.minKB = result.p50KB = result.p95KB = result.maxKB = 0;
+    if (samples > 0)
+    {
+        std::sort(sizes, sizes + samples);
+        result.minKB = sizes[0] / 1024;
+        result.p50KB = sizes[(samples - 1) * 50 / 100] / 1024;
+        result.p95KB = sizes[(samples - 1) * 95 / 100] / 1024;
+        result.maxKB = sizes[samples - 1] / 1024;
+    }
+
+    result.stable = result.frames > 0 && result.timeouts == 0 &&
+                    result.corrupt == 0 && result.overflows == 0;
+    return result.stable;
+}
+
+void SensorBench::sendResult(const SensorBenchResult &r)
+{
+    Serial.printf("[SENSOR]   res %2d | %2dMHz | %d fb | %-10s | %5.1f fps | %3lu-%3lu-%3lu KB | to %lu | bad %lu | ovf %lu%s\n",
+                  r.res, r.xclkHz / 1000000, r.fbCount, grabModeName(r.grabMode), r.fps,
+                  (unsigned long)r.minKB, (unsigned long)r.p50KB, (unsigned long)r.maxKB,
+                  (unsigned long)r.timeouts, (unsigned long)r.corrupt, (unsigned long)r.overflows,
+                  r.stable ? "" : " | ✗");
+
+    wsManager->sendText("{\"type\":\"sensorbench_row\",\"res\":" + String(r.res) +
+                        ",\"xclkMHz\":" + String(r.xclkHz / 1000000) +
+                        ",\"fb\":" + String(r.fbCount) +
+                        ",\"grab\":\"" + String(grabModeName(r.grabMode)) + "\"" +
+                        ",\"fps\":" + String(r.fps, 1) +
+                        ",\"frames\":" + String(r.frames) +
+                        ",\"minKB\":" + String(r.minKB) +
+                        ",\"p50KB\":" + String(r.p50KB) +
+                        ",\"p95KB\":" + String(r.p95KB) +
+                        ",\"maxKB\":" + String(r.maxKB) +
+                        ",\"timeouts\":" + String(r.timeouts) +
+                        ",\"corrupt\":" + String(r.corrupt) +
+                        ",\"overflows\":" + String(r.overflows) +
+                        ",\"stable\":" + String(r.stable ? "true" : "false") + "}");
+}
@@ -0,0 +1,53 @@
+#ifndef SENSOR_BENCH_H
+#define SENSOR_BENCH_H
+
+#include <Arduino.h>
+#include <esp_camera.h>
+#include "../configuration/config.h"
+
+// Forward declarations
+class WebSocketManager;
+class CameraManager;
+
+// Resultado de una combinación resolución × XCLK × buffers × modo de captura
+struct SensorBenchResult
+{
+    int res;
+    int xclkHz;
+    int fbCount;
+    camera_grab_mode_t grabMode;
+    float fps;          // Frames válidos por segundo con esp_camera_fb_get en bucle
+    uint32_t frames;
+    uint32_t timeouts;  // esp_camera_fb_get devolvió NULL
+    uint32_t corrupt;   // JPEG sin SOI/EOI (frame truncado)
+    uint32_t overflows; // FB-OVF / NO-EOI / NO-SOI registrados por el driver
+    uint32_t minKB, p50KB, p95KB, maxKB;
+    bool stable;
+};
+
+// Barrido de configuraciones del sensor: mide la tasa real de captura sin
+// red ni codificación y, opcionalmente, aplica (y guarda) la combinación
+// estable más rápida para la resolución del stream
+class SensorBench
+{
+public:
+    SensorBench(WebSocketManager *ws, CameraManager *cam);
+
+    // Solicitud desde CommandProcessor; se ejecuta en el loop principal
+    void request(bool allResolutions, bool apply);
+    bool isPending() const;
+    void run();
+
+private:
+    WebSocketManager *wsManager;
+    CameraManager *camManager;
+
+    bool pending;
+    bool allResolutions;
+    bool applyBest;
+
+    bool measure(SensorBenchResult &result);
+    void sendResult(const SensorBenchResult &result);
+};
+
+#endif
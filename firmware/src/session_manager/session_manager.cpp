@@ -0,0 +1,135 @@
+#include "session_manager.h"
+#include "../websocket_manager/websocket_manager.h"
+#include "../frame_sender/frame_sender.h"
+#include "../camera_manager/camera_manager.h"
+#include "../fps_controller/fps_controller.h"
+#include <Arduino.h>
+
+SessionManager::SessionManager(WebSocketManager *ws, FrameSender *fs, CameraManager *cam, FPSController *fps)
+    : wsManager(ws), frameSender(fs), camManager(cam), fpsController(fps), registerCallback(nullptr),
+      awaitingResume(false), awaitingFirstFrame(false), lastResumed(false), connectedAt(0),
+      resumes(0), fullRegistrations(0), lastReconnectMs(0), framesLost(0)
+{
+}
+
+void SessionManager::setRegisterCallback(void (*callback)())
+{
+    registerCallback = callback;
+}
+
+void SessionManager::onConnected()
+{
+    connectedAt = millis();
+    awaitingFirstFrame = true;
+
+    if (token.length() == 0)
+    {
+        fullRegistration();
+        return;
+    }
+
+    // Reanudar en un solo mensaje: último frame enviado y ajustes activos
+    String msg = "{\"type\":\"resume\",\"token\":\"" + token + "\"" +
+                 ",\"lastFrameId\":" + String(frameSender->getLastFrameId()) +
+                 ",\"settings\":{\"res\":" + String(camManager->getResolutionIndex()) +
+                 ",\"quality\":" + String(camManager->getCurrentQuality()) +
+                 ",\"fps\":" + String(fpsController->getFPS()) +
+                 ",\"mode\":\"" + frameSender->getModeName() + "\"}}";
+
+    if (!wsManager->sendText(msg))
+    {
+        fullRegistration();
+        return;
+    }
+
+    awaitingResume = true;
+    Serial.println("[SES] 🔁 Reanudando sesión...");
+}
+
+void SessionManager::onSession(JsonDocument &doc)
+{
+    const char *newToken = doc["token"];
+    if (newToken)
+    {
+        token = newToken;
+    }
+
+    if (!awaitingResume)
+    {
+        // Token emitido tras un registro completo
+        Serial.printf("[SES] 🎫 Sesión %s\n", token.c_str());
+        return;
+    }
+    awaitingResume = false;
+
+    if (!(doc["resumed"] | false))
+    {
+        Serial.println("[SES] ✗ Sesión desconocida para el servidor");
+        token = "";
+        fullRegistration();
+        return;
+    }
+
+    resumes++;
+    lastResumed = true;
+
+    // El servidor conserva tablas JPEG y cola de comandos; lo que quedó a
+    // medio enviar durante el corte se da por perdido
+    uint32_t serverLast = doc["lastFrameId"] | 0;
+    uint32_t deviceLast = frameSender->getLastFrameId();
+    framesLost = deviceLast > serverLast ? deviceLast - serverLast : 0;
+    frameSender->resumeJpegTables(doc["tablesHash"] | 0u);
+
+    Serial.printf("[SES] ✅ Sesión reanudada en %lums (frame %lu/%lu, %d comandos pendientes)\n",
+                  millis() - connectedAt, (unsigned long)serverLast, (unsigned long)deviceLast,
+                  (int)(doc["pending"] | 0));
+}
+
+void SessionManager::onFirstFrameAck()
+{
+    if (!awaitingFirstFrame)
+        return;
+    awaitingFirstFrame = false;
+
+    lastReconnectMs = millis() - connectedAt;
+    Serial.printf("[SES] ⏱️ Conexión → primer frame: %lums (%s)\n",
+                  lastReconnectMs, lastResumed ? "reanudada" : "registro completo");
+
+    wsManager->sendText("{\"type\":\"reconnect\",\"resumed\":" + String(lastResumed ? "true" : "false") +
+                        ",\"firstFrameMs\":" + String(lastReconnectMs) +
+                        ",\"framesLost\":" + String(framesLost) +
+                        ",\"resumes\":" + String(resumes) +
+                        ",\"fullRegistrations\":" + String(fullRegistrations) + "}");
+}
+
+void SessionManager::service()
+{
+    if (!awaitingResume)
+        return;
+
+    // Cortada otra vez antes de la respuesta: se reintenta al reconectar
+    if (!wsManager->isConnected())
+    {
+        awaitingResume = false;
+        return;
+    }
+
+    if (millis() - connectedAt >= SESSION_RESUME_TIMEOUT_MS)
+    {
+        Serial.println("[SES] ⏱️ Sin respuesta al resume");
+        awaitingResume = false;
+        token = "";
+        fullRegistration();
+    }
+}
+
+void SessionManager::fullRegistration()
+{
+    fullRegistrations++;
+    lastResumed = false;
+    framesLost = 0;
+    if (registerCallback)
+    {
+        registerCallback();
+    }
+}
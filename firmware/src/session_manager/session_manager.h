@@ -0,0 +1,53 @@
+#ifndef SESSION_MANAGER_H
+#define SESSION_MANAGER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "../configuration/config.h"
+
+// Forward declarations
+class WebSocketManager;
+class FrameSender;
+class CameraManager;
+class FPSController;
+
+// Sesión con el servidor: el token emitido en el registro permite que una
+// reconexión se reanude con un solo mensaje ("resume") en vez de repetir
+// register + info + health. Si el servidor no reconoce el token (reinicio,
+// sesión caducada) se hace el registro completo.
+class SessionManager
+{
+public:
+    SessionManager(WebSocketManager *ws, FrameSender *fs, CameraManager *cam, FPSController *fps);
+
+    // Registro completo (register + info + health), definido en main
+    void setRegisterCallback(void (*callback)());
+
+    void onConnected();
+    void onSession(JsonDocument &doc);
+    void onFirstFrameAck();
+    void service(); // Sin respuesta al resume: registro completo
+
+private:
+    WebSocketManager *wsManager;
+    FrameSender *frameSender;
+    CameraManager *camManager;
+    FPSController *fpsController;
+    void (*registerCallback)();
+
+    String token;
+    bool awaitingResume;
+    bool awaitingFirstFrame;
+    bool lastResumed;
+    unsigned long connectedAt;
+
+    // Estadísticas
+    unsigned long resumes;
+    unsigned long fullRegistrations;
+    unsigned long lastReconnectMs;
+    uint32_t framesLost; // Frames chunked sin confirmar al cortarse la conexión
+
+    void fullRegistration();
+};
+
+#endif
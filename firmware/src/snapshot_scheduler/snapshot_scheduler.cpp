@@ -0,0 +1,149 @@
+#include "snapshot_scheduler.h"
+#include "../frame_sender/frame_sender.h"
+#include "../fps_controller/fps_controller.h"
+#include <Arduino.h>
+
+SnapshotScheduler::SnapshotScheduler(CameraManager *cam, FrameSender *sender, FPSController *fps)
+    : camManager(cam), frameSender(sender), fpsController(fps), resValue(SNAPSHOT_RESOLUTION),
+      intervalMs((unsigned long)SNAPSHOT_INTERVAL_S * 1000), lastSnapshot(0), pending(false), seq(0),
+      snapshotsTaken(0), snapshotsFailed(0), lastSwitchMs(0), lastRestoreMs(0), lastSendMs(0),
+      lastGapMs(0), maxGapMs(0), totalGapMs(0), gapSamples(0),
+      gapPending(false), gapFrom(0), gapFramesSent(0)
+{
+    camManager->makeProfile(SNAPSHOT_RESOLUTION, SNAPSHOT_QUALITY, profile);
+}
+
+bool SnapshotScheduler::setProfile(int res, int quality)
+{
+    CaptureProfile candidate;
+    if (!camManager->makeProfile(res, quality, candidate))
+    {
+        return false;
+    }
+
+    profile = candidate;
+    resValue = res;
+    Serial.printf("[SNAP] ✓ Perfil: %dx%d calidad %d\n", profile.width, profile.height, profile.quality);
+    return true;
+}
+
+void SnapshotScheduler::setInterval(unsigned long seconds)
+{
+    if (seconds > SNAPSHOT_INTERVAL_MAX_S)
+        seconds = SNAPSHOT_INTERVAL_MAX_S;
+    intervalMs = seconds * 1000;
+    lastSnapshot = millis();
+}
+
+void SnapshotScheduler::request()
+{
+    pending = true;
+}
+
+bool SnapshotScheduler::isDue() const
+{
+    return pending || (intervalMs > 0 && millis() - lastSnapshot >= intervalMs);
+}
+
+void SnapshotScheduler::run()
+{
+    pending = false;
+    lastSnapshot = millis();
+
+    // Referencia del hueco: último frame del stream antes del cambio de perfil
+    unsigned long lastStreamFrame = frameSender->getLastSendTime();
+    unsigned long framesBefore = frameSender->getFramesSent();
+
+    unsigned long switchMs, restoreMs;
+    camera_fb_t *fb = camManager->captureWithProfile(profile, switchMs, restoreMs);
+    if (!fb)
+    {
+        snapshotsFailed++;
+        return;
+    }
+
+    seq++;
+    String info = "{\"type\":\"snapshot\",\"seq\":" + String(seq) +
+                  ",\"width\":" + String(profile.width) +
+                  ",\"height\":" + String(profile.height) +
+                  ",\"quality\":" + String(profile.quality) +
+                  ",\"size\":" + String(fb->len) +
+                  ",\"switchMs\":" + String(switchMs) +
+                  ",\"restoreMs\":" + String(restoreMs) + "}";
+
+    unsigned long sendStart = millis();
+    bool ok = frameSender->sendTaggedFrame(fb, info);
+    lastSendMs = millis() - sendStart;
+    camManager->returnFrame(fb);
+
+    lastSwitchMs = switchMs;
+    lastRestoreMs = restoreMs;
+    if (!ok)
+    {
+        snapshotsFailed++;
+        return;
+    }
+    snapshotsTaken++;
+
+    gapPending = lastStreamFrame > 0;
+    gapFrom = lastStreamFrame;
+    gapFramesSent = framesBefore;
+
+    Serial.printf("[SNAP] 📸 #%lu %dx%d | cambio %lums | vuelta %lums | envío %lums\n",
+                  (unsigned long)seq, profile.width, profile.height, switchMs, restoreMs, lastSendMs);
+}
+
+void SnapshotScheduler::update()
+{
+    if (!gapPending || frameSender->getFramesSent() == gapFramesSent)
+    {
+        return;
+    }
+    gapPending = false;
+
+    lastGapMs = frameSender->getLastSendTime() - gapFrom;
+    if (lastGapMs > maxGapMs)
+        maxGapMs = lastGapMs;
+    totalGapMs += lastGapMs;
+    gapSamples++;
+
+    Serial.printf("[SNAP] ⏱️ Hueco en el stream: %lums (intervalo normal %lums)\n",
+                  lastGapMs, fpsController->getFrameInterval());
+}
+
+int SnapshotScheduler::getResolution() const
+{
+    return resValue;
+}
+
+int SnapshotScheduler::getQuality() const
+{
+    return profile.quality;
+}
+
+unsigned long SnapshotScheduler::getSnapshotsTaken() const
+{
+    return snapshotsTaken;
+}
+
+String SnapshotScheduler::getStatusJson()
+{
+    // Coste = hueco medido menos el intervalo que habría habido sin snapshot
+    unsigned long frameInterval = fpsController->getFrameInterval();
+    unsigned long avgGap = gapSamples ? totalGapMs / gapSamples : 0;
+    unsigned long cost = lastGapMs > frameInterval ? lastGapMs - frameInterval : 0;
+
+    return "{\"type\":\"snapshot_status\",\"resolution\":" + String(resValue) +
+           ",\"width\":" + String(profile.width) + ",\"height\":" + String(profile.height) +
+           ",\"quality\":" + String(profile.quality) +
+           ",\"interval\":" + String(intervalMs / 1000) +
+           ",\"taken\":" + String(snapshotsTaken) +
+           ",\"failed\":" + String(snapshotsFailed) +
+           ",\"switchMs\":" + String(lastSwitchMs) +
+           ",\"restoreMs\":" + String(lastRestoreMs) +
+           ",\"sendMs\":" + String(lastSendMs) +
+           ",\"gapMs\":" + String(lastGapMs) +
+           ",\"gapAvgMs\":" + String(avgGap) +
+           ",\"gapMaxMs\":" + String(maxGapMs) +
+           ",\"costMs\":" + String(cost) + "}";
+}
@@ -0,0 +1,59 @@
+#ifndef SNAPSHOT_SCHEDULER_H
+#define SNAPSHOT_SCHEDULER_H
+
+#include <Arduino.h>
+#include "../configuration/config.h"
+#include "../camera_manager/camera_manager.h"
+
+class FrameSender;
+class FPSController;
+
+// Stream continuo en el perfil normal + snapshots periódicos (o bajo comando)
+// en el perfil de alta resolución. Mide el hueco que cada snapshot deja en el stream
+class SnapshotScheduler
+{
+public:
+    SnapshotScheduler(CameraManager *cam, FrameSender *sender, FPSController *fps);
+
+    bool setProfile(int resValue, int quality); // Precalcula el perfil de snapshot
+    void setInterval(unsigned long seconds);    // 0 = solo bajo comando
+    void request();                             // Snapshot en la próxima vuelta del loop
+
+    bool isDue() const;
+    void run();    // Desde el loop principal (bloquea el stream durante el snapshot)
+    void update(); // Desde el loop: cierra la medida del hueco con el siguiente frame
+
+    int getResolution() const; // RES_* del perfil de snapshot
+    int getQuality() const;
+    unsigned long getSnapshotsTaken() const;
+    String getStatusJson();
+
+private:
+    CameraManager *camManager;
+    FrameSender *frameSender;
+    FPSController *fpsController;
+
+    CaptureProfile profile;
+    int resValue;
+    unsigned long intervalMs;
+    unsigned long lastSnapshot;
+    bool pending;
+    uint32_t seq;
+
+    // Coste de cada snapshot
+    unsigned long snapshotsTaken;
+    unsigned long snapshotsFailed;
+    unsigned long lastSwitchMs;  // Cambio de perfil hasta tener el frame
+    unsigned long lastRestoreMs; // Vuelta al perfil del stream
+    unsigned long lastSendMs;
+    unsigned long lastGapMs;     // Último frame del stream → siguiente frame del stream
+    unsigned long maxGapMs;
+    unsigned long totalGapMs;
+    unsigned long gapSamples;
+
+    bool gapPending;
+    unsigned long gapFrom;
+    unsigned long gapFramesSent;
+};
+
+#endif
@@ -0,0 +1,188 @@
+#include "storage.h"
+#include "../configuration/config.h"
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <SD_MMC.h>
+#include "../configuration/pins.h"
+
+class ArduinoFsFile : public StorageFile
+{
+public:
+    ArduinoFsFile(fs::File f) : file(f) {}
+
+    size_t write(const uint8_t *data, size_t len) override { return file.write(data, len); }
+    size_t read(uint8_t *data, size_t len) override { return file.read(data, len); }
+    bool seek(uint32_t position) override { return file.seek(position); }
+    uint32_t size() override { return file.size(); }
+    void close() override { file.close(); }
+
+private:
+    fs::File file;
+};
+
+ArduinoFsStorage::ArduinoFsStorage(uint8_t backend)
+    : backend(backend), fs(nullptr)
+{
+}
+
+bool ArduinoFsStorage::begin()
+{
+    if (backend == RECORDER_STORAGE_SD)
+    {
+        SD_MMC.setPins(SD_MMC_CLK_GPIO_NUM, SD_MMC_CMD_GPIO_NUM, SD_MMC_D0_GPIO_NUM);
+        if (!SD_MMC.begin("/sdcard", true))
+        {
+            Serial.println("[STO] ✗ Tarjeta SD no disponible");
+            return false;
+        }
+        fs = &SD_MMC;
+    }
+    else
+    {
+        // Formatea la partición si no tiene un LittleFS válido
+        if (!LittleFS.begin(true))
+        {
+            Serial.println("[STO] ✗ LittleFS no disponible");
+            return false;
+        }
+        fs = &LittleFS;
+    }
+
+    Serial.printf("[STO] ✓ %s: %llu/%llu KB usados\n", name(),
+                  usedBytes() / 1024, totalBytes() / 1024);
+    return true;
+}
+
+StorageFile *ArduinoFsStorage::open(const char *path, bool write)
+{
+    if (!fs)
+        return nullptr;
+
+    // "w+" permite volver atrás para reescribir la cabecera al cerrar
+    fs::File file = fs->open(path, write ? "w+" : "r");
+    if (!file)
+        return nullptr;
+    return new ArduinoFsFile(file);
+}
+
+bool ArduinoFsStorage::remove(const char *path)
+{
+    return fs && fs->remove(path);
+}
+
+uint64_t ArduinoFsStorage::totalBytes()
+{
+    if (!fs)
+        return 0;
+    return backend == RECORDER_STORAGE_SD ? SD_MMC.totalBytes() : LittleFS.totalBytes();
+}
+
+uint64_t ArduinoFsStorage::usedBytes()
+{
+    if (!fs)
+        return 0;
+    return backend == RECORDER_STORAGE_SD ? SD_MMC.usedBytes() : LittleFS.usedBytes();
+}
+
+const char *ArduinoFsStorage::name() const
+{
+    return backend == RECORDER_STORAGE_SD ? "SD" : "LittleFS";
+}
+
+#else
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+class PosixFile : public StorageFile
+{
+public:
+    PosixFile(FILE *f) : file(f) {}
+    ~PosixFile() override { close(); }
+
+    size_t write(const uint8_t *data, size_t len) override { return file ? fwrite(data, 1, len, file) : 0; }
+    size_t read(uint8_t *data, size_t len) override { return file ? fread(data, 1, len, file) : 0; }
+    bool seek(uint32_t position) override { return file && fseek(file, position, SEEK_SET) == 0; }
+
+    uint32_t size() override
+    {
+        if (!file)
+            return 0;
+        long current = ftell(file);
+        fseek(file, 0, SEEK_END);
+        long end = ftell(file);
+        fseek(file, current, SEEK_SET);
+        return (uint32_t)end;
+    }
+
+    void close() override
+    {
+        if (file)
+            fclose(file);
+        file = nullptr;
+    }
+
+private:
+    FILE *file;
+};
+
+PosixStorage::PosixStorage(const char *rootDir)
+{
+    snprintf(root, sizeof(root), "%s", rootDir);
+}
+
+bool PosixStorage::begin()
+{
+    struct stat info;
+    return stat(root, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+void PosixStorage::resolve(const char *path, char *out, size_t outSize) const
+{
+    snprintf(out, outSize, "%s%s", root, path);
+}
+
+StorageFile *PosixStorage::open(const char *path, bool write)
+{
+    char full[256];
+    resolve(path, full, sizeof(full));
+    FILE *file = fopen(full, write ? "w+b" : "rb");
+    if (!file)
+        return nullptr;
+    return new PosixFile(file);
+}
+
+bool PosixStorage::remove(const char *path)
+{
+    char full[256];
+    resolve(path, full, sizeof(full));
+    return ::remove(full) == 0;
+}
+
+uint64_t PosixStorage::totalBytes()
+{
+    struct statvfs info;
+    if (statvfs(root, &info) != 0)
+        return 0;
+    return (uint64_t)info.f_blocks * info.f_frsize;
+}
+
+uint64_t PosixStorage::usedBytes()
+{
+    struct statvfs info;
+    if (statvfs(root, &info) != 0)
+        return 0;
+    return (uint64_t)(info.f_blocks - info.f_bavail) * info.f_frsize;
+}
+
+const char *PosixStorage::name() const
+{
+    return "POSIX";
+}
+
+#endif
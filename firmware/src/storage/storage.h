@@ -0,0 +1,78 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Fichero abierto en un backend de almacenamiento
+class StorageFile
+{
+public:
+    virtual ~StorageFile() {}
+
+    virtual size_t write(const uint8_t *data, size_t len) = 0;
+    virtual size_t read(uint8_t *data, size_t len) = 0;
+    virtual bool seek(uint32_t position) = 0;
+    virtual uint32_t size() = 0;
+    virtual void close() = 0;
+};
+
+// Almacenamiento mínimo para la grabación: en el dispositivo LittleFS o SD
+// (API fs::FS de Arduino); en el host un directorio POSIX para probar en Linux
+class Storage
+{
+public:
+    virtual ~Storage() {}
+
+    virtual bool begin() = 0;
+    // write = true crea/trunca (lectura y escritura con seek). Liberar con delete
+    virtual StorageFile *open(const char *path, bool write) = 0;
+    virtual bool remove(const char *path) = 0;
+    virtual uint64_t totalBytes() = 0;
+    virtual uint64_t usedBytes() = 0;
+    virtual const char *name() const = 0;
+};
+
+#ifdef ARDUINO
+
+#include <FS.h>
+
+class ArduinoFsStorage : public Storage
+{
+public:
+    ArduinoFsStorage(uint8_t backend); // RECORDER_STORAGE_*
+
+    bool begin() override;
+    StorageFile *open(const char *path, bool write) override;
+    bool remove(const char *path) override;
+    uint64_t totalBytes() override;
+    uint64_t usedBytes() override;
+    const char *name() const override;
+
+private:
+    uint8_t backend;
+    fs::FS *fs;
+};
+
+#else
+
+class PosixStorage : public Storage
+{
+public:
+    PosixStorage(const char *root); // Directorio base de las rutas "/x.avi"
+
+    bool begin() override;
+    StorageFile *open(const char *path, bool write) override;
+    bool remove(const char *path) override;
+    uint64_t totalBytes() override;
+    uint64_t usedBytes() override;
+    const char *name() const override;
+
+private:
+    char root[128];
+    void resolve(const char *path, char *out, size_t outSize) const;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,392 @@
+#include "stream_profiles.h"
+#include "../chunk_tuner/chunk_tuner.h"
+#include <Arduino.h>
+#include <esp_camera.h>
+
+// Perfiles de fábrica, en el orden de los MODE_*
+static const StreamProfile BUILTIN_PROFILES[STREAM_PROFILE_BUILTIN] = {
+    // Velocidad: chunks grandes y pausas mínimas
+    {"speed",
+     {CHUNK_SIZE_TINY, CHUNK_SIZE_SMALL, CHUNK_SIZE_MEDIUM, CHUNK_SIZE_LARGE, CHUNK_SIZE_XLARGE},
+     DELAY_BETWEEN_CHUNKS_SPEED, DELAY_AFTER_HEADER_SPEED, DELAY_AFTER_FRAME_SPEED,
+     DELAY_AFTER_FOOTER_SPEED, DELAY_SMALL_FRAME_SPEED,
+     0, FRAME_SIZE_SMALL, FRAME_SIZE_MEDIUM, STREAM_PROFILE_GRAB_KEEP, MIN_QUALITY, MAX_QUALITY},
+    // Estabilidad: chunks un tramo más pequeños y pausas largas
+    {"stability",
+     {CHUNK_SIZE_TINY, CHUNK_SIZE_TINY, CHUNK_SIZE_SMALL, CHUNK_SIZE_MEDIUM, CHUNK_SIZE_LARGE},
+     DELAY_BETWEEN_CHUNKS_STABILITY, DELAY_AFTER_HEADER_STABILITY, DELAY_AFTER_FRAME_STABILITY,
+     DELAY_AFTER_FOOTER_STABILITY, DELAY_SMALL_FRAME_STABILITY,
+     0, FRAME_SIZE_SMALL, FRAME_SIZE_MEDIUM, STREAM_PROFILE_GRAB_KEEP, MIN_QUALITY, MAX_QUALITY},
+    // Baja latencia: sin pausas, sin ACK hasta 30KB y siempre el frame más reciente
+    {"low-latency",
+     {CHUNK_SIZE_SMALL, CHUNK_SIZE_MEDIUM, CHUNK_SIZE_LARGE, CHUNK_SIZE_XLARGE, CHUNK_SIZE_XLARGE},
+     0, 0, 0, 0, 0,
+     0, FRAME_SIZE_MEDIUM, FRAME_SIZE_MEDIUM * 2, CAMERA_GRAB_LATEST, 12, 40},
+    // Archivo: calidad alta con transferencias de estabilidad
+    {"archive-quality",
+     {CHUNK_SIZE_TINY, CHUNK_SIZE_TINY, CHUNK_SIZE_SMALL, CHUNK_SIZE_MEDIUM, CHUNK_SIZE_LARGE},
+     DELAY_BETWEEN_CHUNKS_STABILITY, DELAY_AFTER_HEADER_STABILITY, DELAY_AFTER_FRAME_STABILITY,
+     DELAY_AFTER_FOOTER_STABILITY, DELAY_SMALL_FRAME_STABILITY,
+     0, FRAME_SIZE_SMALL, FRAME_SIZE_MEDIUM, STREAM_PROFILE_GRAB_KEEP, MIN_QUALITY, 12},
+    // Enlace con cuota: 64 KB/s, chunks pequeños (una pérdida cuesta poco) y calidad baja
+    {"metered-uplink",
+     {CHUNK_SIZE_TINY, CHUNK_SIZE_TINY, CHUNK_SIZE_SMALL, CHUNK_SIZE_SMALL, CHUNK_SIZE_MEDIUM},
+     DELAY_BETWEEN_CHUNKS_SPEED, DELAY_AFTER_HEADER_SPEED, DELAY_AFTER_FRAME_SPEED,
+     DELAY_AFTER_FOOTER_SPEED, DELAY_SMALL_FRAME_SPEED,
+     64 * 1024, FRAME_SIZE_SMALL / 2, FRAME_SIZE_MEDIUM, CAMERA_GRAB_LATEST, 20, MAX_QUALITY},
+};
+
+static String profileKey(uint8_t index)
+{
+    return "s" + String(index);
+}
+
+// Entero sin signo dentro de [min, max]
+static bool parseNumber(const String &text, long min, long max, long &out)
+{
+    if (text.length() == 0)
+        return false;
+    for (unsigned int i = 0; i < text.length(); i++)
+    {
+        if (!isdigit(text[i]))
+            return false;
+    }
+    out = text.toInt();
+    return out >= min && out <= max;
+}
+
+StreamProfiles::StreamProfiles() : chunkTuner(nullptr)
+{
+    memset(profiles, 0, sizeof(profiles));
+    memset(stats, 0, sizeof(stats));
+    for (int i = 0; i < STREAM_PROFILE_BUILTIN; i++)
+    {
+        profiles[i] = BUILTIN_PROFILES[i];
+    }
+}
+
+const StreamProfile &StreamProfiles::builtin(uint8_t index)
+{
+    return BUILTIN_PROFILES[index < STREAM_PROFILE_BUILTIN ? index : MODE_STABILITY];
+}
+
+void StreamProfiles::setChunkTuner(ChunkTuner *tuner)
+{
+    chunkTuner = tuner;
+}
+
+void StreamProfiles::begin()
+{
+    int loaded = 0;
+    preferences.begin("profiles", true);
+    for (int i = 0; i < STREAM_PROFILE_MAX; i++)
+    {
+        String key = profileKey(i);
+        // Un blob de otro tamaño es de una versión anterior del firmware
+        if (preferences.getBytesLength(key.c_str()) != sizeof(StreamProfile))
+            continue;
+
+        StreamProfile stored;
+        if (preferences.getBytes(key.c_str(), &stored, sizeof(stored)) == sizeof(stored))
+        {
+            stored.name[STREAM_PROFILE_NAME_MAX] = '\0';
+            profiles[i] = stored;
+            loaded++;
+        }
+    }
+    preferences.end();
+
+    if (loaded > 0)
+    {
+        Serial.printf("[PROF] 💾 %d perfiles editados cargados\n", loaded);
+    }
+}
+
+const StreamProfile &StreamProfiles::get(uint8_t index) const
+{
+    return profiles[isValid(index) ? index : MODE_STABILITY];
+}
+
+bool StreamProfiles::isValid(uint8_t index) const
+{
+    return index < STREAM_PROFILE_MAX && profiles[index].name[0] != '\0';
+}
+
+int StreamProfiles::find(const String &name) const
+{
+    long index;
+    if (parseNumber(name, 0, STREAM_PROFILE_MAX - 1, index))
+    {
+        return isValid(index) ? index : -1;
+    }
+
+    for (int i = 0; i < STREAM_PROFILE_MAX; i++)
+    {
+        if (isValid(i) && name == profiles[i].name)
+            return i;
+    }
+    return -1;
+}
+
+int StreamProfiles::create(const String &name, uint8_t base)
+{
+    if (name.length() == 0 || name.length() > STREAM_PROFILE_NAME_MAX || find(name) >= 0 ||
+        isdigit(name[0]) || name.indexOf(',') >= 0 || name.indexOf(':') >= 0 || name.indexOf('"') >= 0)
+        return -1;
+
+    for (int i = STREAM_PROFILE_BUILTIN; i < STREAM_PROFILE_MAX; i++)
+    {
+        if (isValid(i))
+            continue;
+
+        profiles[i] = get(base);
+        memset(profiles[i].name, 0, sizeof(profiles[i].name));
+        strncpy(profiles[i].name, name.c_str(), STREAM_PROFILE_NAME_MAX);
+        memset(&stats[i], 0, sizeof(stats[i]));
+        save(i);
+        // Hueco reutilizado: nada de lo afinado para el perfil anterior
+        if (chunkTuner)
+            chunkTuner->forgetProfile(i);
+
+        Serial.printf("[PROF] ➕ Perfil '%s' creado a partir de '%s'\n", name.c_str(), get(base).name);
+        return i;
+    }
+    return -1;
+}
+
+bool StreamProfiles::edit(uint8_t index, const String &assignments, String &error)
+{
+    if (!isValid(index))
+    {
+        error = "perfil no encontrado";
+        return false;
+    }
+
+    // Se edita una copia: un campo no válido no deja el perfil a medias
+    StreamProfile edited = profiles[index];
+    int start = 0;
+    while (start < (int)assignments.length())
+    {
+        int comma = assignments.indexOf(',', start);
+        String pair = comma < 0 ? assignments.substring(start) : assignments.substring(start, comma);
+        int eq = pair.indexOf('=');
+        String field = eq >= 0 ? pair.substring(0, eq) : pair;
+
+        if (eq < 0 || !setField(edited, field, pair.substring(eq + 1)))
+        {
+            error = "campo no válido: " + pair;
+            return false;
+        }
+
+        if (comma < 0)
+            break;
+        start = comma + 1;
+    }
+
+    if (edited.directMax > edited.ackMax)
+    {
+        error = "direct debe ser <= ack";
+        return false;
+    }
+    if (edited.qualityMin > edited.qualityMax)
+    {
+        error = "qmin debe ser <= qmax";
+        return false;
+    }
+
+    // Tabla de chunks nueva: los tamaños afinados sobre la anterior ya no valen
+    bool chunksChanged = memcmp(edited.chunkSizes, profiles[index].chunkSizes, sizeof(edited.chunkSizes)) != 0;
+
+    profiles[index] = edited;
+    save(index);
+    if (chunksChanged && chunkTuner)
+        chunkTuner->forgetProfile(index);
+    Serial.printf("[PROF] ✏️ Perfil '%s': %s\n", edited.name, assignments.c_str());
+    return true;
+}
+
+bool StreamProfiles::setField(StreamProfile &profile, const String &field, const String &value)
+{
+    long number;
+
+    if (field == "chunks")
+    {
+        // Tamaños por tramo separados por '/'
+        uint16_t sizes[STREAM_PROFILE_TIERS];
+        int start = 0;
+        for (int i = 0; i < STREAM_PROFILE_TIERS; i++)
+        {
+            int slash = value.indexOf('/', start);
+            if ((slash < 0) != (i == STREAM_PROFILE_TIERS - 1))
+                return false;
+            String item = slash < 0 ? value.substring(start) : value.substring(start, slash);
+            if (!parseNumber(item, 256, 32768, number))
+                return false;
+            sizes[i] = number;
+            start = slash + 1;
+        }
+        memcpy(profile.chunkSizes, sizes, sizeof(sizes));
+        return true;
+    }
+    if (field == "grab")
+    {
+        if (value == "latest")
+            profile.grabMode = CAMERA_GRAB_LATEST;
+        else if (value == "empty")
+            profile.grabMode = CAMERA_GRAB_WHEN_EMPTY;
+        else if (value == "keep")
+            profile.grabMode = STREAM_PROFILE_GRAB_KEEP;
+        else
+            return false;
+        return true;
+    }
+
+    uint16_t *delayField = field == "gap"      ? &profile.betweenChunks
+                           : field == "header" ? &profile.afterHeader
+                           : field == "frame"  ? &profile.afterFrame
+                           : field == "footer" ? &profile.afterFooter
+                           : field == "small"  ? &profile.smallFrame
+                                               : nullptr;
+    if (delayField)
+    {
+        if (!parseNumber(value, 0, 1000, number))
+            return false;
+        *delayField = number;
+        return true;
+    }
+
+    if (field == "pace" && parseNumber(value, 0, 100000, number))
+    {
+        profile.pacingMaxBps = number * 1024; // KB/s
+        return true;
+    }
+    if (field == "direct" && parseNumber(value, 0, 1 << 20, number))
+    {
+        profile.directMax = number;
+        return true;
+    }
+    if (field == "ack" && parseNumber(value, 0, 1 << 20, number))
+    {
+        profile.ackMax = number;
+        return true;
+    }
+    if (field == "qmin" && parseNumber(value, MIN_QUALITY, MAX_QUALITY, number))
+    {
+        profile.qualityMin = number;
+        return true;
+    }
+    if (field == "qmax" && parseNumber(value, MIN_QUALITY, MAX_QUALITY, number))
+    {
+        profile.qualityMax = number;
+        return true;
+    }
+    return false;
+}
+
+bool StreamProfiles::reset(uint8_t index)
+{
+    if (!isValid(index))
+        return false;
+
+    preferences.begin("profiles", false);
+    preferences.remove(profileKey(index).c_str());
+    preferences.end();
+
+    if (index < STREAM_PROFILE_BUILTIN)
+    {
+        profiles[index] = BUILTIN_PROFILES[index];
+        Serial.printf("[PROF] ↩️ Perfil '%s' restaurado\n", profiles[index].name);
+    }
+    else
+    {
+        Serial.printf("[PROF] 🗑️ Perfil '%s' eliminado\n", profiles[index].name);
+        memset(&profiles[index], 0, sizeof(profiles[index]));
+    }
+    memset(&stats[index], 0, sizeof(stats[index]));
+    if (chunkTuner)
+        chunkTuner->forgetProfile(index);
+    return true;
+}
+
+bool StreamProfiles::save(uint8_t index)
+{
+    preferences.begin("profiles", false);
+    bool ok = preferences.putBytes(profileKey(index).c_str(), &profiles[index], sizeof(StreamProfile)) ==
+              sizeof(StreamProfile);
+    preferences.end();
+    return ok;
+}
+
+void StreamProfiles::onActivated(uint8_t index)
+{
+    if (isValid(index))
+        stats[index].activations++;
+}
+
+void StreamProfiles::record(uint8_t index, size_t bytes, unsigned long ms, bool success)
+{
+    if (!isValid(index))
+        return;
+
+    ProfileStats &s = stats[index];
+    if (success)
+    {
+        s.frames++;
+        s.bytes += bytes;
+        s.totalMs += ms;
+    }
+    else
+    {
+        s.failures++;
+    }
+}
+
+String StreamProfiles::getProfileJson(uint8_t index)
+{
+    const StreamProfile &p = profiles[index];
+    const ProfileStats &s = stats[index];
+
+    String json = "{\"id\":" + String(index) + ",\"name\":\"" + String(p.name) + "\"" +
+                  ",\"builtin\":" + String(index < STREAM_PROFILE_BUILTIN ? "true" : "false") + ",\"chunks\":[";
+    for (int i = 0; i < STREAM_PROFILE_TIERS; i++)
+    {
+        json += (i > 0 ? "," : "") + String(p.chunkSizes[i]);
+    }
+    json += "],\"gap\":" + String(p.betweenChunks) +
+            ",\"header\":" + String(p.afterHeader) +
+            ",\"frame\":" + String(p.afterFrame) +
+            ",\"footer\":" + String(p.afterFooter) +
+            ",\"small\":" + String(p.smallFrame) +
+            ",\"pace\":" + String(p.pacingMaxBps / 1024) +
+            ",\"direct\":" + String(p.directMax) +
+            ",\"ack\":" + String(p.ackMax) +
+            ",\"grab\":\"" + (p.grabMode == CAMERA_GRAB_LATEST ? "latest" : p.grabMode == CAMERA_GRAB_WHEN_EMPTY ? "empty" : "keep") + "\"" +
+            ",\"qmin\":" + String(p.qualityMin) +
+            ",\"qmax\":" + String(p.qualityMax);
+
+    // Rendimiento desde el arranque
+    json += ",\"stats\":{\"activations\":" + String(s.activations) +
+            ",\"frames\":" + String(s.frames) +
+            ",\"failures\":" + String(s.failures) +
+            ",\"kb\":" + String((uint32_t)(s.bytes / 1024)) +
+            ",\"avgMs\":" + String(s.frames ? s.totalMs / s.frames : 0) +
+            ",\"kbps\":" + String(s.totalMs ? (float)s.bytes / 1024.0f * 1000.0f / s.totalMs : 0.0f, 1) + "}}";
+    return json;
+}
+
+String StreamProfiles::getStatusJson(uint8_t active)
+{
+    String json = "{\"type\":\"profiles\",\"active\":" + String(active) + ",\"profiles\":[";
+    bool first = true;
+    for (int i = 0; i < STREAM_PROFILE_MAX; i++)
+    {
+        if (!isValid(i))
+            continue;
+        if (!first)
+            json += ",";
+        first = false;
+        json += getProfileJson(i);
+    }
+    json += "]}";
+    return json;
+}
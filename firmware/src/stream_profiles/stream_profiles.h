@@ -0,0 +1,77 @@
+#ifndef STREAM_PROFILES_H
+#define STREAM_PROFILES_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "../configuration/config.h"
+
+class ChunkTuner;
+
+// Política de transmisión de un modo (blob en NVS)
+struct StreamProfile
+{
+    char name[STREAM_PROFILE_NAME_MAX + 1]; // Vacío = hueco libre
+    // Chunk por tramo de frame: ≤30KB, ≤100KB, ≤200KB, ≤400KB, >400KB
+    uint16_t chunkSizes[STREAM_PROFILE_TIERS];
+    // Pausas (ms)
+    uint16_t betweenChunks;
+    uint16_t afterHeader;
+    uint16_t afterFrame;
+    uint16_t afterFooter;
+    uint16_t smallFrame;
+    uint32_t pacingMaxBps; // Techo de tasa (0 = sin límite)
+    uint32_t directMax;    // Hasta este tamaño: envío directo
+    uint32_t ackMax;       // Hasta este tamaño: con ACK; por encima, chunks
+    uint8_t grabMode;      // CAMERA_GRAB_* o STREAM_PROFILE_GRAB_KEEP
+    uint8_t qualityMin;    // Límites de calidad JPEG mientras el perfil está activo
+    uint8_t qualityMax;
+};
+
+// Contadores de rendimiento por perfil (no se guardan)
+struct ProfileStats
+{
+    uint32_t activations;
+    uint32_t frames;
+    uint32_t failures;
+    uint64_t bytes;
+    uint32_t totalMs;
+};
+
+// Tabla de perfiles de streaming: los MODE_* integrados más perfiles
+// propios, editables por comando y persistidos en NVS
+class StreamProfiles
+{
+public:
+    StreamProfiles();
+
+    void begin(); // Carga las ediciones guardadas
+    void setChunkTuner(ChunkTuner *tuner); // Olvida chunks afinados de perfiles editados
+
+    const StreamProfile &get(uint8_t index) const; // Índice no válido → estabilidad
+    bool isValid(uint8_t index) const;
+    int find(const String &name) const;  // Nombre o índice; -1 si no existe
+
+    int create(const String &name, uint8_t base); // Copia de base en un hueco libre
+    // "campo=valor,campo=valor": se aplica todo o nada y se guarda
+    bool edit(uint8_t index, const String &assignments, String &error);
+    bool reset(uint8_t index); // Integrados: valores de fábrica; propios: se borran
+
+    void onActivated(uint8_t index);
+    void record(uint8_t index, size_t bytes, unsigned long ms, bool success);
+
+    String getStatusJson(uint8_t active); // {"type":"profiles",...}
+
+    static const StreamProfile &builtin(uint8_t index);
+
+private:
+    StreamProfile profiles[STREAM_PROFILE_MAX];
+    ProfileStats stats[STREAM_PROFILE_MAX];
+    Preferences preferences;
+    ChunkTuner *chunkTuner;
+
+    bool setField(StreamProfile &profile, const String &field, const String &value);
+    bool save(uint8_t index);
+    String getProfileJson(uint8_t index);
+};
+
+#endif
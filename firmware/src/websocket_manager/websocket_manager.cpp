@@ -1,7 +1,10 @@
 #include "websocket_manager.h"
 #include "../configuration/secrets.h" // <--- Aquí es donde viven los valores reales
+#include "../configuration/config.h"
 
-WebSocketManager::WebSocketManager() : connected(false) {}
+WebSocketManager::WebSocketManager()
+    : connected(false), capRate(0), capBurst(0), tokens(0), lastRefillUs(0), bytesSent(0),
+      bytesOverBudget(0), framesDeferred(0) {}
 
 void WebSocketManager::init()
 {
@@ -56,20 +59,34 @@ void WebSocketManager::setEventCallback(void (*callback)(WStype_t, uint8_t *, si
     webSocket.onEvent(callback);
 }
 
-void WebSocketManager::sendBinary(const uint8_t *data, size_t length)
+bool WebSocketManager::sendBinary(const uint8_t *data, size_t length)
 {
-    if (isConnected())
+    if (isConnected() && webSocket.sendBIN(data, length))
     {
-        webSocket.sendBIN(data, length);
+        consumeTokens(length);
+        return true;
     }
+    return false;
 }
 
-void WebSocketManager::sendText(const String &text)
+bool WebSocketManager::sendText(const String &text)
 {
-    if (isConnected())
+    if (isConnected() && webSocket.sendTXT(text.c_str()))
     {
-        webSocket.sendTXT(text.c_str());
+        consumeTokens(text.length());
+        return true;
     }
+    return false;
+}
+
+bool WebSocketManager::sendPing(uint8_t *payload, size_t length)
+{
+    if (isConnected() && webSocket.sendPing(payload, length))
+    {
+        consumeTokens(length);
+        return true;
+    }
+    return false;
 }
 
 void WebSocketManager::sendCommandResponse(const String &cmd, const String &status, const String &value)
@@ -83,4 +100,137 @@ void WebSocketManager::sendCommandResponse(const String &cmd, const String &stat
     response += "}";
 
     sendText(response);
-}
\ No newline at end of file
+}
+
+void WebSocketManager::beginBandwidthCap()
+{
+    preferences.begin("bwcap", true);
+    uint32_t rate = preferences.getUInt("rate", 0);
+    uint32_t burst = preferences.getUInt("burst", 0);
+    preferences.end();
+
+    if (rate > 0)
+    {
+        capRate = rate;
+        capBurst = burst;
+        tokens = capBurst;
+        lastRefillUs = micros();
+        Serial.printf("[WS] 🪣 Tope de ancho de banda: %u KB/s, ráfaga %u KB\n", capRate / 1024, capBurst / 1024);
+    }
+}
+
+bool WebSocketManager::setBandwidthCap(uint32_t bytesPerSecond, uint32_t burst)
+{
+    if (bytesPerSecond > 0 &&
+        (bytesPerSecond < BWCAP_MIN_KBPS * 1024 || bytesPerSecond > BWCAP_MAX_KBPS * 1024))
+        return false;
+
+    if (bytesPerSecond > 0 && burst == 0)
+    {
+        burst = (uint64_t)bytesPerSecond * BWCAP_BURST_DEFAULT_MS / 1000;
+    }
+    capRate = bytesPerSecond;
+    capBurst = bytesPerSecond > 0 ? max(burst, (uint32_t)BWCAP_BURST_MIN) : 0;
+
+    // Cubo lleno al activar: el primer frame no espera
+    tokens = capBurst;
+    lastRefillUs = micros();
+
+    preferences.begin("bwcap", false);
+    preferences.putUInt("rate", capRate);
+    preferences.putUInt("burst", capBurst);
+    preferences.end();
+
+    if (capRate > 0)
+        Serial.printf("[WS] 🪣 Tope de ancho de banda: %u KB/s, ráfaga %u KB\n", capRate / 1024, capBurst / 1024);
+    else
+        Serial.println("[WS] 🪣 Tope de ancho de banda desactivado");
+    return true;
+}
+
+uint32_t WebSocketManager::getBandwidthCap() const
+{
+    return capRate;
+}
+
+uint32_t WebSocketManager::getBandwidthBurst() const
+{
+    return capBurst;
+}
+
+void WebSocketManager::refillTokens()
+{
+    unsigned long now = micros();
+    tokens += (float)capRate * (now - lastRefillUs) / 1000000.0f;
+    lastRefillUs = now;
+    if (tokens > capBurst)
+        tokens = capBurst;
+}
+
+void WebSocketManager::consumeTokens(size_t bytes)
+{
+    bytes += BWCAP_FRAME_OVERHEAD;
+    bytesSent += bytes;
+    if (capRate == 0)
+        return;
+
+    // Lo que ya ha salido se descuenta siempre (el saldo puede quedar en
+    // negativo); la parte sin presupuesto se contabiliza como exceso
+    refillTokens();
+    float covered = tokens > 0 ? tokens : 0;
+    if (bytes > covered)
+    {
+        bytesOverBudget += bytes - (size_t)covered;
+    }
+    tokens -= bytes;
+}
+
+bool WebSocketManager::admit(size_t bytes)
+{
+    if (capRate == 0)
+        return true;
+
+    // Un frame mayor que la ráfaga entra con el cubo lleno y el resto se
+    // reparte entre chunks (getBudgetWaitMs)
+    refillTokens();
+    if (tokens >= min(bytes + BWCAP_FRAME_OVERHEAD, (size_t)capBurst))
+        return true;
+
+    framesDeferred++;
+    return false;
+}
+
+bool WebSocketManager::hasBudget()
+{
+    if (capRate == 0)
+        return true;
+
+    refillTokens();
+    return tokens > 0;
+}
+
+unsigned long WebSocketManager::getBudgetWaitMs(size_t bytes)
+{
+    if (capRate == 0)
+        return 0;
+
+    refillTokens();
+    float needed = min((float)(bytes + BWCAP_FRAME_OVERHEAD), (float)capBurst);
+    if (tokens >= needed)
+        return 0;
+    return (unsigned long)((needed - tokens) * 1000.0f / capRate) + 1;
+}
+
+String WebSocketManager::getBandwidthJson()
+{
+    if (capRate > 0)
+        refillTokens();
+
+    String json = "\"bwcap\":{\"rate\":" + String(capRate) + ",";
+    json += "\"burst\":" + String(capBurst) + ",";
+    json += "\"tokens\":" + String((long)tokens) + ",";
+    json += "\"sentKB\":" + String((unsigned long)(bytesSent / 1024)) + ",";
+    json += "\"overBudget\":" + String((unsigned long)bytesOverBudget) + ",";
+    json += "\"deferred\":" + String(framesDeferred) + "}";
+    return json;
+}
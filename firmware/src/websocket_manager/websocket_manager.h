@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <WebSocketsClient.h>
+#include <Preferences.h>
 
 class WebSocketManager
 {
@@ -10,6 +11,19 @@ private:
     WebSocketsClient webSocket;
     bool connected;
 
+    // Tope de ancho de banda (token bucket, bytes)
+    Preferences preferences;
+    uint32_t capRate; // Bytes/s (0 = sin tope)
+    uint32_t capBurst;
+    float tokens;
+    unsigned long lastRefillUs;
+    uint64_t bytesSent;
+    uint64_t bytesOverBudget;
+    unsigned long framesDeferred;
+
+    void refillTokens();
+    void consumeTokens(size_t bytes);
+
 public:
     WebSocketManager();
     void init(); // Sin parámetros, porque los toma de secrets.h
@@ -18,9 +32,20 @@ public:
     void setConnected(bool connected);
     void setEventCallback(void (*callback)(WStype_t, uint8_t *, size_t));
 
-    void sendBinary(const uint8_t *data, size_t length);
-    void sendText(const String &text);
+    bool sendBinary(const uint8_t *data, size_t length);
+    bool sendText(const String &text);
+    bool sendPing(uint8_t *payload, size_t length); // El pong devuelve el mismo payload
     void sendCommandResponse(const String &cmd, const String &status, const String &value = "");
+
+    // Tope de ancho de banda sobre todos los bytes enviados
+    void beginBandwidthCap();                                        // Carga el tope guardado
+    bool setBandwidthCap(uint32_t bytesPerSecond, uint32_t burst); // 0 = sin tope; se guarda en NVS
+    uint32_t getBandwidthCap() const;
+    uint32_t getBandwidthBurst() const;
+    bool admit(size_t bytes);                   // ¿Presupuesto para un frame? Si no, cuenta el descarte
+    bool hasBudget();                           // Presupuesto positivo (o sin tope)
+    unsigned long getBudgetWaitMs(size_t bytes); // Espera hasta poder enviar bytes
+    String getBandwidthJson();                  // Fragmento "bwcap":{...}
 };
 
 #endif
\ No newline at end of file
@@ -1,7 +1,27 @@
 #include "wifi_manager.h"
 #include <Arduino.h>
+#include <algorithm>
 
-WifiManager::WifiManager() : webServer(80)
+// Instantes de asociación y de IP de la conexión en curso (eventos del driver)
+static volatile unsigned long associatedAt = 0;
+static volatile unsigned long gotIpAt = 0;
+
+static void onWifiEvent(arduino_event_id_t event)
+{
+    if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED)
+        associatedAt = millis();
+    else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP)
+        gotIpAt = millis();
+}
+
+WifiManager::WifiManager()
+    : webServer(80),
+      connectPath("none"),
+      connectStart(0),
+      attemptStart(0),
+      assocMs(0),
+      ipMs(0),
+      totalMs(0)
 {
     // Constructor
 }
@@ -11,42 +31,57 @@ bool WifiManager::connect()
     if (WiFi.status() == WL_CONNECTED)
         return true;
 
+    static bool eventsRegistered = false;
+    if (!eventsRegistered)
+    {
+        WiFi.onEvent(onWifiEvent, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+        WiFi.onEvent(onWifiEvent, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+        eventsRegistered = true;
+    }
+
+    connectStart = millis();
+
     WiFi.mode(WIFI_STA);
     WiFi.setSleep(false);
     WiFi.setAutoReconnect(true);
 
-    // 1. Intentar conectar a redes guardadas (NVS)
-    if (connectToSavedNetwork()) {
+    // 1. Ruta rápida: último AP (BSSID + canal) sin escanear
+    if (connectCached())
         return true;
-    }
 
-    // 2. Intentar conectar a cada red en la lista hardcoded
-    Serial.println("[WiFi] 📂 Probando lista predefinida...");
-    for (int i = 0; i < wifiCredentialCount; i++)
+    // 2. Un único escaneo: redes conocidas visibles, de mayor a menor RSSI
+    int tried = 0;
+    if (connectByScan(tried))
+        return true;
+
+    // 3. Ninguna red conocida visible (p. ej. SSID oculto): probar a ciegas
+    if (tried == 0)
     {
-        const char *currentSSID = wifiCredentials[i].ssid;
-        const char *currentPass = wifiCredentials[i].password;
-
-        Serial.printf("\n[WiFi] 📶 Intentando red %d/%d: %s\n", i + 1, wifiCredentialCount, currentSSID);
-        
-        // Desconectar intento anterior si lo hubo
-        WiFi.disconnect(); 
-        delay(100);
-        
-        WiFi.begin(currentSSID, currentPass);
-
-        if (attemptConnection())
-        {
-            Serial.printf("[WiFi] ✓ Conexión exitosa a %s\n", currentSSID);
+        if (connectToSavedNetwork())
             return true;
-        }
-        else
+
+        Serial.println("[WiFi] 📂 Probando lista predefinida...");
+        for (int i = 0; i < wifiCredentialCount; i++)
         {
-            Serial.printf("[WiFi] ✗ Falló conexión a %s\n", currentSSID);
+            const char *currentSSID = wifiCredentials[i].ssid;
+            const char *currentPass = wifiCredentials[i].password;
+
+            Serial.printf("\n[WiFi] 📶 Intentando red %d/%d: %s\n", i + 1, wifiCredentialCount, currentSSID);
+
+            if (attemptConnection(currentSSID, currentPass, 0, nullptr, WIFI_CONNECT_TIMEOUT_MS))
+            {
+                Serial.printf("[WiFi] ✓ Conexión exitosa a %s\n", currentSSID);
+                recordConnection("list", currentSSID, currentPass);
+                return true;
+            }
+            else
+            {
+                Serial.printf("[WiFi] ✗ Falló conexión a %s\n", currentSSID);
+            }
         }
     }
 
-    // 3. Fallback: Portal Captive
+    // 4. Fallback: Portal Captive
     Serial.println("\n[WiFi] ❌ Todas las redes fallaron");
     Serial.println("[WiFi] 🌐 Iniciando Portal Captive...");
     startCaptivePortal();
@@ -56,15 +91,21 @@ bool WifiManager::connect()
     return false;
 }
 
-bool WifiManager::attemptConnection()
+bool WifiManager::attemptConnection(const char *ssid, const char *password, int32_t channel,
+                                    const uint8_t *bssid, unsigned long timeoutMs)
 {
-    int attempts = 0;
-    // Reducir intentos a 20 (aprox 10s) para iterar más rápido entre redes
-    while (WiFi.status() != WL_CONNECTED && attempts < 20)
+    // Desconectar intento anterior si lo hubo
+    WiFi.disconnect();
+
+    associatedAt = 0;
+    gotIpAt = 0;
+    attemptStart = millis();
+    WiFi.begin(ssid, password, channel, bssid);
+
+    // Sondeo corto: la conexión se detecta en cuanto hay IP
+    while (WiFi.status() != WL_CONNECTED && millis() - attemptStart < timeoutMs)
     {
-        delay(500);
-        Serial.print(".");
-        attempts++;
+        delay(WIFI_POLL_MS);
     }
 
     if (WiFi.status() == WL_CONNECTED)
@@ -76,6 +117,215 @@ bool WifiManager::attemptConnection()
     return false;
 }
 
+void WifiManager::recordConnection(const char *path, const String &ssid, const String &password)
+{
+    unsigned long now = millis();
+    unsigned long assocAt = associatedAt;
+    unsigned long ipAt = gotIpAt ? gotIpAt : now;
+
+    connectPath = path;
+    connectedSSID = ssid;
+    assocMs = assocAt ? assocAt - attemptStart : 0;
+    ipMs = ipAt - attemptStart;
+    totalMs = ipAt - connectStart;
+
+    Serial.printf("[WiFi] ⏱️ Ruta %s: asociación %lums, IP %lums (total %lums con escaneo y reintentos)\n",
+                  connectPath, assocMs, ipMs, totalMs);
+
+    saveFastCache(ssid, password);
+}
+
+// === CONEXIÓN RÁPIDA ===
+
+bool WifiManager::connectCached()
+{
+    preferences.begin("wifi", true); // Read-only
+    String ssid = preferences.getString("fast_ssid", "");
+    String password = preferences.getString("fast_pass", "");
+    uint8_t bssid[6] = {0};
+    size_t bssidLen = preferences.getBytes("fast_bssid", bssid, sizeof(bssid));
+    uint8_t channel = preferences.getUChar("fast_chan", 0);
+    uint32_t ip = preferences.getUInt("fast_ip", 0);
+    uint32_t gateway = preferences.getUInt("fast_gw", 0);
+    uint32_t mask = preferences.getUInt("fast_mask", 0);
+    uint32_t dns = preferences.getUInt("fast_dns", 0);
+    preferences.end();
+
+    if (ssid == "" || bssidLen != sizeof(bssid) || channel == 0)
+        return false;
+
+    Serial.printf("[WiFi] ⚡ Ruta rápida: %s (%02X:%02X:%02X:%02X:%02X:%02X, canal %u)\n",
+                  ssid.c_str(), bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5], channel);
+
+    bool staticIp = WIFI_STATIC_IP_CACHE && ip != 0;
+    if (staticIp)
+        WiFi.config(IPAddress(ip), IPAddress(gateway), IPAddress(mask), IPAddress(dns));
+
+    if (attemptConnection(ssid.c_str(), password.c_str(), channel, bssid, WIFI_FAST_TIMEOUT_MS))
+    {
+        recordConnection(staticIp ? "cache_static" : "cache", ssid, password);
+        return true;
+    }
+
+    // El AP cambió de canal o ya no está: volver a DHCP y escanear
+    Serial.println("[WiFi] ✗ Ruta rápida fallida");
+    WiFi.disconnect();
+    if (staticIp)
+        WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+    return false;
+}
+
+bool WifiManager::connectByScan(int &tried)
+{
+    tried = 0;
+    unsigned long scanStart = millis();
+    int found = WiFi.scanNetworks(false, false, false, WIFI_SCAN_MS_PER_CHANNEL);
+    if (found <= 0)
+    {
+        Serial.printf("[WiFi] 🔍 Escaneo sin resultados (%lums)\n", millis() - scanStart);
+        WiFi.scanDelete();
+        return false;
+    }
+
+    // AP más fuerte de cada red conocida, ordenados por RSSI descendente
+    int candidates[WIFI_MAX_CANDIDATES];
+    String passwords[WIFI_MAX_CANDIDATES];
+    int count = 0;
+
+    for (int i = 0; i < found; i++)
+    {
+        String ssid = WiFi.SSID(i);
+        String password;
+        if (ssid == "" || !findPassword(ssid, password))
+            continue;
+
+        int existing = -1;
+        for (int c = 0; c < count; c++)
+        {
+            if (WiFi.SSID(candidates[c]) == ssid)
+                existing = c;
+        }
+        if (existing >= 0)
+        {
+            if (WiFi.RSSI(i) > WiFi.RSSI(candidates[existing]))
+                candidates[existing] = i;
+            continue;
+        }
+        if (count < WIFI_MAX_CANDIDATES)
+        {
+            candidates[count] = i;
+            passwords[count] = password;
+            count++;
+        }
+    }
+
+    for (int a = 1; a < count; a++)
+    {
+        for (int b = a; b > 0 && WiFi.RSSI(candidates[b]) > WiFi.RSSI(candidates[b - 1]); b--)
+        {
+            std::swap(candidates[b], candidates[b - 1]);
+            std::swap(passwords[b], passwords[b - 1]);
+        }
+    }
+
+    Serial.printf("[WiFi] 🔍 Escaneo: %d redes, %d conocidas (%lums)\n", found, count, millis() - scanStart);
+
+    bool connected = false;
+    for (int c = 0; c < count && !connected; c++)
+    {
+        int i = candidates[c];
+        String ssid = WiFi.SSID(i);
+        int32_t channel = WiFi.channel(i);
+        uint8_t bssid[6];
+        memcpy(bssid, WiFi.BSSID(i), sizeof(bssid));
+
+        Serial.printf("[WiFi] 📶 %d/%d: %s (%d dBm, canal %d)\n",
+                      c + 1, count, ssid.c_str(), WiFi.RSSI(i), channel);
+        tried++;
+
+        if (attemptConnection(ssid.c_str(), passwords[c].c_str(), channel, bssid, WIFI_CONNECT_TIMEOUT_MS))
+        {
+            recordConnection("scan", ssid, passwords[c]);
+            connected = true;
+        }
+        else
+        {
+            Serial.printf("[WiFi] ✗ Falló conexión a %s\n", ssid.c_str());
+        }
+    }
+
+    WiFi.scanDelete();
+    return connected;
+}
+
+bool WifiManager::findPassword(const String &ssid, String &password)
+{
+    preferences.begin("wifi", true); // Read-only
+    String savedSSID = preferences.getString("ssid", "");
+    String savedPass = preferences.getString("password", "");
+    preferences.end();
+
+    if (savedSSID != "" && savedSSID == ssid)
+    {
+        password = savedPass;
+        return true;
+    }
+
+    for (int i = 0; i < wifiCredentialCount; i++)
+    {
+        if (ssid == wifiCredentials[i].ssid)
+        {
+            password = wifiCredentials[i].password;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WifiManager::saveFastCache(const String &ssid, const String &password)
+{
+    uint8_t bssid[6];
+    memcpy(bssid, WiFi.BSSID(), sizeof(bssid));
+    uint8_t channel = WiFi.channel();
+    uint32_t ip = WIFI_STATIC_IP_CACHE ? (uint32_t)WiFi.localIP() : 0;
+
+    preferences.begin("wifi", false); // Read-write
+
+    // Escribir solo lo que cambia (la flash tiene ciclos limitados)
+    uint8_t cachedBssid[6] = {0};
+    preferences.getBytes("fast_bssid", cachedBssid, sizeof(cachedBssid));
+    bool changed = preferences.getString("fast_ssid", "") != ssid ||
+                   preferences.getString("fast_pass", "") != password ||
+                   memcmp(cachedBssid, bssid, sizeof(bssid)) != 0 ||
+                   preferences.getUChar("fast_chan", 0) != channel ||
+                   preferences.getUInt("fast_ip", 0) != ip;
+
+    if (changed)
+    {
+        preferences.putString("fast_ssid", ssid);
+        preferences.putString("fast_pass", password);
+        preferences.putBytes("fast_bssid", bssid, sizeof(bssid));
+        preferences.putUChar("fast_chan", channel);
+        preferences.putUInt("fast_ip", ip);
+        preferences.putUInt("fast_gw", WIFI_STATIC_IP_CACHE ? (uint32_t)WiFi.gatewayIP() : 0);
+        preferences.putUInt("fast_mask", WIFI_STATIC_IP_CACHE ? (uint32_t)WiFi.subnetMask() : 0);
+        preferences.putUInt("fast_dns", WIFI_STATIC_IP_CACHE ? (uint32_t)WiFi.dnsIP() : 0);
+        Serial.println("[WiFi] 💾 BSSID/canal guardados para la ruta rápida");
+    }
+    preferences.end();
+}
+
+String WifiManager::getConnectJson()
+{
+    String json = "\"wifi\":{\"path\":\"" + String(connectPath) + "\",";
+    json += "\"ssid\":\"" + connectedSSID + "\",";
+    json += "\"channel\":" + String(WiFi.channel()) + ",";
+    json += "\"assocMs\":" + String(assocMs) + ",";
+    json += "\"ipMs\":" + String(ipMs) + ",";
+    json += "\"totalMs\":" + String(totalMs) + "}";
+    return json;
+}
+
 void WifiManager::checkConnection()
 {
     if (WiFi.status() != WL_CONNECTED)
@@ -117,11 +367,9 @@ bool WifiManager::connectToSavedNetwork() {
 
     if (savedSSID != "") {
         Serial.printf("[WiFi] 💾 Red guardada: %s. Conectando...\n", savedSSID.c_str());
-        WiFi.disconnect();
-        WiFi.begin(savedSSID.c_str(), savedPass.c_str());
-        
-        if (attemptConnection()) {
+        if (attemptConnection(savedSSID.c_str(), savedPass.c_str(), 0, nullptr, WIFI_CONNECT_TIMEOUT_MS)) {
             Serial.println("[WiFi] ✓ Conectado con credenciales guardadas");
+            recordConnection("list", savedSSID, savedPass);
             return true;
         }
         Serial.println("[WiFi] ✗ No se pudo conectar a red guardada");
@@ -6,6 +6,7 @@
 #include <WebServer.h>
 #include <Preferences.h>
 #include "../configuration/secrets.h"
+#include "../configuration/config.h"
 
 class WifiManager
 {
@@ -18,14 +19,34 @@ public:
     int getRSSI();
     String getIP();
 
+    // Ruta usada y tiempos de la última conexión (fragmento JSON "wifi":{...})
+    String getConnectJson();
+
 private:
     Preferences preferences;
     DNSServer dnsServer;
     WebServer webServer;
 
-    bool attemptConnection();
+    // Última conexión: "cache", "cache_static", "scan" o "list"; tiempos desde WiFi.begin
+    const char *connectPath;
+    String connectedSSID;
+    unsigned long connectStart;
+    unsigned long attemptStart;
+    unsigned long assocMs;
+    unsigned long ipMs;
+    unsigned long totalMs;
+
+    bool attemptConnection(const char *ssid, const char *password, int32_t channel,
+                           const uint8_t *bssid, unsigned long timeoutMs);
     void printConnectionInfo();
-    
+    void recordConnection(const char *path, const String &ssid, const String &password);
+
+    // Conexión rápida: último AP conocido y escaneo ordenado por RSSI
+    bool connectCached();
+    bool connectByScan(int &tried);
+    bool findPassword(const String &ssid, String &password);
+    void saveFastCache(const String &ssid, const String &password);
+
     // NVS Methods
     bool connectToSavedNetwork();
     void saveCredentials(String ssid, String password);
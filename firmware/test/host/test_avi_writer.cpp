@@ -0,0 +1,144 @@
+// Escribe un AVI con AviWriter sobre PosixStorage y comprueba la estructura
+// RIFF: cabecera, LIST movi, chunks 00dc, idx1 y lectura con AviReader.
+#include "avi_writer/avi_writer.h"
+#include "configuration/config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                      \
+    do                                                                   \
+    {                                                                    \
+        if (!(cond))                                                     \
+        {                                                                \
+            fprintf(stderr, "%s:%d: falla: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                  \
+        }                                                                \
+    } while (0)
+
+static uint32_t get32(const std::vector<uint8_t> &data, size_t pos)
+{
+    return data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | ((uint32_t)data[pos + 3] << 24);
+}
+
+static bool fourcc(const std::vector<uint8_t> &data, size_t pos, const char *tag)
+{
+    return pos + 4 <= data.size() && memcmp(&data[pos], tag, 4) == 0;
+}
+
+// Frame sintético: SOI, relleno dependiente del índice y EOI
+static std::vector<uint8_t> makeFrame(size_t len, uint8_t seed)
+{
+    std::vector<uint8_t> frame(len);
+    for (size_t i = 0; i < len; i++)
+        frame[i] = (uint8_t)(seed + i * 7);
+    frame[0] = 0xFF;
+    frame[1] = 0xD8;
+    frame[len - 2] = 0xFF;
+    frame[len - 1] = 0xD9;
+    return frame;
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = argc > 1 ? argv[1] : ".";
+    PosixStorage storage(dir);
+    CHECK(storage.begin());
+
+    // Tamaños impares (relleno), uno mayor que el buffer (escritura directa)
+    const size_t sizes[] = {1001, 2048, RECORDER_WRITE_BUFFER * 2 + 333, 4095, 17};
+    const uint32_t count = sizeof(sizes) / sizeof(sizes[0]);
+    std::vector<std::vector<uint8_t>> frames;
+    for (uint32_t i = 0; i < count; i++)
+        frames.push_back(makeFrame(sizes[i], (uint8_t)i));
+
+    StorageFile *out = storage.open("/test.avi", true);
+    CHECK(out != nullptr);
+    if (!out)
+        return 1;
+
+    AviWriter writer;
+    CHECK(writer.begin(out, 640, 480, count + 2));
+    for (uint32_t i = 0; i < count; i++)
+        CHECK(writer.addFrame(frames[i].data(), frames[i].size(), 1000 + i * 100));
+    uint32_t moviBytes = writer.getFileSize(); // Cabecera + frames, sin idx1
+    CHECK(writer.finish());
+    delete out;
+
+    // Fichero completo en memoria
+    StorageFile *in = storage.open("/test.avi", false);
+    CHECK(in != nullptr);
+    if (!in)
+        return 1;
+    std::vector<uint8_t> data(in->size());
+    CHECK(in->read(data.data(), data.size()) == data.size());
+
+    // RIFF: tamaño = fichero - 8
+    CHECK(fourcc(data, 0, "RIFF"));
+    CHECK(get32(data, 4) == data.size() - 8);
+    CHECK(fourcc(data, 8, "AVI "));
+    CHECK(fourcc(data, 12, "LIST"));
+    CHECK(fourcc(data, 20, "hdrl"));
+    CHECK(fourcc(data, 24, "avih"));
+    CHECK(get32(data, 32) == 100000); // 100 ms entre frames
+    CHECK(get32(data, 32 + 16) == count);
+
+    // LIST movi: el primer frame empieza alineado al sector
+    CHECK(fourcc(data, AVI_MOVI_FOURCC_POS - 8, "LIST"));
+    CHECK(fourcc(data, AVI_MOVI_FOURCC_POS, "movi"));
+    CHECK(fourcc(data, AVI_HEADER_SIZE, "00dc"));
+    uint32_t moviEnd = AVI_MOVI_FOURCC_POS + get32(data, AVI_MOVI_FOURCC_POS - 4);
+
+    // Los chunks 00dc recorren movi sin huecos (con relleno a par)
+    size_t pos = AVI_HEADER_SIZE;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        CHECK(fourcc(data, pos, "00dc"));
+        CHECK(get32(data, pos + 4) == sizes[i]);
+        CHECK(memcmp(&data[pos + 8], frames[i].data(), sizes[i]) == 0);
+        pos += 8 + sizes[i] + (sizes[i] & 1);
+    }
+    CHECK(pos == moviEnd);
+    CHECK(moviEnd == moviBytes);
+
+    // idx1 justo tras movi; offsets relativos al fourcc 'movi'
+    CHECK(fourcc(data, moviEnd, "idx1"));
+    CHECK(get32(data, moviEnd + 4) == count * 16);
+    CHECK(moviEnd + 8 + count * 16 == data.size());
+    for (uint32_t i = 0; i < count; i++)
+    {
+        size_t entry = moviEnd + 8 + i * 16;
+        CHECK(fourcc(data, entry, "00dc"));
+        uint32_t offset = get32(data, entry + 8);
+        CHECK(get32(data, entry + 12) == sizes[i]);
+        CHECK(fourcc(data, AVI_MOVI_FOURCC_POS + offset, "00dc"));
+        CHECK(get32(data, AVI_MOVI_FOURCC_POS + offset + 4) == sizes[i]);
+    }
+
+    // Lectura de vuelta con AviReader
+    AviReader reader;
+    CHECK(reader.open(in));
+    CHECK(reader.getFrameCount() == count);
+    CHECK(reader.getWidth() == 640 && reader.getHeight() == 480);
+    CHECK(reader.getMicrosPerFrame() == 100000);
+    std::vector<uint8_t> buf(RECORDER_WRITE_BUFFER * 3);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        CHECK(reader.getFrameSize(i) == sizes[i]);
+        CHECK(reader.readFrame(i, buf.data(), buf.size()) == sizes[i]);
+        CHECK(memcmp(buf.data(), frames[i].data(), sizes[i]) == 0);
+    }
+    delete in;
+    storage.remove("/test.avi");
+
+    if (failures > 0)
+    {
+        fprintf(stderr, "✗ %d comprobaciones fallidas\n", failures);
+        return 1;
+    }
+    printf("✓ AVI de %u frames correcto (%zu bytes)\n", count, data.size());
+    return 0;
+}
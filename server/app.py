@@ -256,6 +256,14 @@ def latest_image():
         return Response(latest_frame, mimetype='image/jpeg')
     return jsonify({'status': 'error', 'message': 'No image available'}), 404
 
+@app.route('/api/images/snapshot')
+def latest_snapshot():
+    """Obtener el último snapshot en alta resolución"""
+    snapshot = getattr(camera_server, 'latest_snapshot', None)
+    if snapshot:
+        return Response(snapshot, mimetype='image/jpeg')
+    return jsonify({'status': 'error', 'message': 'No snapshot available'}), 404
+
 # ========== ENDPOINT PARA FAVICON (evitar error 404) ==========
 @app.route('/favicon.ico')
 def favicon():
@@ -7,7 +7,10 @@ import asyncio
 import websockets
 import threading
 import json
+import secrets
+import struct
 import time
+import zlib
 from datetime import datetime
 from collections import defaultdict, deque
 from typing import Set, Optional
@@ -21,12 +24,63 @@ from config import (
     WS_PING_TIMEOUT,
     CHUNK_TIMEOUT,
     CHUNK_CLEANUP_INTERVAL,
+    CHUNK_MAGIC,
+    CHUNK_HEADER_FORMAT,
+    CHUNK_FLAG_RETRANSMIT,
+    CHUNK_FLAG_SLICE,
+    PROGRESSIVE_MIN_INTERVAL,
+    NACK_MAX_INDICES,
+    PROBE_MAGIC,
+    PROBE_HEADER_FORMAT,
+    DELTA_MAGIC,
+    DELTA_HEADER_FORMAT,
+    DELTA_RUN_FORMAT,
+    PREVIEW_MAGIC,
+    PREVIEW_HEADER_FORMAT,
+    PREVIEW_FORMAT_RAW,
     COMMANDS,
+    CMD_MAGIC,
+    CMD_HEADER_FORMAT,
+    CMD_ENTRY_FORMAT,
+    CMD_BATCH_MAX,
+    BINARY_COMMANDS,
+    BATCH_COMMANDS,
+    MODE_SWITCH_HISTORY,
     PRIORITY_CRITICAL,
     PRIORITY_HIGH,
     PRIORITY_NORMAL,
+    SESSION_TTL,
 )
 from image_saver import image_saver
+import jpeg_utils
+
+
+def command_hash(name: str) -> int:
+    """Hash FNV-1a de 32 bits del nombre (igual que commandHash del firmware)"""
+    h = 2166136261
+    for byte in name.encode():
+        h = ((h ^ byte) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def encode_command(command: dict):
+    """Codifica un comando o lote para la cámara (binario compacto o JSON)"""
+    if not BINARY_COMMANDS:
+        return json.dumps(command)
+
+    if command.get("type") == "batch":
+        entries = command["cmds"]
+        batch_id = command.get("id", 0)
+    else:
+        entries = [command]
+        batch_id = 0
+
+    packet = bytearray(struct.pack(CMD_HEADER_FORMAT, CMD_MAGIC, len(entries), batch_id))
+    for entry in entries:
+        value = str(entry.get("val", "")).encode()[:255]
+        packet += struct.pack(CMD_ENTRY_FORMAT, command_hash(entry["cmd"]), len(value))
+        packet += value
+    return bytes(packet)
 
 
 class FPSCounter:
@@ -96,7 +150,23 @@ class CameraWebSocketServer:
     def __init__(self):
         self.camera_client = None
         self.browser_clients: Set = set()
+        # Navegadores suscritos solo a la vista previa (subconjunto de browser_clients)
+        self.preview_clients: Set = set()
+        self.latest_preview = None
+        self.preview_mode_sent = None
         self.latest_frame = None
+        # Frames fuera del stream (snapshot, ventana de evento): el aviso
+        # JSON precede al frame
+        self.tagged_pending = None
+        # Cámara recién registrada que espera confirmación de su primer frame
+        self.first_frame_pending = None
+        # Sesiones de cámara: token → último frame confirmado, ajustes, última actividad
+        self.sessions = {}
+        self.session_token = None
+        self.batch_seq = 0  # Id de los lotes enviados a la cámara
+        self.latest_snapshot = None
+        # Ventanas pre-evento en curso: id de evento → carpeta de destino
+        self.events = {}
         self.frame_lock = threading.Lock()
 
         # Cola de comandos con prioridades
@@ -108,6 +178,31 @@ class CameraWebSocketServer:
             "frames_received": 0,
             "frames_chunked": 0,
             "frames_failed": 0,
+            "chunks_crc_errors": 0,
+            "chunks_retransmitted": 0,
+            "nacks_sent": 0,
+            "frames_partial": 0,
+            "frames_salvaged": 0,
+            "delta_frames": 0,
+            "delta_bytes_saved": 0,
+            "delta_resyncs": 0,
+            "previews_received": 0,
+            "preview_bytes": 0,
+            "preview_subscribers": 0,
+            "snapshots_received": 0,
+            "events_received": 0,
+            "event_frames": 0,
+            "event_frames_lost": 0,
+            "backfill_segments": 0,
+            "backfill_frames": 0,
+            "roi": None,
+            "wifi_connect": None,
+            "boot": None,
+            "reconnect": None,
+            "session_resumes": 0,
+            "mode_switches": [],
+            "bwcap": None,
+            "pacing": None,
             "total_bytes": 0,
             "fps": 0,
             "last_frame_time": None,
@@ -121,6 +216,18 @@ class CameraWebSocketServer:
         self.chunk_buffers = defaultdict(bytearray)
         self.chunk_metadata = {}
 
+        # Tablas DQT/DHT del stream abreviado (JPEG "solo tablas")
+        self.jpeg_tables = None
+        self.jpeg_tables_hash = None
+
+        # Modo delta: último frame completo y su división en intervalos RSTn
+        self.delta_base = None
+        self.delta_split = None
+        self.delta_seq = 0
+
+        # Probe sink: bytes recibidos por escalón de cada sonda activa
+        self.probes = {}
+
         # Contador FPS
         self.fps_counter = FPSCounter()
 
@@ -132,6 +239,7 @@ class CameraWebSocketServer:
     def get_stats(self) -> dict:
         """Obtiene estadísticas actualizadas"""
         self.stats["browsers_connected"] = len(self.browser_clients)
+        self.stats["preview_subscribers"] = len(self.preview_clients)
         self.stats["uptime"] = time.time() - self.stats["start_time"]
         self.stats["pending_commands"] = self.command_queue.size()
 
@@ -158,6 +266,7 @@ class CameraWebSocketServer:
                         logger.warning(f"⏱️ Timeout de chunking para {client_id}")
 
                 for client_id in to_remove:
+                    await self._salvage_slices(client_id)
                     self._cleanup_client_buffers(client_id)
                     self.stats["frames_failed"] += 1
 
@@ -174,8 +283,8 @@ class CameraWebSocketServer:
                     command = await self.command_queue.get()
                     if command:
                         try:
-                            await self.camera_client.send(json.dumps(command))
-                            cmd_name = command.get("cmd", "unknown")
+                            await self.camera_client.send(encode_command(command))
+                            cmd_name = command.get("cmd", command.get("type", "unknown"))
                             logger.info(f"✅ Comando enviado desde cola: {cmd_name}")
                         except Exception as e:
                             logger.error(f"❌ Error enviando comando desde cola: {e}")
@@ -221,11 +330,16 @@ class CameraWebSocketServer:
     ):
         """Maneja mensajes binarios (frames o chunks)"""
         try:
+            # Paquetes sintéticos de la sonda de ancho de banda
+            if client_id in self.probes and message[:1] == bytes([PROBE_MAGIC]):
+                self._handle_probe_packet(message, client_id)
+                return
+
             # Modo chunking activo
             if client_id in self.chunk_metadata:
                 metadata = self.chunk_metadata[client_id]
-                self.chunk_buffers[client_id].extend(message)
-                metadata["received"] += len(message)
+                if not self._store_chunk(message, client_id, metadata):
+                    return
 
                 # Log cada 20% de progreso para imágenes grandes
                 progress = (metadata["received"] / metadata["size"]) * 100
@@ -235,23 +349,36 @@ class CameraWebSocketServer:
                     )
 
                 # Verificar si se completó la imagen
-                if metadata["received"] >= metadata["size"]:
-                    full_image = bytes(
-                        self.chunk_buffers[client_id][: metadata["size"]]
-                    )
-                    await self._process_complete_image(
-                        full_image, websocket, client_id, client_ip
+                if len(metadata["chunks_ok"]) >= metadata["chunks"]:
+                    await self._complete_chunked_image(
+                        metadata, websocket, client_id, client_ip
                     )
-
-                    # Limpiar buffers
-                    self._cleanup_client_buffers(client_id)
+                elif metadata["slices"]:
+                    await self._send_partial_frame(client_id, metadata)
 
             # Modo normal: frame completo
             else:
+                # Substream de vista previa 1/8
+                if message[:1] == bytes([PREVIEW_MAGIC]):
+                    await self._handle_preview(message)
+                    return
+
+                # Frame delta: solo los intervalos RSTn que cambiaron
+                if message[:1] == bytes([DELTA_MAGIC]):
+                    await self._handle_delta(message, websocket, client_id, client_ip)
+                    return
+
+                # Actualización de tablas del stream abreviado
+                if jpeg_utils.is_tables_only(message):
+                    self.jpeg_tables = jpeg_utils.extract_tables(message)
+                    logger.info(f"📋 Tablas JPEG actualizadas ({len(message)} bytes)")
+                    return
+
                 # Validar JPEG
                 if len(message) > 2 and message[0] == 0xFF and message[1] == 0xD8:
+                    tagged, self.tagged_pending = self.tagged_pending, None
                     await self._process_complete_image(
-                        message, websocket, client_id, client_ip
+                        message, websocket, client_id, client_ip, tagged=tagged
                     )
                 else:
                     logger.warning(
@@ -276,18 +403,104 @@ class CameraWebSocketServer:
             if msg_type == "register":
                 await self._handle_register(data, websocket, client_id, client_ip)
 
+            # Reconexión con token de sesión (sustituye a register + info + health)
+            elif msg_type == "resume":
+                await self._handle_resume(data, websocket, client_id, client_ip)
+
             # Inicio de chunking
             elif msg_type == "img_start":
                 await self._handle_img_start(data, websocket, client_id)
 
             # Fin de chunking
             elif msg_type == "img_end":
-                await self._handle_img_end(data, client_id)
+                await self._handle_img_end(data, websocket, client_id)
+
+            # Sonda de ancho de banda
+            elif msg_type in ("probe_start", "probe_ping", "probe_end"):
+                await self._handle_probe_message(msg_type, data, websocket, client_id)
+
+            # Navegador cambia entre vista previa y frames completos
+            elif msg_type == "subscribe":
+                await self._handle_subscribe(data, websocket)
+
+            # Aviso de snapshot, frame de evento o de backfill (el frame llega a continuación)
+            elif msg_type in ("snapshot", "event_frame", "backfill_frame"):
+                self.tagged_pending = data
+
+            # Inicio/fin de la subida de una ventana pre-evento o de un hueco grabado
+            elif msg_type in ("event_start", "event_end", "backfill_start", "backfill_end"):
+                await self._handle_event_message(msg_type, data)
+
+            # Resultados del benchmark de escritura local
+            elif msg_type == "recbench":
+                self._log_recbench(data)
+
+            # Ventana ROI activa (los frames pequeños no llevan cabecera)
+            elif msg_type == "roi_status":
+                await self._update_roi(data.get("roi") if data.get("active") else None)
+
+            # Cambio de resolución confirmado que no validó con el primer frame
+            elif msg_type == "resolution_reverted":
+                logger.warning(
+                    f"⚠️ Resolución {data.get('requested')} ({data.get('requestedSize')}) revertida a "
+                    f"{data.get('restored')} ({data.get('restoredName')})"
+                )
+                if data.get("requested") == "roi":
+                    await self._update_roi(None)
+                await self._broadcast_to_browsers(json.dumps(data))
+
+            # Barrido de configuraciones del sensor (una fila por combinación)
+            elif msg_type in ("sensorbench_row", "sensorbench"):
+                self._log_sensorbench(msg_type, data)
+
+            # Tiempo de conexión → primer frame confirmado
+            elif msg_type == "reconnect":
+                self._log_reconnect(data)
+
+            # Línea de tiempo del arranque hasta el primer frame confirmado
+            elif msg_type == "boot_timeline":
+                self._log_boot_timeline(data)
+
+            # Presets guardados en la cámara
+            elif msg_type == "presets":
+                await self._log_presets(data)
+
+            # Tabla de perfiles de streaming con sus contadores
+            elif msg_type == "profiles":
+                await self._log_profiles(data)
+
+            # Cambio de modo decidido por la selección automática
+            elif msg_type == "mode_switch":
+                await self._log_mode_switch(data)
+
+            # Estado del tope de ancho de banda (comando bwcap status)
+            elif msg_type == "bwcap_status":
+                self._log_bwcap(data.get("bwcap", {}))
+
+            # Métricas de ráfaga del pacing (comando pace status)
+            elif msg_type == "pace_status":
+                self._log_pacing(data.get("pacing", {}))
+
+            # Configuración inicial de la cámara (incluye tiempos de conexión WiFi)
+            elif msg_type == "info":
+                self._log_camera_info(data)
+
+            # Aviso de tablas JPEG (el binario llega a continuación)
+            elif msg_type == "jpeg_tables":
+                self.jpeg_tables_hash = data.get("hash")
 
             # Comando para cámara
             elif msg_type == "command":
                 await self._handle_command(data, websocket)
 
+            # Varios ajustes aplicados de forma atómica en la cámara
+            elif msg_type == "batch":
+                await self._handle_batch(data, websocket)
+
+            # Resultado único de un lote
+            elif msg_type == "batch_result":
+                await self._log_batch_result(data)
+
             # Health check
             elif msg_type == "health":
                 await self._handle_health(data)
@@ -309,6 +522,51 @@ class CameraWebSocketServer:
         except Exception as e:
             logger.error(f"❌ Error procesando mensaje: {e}")
 
+    async def _handle_resume(self, data: dict, websocket, client_id: str, client_ip: str):
+        """Reanuda la sesión de la cámara en un solo intercambio"""
+        now = time.time()
+        for token in [t for t, sess in self.sessions.items() if now - sess["last_seen"] > SESSION_TTL]:
+            del self.sessions[token]
+
+        token = data.get("token")
+        session = self.sessions.get(token)
+        if session is None:
+            logger.info(f"🔁 Sesión desconocida o caducada: {client_id} se registrará de nuevo")
+            await websocket.send(json.dumps({"type": "session", "resumed": False}))
+            return
+
+        self.camera_client = websocket
+        self.session_token = token
+        self.stats["connected"] = True
+        self.stats["camera_ip"] = client_ip
+        self.stats["session_resumes"] += 1
+        self.first_frame_pending = websocket
+        session["settings"] = data.get("settings", {})
+        session["last_seen"] = now
+
+        # La cola de comandos pendientes se vacía sola al volver a haber cámara
+        await websocket.send(
+            json.dumps(
+                {
+                    "type": "session",
+                    "token": token,
+                    "resumed": True,
+                    "lastFrameId": session["last_frame_id"],
+                    "tablesHash": self.jpeg_tables_hash or 0,
+                    "pending": self.command_queue.size(),
+                }
+            )
+        )
+        logger.info(
+            f"🔁 Sesión reanudada: {client_id} | frame {session['last_frame_id']}/"
+            f"{data.get('lastFrameId')} | ajustes {session['settings']}"
+        )
+
+        await self._broadcast_to_browsers(
+            json.dumps({"type": "status", "camera_connected": True, "stats": self.stats})
+        )
+        await self._sync_preview_demand()
+
     async def _handle_register(
         self, data: dict, websocket, client_id: str, client_ip: str
     ):
@@ -321,6 +579,10 @@ class CameraWebSocketServer:
             self.stats["camera_ip"] = client_ip
             logger.info(f"📷 Cámara registrada: {client_id}")
 
+            # La cámara pudo reiniciarse: volver a pedir la vista previa
+            self.preview_mode_sent = None
+            self.first_frame_pending = websocket
+
             await websocket.send(
                 json.dumps(
                     {
@@ -331,6 +593,17 @@ class CameraWebSocketServer:
                 )
             )
 
+            # Nueva sesión: el token permite reanudar tras un corte breve
+            self.session_token = secrets.token_hex(8)
+            self.sessions[self.session_token] = {
+                "last_frame_id": 0,
+                "settings": {},
+                "last_seen": time.time(),
+            }
+            await websocket.send(
+                json.dumps({"type": "session", "token": self.session_token, "resumed": False})
+            )
+
             # Broadcast status a navegadores
             await self._broadcast_to_browsers(
                 json.dumps(
@@ -338,6 +611,8 @@ class CameraWebSocketServer:
                 )
             )
 
+            await self._sync_preview_demand()
+
             # Procesar comandos pendientes en la cola
             pending = self.command_queue.size()
             if pending > 0:
@@ -345,12 +620,20 @@ class CameraWebSocketServer:
 
         elif device == "browser":
             self.browser_clients.add(websocket)
-            logger.info(f"🌐 Navegador registrado: {client_id}")
+            preview = data.get("stream") == "preview"
+            if preview:
+                self.preview_clients.add(websocket)
+            logger.info(
+                f"🌐 Navegador registrado: {client_id}{' (solo vista previa)' if preview else ''}"
+            )
 
-            # Enviar último frame si existe
+            # Enviar último frame (o vista previa) si existe
             with self.frame_lock:
-                if self.latest_frame:
-                    await websocket.send(self.latest_frame)
+                latest = self.latest_preview if preview else self.latest_frame
+            if latest:
+                await websocket.send(latest)
+
+            await self._sync_preview_demand()
 
             # Enviar estado actual
             await websocket.send(
@@ -363,6 +646,83 @@ class CameraWebSocketServer:
                 )
             )
 
+    async def _handle_subscribe(self, data: dict, websocket):
+        """Cambia un navegador entre vista previa y frames completos"""
+        if websocket not in self.browser_clients:
+            return
+
+        if data.get("stream") == "preview":
+            self.preview_clients.add(websocket)
+        else:
+            self.preview_clients.discard(websocket)
+        await self._sync_preview_demand()
+
+    async def _sync_preview_demand(self):
+        """Pide a la cámara solo lo que los navegadores consumen: sin
+        suscriptores no hay vista previa; si nadie ve ni guarda frames completos,
+        la cámara envía solo la vista previa"""
+        full_viewers = len(self.browser_clients) - len(self.preview_clients)
+        if not self.preview_clients:
+            mode = "off"
+        elif full_viewers > 0 or image_saver.enabled:
+            mode = "on"
+        else:
+            mode = "only"
+
+        if mode == self.preview_mode_sent or not self.camera_client:
+            return
+        self.preview_mode_sent = mode
+        logger.info(f"🖼️ Vista previa: {mode} ({len(self.preview_clients)} suscriptores)")
+        await self._handle_command({"cmd": "preview", "val": mode}, None)
+
+    async def _handle_preview(self, message: bytes):
+        """Reenvía la vista previa 1/8 a los navegadores suscritos"""
+        header_size = struct.calcsize(PREVIEW_HEADER_FORMAT)
+        if len(message) < header_size:
+            return
+
+        _, header_len, fmt, _, width, height, _ = struct.unpack_from(
+            PREVIEW_HEADER_FORMAT, message
+        )
+        payload = message[header_len:]
+
+        if fmt == PREVIEW_FORMAT_RAW:
+            if len(payload) != width * height:
+                logger.warning(f"⚠️ Vista previa raw con tamaño inválido ({len(payload)} bytes)")
+                return
+            image = self._gray_to_bmp(width, height, payload)
+        else:
+            image = payload
+
+        self.stats["previews_received"] += 1
+        self.stats["preview_bytes"] += len(message)
+
+        with self.frame_lock:
+            self.latest_preview = image
+
+        for browser in list(self.preview_clients):
+            try:
+                await browser.send(image)
+            except Exception:
+                self.preview_clients.discard(browser)
+
+    @staticmethod
+    def _gray_to_bmp(width: int, height: int, pixels: bytes) -> bytes:
+        """Gris 8 bits → BMP con paleta (los navegadores lo muestran directo)"""
+        row_size = (width + 3) & ~3
+        palette = b"".join(bytes((i, i, i, 0)) for i in range(256))
+        offset = 14 + 40 + len(palette)
+        padding = b"\x00" * (row_size - width)
+        # BMP guarda las filas de abajo hacia arriba
+        rows = b"".join(
+            pixels[y * width : (y + 1) * width] + padding for y in range(height - 1, -1, -1)
+        )
+        file_header = struct.pack("<2sIHHI", b"BM", offset + len(rows), 0, 0, offset)
+        info_header = struct.pack(
+            "<IiiHHIIiiII", 40, width, height, 1, 8, 0, len(rows), 2835, 2835, 256, 0
+        )
+        return file_header + info_header + palette + rows
+
     async def _handle_img_start(self, data: dict, websocket, client_id: str):
         """Maneja inicio de transferencia chunked"""
         size = data.get("size", 0)
@@ -372,14 +732,30 @@ class CameraWebSocketServer:
             # Limpiar buffer anterior si existe
             if client_id in self.chunk_buffers:
                 logger.warning(f"⚠️ Limpiando buffer previo para {client_id}")
+                await self._salvage_slices(client_id)
                 self._cleanup_client_buffers(client_id)
 
-            self.chunk_buffers[client_id] = bytearray()
+            tagged, self.tagged_pending = self.tagged_pending, None
+            if tagged is None:
+                await self._update_roi(data.get("roi"))
+            self.chunk_buffers[client_id] = bytearray(size)
             self.chunk_metadata[client_id] = {
+                "id": data.get("id", 0),
                 "size": size,
                 "chunks": chunks,
                 "received": 0,
+                "chunks_ok": set(),
                 "start_time": time.time(),
+                "tagged": tagged,
+                # Chunks por franjas: rango de bytes de cada índice recibido
+                # (un frame fuera del stream no se muestra por franjas)
+                "slices": bool(data.get("slices", False)) and tagged is None,
+                "mcu_rows": data.get("mcuRows", 0),
+                "slice_ranges": {},
+                "prefix_chunks": 0,
+                "prefix_end": 0,
+                "prefix_row": 0,
+                "last_partial": 0.0,
             }
 
             self.stats["frames_chunked"] += 1
@@ -391,18 +767,283 @@ class CameraWebSocketServer:
                 )
             )
 
-    async def _handle_img_end(self, data: dict, client_id: str):
-        """Maneja fin de transferencia chunked"""
-        if client_id in self.chunk_metadata:
-            size = data.get("size", 0)
-            success = data.get("success", False)
+    async def _handle_img_end(self, data: dict, websocket, client_id: str):
+        """Maneja fin de transferencia chunked: NACK selectivo de chunks perdidos"""
+        metadata = self.chunk_metadata.get(client_id)
+        if metadata is None or data.get("id") != metadata["id"]:
+            return
 
-            if success:
-                logger.info(f"✅ Transferencia chunked completada: {size/1024:.1f}KB")
-            else:
-                logger.warning(f"⚠️ Transferencia chunked fallida")
-                self._cleanup_client_buffers(client_id)
-                self.stats["frames_failed"] += 1
+        size = data.get("size", 0)
+        success = data.get("success", False)
+
+        if not success:
+            logger.warning(f"⚠️ Transferencia chunked fallida")
+            await self._salvage_slices(client_id)
+            self._cleanup_client_buffers(client_id)
+            self.stats["frames_failed"] += 1
+            return
+
+        missing = [
+            i for i in range(metadata["chunks"]) if i not in metadata["chunks_ok"]
+        ]
+        if not missing:
+            logger.info(f"✅ Transferencia chunked completada: {size/1024:.1f}KB")
+            return
+
+        # Pedir solo los chunks perdidos o corruptos
+        missing = missing[:NACK_MAX_INDICES]
+        metadata["start_time"] = time.time()
+        self.stats["nacks_sent"] += 1
+        logger.warning(
+            f"🔁 NACK frame #{metadata['id']}: {len(missing)} chunks perdidos"
+        )
+        await websocket.send(
+            json.dumps({"type": "img_nack", "id": metadata["id"], "missing": missing})
+        )
+
+    def _store_chunk(self, message: bytes, client_id: str, metadata: dict) -> bool:
+        """Valida cabecera y CRC32 de un chunk y lo copia a su offset"""
+        header_size = struct.calcsize(CHUNK_HEADER_FORMAT)
+        if len(message) < header_size or message[0] != CHUNK_MAGIC:
+            logger.warning(f"⚠️ Chunk sin cabecera válida ({len(message)} bytes)")
+            return False
+
+        (
+            _,
+            header_len,
+            flags,
+            _,
+            frame_id,
+            offset,
+            index,
+            _,
+            crc,
+            _,
+            _,
+            _,
+            row_end,
+        ) = struct.unpack_from(CHUNK_HEADER_FORMAT, message)
+        payload = message[header_len:]
+
+        if frame_id != metadata["id"] or offset + len(payload) > metadata["size"]:
+            logger.warning(f"⚠️ Chunk fuera de frame (id={frame_id}, offset={offset})")
+            return False
+
+        if zlib.crc32(payload) & 0xFFFFFFFF != crc:
+            self.stats["chunks_crc_errors"] += 1
+            logger.warning(f"⚠️ CRC inválido en chunk #{index} del frame #{frame_id}")
+            return False
+
+        if flags & CHUNK_FLAG_RETRANSMIT:
+            self.stats["chunks_retransmitted"] += 1
+
+        if index not in metadata["chunks_ok"]:
+            self.chunk_buffers[client_id][offset : offset + len(payload)] = payload
+            metadata["chunks_ok"].add(index)
+            metadata["received"] += len(payload)
+            if flags & CHUNK_FLAG_SLICE:
+                metadata["slice_ranges"][index] = (offset, offset + len(payload), row_end)
+        return True
+
+    async def _send_partial_frame(self, client_id: str, metadata: dict):
+        """Muestra en navegadores las franjas contiguas recibidas hasta ahora"""
+        ranges = metadata["slice_ranges"]
+        advanced = False
+        while metadata["prefix_chunks"] in ranges:
+            _, end, row_end = ranges[metadata["prefix_chunks"]]
+            metadata["prefix_end"] = end
+            metadata["prefix_row"] = row_end + 1
+            metadata["prefix_chunks"] += 1
+            advanced = True
+
+        now = time.time()
+        if (
+            not advanced
+            or not self.browser_clients
+            or now - metadata["last_partial"] < PROGRESSIVE_MIN_INTERVAL
+        ):
+            return
+        metadata["last_partial"] = now
+
+        # Cabecera + franjas completas + EOI: el decodificador pinta esas filas
+        partial = bytes(self.chunk_buffers[client_id][: metadata["prefix_end"]])
+        partial = jpeg_utils.reconstitute(partial + b"\xff\xd9", self.jpeg_tables)
+        self.stats["frames_partial"] += 1
+        await self._broadcast_to_browsers(
+            json.dumps(
+                {
+                    "type": "frame_partial",
+                    "rows": metadata["prefix_row"],
+                    "of": metadata["mcu_rows"],
+                }
+            ),
+            full_only=True,
+        )
+        await self._broadcast_to_browsers(partial)
+
+    async def _salvage_slices(self, client_id: str):
+        """Frame por franjas incompleto: mostrar lo recibido (solo se pierden
+        las filas de los chunks que faltan; el decodificador resincroniza en RSTn)"""
+        metadata = self.chunk_metadata.get(client_id)
+        if not metadata or not metadata["slices"] or 0 not in metadata["slice_ranges"]:
+            return
+
+        buffer = self.chunk_buffers[client_id]
+        ranges = metadata["slice_ranges"]
+        image = b"".join(
+            bytes(buffer[start:end]) for _, (start, end, _) in sorted(ranges.items())
+        )
+        if not image.endswith(b"\xff\xd9"):
+            image += b"\xff\xd9"
+
+        lost = metadata["chunks"] - len(ranges)
+        self.stats["frames_salvaged"] += 1
+        logger.warning(
+            f"🩹 Frame #{metadata['id']} incompleto: mostrando {len(ranges)}/{metadata['chunks']} franjas ({lost} perdidas)"
+        )
+        with self.frame_lock:
+            self.latest_frame = jpeg_utils.reconstitute(image, self.jpeg_tables)
+        await self._broadcast_to_browsers(self.latest_frame)
+
+    async def _complete_chunked_image(
+        self, metadata: dict, websocket, client_id: str, client_ip: str
+    ):
+        """Confirma (ACK) y procesa un frame chunked con todos sus chunks válidos"""
+        full_image = bytes(self.chunk_buffers[client_id])
+        frame_id = metadata["id"]
+
+        # Limpiar buffers
+        self._cleanup_client_buffers(client_id)
+
+        # ACK inmediato: el firmware libera el frame sin esperar más
+        await websocket.send(json.dumps({"type": "img_complete", "id": frame_id}))
+        if self.session_token in self.sessions:
+            self.sessions[self.session_token]["last_frame_id"] = frame_id
+
+        if full_image[:1] == bytes([DELTA_MAGIC]):
+            await self._handle_delta(full_image, websocket, client_id, client_ip)
+        else:
+            await self._process_complete_image(
+                full_image,
+                websocket,
+                client_id,
+                client_ip,
+                tagged=metadata.get("tagged"),
+            )
+
+    async def _handle_delta(
+        self, message: bytes, websocket, client_id: str, client_ip: str
+    ):
+        """Parchea el último frame con los intervalos RSTn del delta"""
+        header_size = struct.calcsize(DELTA_HEADER_FORMAT)
+        run_size = struct.calcsize(DELTA_RUN_FORMAT)
+        if len(message) < header_size:
+            return
+
+        _, header_len, intervals, seq, runs, _ = struct.unpack_from(
+            DELTA_HEADER_FORMAT, message
+        )
+
+        if self.delta_split is None and self.delta_base is not None:
+            self.delta_split = jpeg_utils.split_restart_intervals(self.delta_base)
+
+        # Referencia perdida o delta intermedio perdido: pedir keyframe
+        if (
+            self.delta_split is None
+            or len(self.delta_split[1]) != intervals
+            or seq != self.delta_seq + 1
+        ):
+            self.stats["delta_resyncs"] += 1
+            logger.warning(
+                f"🔑 Delta #{seq} sin referencia válida - solicitando keyframe"
+            )
+            self.delta_split = None
+            self.delta_base = None
+            await websocket.send(json.dumps({"type": "keyframe_request"}))
+            return
+
+        header, reference = self.delta_split
+        patched = list(reference)
+        pos = header_len
+        try:
+            for _ in range(runs):
+                first, count, length = struct.unpack_from(DELTA_RUN_FORMAT, message, pos)
+                pos += run_size
+                data = message[pos : pos + length]
+                pos += length
+                if first + count > intervals or len(data) != length:
+                    raise ValueError("run fuera de rango")
+
+                # Los intervalos de la racha van contiguos: separarlos por sus RSTn
+                bounds = [0] + [
+                    m.end() for m in jpeg_utils.RST_PATTERN.finditer(data)
+                ]
+                if len(bounds) < count:
+                    raise ValueError("run con menos intervalos de los declarados")
+                bounds = bounds[:count] + [length]
+                for k in range(count):
+                    patched[first + k] = data[bounds[k] : bounds[k + 1]]
+        except (struct.error, ValueError) as e:
+            logger.warning(f"⚠️ Delta #{seq} inválido: {e}")
+            self.delta_split = None
+            self.delta_base = None
+            await websocket.send(json.dumps({"type": "keyframe_request"}))
+            return
+
+        image = jpeg_utils.join_restart_intervals(header, patched)
+        self.delta_split = (header, patched)
+        self.delta_seq = seq
+        self.stats["delta_frames"] += 1
+        self.stats["delta_bytes_saved"] += max(0, len(image) - len(message))
+
+        await self._process_complete_image(
+            image, websocket, client_id, client_ip, is_delta=True
+        )
+
+    async def _handle_probe_message(
+        self, msg_type: str, data: dict, websocket, client_id: str
+    ):
+        """Probe sink: cuenta bytes por escalón, responde pings y reporta"""
+        probe_id = data.get("id", 0)
+
+        if msg_type == "probe_start":
+            # "steps" es el máximo: la sonda para antes si el enlace satura
+            steps = data.get("steps", 0)
+            self.probes[client_id] = {"id": probe_id, "received": [0] * steps}
+            logger.info(
+                f"📡 Sonda #{probe_id}: hasta {steps} escalones de {data.get('stepMs', 0)}ms"
+            )
+
+        elif msg_type == "probe_ping":
+            # Eco inmediato para medir RTT en el dispositivo
+            await websocket.send(
+                json.dumps(
+                    {"type": "probe_pong", "id": probe_id, "seq": data.get("seq", 0)}
+                )
+            )
+
+        elif msg_type == "probe_end":
+            probe = self.probes.pop(client_id, None)
+            if probe is None or probe["id"] != probe_id:
+                return
+            sent = data.get("sent", [])
+            received = probe["received"][: len(sent)]
+            logger.info(f"📡 Sonda #{probe_id}: enviados={sent} recibidos={received}")
+            await websocket.send(
+                json.dumps(
+                    {"type": "probe_report", "id": probe_id, "received": received}
+                )
+            )
+
+    def _handle_probe_packet(self, message: bytes, client_id: str):
+        """Acumula bytes de un paquete sintético en su escalón"""
+        header_size = struct.calcsize(PROBE_HEADER_FORMAT)
+        if len(message) < header_size:
+            return
+        _, step, _, probe_id, _ = struct.unpack_from(PROBE_HEADER_FORMAT, message)
+        probe = self.probes[client_id]
+        if probe_id == probe["id"] and step < len(probe["received"]):
+            probe["received"][step] += len(message)
 
     async def _handle_command(self, data: dict, websocket):
         """Maneja comandos para la cámara con sistema de prioridades"""
@@ -429,7 +1070,7 @@ class CameraWebSocketServer:
             if priority == PRIORITY_CRITICAL:
                 # Comandos críticos se envían INMEDIATAMENTE
                 try:
-                    await self.camera_client.send(json.dumps(command))
+                    await self.camera_client.send(encode_command(command))
                     logger.warning(f"🔴 Comando crítico enviado inmediatamente: {cmd}")
                 except Exception as e:
                     logger.error(f"❌ Error enviando comando crítico: {e}")
@@ -438,7 +1079,7 @@ class CameraWebSocketServer:
             else:
                 # Comandos normales se envían directamente
                 try:
-                    await self.camera_client.send(json.dumps(command))
+                    await self.camera_client.send(encode_command(command))
                     logger.info(f"⚡ Comando enviado: {cmd}={val}")
                 except Exception as e:
                     logger.error(f"❌ Error enviando comando: {e}")
@@ -451,9 +1092,83 @@ class CameraWebSocketServer:
             else:
                 logger.info(f"📋 Comando encolado: {cmd}={val} (prioridad: {priority})")
 
+    async def _handle_batch(self, data: dict, websocket):
+        """Envía varios ajustes en un solo mensaje (la cámara los aplica todos o ninguno)"""
+        cmds = []
+        for item in data.get("cmds", []):
+            cmd = str(item.get("cmd", "")).lower()
+            if cmd not in BATCH_COMMANDS:
+                await websocket.send(
+                    json.dumps({"type": "batch_result", "id": data.get("id", 0), "status": "error",
+                                "applied": 0, "error": f"{cmd} no admitido en lotes"})
+                )
+                return
+            cmds.append({"cmd": cmd, "val": str(item.get("val", ""))})
+
+        if not cmds or len(cmds) > CMD_BATCH_MAX:
+            await websocket.send(
+                json.dumps({"type": "batch_result", "id": data.get("id", 0), "status": "error",
+                            "applied": 0, "error": f"entre 1 y {CMD_BATCH_MAX} comandos"})
+            )
+            return
+
+        self.batch_seq = self.batch_seq % 0xFFFF + 1
+        batch = {"type": "batch", "id": self.batch_seq, "cmds": cmds, "timestamp": time.time()}
+        priority = min(COMMANDS.get(c["cmd"], {}).get("priority", PRIORITY_NORMAL) for c in cmds)
+
+        if self.camera_client and self.camera_client != websocket:
+            try:
+                await self.camera_client.send(encode_command(batch))
+                logger.info(f"⚡ Lote #{batch['id']} enviado: {len(cmds)} ajustes")
+                return
+            except Exception as e:
+                logger.error(f"❌ Error enviando lote: {e}")
+
+        await self.command_queue.add(batch, priority)
+        logger.info(f"📋 Lote #{batch['id']} encolado: {len(cmds)} ajustes (prioridad: {priority})")
+
+    async def _log_batch_result(self, data: dict):
+        """Respuesta única de un lote: aplicado completo o revertido"""
+        if data.get("status") == "ok":
+            logger.info(f"✅ Lote #{data.get('id')}: {data.get('applied')} ajustes aplicados")
+        else:
+            logger.warning(
+                f"⚠️ Lote #{data.get('id')} revertido tras {data.get('applied', 0)} ajustes: {data.get('error')}"
+            )
+        await self._broadcast_to_browsers(json.dumps(data))
+
     async def _handle_health(self, data: dict):
         """Maneja health check de la cámara"""
-        logger.info(f"💚 Health check: Frames={data.get('frames', 0)}")
+        logger.info(
+            f"💚 Health check: Frames={data.get('frames', 0)} | "
+            f"FPS={data.get('fpsActual', 0)}/{data.get('fpsTarget', 0)} | "
+            f"jitter p95={data.get('jitterP95', 0)}µs | saltados={data.get('skipped', 0)}"
+        )
+
+        link = data.get("link")
+        if link:
+            logger.info(
+                f"📶 Enlace: {link.get('score')}/100 | RSSI {link.get('rssi')}dBm | "
+                f"PHY {link.get('phyMbps')}Mbps | RTT {link.get('rttMs')}ms | "
+                f"goodput {link.get('goodputKBps')}KB/s | "
+                f"retx {link.get('retransPerSec')}/s | dupACK {link.get('dupAcksPerSec')}/s"
+            )
+
+        bwcap = data.get("bwcap")
+        if bwcap and bwcap.get("rate"):
+            self._log_bwcap(bwcap)
+
+        pacing = data.get("pacing")
+        if pacing and pacing.get("frames"):
+            self._log_pacing(pacing)
+
+        governor = data.get("governor")
+        if governor and governor.get("enabled"):
+            logger.info(
+                f"🧭 Modo auto: {governor.get('mode')} | éxito {governor.get('success', 0) * 100:.0f}% | "
+                f"variabilidad {governor.get('cv')} | {governor.get('switches')} cambios | "
+                f"espera para subir {governor.get('upDwellMs', 0) // 1000}s"
+            )
 
         # Broadcast a navegadores
         health_msg = json.dumps(
@@ -467,10 +1182,19 @@ class CameraWebSocketServer:
         await self._broadcast_to_browsers(health_msg)
 
     async def _process_complete_image(
-        self, image_data: bytes, websocket, client_id: str, client_ip: str
+        self,
+        image_data: bytes,
+        websocket,
+        client_id: str,
+        client_ip: str,
+        is_delta: bool = False,
+        tagged: Optional[dict] = None,
     ):
         """Procesa una imagen JPEG completa"""
         try:
+            # JPEG abreviado: reinsertar las tablas cacheadas
+            image_data = jpeg_utils.reconstitute(image_data, self.jpeg_tables)
+
             # Validar que sea JPEG completo
             if len(image_data) < 100:
                 logger.warning(f"⚠️ Imagen demasiado pequeña: {len(image_data)} bytes")
@@ -495,6 +1219,20 @@ class CameraWebSocketServer:
                 self.stats["frames_failed"] += 1
                 return
 
+            # Snapshot o frame de evento: no es frame del stream ni referencia delta
+            if tagged is not None:
+                if tagged.get("type") in ("event_frame", "backfill_frame"):
+                    self._handle_event_frame(image_data, tagged)
+                else:
+                    await self._handle_snapshot(image_data, tagged)
+                return
+
+            # Cada frame completo es el nuevo keyframe de referencia del modo delta
+            if not is_delta:
+                self.delta_base = image_data
+                self.delta_split = None
+                self.delta_seq = 0
+
             # Auto-registrar cámara si no está registrada
             if self.camera_client != websocket:
                 self.camera_client = websocket
@@ -508,6 +1246,11 @@ class CameraWebSocketServer:
             self.stats["fps"] = self.fps_counter.tick()
             self.stats["last_frame_time"] = datetime.now().isoformat()
 
+            # Primer frame tras el registro: la cámara cierra su línea de tiempo de arranque
+            if self.first_frame_pending is websocket:
+                self.first_frame_pending = None
+                await websocket.send(json.dumps({"type": "first_frame_ack"}))
+
             # Guardar frame más reciente
             with self.frame_lock:
                 self.latest_frame = image_data
@@ -538,11 +1281,229 @@ class CameraWebSocketServer:
             logger.error(f"❌ Error procesando imagen: {e}")
             self.stats["frames_failed"] += 1
 
-    async def _broadcast_to_browsers(self, data):
-        """Envía datos a todos los navegadores conectados"""
+    async def _handle_snapshot(self, image_data: bytes, info: dict):
+        """Guarda siempre el snapshot y avisa a los navegadores"""
+        self.stats["snapshots_received"] += 1
+        with self.frame_lock:
+            self.latest_snapshot = image_data
+
+        saved_path = image_saver.save_image(image_data, force=True)
+        logger.info(
+            f"📸 Snapshot #{info.get('seq')} {info.get('width')}x{info.get('height')} "
+            f"({len(image_data)/1024:.1f}KB, cambio {info.get('switchMs')}ms)"
+        )
+
+        await self._broadcast_to_browsers(
+            json.dumps(
+                {
+                    "type": "snapshot",
+                    "seq": info.get("seq"),
+                    "width": info.get("width"),
+                    "height": info.get("height"),
+                    "size": len(image_data),
+                    "saved": saved_path.name if saved_path else None,
+                    "timestamp": time.time(),
+                }
+            )
+        )
+
+    async def _handle_event_message(self, msg_type: str, data: dict):
+        """Inicio/fin de una ventana pre-evento o de un hueco grabado sin
+        conexión (backfill); se reenvía a los navegadores"""
+        kind, phase = msg_type.split("_")
+        key = (kind, data.get("event"))
+        if phase == "start":
+            self.stats["events_received" if kind == "event" else "backfill_segments"] += 1
+            self.events[key] = image_saver.new_event_dir(kind, data.get("event"))
+            if kind == "event":
+                logger.info(
+                    f"🚨 Evento #{key[1]} ({data.get('reason')}): {data.get('frames')} frames, "
+                    f"{data.get('bytes', 0)/1024:.1f}KB, {data.get('spanMs')}ms de historial"
+                )
+            else:
+                logger.info(
+                    f"⏫ Backfill de hueco #{key[1]}: {data.get('frames')} frames "
+                    f"{data.get('width')}x{data.get('height')}"
+                )
+        else:
+            self.stats["event_frames_lost"] += data.get("lost", 0)
+            path = self.events.pop(key, None)
+            logger.info(
+                f"✅ {kind} #{key[1]} recibido: {data.get('sent')} frames, "
+                f"{data.get('lost')} perdidos → {path}"
+            )
+
+        await self._broadcast_to_browsers(json.dumps(data))
+
+    def _handle_event_frame(self, image_data: bytes, info: dict):
+        """Guarda un frame de una ventana pre-evento o de un backfill en su carpeta"""
+        kind = info.get("type", "event_frame").split("_")[0]
+        key = (kind, info.get("event"))
+        if key not in self.events:
+            # *_start perdido (p.ej. reconexión a mitad de la subida)
+            self.events[key] = image_saver.new_event_dir(kind, key[1])
+
+        if kind == "event":
+            self.stats["event_frames"] += 1
+            name = f"{info.get('index', 0):04d}_{info.get('ageMs', 0)}ms_antes.jpg"
+        else:
+            self.stats["backfill_frames"] += 1
+            name = f"{info.get('index', 0):05d}_{info.get('ms', 0)}ms.jpg"
+        image_saver.save_event_frame(self.events[key], name, image_data)
+
+    async def _update_roi(self, roi):
+        """Ventana del sensor [x, y, w, h, outW, outH] del stream; avisa a los
+        navegadores solo cuando cambia"""
+        if roi == self.stats.get("roi"):
+            return
+        self.stats["roi"] = roi
+        if roi:
+            logger.info(f"🔍 ROI {roi[2]}x{roi[3]} en ({roi[0]},{roi[1]}) → {roi[4]}x{roi[5]}")
+        else:
+            logger.info("🔍 ROI desactivada")
+        await self._broadcast_to_browsers(json.dumps({"type": "roi", "roi": roi}))
+
+    def _log_reconnect(self, data: dict):
+        """Tiempo desde la conexión hasta el primer frame confirmado"""
+        self.stats["reconnect"] = data
+        logger.info(
+            f"⏱️ Conexión → primer frame: {data.get('firstFrameMs')}ms "
+            f"({'sesión reanudada' if data.get('resumed') else 'registro completo'}, "
+            f"frames perdidos {data.get('framesLost', 0)})"
+        )
+
+    def _log_boot_timeline(self, data: dict):
+        """Etapas del arranque de la cámara (ms desde el reset)"""
+        boot = data.get("boot") or {}
+        self.stats["boot"] = boot
+        logger.info(f"⏱️ Arranque de la cámara: {boot.get('totalMs')}ms hasta el primer frame confirmado")
+        previous = 0
+        for name, ms in boot.get("stages", []):
+            logger.info(f"   {name:<14} {ms:>5}ms  (+{ms - previous}ms)")
+            previous = ms
+
+    async def _log_presets(self, data: dict):
+        """Presets guardados en la NVS de la cámara"""
+        self.stats["presets"] = data
+        names = ", ".join(p.get("name", "?") for p in data.get("presets", []))
+        logger.info(
+            f"🎛️ Presets ({len(data.get('presets', []))}/{data.get('max')}): {names or '-'} | "
+            f"activo: {data.get('active') or '-'} | arranque: {data.get('boot') or '-'}"
+        )
+        await self._broadcast_to_browsers(json.dumps(data))
+
+    async def _log_profiles(self, data: dict):
+        """Perfiles de streaming de la cámara y su rendimiento"""
+        self.stats["profiles"] = data
+        active = data.get("active")
+        for profile in data.get("profiles", []):
+            stats = profile.get("stats", {})
+            logger.info(
+                f"{'▶' if profile.get('id') == active else ' '} {profile.get('name'):<16} "
+                f"chunks {profile.get('chunks')} | pausas {profile.get('gap')}/{profile.get('header')}ms | "
+                f"pace {profile.get('pace') or '-'} KB/s | q {profile.get('qmin')}-{profile.get('qmax')} | "
+                f"{stats.get('frames', 0)} frames, {stats.get('failures', 0)} fallos, "
+                f"{stats.get('avgMs', 0)}ms, {stats.get('kbps', 0)} KB/s"
+            )
+        await self._broadcast_to_browsers(json.dumps(data))
+
+    def _log_bwcap(self, bwcap: dict):
+        """Tope de ancho de banda: presupuesto, exceso y frames descartados"""
+        self.stats["bwcap"] = bwcap
+        if not bwcap.get("rate"):
+            logger.info(f"🪣 Sin tope de ancho de banda | enviado {bwcap.get('sentKB', 0)} KB")
+            return
+        logger.info(
+            f"🪣 Tope {bwcap.get('rate', 0) // 1024} KB/s (ráfaga {bwcap.get('burst', 0) // 1024} KB) | "
+            f"saldo {bwcap.get('tokens', 0)} B | enviado {bwcap.get('sentKB', 0)} KB | "
+            f"exceso {bwcap.get('overBudget', 0)} B | {bwcap.get('deferred', 0)} frames descartados"
+        )
+
+    def _log_pacing(self, pacing: dict):
+        """Patrón de envío de chunks: regularidad, ráfagas y cola de latencia"""
+        self.stats["pacing"] = pacing
+        mode = pacing.get("mode")
+        if mode == "spread":
+            mode = f"repartido {pacing.get('spreadPct')}% a {pacing.get('rateKBps')} KB/s"
+        else:
+            mode = "ráfaga"
+        logger.info(
+            f"⏱️ Pacing {mode} | huecos cv {pacing.get('gapCv')} | "
+            f"pico/media {pacing.get('peakToMean')} | ráfaga máx {pacing.get('maxBurstKB')} KB | "
+            f"retraso {pacing.get('lateUs')}µs | ocupación {pacing.get('dutyPct')}% | "
+            f"transferencia p50/p95/p99 {pacing.get('transferP50')}/{pacing.get('transferP95')}/"
+            f"{pacing.get('transferP99')}ms"
+        )
+
+    async def _log_mode_switch(self, data: dict):
+        """Cambio automático de modo con el motivo y las métricas que lo causaron"""
+        data["time"] = datetime.now().isoformat()
+        history = self.stats["mode_switches"]
+        history.append(data)
+        del history[:-MODE_SWITCH_HISTORY]
+
+        arrow = "⬆️" if data.get("direction") == "up" else "⬇️"
+        logger.info(
+            f"🧭 {arrow} Modo {data.get('from')} → {data.get('to')}: {data.get('reason')} | "
+            f"éxito {data.get('success', 0) * 100:.0f}% | variabilidad {data.get('cv')} | "
+            f"enlace {data.get('linkScore')}/100"
+        )
+        await self._broadcast_to_browsers(json.dumps(data))
+
+    def _log_camera_info(self, data: dict):
+        """Ruta y tiempos de la conexión WiFi con la que arrancó la cámara"""
+        wifi = data.get("wifi")
+        if not wifi:
+            return
+        self.stats["wifi_connect"] = wifi
+        logger.info(
+            f"📶 WiFi {wifi.get('ssid')} por {wifi.get('path')} (canal {wifi.get('channel')}): "
+            f"asociación {wifi.get('assocMs')}ms, IP {wifi.get('ipMs')}ms, "
+            f"total {wifi.get('totalMs')}ms"
+        )
+
+    def _log_sensorbench(self, msg_type: str, data: dict):
+        """Filas y resumen del benchmark del sensor"""
+        if msg_type == "sensorbench_row":
+            logger.info(
+                f"   res {data.get('res'):>2} | {data.get('xclkMHz')}MHz | {data.get('fb')} fb | "
+                f"{data.get('grab'):<10} | {data.get('fps')} fps | "
+                f"{data.get('minKB')}/{data.get('p50KB')}/{data.get('p95KB')}/{data.get('maxKB')}KB | "
+                f"timeouts {data.get('timeouts')} | corruptos {data.get('corrupt')} | "
+                f"overflows {data.get('overflows')}{'' if data.get('stable') else ' | ✗'}"
+            )
+            return
+
+        best = data.get("best")
+        if best:
+            logger.info(
+                f"🏆 Sensor en res {data.get('res')}: XCLK {best.get('xclkMHz')}MHz, "
+                f"{best.get('fb')} buffers, {best.get('grab')} → {best.get('fps')} fps"
+                f"{' (aplicada)' if data.get('applied') else ''}"
+            )
+        else:
+            logger.warning(f"⚠️ Sensorbench: ninguna combinación estable ({data.get('combos')} probadas)")
+
+    def _log_recbench(self, data: dict):
+        """Tabla del benchmark de escritura sostenida por resolución"""
+        logger.info(f"🏁 Benchmark de grabación ({data.get('storage', '?')}):")
+        for row in data.get("results", []):
+            logger.info(
+                f"   res {row.get('res'):>2} | {row.get('avgKB')}KB/frame | "
+                f"{row.get('writeKBps')}KB/s | máx {row.get('writeFps')} fps | "
+                f"real {row.get('captureFps')} fps"
+            )
+
+    async def _broadcast_to_browsers(self, data, full_only: Optional[bool] = None):
+        """Envía datos a todos los navegadores conectados. Los frames (binarios)
+        no van a los suscritos solo a la vista previa"""
+        if full_only is None:
+            full_only = isinstance(data, bytes)
         disconnected = []
 
         for browser in list(self.browser_clients):
+            if full_only and browser in self.preview_clients:
+                continue
             try:
                 await browser.send(data)
             except Exception:
@@ -551,6 +1512,7 @@ class CameraWebSocketServer:
         # Limpiar desconectados
         for client in disconnected:
             self.browser_clients.discard(client)
+            self.preview_clients.discard(client)
 
     def _cleanup_client_buffers(self, client_id: str):
         """Limpia buffers de chunking para un cliente"""
@@ -563,11 +1525,14 @@ class CameraWebSocketServer:
         """Limpia recursos al desconectar"""
         # Limpiar buffers
         self._cleanup_client_buffers(client_id)
+        self.probes.pop(client_id, None)
 
         # Limpiar registro
         if websocket == self.camera_client:
             logger.warning("📷 Cámara desconectada")
             self.camera_client = None
+            if self.session_token in self.sessions:
+                self.sessions[self.session_token]["last_seen"] = time.time()
             self.stats["connected"] = False
             self.stats["camera_ip"] = None
 
@@ -580,9 +1545,11 @@ class CameraWebSocketServer:
 
         if websocket in self.browser_clients:
             self.browser_clients.discard(websocket)
+            self.preview_clients.discard(websocket)
             logger.info(
                 f"🌐 Navegador desconectado (activos: {len(self.browser_clients)})"
             )
+            await self._sync_preview_demand()
 
     async def start_server(self):
         """Inicia el servidor WebSocket"""
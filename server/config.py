@@ -57,13 +57,13 @@ COMMANDS = {
         "type": "int",
         "range": (1, 30),
         "priority": 1,  # HIGH
-        "description": "Frames por segundo"
+        "description": "Frames por segundo (status: FPS entregado, jitter y slots saltados)"
     },
     "mode": {
         "type": "int",
-        "range": (0, 1),
+        "range": (0, 7),
         "priority": 1,  # HIGH
-        "description": "0=Velocidad, 1=Estabilidad"
+        "description": "Perfil de streaming: 0=Velocidad, 1=Estabilidad, 2=Baja latencia, 3=Archivo, 4=Enlace con cuota (o nombre); auto=elegir según la salud de las transferencias"
     },
     "reboot": {
         "type": "trigger",
@@ -98,6 +98,91 @@ COMMANDS = {
         "range": (-2, 2),
         "priority": 2,  # NORMAL
         "description": "Saturación"
+    },
+    "probe": {
+        "type": "string",
+        "priority": 2,  # NORMAL
+        "description": "Sonda de ancho de banda ('' = medir y aplicar, 'dry', o ms)"
+    },
+    "abbrev": {
+        "type": "int",
+        "range": (0, 1),
+        "priority": 2,  # NORMAL
+        "description": "JPEG abreviado (tablas DQT/DHT una sola vez)"
+    },
+    "chunktune": {
+        "type": "string",
+        "values": ("on", "off", "reset", "status"),
+        "priority": 2,  # NORMAL
+        "description": "Auto-tuning de tamaño de chunk"
+    },
+    "slices": {
+        "type": "int",
+        "range": (0, 1),
+        "priority": 2,  # NORMAL
+        "description": "Chunks alineados a marcadores RSTn (visualización por franjas)"
+    },
+    "delta": {
+        "type": "string",
+        "priority": 2,  # NORMAL
+        "description": "Frames delta: on/off/key/period:N/threshold:N/status"
+    },
+    "preview": {
+        "type": "string",
+        "priority": 2,  # NORMAL
+        "description": "Vista previa 1/8: on/off/only/raw/jpeg/interval:N/status"
+    },
+    "snapshot": {
+        "type": "string",
+        "priority": 2,  # NORMAL
+        "description": "Snapshot en alta resolución: now/interval:N/res:N/quality:N/status"
+    },
+    "event": {
+        "type": "string",
+        "priority": 2,  # NORMAL
+        "description": "Historial pre-evento: on/off/trigger[:s]/motion:0|1/threshold:N/budget:KB/status"
+    },
+    "record": {
+        "type": "string",
+        "values": ("off", "continuous", "disconnected", "status"),
+        "priority": 2,  # NORMAL
+        "description": "Grabación local AVI/MJPEG (disconnected = solo huecos, con backfill)"
+    },
+    "recbench": {
+        "type": "string",
+        "priority": 2,  # NORMAL
+        "description": "Benchmark de escritura sostenida por resolución"
+    },
+    "roi": {
+        "type": "string",
+        "priority": 1,  # HIGH
+        "description": "Zoom por ventana del sensor: x,y,w,h[,outW,outH] (píxeles del array 2048x1536) | off | status"
+    },
+    "preset": {
+        "type": "string",
+        "priority": 1,  # HIGH
+        "description": "Presets en NVS: list/save:N/apply:N/delete:N/boot:N|none (apply queda como preset de arranque)"
+    },
+    "profile": {
+        "type": "string",
+        "priority": 2,  # NORMAL
+        "description": "Perfiles de streaming: list/use:P/new:N[,base]/set:P,campo=valor,.../reset:P"
+    },
+    "bwcap": {
+        "type": "string",
+        "priority": 1,  # HIGH
+        "description": "Tope de ancho de banda (token bucket sobre todo lo enviado): KB/s[,ráfaga KB], off o status"
+    },
+    "pace": {
+        "type": "string",
+        "priority": 2,  # NORMAL
+        "description": "Pacing de chunks: burst (ráfaga) o spread[,%] (repartido sobre el intervalo de frame); status = métricas de ráfaga"
+    },
+    "sensorbench": {
+        "type": "string",
+        "values": ("all", "current", "apply", "all:apply", "status"),
+        "priority": 2,  # NORMAL
+        "description": "Tasa real de captura por resolución × XCLK × buffers × modo (apply guarda la más rápida estable)"
     }
 }
 
@@ -115,10 +200,52 @@ MAX_FRAME_SIZE = 5 * 1024 * 1024  # 5MB
 WS_PING_INTERVAL = 20
 WS_PING_TIMEOUT = 10
 
+# === SESIONES DE CÁMARA ===
+SESSION_TTL = 300  # segundos - Una cámara desconectada más tiempo se registra de nuevo
+
 # === CHUNKING TIMEOUTS ===
 CHUNK_TIMEOUT = 10  # segundos - Para completar una imagen chunked
 CHUNK_CLEANUP_INTERVAL = 30  # segundos - Limpiar buffers viejos
 
+# === INTEGRIDAD DE CHUNKS (CRC32 + NACK) ===
+CHUNK_MAGIC = 0xC5  # Debe coincidir con CHUNK_MAGIC en firmware/config.h
+CHUNK_HEADER_FORMAT = "<BBBBIIHHIHHHH"  # magic, headerLen, flags, reserved, frameId, offset, index, count, crc, rstFirst, rstCount, mcuRowStart, mcuRowEnd
+CHUNK_FLAG_RETRANSMIT = 0x01
+CHUNK_FLAG_SLICE = 0x02  # Chunk alineado a RSTn: decodificable por franjas
+
+# === REPOSICIÓN CONDICIONAL (frames delta) ===
+DELTA_MAGIC = 0xD3  # Debe coincidir con DELTA_MAGIC en firmware/config.h
+DELTA_HEADER_FORMAT = "<BBHIHH"  # magic, headerLen, intervals, seq, runs, reserved
+DELTA_RUN_FORMAT = "<HHI"  # first, count, length
+
+# === VISTA PREVIA 1/8 (substream de baja tasa) ===
+PREVIEW_MAGIC = 0xA7  # Debe coincidir con PREVIEW_MAGIC en firmware/config.h
+PREVIEW_HEADER_FORMAT = "<BBBBHHI"  # magic, headerLen, format, reserved, width, height, seq
+PREVIEW_FORMAT_RAW = 0  # Gris 8 bits
+PREVIEW_FORMAT_JPEG = 1
+
+# === RENDERIZADO PROGRESIVO (chunks por franjas) ===
+PROGRESSIVE_MIN_INTERVAL = 0.15  # segundos mínimos entre frames parciales a navegadores
+NACK_MAX_INDICES = 64  # Índices máximos por NACK (igual que el firmware)
+
+# === PROBE SINK (comando probe) ===
+PROBE_MAGIC = 0xB7  # Debe coincidir con PROBE_MAGIC en firmware/config.h
+PROBE_HEADER_FORMAT = "<BBHII"  # magic, step, reserved, probeId, seq
+
+# === COMANDOS BINARIOS Y LOTES ATÓMICOS ===
+CMD_MAGIC = 0xCB  # Debe coincidir con CMD_MAGIC en firmware/config.h
+CMD_HEADER_FORMAT = "<BBH"  # magic, count, batchId
+CMD_ENTRY_FORMAT = "<IB"  # hash FNV-1a del nombre, longitud del valor
+CMD_BATCH_MAX = 16  # Ajustes máximos por lote (igual que el firmware)
+BINARY_COMMANDS = True  # False = enviar los comandos como JSON
+BATCH_COMMANDS = (
+    "resolution", "quality", "fps", "mode", "brightness", "contrast",
+    "exposure", "gain", "whitebalance", "hmirror", "vflip",
+)
+
+# === SELECCIÓN AUTOMÁTICA DE MODO (mode auto) ===
+MODE_SWITCH_HISTORY = 20  # Cambios de modo recientes guardados en las estadísticas
+
 # === PRIORITY LEVELS ===
 PRIORITY_CRITICAL = 0  # Reboot, emergencias
 PRIORITY_HIGH = 1      # Resolución, FPS, modo
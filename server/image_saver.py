@@ -163,17 +163,18 @@ class ImageSaver:
 
             return self.image_counter[path_str]
 
-    def save_image(self, image_data: bytes) -> Optional[Path]:
+    def save_image(self, image_data: bytes, force: bool = False) -> Optional[Path]:
         """
         Guarda una imagen con nombre secuencial en directorio por hora
 
         Args:
             image_data: Bytes de la imagen JPEG
+            force: Guardar aunque el guardado esté desactivado (snapshots)
 
         Returns:
             Path de la imagen guardada o None
         """
-        if not self.enabled or not image_data:
+        if not (self.enabled or force) or not image_data:
             return None
 
         try:
@@ -203,6 +204,34 @@ class ImageSaver:
             traceback.print_exc()
             return None
 
+    def new_event_dir(self, kind: str, event_id) -> Path:
+        """Carpeta para los frames de una ventana pre-evento o de un backfill"""
+        stamp = datetime.now().strftime("%Y-%m-%d_%H-%M-%S")
+        folder = "events" if kind == "event" else "backfill"
+        path = IMAGES_DIR / folder / f"{stamp}_{kind}{event_id}"
+        path.mkdir(parents=True, exist_ok=True)
+        return path
+
+    def save_event_frame(
+        self, event_dir: Path, filename: str, image_data: bytes
+    ) -> Optional[Path]:
+        """
+        Guarda un frame de evento o de backfill (siempre, sin depender de enabled)
+
+        Args:
+            event_dir: Carpeta creada con new_event_dir
+            filename: Nombre del frame dentro de la carpeta
+            image_data: Bytes de la imagen JPEG
+        """
+        try:
+            filepath = event_dir / filename
+            with open(filepath, "wb") as f:
+                f.write(image_data)
+            return filepath
+        except Exception as e:
+            logger.error(f"❌ Error guardando frame de evento: {e}")
+            return None
+
     def toggle_saving(self, enabled: bool = None):
         """Activa/desactiva el guardado de imágenes"""
         if enabled is None:
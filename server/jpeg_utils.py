@@ -0,0 +1,99 @@
+"""
+Utilidades JPEG del lado receptor
+Reconstitución de JPEG abreviados (tablas DQT/DHT enviadas una sola vez)
+y división en intervalos RSTn para el modo delta
+"""
+
+import re
+from typing import List, Optional, Tuple
+
+# Marcadores relevantes
+SOI = 0xD8
+EOI = 0xD9
+SOS = 0xDA
+DQT = 0xDB
+DHT = 0xC4
+DRI = 0xDD
+TABLE_MARKERS = (DQT, DHT)
+SOF_MARKERS = tuple(m for m in range(0xC0, 0xD0) if m not in (0xC4, 0xC8, 0xCC))
+
+# En datos entrópicos un 0xFF literal va seguido de 0x00: FFD0-FFD7 solo son RSTn
+RST_PATTERN = re.compile(rb"\xff[\xd0-\xd7]")
+
+
+def parse_segments(data: bytes) -> List[Tuple[int, int, int]]:
+    """Devuelve (marcador, offset, longitud_total) de cada segmento hasta el SOS"""
+    segments = []
+    if len(data) < 4 or data[0] != 0xFF or data[1] != SOI:
+        return segments
+
+    i = 2
+    while i + 4 <= len(data):
+        if data[i] != 0xFF:
+            break
+        marker = data[i + 1]
+        if marker == 0xFF:  # Relleno
+            i += 1
+            continue
+        if marker == EOI:
+            break
+        seg_len = (data[i + 2] << 8) | data[i + 3]
+        segments.append((marker, i, seg_len + 2))
+        if marker == SOS:
+            break
+        i += 2 + seg_len
+
+    return segments
+
+
+def has_tables(data: bytes) -> bool:
+    """True si el JPEG trae sus tablas de cuantización"""
+    return any(m == DQT for m, _, _ in parse_segments(data))
+
+
+def is_tables_only(data: bytes) -> bool:
+    """JPEG abreviado de solo tablas: DQT/DHT sin SOS"""
+    segments = parse_segments(data)
+    return bool(segments) and all(m in TABLE_MARKERS for m, _, _ in segments)
+
+
+def extract_tables(data: bytes) -> bytes:
+    """Concatena los segmentos DQT/DHT de un JPEG"""
+    return b"".join(
+        data[off : off + length]
+        for m, off, length in parse_segments(data)
+        if m in TABLE_MARKERS
+    )
+
+
+def reconstitute(data: bytes, tables: Optional[bytes]) -> bytes:
+    """Reconstruye un JPEG estándar insertando las tablas antes del SOF"""
+    if not tables or has_tables(data):
+        return data
+
+    for marker, offset, _ in parse_segments(data):
+        if marker in SOF_MARKERS:
+            return data[:offset] + tables + data[offset:]
+
+    return data
+
+
+def split_restart_intervals(data: bytes) -> Optional[Tuple[bytes, List[bytes]]]:
+    """Divide un JPEG con DRI en (cabecera, intervalos). Cada intervalo incluye
+    su RSTn final; el último termina antes del EOI (igual que el firmware)"""
+    segments = parse_segments(data)
+    if not segments or segments[-1][0] != SOS or not any(m == DRI for m, _, _ in segments):
+        return None
+
+    _, sos_offset, sos_length = segments[-1]
+    scan = sos_offset + sos_length
+    end = len(data) - 2 if data.endswith(b"\xff\xd9") else len(data)
+
+    bounds = [scan] + [m.end() for m in RST_PATTERN.finditer(data, scan, end)] + [end]
+    intervals = [data[bounds[k] : bounds[k + 1]] for k in range(len(bounds) - 1)]
+    return data[:scan], intervals
+
+
+def join_restart_intervals(header: bytes, intervals: List[bytes]) -> bytes:
+    """Inverso de split_restart_intervals"""
+    return header + b"".join(intervals) + b"\xff\xd9"
@@ -168,7 +168,8 @@ export class CameraControls {
     // Mode
     if (this.elements.cameraMode) {
       this.elements.cameraMode.addEventListener("change", (e) => {
-        this.sendCommand("mode", parseInt(e.target.value));
+        const value = e.target.value;
+        this.sendCommand("mode", value === "auto" ? value : parseInt(value));
         this.updateModeHint();
       });
     }
@@ -411,10 +412,15 @@ export class CameraControls {
   updateModeHint() {
     if (!this.elements.cameraMode || !this.elements.modeHintText) return;
 
-    const mode = parseInt(this.elements.cameraMode.value);
+    const value = this.elements.cameraMode.value;
+    const mode = value === "auto" ? value : parseInt(value);
     const hints = {
       0: "Prioriza velocidad y baja latencia. Ideal para control en tiempo real.",
       1: "Balance entre velocidad y calidad. Recomendado para uso general.",
+      2: "Sin pausas y siempre el frame más reciente. Limita la calidad JPEG (12-40).",
+      3: "Calidad JPEG alta (5-12) con transferencias de estabilidad.",
+      4: "Tasa limitada a 64 KB/s y calidad baja para conexiones con cuota.",
+      auto: "Alterna entre velocidad y estabilidad según los fallos y la variabilidad de las transferencias.",
     };
 
     this.elements.modeHintText.textContent = hints[mode] || "";
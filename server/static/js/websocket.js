@@ -8,6 +8,7 @@ export class WebSocketManager {
     this.ws = null;
     this.cameraConnected = false;
     this.frameCount = 0;
+    this.partialFrame = false;
     this.lastFrameTime = Date.now();
     this.reconnectTimeout = null;
     this.messageHandlers = new Map();
@@ -115,10 +116,12 @@ export class WebSocketManager {
         if (DEBUG) console.log("✓ WebSocket conectado");
         this.updateConnectionStatus("connecting", "CONECTANDO...");
 
-        // Registrarse como navegador
+        // Registrarse como navegador (?stream=preview = solo vista previa 1/8)
+        const stream = new URLSearchParams(window.location.search).get("stream");
         this.send({
           type: "register",
           device: "browser",
+          stream: stream === "preview" ? "preview" : "full",
           timestamp: Date.now(),
         });
 
@@ -232,8 +235,12 @@ export class WebSocketManager {
       this.updateConnectionStatus("connected", "CÁMARA CONECTADA");
     }
 
-    // Incrementar contador de frames
-    this.frameCount++;
+    // Incrementar contador de frames (los parciales por franjas no cuentan)
+    if (this.partialFrame) {
+      this.partialFrame = false;
+    } else {
+      this.frameCount++;
+    }
   }
 
   handleMessage(data) {
@@ -249,6 +256,10 @@ export class WebSocketManager {
       case "server_stats":
         this.emit("server_stats", data.data);
         break;
+      case "frame_partial":
+        // El siguiente binario es un frame parcial (franjas recibidas hasta ahora)
+        this.partialFrame = true;
+        break;
       default:
         if (DEBUG) console.log("Mensaje no manejado:", data.type);
     }